@@ -0,0 +1,113 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements a simple counter of heap allocations used by the benchmarks.
+***********************************************************************************************************************/
+
+#include <cstddef>
+#include <cstdlib>
+
+#include "allocation_counter.h"
+
+/**
+ * Flag indicating that allocations made by this thread are being counted.
+ */
+static thread_local bool counting = false;
+
+/**
+ * The number of allocations counted.
+ */
+static thread_local unsigned long allocationCount = 0;
+
+/**
+ * The number of bytes requested by the counted allocations.
+ */
+static thread_local unsigned long long allocationBytes = 0;
+
+#if (defined(__GLIBC__))
+
+    extern "C" {
+        void* __libc_malloc(std::size_t size);
+        void* __libc_calloc(std::size_t count, std::size_t size);
+        void* __libc_realloc(void* pointer, std::size_t size);
+
+        // Definitions in the executable take precedence over the C library, including for calls made by Qt.  The
+        // default operator new calls malloc so C++ allocations are counted as well.
+
+        void* malloc(std::size_t size) {
+            AllocationCounter::record(size);
+            return __libc_malloc(size);
+        }
+
+
+        void* calloc(std::size_t count, std::size_t size) {
+            AllocationCounter::record(count * size);
+            return __libc_calloc(count, size);
+        }
+
+
+        void* realloc(void* pointer, std::size_t size) {
+            AllocationCounter::record(size);
+            return __libc_realloc(pointer, size);
+        }
+    }
+
+#endif
+
+bool AllocationCounter::supported() {
+    #if (defined(__GLIBC__))
+
+        return true;
+
+    #else
+
+        return false;
+
+    #endif
+}
+
+
+void AllocationCounter::start() {
+    allocationCount = 0;
+    allocationBytes = 0;
+    counting        = true;
+}
+
+
+void AllocationCounter::stop() {
+    counting = false;
+}
+
+
+unsigned long AllocationCounter::allocations() {
+    return allocationCount;
+}
+
+
+unsigned long long AllocationCounter::bytes() {
+    return allocationBytes;
+}
+
+
+void AllocationCounter::record(std::size_t size) {
+    if (counting) {
+        ++allocationCount;
+        allocationBytes += size;
+    }
+}
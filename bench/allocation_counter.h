@@ -0,0 +1,76 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines a simple counter of heap allocations used by the benchmarks.
+***********************************************************************************************************************/
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+/**
+ * Class that counts heap allocations made by the calling thread between calls to \ref AllocationCounter::start and
+ * \ref AllocationCounter::stop.  Allocations are counted by interposing malloc, calloc, and realloc, so allocations
+ * made inside Qt are counted along with allocations made by the benchmark itself.  Interposition is only available
+ * with the GNU C library.
+ */
+class AllocationCounter {
+    public:
+        /**
+         * Method you can use to determine if allocations can be counted on this platform.
+         *
+         * \return Returns true if allocations are counted.  Returns false if the counts are always zero.
+         */
+        static bool supported();
+
+        /**
+         * Method that clears the counts and starts counting allocations made by the calling thread.
+         */
+        static void start();
+
+        /**
+         * Method that stops counting allocations.
+         */
+        static void stop();
+
+        /**
+         * Method you can use to obtain the number of allocations counted.  A reallocation is counted as an
+         * allocation.
+         *
+         * \return Returns the number of allocations.
+         */
+        static unsigned long allocations();
+
+        /**
+         * Method you can use to obtain the number of bytes requested by the counted allocations.
+         *
+         * \return Returns the number of bytes requested.
+         */
+        static unsigned long long bytes();
+
+        /**
+         * Method that is called by the allocation functions to record a single allocation.
+         *
+         * \param[in] size The number of bytes requested.
+         */
+        static void record(std::size_t size);
+};
+
+#endif
@@ -0,0 +1,140 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements benchmarks for the \ref Wh::Compressor class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QString>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <wh_envelope_writer.h>
+#include <wh_compressor.h>
+
+#include "bench_compressor.h"
+
+BenchCompressor::BenchCompressor() {}
+
+
+BenchCompressor::~BenchCompressor() {}
+
+
+void BenchCompressor::initTestCase() {}
+
+
+void BenchCompressor::benchmarkCompress_data() {
+    static const unsigned sizes[]  = { 1024, 16384, 262144 };
+    static const int      levels[] = { 1, 6, 9 };
+
+    QTest::addColumn<unsigned>("payloadSize");
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("level");
+
+    for (unsigned size : sizes) {
+        for (int level : levels) {
+            QString deflateRow = QString("deflate %1 B level %2").arg(size).arg(level);
+            QString gzipRow    = QString("gzip %1 B level %2").arg(size).arg(level);
+
+            QTest::newRow(deflateRow.toUtf8().constData())
+                << size << static_cast<int>(Wh::Compressor::Format::DEFLATE) << level;
+            QTest::newRow(gzipRow.toUtf8().constData())
+                << size << static_cast<int>(Wh::Compressor::Format::GZIP) << level;
+        }
+    }
+}
+
+
+void BenchCompressor::benchmarkCompress() {
+    QFETCH(unsigned, payloadSize);
+    QFETCH(int, format);
+    QFETCH(int, level);
+
+    QByteArray data = envelope(payloadSize);
+    QByteArray compressed;
+
+    QBENCHMARK {
+        compressed = Wh::Compressor::compress(data, static_cast<Wh::Compressor::Format>(format), level);
+    }
+
+    QVERIFY(!compressed.isEmpty());
+}
+
+
+void BenchCompressor::reportSavings() {
+    static const unsigned sizes[]       = { 256, 1024, 4096, 16384, 65536, 262144 };
+    static const int      levels[]      = { 1, 6, 9 };
+    static const unsigned minimumRounds = 20;
+
+    for (unsigned size : sizes) {
+        QByteArray data = envelope(size);
+
+        for (int level : levels) {
+            QElapsedTimer timer;
+            unsigned      rounds = 0;
+            QByteArray    compressed;
+
+            timer.start();
+            while (rounds < minimumRounds || timer.elapsed() < 100) {
+                compressed = Wh::Compressor::compress(data, Wh::Compressor::Format::GZIP, level);
+                ++rounds;
+            }
+
+            double microseconds = static_cast<double>(timer.nsecsElapsed()) / (1000.0 * rounds);
+            long   saved        = static_cast<long>(data.size()) - static_cast<long>(compressed.size());
+
+            qDebug() << "payload" << size << "bytes, envelope" << data.size() << "bytes, gzip level" << level << ":"
+                     << compressed.size() << "bytes on the wire," << saved << "bytes saved,"
+                     << microseconds << "us per envelope,"
+                     << (microseconds > 0 ? saved / microseconds : 0.0) << "bytes saved per us";
+        }
+    }
+}
+
+
+void BenchCompressor::cleanupTestCase() {}
+
+
+QByteArray BenchCompressor::envelope(unsigned payloadSize) {
+    // Typical diagnostics traffic: many small records with repeated keys and slowly changing values.
+    QByteArray payload("[");
+    unsigned   index = 0;
+
+    while (static_cast<unsigned>(payload.size()) < payloadSize) {
+        QJsonObject record;
+        record.insert(QString("timestamp"), 1700000000000.0 + 250.0 * index);
+        record.insert(QString("subsystem"), QString(index % 3 == 0 ? "network" : "storage"));
+        record.insert(QString("level"), QString(index % 7 == 0 ? "warning" : "info"));
+        record.insert(QString("latency_ms"), 10.0 + (index * 37 % 101) / 10.0);
+        record.insert(QString("queue_depth"), static_cast<int>(index * 13 % 64));
+
+        if (index > 0) {
+            payload.append(',');
+        }
+
+        payload.append(QJsonDocument(record).toJson(QJsonDocument::JsonFormat::Compact));
+        ++index;
+    }
+
+    return Wh::EnvelopeWriter::write(payload.left(static_cast<int>(payloadSize)), QByteArray(32, '\x5A'));
+}
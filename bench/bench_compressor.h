@@ -0,0 +1,51 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header provides benchmarks for the \ref Wh::Compressor class.
+***********************************************************************************************************************/
+
+#ifndef BENCH_COMPRESSOR_H
+#define BENCH_COMPRESSOR_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class BenchCompressor:public QObject {
+    Q_OBJECT
+
+    public:
+        BenchCompressor();
+
+        ~BenchCompressor() override;
+
+    private slots:
+        void initTestCase();
+
+        void benchmarkCompress_data();
+        void benchmarkCompress();
+
+        void reportSavings();
+
+        void cleanupTestCase();
+
+    private:
+        static QByteArray envelope(unsigned payloadSize);
+};
+
+#endif
@@ -0,0 +1,201 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements benchmarks for the \ref Wh::EnvelopeWriter class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QString>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <wh_envelope_writer.h>
+
+#include "allocation_counter.h"
+#include "bench_envelope_writer.h"
+
+const QByteArray BenchEnvelopeWriter::hash(32, '\x5A');
+
+BenchEnvelopeWriter::BenchEnvelopeWriter() {}
+
+
+BenchEnvelopeWriter::~BenchEnvelopeWriter() {}
+
+
+void BenchEnvelopeWriter::initTestCase() {}
+
+
+void BenchEnvelopeWriter::testIdenticalOutput_data() {
+    payloadSizes();
+}
+
+
+void BenchEnvelopeWriter::testIdenticalOutput() {
+    QFETCH(unsigned, payloadSize);
+
+    for (unsigned size=payloadSize ; size<payloadSize+3 ; ++size) {
+        QByteArray data = payload(size);
+        QCOMPARE(Wh::EnvelopeWriter::write(data, hash), jsonObjectEnvelope(data, hash));
+    }
+}
+
+
+void BenchEnvelopeWriter::benchmarkJsonObjectEnvelope_data() {
+    payloadSizes();
+}
+
+
+void BenchEnvelopeWriter::benchmarkJsonObjectEnvelope() {
+    QFETCH(unsigned, payloadSize);
+
+    QByteArray data = payload(payloadSize);
+    QByteArray envelope;
+
+    QBENCHMARK {
+        envelope = jsonObjectEnvelope(data, hash);
+    }
+
+    QVERIFY(!envelope.isEmpty());
+}
+
+
+void BenchEnvelopeWriter::benchmarkEnvelopeWriter_data() {
+    payloadSizes();
+}
+
+
+void BenchEnvelopeWriter::benchmarkEnvelopeWriter() {
+    QFETCH(unsigned, payloadSize);
+
+    QByteArray data = payload(payloadSize);
+    QByteArray envelope;
+
+    QBENCHMARK {
+        envelope = Wh::EnvelopeWriter::write(data, hash);
+    }
+
+    QVERIFY(!envelope.isEmpty());
+}
+
+
+void BenchEnvelopeWriter::benchmarkCborEnvelope_data() {
+    payloadSizes();
+}
+
+
+void BenchEnvelopeWriter::benchmarkCborEnvelope() {
+    QFETCH(unsigned, payloadSize);
+
+    QByteArray data = payload(payloadSize);
+    QByteArray envelope;
+
+    QBENCHMARK {
+        envelope = Wh::EnvelopeWriter::writeCbor(data, hash);
+    }
+
+    QVERIFY(!envelope.isEmpty());
+}
+
+
+void BenchEnvelopeWriter::reportAllocations() {
+    static const unsigned sizes[] = { 64, 1024, 16384, 262144, 4194304 };
+
+    if (!AllocationCounter::supported()) {
+        QSKIP("Allocations can not be counted on this platform.");
+    }
+
+    for (unsigned size : sizes) {
+        QByteArray data = payload(size);
+
+        AllocationCounter::start();
+        QByteArray jsonEnvelope = jsonObjectEnvelope(data, hash);
+        AllocationCounter::stop();
+
+        unsigned long      jsonAllocations = AllocationCounter::allocations();
+        unsigned long long jsonBytes       = AllocationCounter::bytes();
+
+        AllocationCounter::start();
+        QByteArray writerEnvelope = Wh::EnvelopeWriter::write(data, hash);
+        AllocationCounter::stop();
+
+        unsigned long      writerAllocations = AllocationCounter::allocations();
+        unsigned long long writerBytes       = AllocationCounter::bytes();
+
+        AllocationCounter::start();
+        QByteArray cborEnvelope = Wh::EnvelopeWriter::writeCbor(data, hash);
+        AllocationCounter::stop();
+
+        unsigned long      cborAllocations = AllocationCounter::allocations();
+        unsigned long long cborBytes       = AllocationCounter::bytes();
+
+        QCOMPARE(writerEnvelope, jsonEnvelope);
+        QVERIFY(!cborEnvelope.isEmpty());
+
+        qDebug() << "payload" << size << "bytes:"
+                 << "QJsonObject envelope" << jsonAllocations << "allocations," << jsonBytes << "bytes;"
+                 << "EnvelopeWriter" << writerAllocations << "allocations," << writerBytes << "bytes;"
+                 << "CBOR envelope" << cborAllocations << "allocations," << cborBytes << "bytes";
+    }
+}
+
+
+void BenchEnvelopeWriter::cleanupTestCase() {}
+
+
+void BenchEnvelopeWriter::payloadSizes() {
+    QTest::addColumn<unsigned>("payloadSize");
+
+    QTest::newRow("64 B") << 64U;
+    QTest::newRow("1 kB") << 1024U;
+    QTest::newRow("16 kB") << 16384U;
+    QTest::newRow("256 kB") << 262144U;
+    QTest::newRow("4 MB") << 4194304U;
+}
+
+
+QByteArray BenchEnvelopeWriter::payload(unsigned size) {
+    QByteArray result(static_cast<int>(size), Qt::Uninitialized);
+
+    unsigned v = 0x12345678;
+    for (unsigned i=0 ; i<size ; ++i) {
+        v = v * 1103515245 + 12345;
+        result[i] = static_cast<char>(v >> 24);
+    }
+
+    return result;
+}
+
+
+QByteArray BenchEnvelopeWriter::jsonObjectEnvelope(const QByteArray& data, const QByteArray& hash) {
+    // This mirrors the envelope construction previously used by Wh::WebHook::doSend.
+    QByteArray encodedData = data.toBase64();
+    QString    dataString  = QString::fromLatin1(encodedData);
+    QByteArray encodedHash = hash.toBase64();
+    QString    hashString  = QString::fromLatin1(encodedHash);
+
+    QJsonObject json;
+    json.insert(QString("data"), dataString);
+    json.insert(QString("hash"), hashString);
+    QByteArray result = QJsonDocument(json).toJson(QJsonDocument::JsonFormat::Compact);
+
+    return result;
+}
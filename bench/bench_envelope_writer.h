@@ -0,0 +1,66 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header provides benchmarks for the \ref Wh::EnvelopeWriter class.
+***********************************************************************************************************************/
+
+#ifndef BENCH_ENVELOPE_WRITER_H
+#define BENCH_ENVELOPE_WRITER_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class BenchEnvelopeWriter:public QObject {
+    Q_OBJECT
+
+    public:
+        BenchEnvelopeWriter();
+
+        ~BenchEnvelopeWriter() override;
+
+    private slots:
+        void initTestCase();
+
+        void testIdenticalOutput_data();
+        void testIdenticalOutput();
+
+        void benchmarkJsonObjectEnvelope_data();
+        void benchmarkJsonObjectEnvelope();
+
+        void benchmarkEnvelopeWriter_data();
+        void benchmarkEnvelopeWriter();
+
+        void benchmarkCborEnvelope_data();
+        void benchmarkCborEnvelope();
+
+        void reportAllocations();
+
+        void cleanupTestCase();
+
+    private:
+        static void payloadSizes();
+
+        static QByteArray payload(unsigned size);
+
+        static QByteArray jsonObjectEnvelope(const QByteArray& data, const QByteArray& hash);
+
+        static const QByteArray hash;
+};
+
+#endif
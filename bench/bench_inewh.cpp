@@ -0,0 +1,44 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file is the main entry point for the inewh benchmarks.
+***********************************************************************************************************************/
+
+#include <QDebug>
+
+#include "application_wrapper.h"
+
+#include "bench_envelope_writer.h"
+#include "bench_compressor.h"
+#include "bench_spool.h"
+#include "bench_signing.h"
+#include "bench_web_hook.h"
+
+int main(int argumentCount, char** argumentValues) {
+    ApplicationWrapper wrapper(argumentCount, argumentValues);
+
+    wrapper.includeTest(new BenchEnvelopeWriter);
+    wrapper.includeTest(new BenchCompressor);
+    wrapper.includeTest(new BenchSpool);
+    wrapper.includeTest(new BenchSigning);
+    wrapper.includeTest(new BenchWebHook);
+    int status = wrapper.exec();
+
+    return status;
+}
@@ -0,0 +1,179 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements benchmarks for message signing.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QBuffer>
+
+#include <crypto_hmac.h>
+
+#include <wh_envelope_writer.h>
+#include <wh_envelope_stream.h>
+#include <wh_signing_key_cache.h>
+
+#include "bench_signing.h"
+
+const QByteArray BenchSigning::secret("0123456789ABCDEF0123456789ABCDEF");
+const long long  BenchSigning::minute = 27000000;
+
+BenchSigning::BenchSigning() {}
+
+
+BenchSigning::~BenchSigning() {}
+
+
+void BenchSigning::initTestCase() {}
+
+
+void BenchSigning::benchmarkDeriveKey() {
+    QByteArray key;
+
+    QBENCHMARK {
+        key = Wh::SigningKeyCache::deriveKey(secret, minute);
+    }
+
+    QVERIFY(!key.isEmpty());
+}
+
+
+void BenchSigning::benchmarkUncachedSign_data() {
+    payloadSizes();
+}
+
+
+void BenchSigning::benchmarkUncachedSign() {
+    QFETCH(unsigned, payloadSize);
+
+    QByteArray data = payload(payloadSize);
+    QByteArray hash;
+
+    // This mirrors the signing previously done by Wh::WebHook::doSend, deriving the key for every message.
+    QBENCHMARK {
+        QByteArray key = Wh::SigningKeyCache::deriveKey(secret, minute);
+
+        Crypto::Hmac hmac(key);
+        hmac.addData(data);
+        hash = hmac.digest();
+    }
+
+    QCOMPARE(hash.size(), static_cast<int>(Wh::SigningKeyCache::signatureLength));
+}
+
+
+void BenchSigning::benchmarkCachedSign_data() {
+    payloadSizes();
+}
+
+
+void BenchSigning::benchmarkCachedSign() {
+    QFETCH(unsigned, payloadSize);
+
+    Wh::SigningKeyCache signingKeys;
+    QByteArray          data = payload(payloadSize);
+    QByteArray          hash;
+
+    QBENCHMARK {
+        hash = signingKeys.sign(secret, minute, data);
+    }
+
+    QCOMPARE(hash.size(), static_cast<int>(Wh::SigningKeyCache::signatureLength));
+}
+
+
+void BenchSigning::benchmarkSignAndWrite_data() {
+    payloadSizes();
+}
+
+
+void BenchSigning::benchmarkSignAndWrite() {
+    QFETCH(unsigned, payloadSize);
+
+    Wh::SigningKeyCache signingKeys;
+    QByteArray          data = payload(payloadSize);
+    QByteArray          envelope;
+
+    QBENCHMARK {
+        envelope = Wh::EnvelopeWriter::write(data, signingKeys.sign(secret, minute, data));
+    }
+
+    QVERIFY(!envelope.isEmpty());
+}
+
+
+void BenchSigning::benchmarkStreamedEnvelope_data() {
+    payloadSizes();
+}
+
+
+void BenchSigning::benchmarkStreamedEnvelope() {
+    QFETCH(unsigned, payloadSize);
+
+    Wh::SigningKeyCache signingKeys;
+    QByteArray          data = payload(payloadSize);
+    QBuffer             buffer(&data);
+    buffer.open(QBuffer::OpenModeFlag::ReadOnly);
+
+    Wh::EnvelopeStream stream(&buffer, 0, data.size(), signingKeys, secret, minute);
+    QByteArray         piece(16384, Qt::Uninitialized);
+    qint64             total = 0;
+
+    QBENCHMARK {
+        stream.reset();
+
+        total = 0;
+        qint64 count;
+        do {
+            count  = stream.read(piece.data(), piece.size());
+            total += count;
+        } while (count > 0);
+    }
+
+    QCOMPARE(total, stream.size());
+}
+
+
+void BenchSigning::cleanupTestCase() {}
+
+
+void BenchSigning::payloadSizes() {
+    QTest::addColumn<unsigned>("payloadSize");
+
+    QTest::newRow("64 B") << 64U;
+    QTest::newRow("1 kB") << 1024U;
+    QTest::newRow("16 kB") << 16384U;
+    QTest::newRow("256 kB") << 262144U;
+    QTest::newRow("4 MB") << 4194304U;
+}
+
+
+QByteArray BenchSigning::payload(unsigned size) {
+    QByteArray result(static_cast<int>(size), Qt::Uninitialized);
+
+    unsigned v = 0x9E3779B9;
+    for (unsigned i=0 ; i<size ; ++i) {
+        v = v * 1103515245 + 12345;
+        result[i] = static_cast<char>(v >> 24);
+    }
+
+    return result;
+}
@@ -0,0 +1,65 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header provides benchmarks for message signing.
+***********************************************************************************************************************/
+
+#ifndef BENCH_SIGNING_H
+#define BENCH_SIGNING_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class BenchSigning:public QObject {
+    Q_OBJECT
+
+    public:
+        BenchSigning();
+
+        ~BenchSigning() override;
+
+    private slots:
+        void initTestCase();
+
+        void benchmarkDeriveKey();
+
+        void benchmarkUncachedSign_data();
+        void benchmarkUncachedSign();
+
+        void benchmarkCachedSign_data();
+        void benchmarkCachedSign();
+
+        void benchmarkSignAndWrite_data();
+        void benchmarkSignAndWrite();
+
+        void benchmarkStreamedEnvelope_data();
+        void benchmarkStreamedEnvelope();
+
+        void cleanupTestCase();
+
+    private:
+        static void payloadSizes();
+
+        static QByteArray payload(unsigned size);
+
+        static const QByteArray secret;
+        static const long long  minute;
+};
+
+#endif
@@ -0,0 +1,73 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements benchmarks for the \ref Wh::Spool class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QUrl>
+#include <QByteArray>
+#include <QList>
+
+#include <wh_spool.h>
+
+#include "bench_spool.h"
+
+BenchSpool::BenchSpool() {}
+
+
+BenchSpool::~BenchSpool() {}
+
+
+void BenchSpool::initTestCase() {}
+
+
+void BenchSpool::benchmarkAppend_data() {
+    QTest::addColumn<unsigned>("payloadSize");
+
+    QTest::newRow("64 B") << 64U;
+    QTest::newRow("1 kB") << 1024U;
+    QTest::newRow("16 kB") << 16384U;
+}
+
+
+void BenchSpool::benchmarkAppend() {
+    QFETCH(unsigned, payloadSize);
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    Wh::Spool                spool(directory.path());
+    QList<Wh::Spool::Record> pending;
+    QVERIFY(spool.open(pending));
+
+    QUrl       url("https://example.com/v2/test");
+    QByteArray payload(static_cast<int>(payloadSize), 'x');
+
+    QBENCHMARK {
+        unsigned long long recordId = spool.append(url, payload);
+        spool.acknowledge(recordId);
+    }
+}
+
+
+void BenchSpool::cleanupTestCase() {}
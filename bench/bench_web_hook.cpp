@@ -0,0 +1,223 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements end-to-end benchmarks for the \ref Wh::WebHook class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QString>
+#include <QUrl>
+#include <QJsonObject>
+#include <QEventLoop>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QNetworkAccessManager>
+
+#include <wh_web_hook.h>
+#include <wh_metrics.h>
+
+#include "stand_in_server.h"
+#include "bench_web_hook.h"
+
+const QByteArray BenchWebHook::secret("0123456789ABCDEF0123456789ABCDEF");
+
+BenchWebHook::BenchWebHook():server(secret, QByteArray()) {
+    networkAccessManager = Q_NULLPTR;
+}
+
+
+BenchWebHook::~BenchWebHook() {}
+
+
+void BenchWebHook::initTestCase() {
+    // The server checks every signature on its own thread so the benchmark also confirms every message is valid.
+    QVERIFY(server.start());
+    networkAccessManager = new QNetworkAccessManager(this);
+}
+
+
+void BenchWebHook::benchmarkThroughput_data() {
+    static const unsigned sizes[]    = { 64, 1024, 16384 };
+    static const unsigned inFlight[] = { 1, 6, 64 };
+
+    QTest::addColumn<unsigned>("payloadSize");
+    QTest::addColumn<unsigned>("maximumInFlight");
+    QTest::addColumn<bool>("batching");
+
+    for (unsigned size : sizes) {
+        for (unsigned limit : inFlight) {
+            QString row = QString("%1 B, %2 in flight").arg(size).arg(limit);
+            QTest::newRow(row.toUtf8().constData()) << size << limit << false;
+        }
+
+        QString row = QString("%1 B, batched").arg(size);
+        QTest::newRow(row.toUtf8().constData()) << size << 6U << true;
+    }
+}
+
+
+void BenchWebHook::benchmarkThroughput() {
+    QFETCH(unsigned, payloadSize);
+    QFETCH(unsigned, maximumInFlight);
+    QFETCH(bool, batching);
+
+    unsigned    messageCount = payloadSize > 4096 ? 1000 : 5000;
+    QJsonObject message      = payload(payloadSize);
+    QUrl        url          = server.url(QString("/v2/test"));
+
+    Wh::WebHook webHook(networkAccessManager, secret);
+    webHook.setMaximumInFlight(maximumInFlight);
+    webHook.setBatchingEnabled(batching);
+
+    // Warm the connection pool so the first handshake is not timed.
+    QVERIFY(sendAll(webHook, url, message, maximumInFlight));
+    webHook.setMetrics(QSharedPointer<Wh::Metrics>(new Wh::Metrics));
+
+    QElapsedTimer timer;
+    bool          success = false;
+
+    QBENCHMARK_ONCE {
+        timer.start();
+        success = sendAll(webHook, url, message, messageCount);
+    }
+
+    QVERIFY(success);
+    report("throughput", webHook, messageCount, timer.elapsed());
+}
+
+
+void BenchWebHook::benchmarkLatency_data() {
+    QTest::addColumn<unsigned>("payloadSize");
+
+    QTest::newRow("64 B") << 64U;
+    QTest::newRow("1 kB") << 1024U;
+    QTest::newRow("16 kB") << 16384U;
+    QTest::newRow("256 kB") << 262144U;
+}
+
+
+void BenchWebHook::benchmarkLatency() {
+    QFETCH(unsigned, payloadSize);
+
+    unsigned    messageCount = 500;
+    QJsonObject message      = payload(payloadSize);
+    QUrl        url          = server.url(QString("/v2/test"));
+
+    Wh::WebHook webHook(networkAccessManager, secret);
+    webHook.setMaximumInFlight(1);
+
+    QVERIFY(sendAll(webHook, url, message, 1));
+    webHook.setMetrics(QSharedPointer<Wh::Metrics>(new Wh::Metrics));
+
+    QElapsedTimer timer;
+    bool          success = false;
+
+    QBENCHMARK_ONCE {
+        timer.start();
+        success = sendAll(webHook, url, message, messageCount);
+    }
+
+    QVERIFY(success);
+    report("latency", webHook, messageCount, timer.elapsed());
+}
+
+
+void BenchWebHook::cleanupTestCase() {
+    delete networkAccessManager;
+    networkAccessManager = Q_NULLPTR;
+
+    server.stop();
+}
+
+
+QJsonObject BenchWebHook::payload(unsigned size) {
+    QJsonObject result;
+    result.insert(QString("data"), QString(static_cast<int>(size > 12 ? size - 12 : 0), QChar('x')));
+
+    return result;
+}
+
+
+void BenchWebHook::report(const char* label, Wh::WebHook& webHook, unsigned messageCount, qint64 elapsedMsec) {
+    Wh::Metrics::Snapshot     metrics   = webHook.metrics()->snapshot();
+    Wh::Metrics::Distribution delivery  = metrics.latency(Wh::Metrics::Latency::DELIVERY);
+    Wh::Metrics::Distribution roundTrip = metrics.latency(Wh::Metrics::Latency::ROUND_TRIP);
+    Wh::Metrics::Distribution signing   = metrics.latency(Wh::Metrics::Latency::SIGN);
+
+    double seconds = qMax(elapsedMsec, qint64(1)) / 1000.0;
+
+    qDebug() << label << ":"
+             << messageCount / seconds << "messages/s,"
+             << metrics.counter(Wh::Metrics::Counter::REQUESTS) << "requests;"
+             << "delivery p50" << delivery.percentile(50.0) << "us p99" << delivery.percentile(99.0) << "us;"
+             << "round trip p50" << roundTrip.percentile(50.0) << "us p99" << roundTrip.percentile(99.0) << "us;"
+             << "signing p50" << signing.percentile(50.0) << "us";
+}
+
+
+bool BenchWebHook::sendAll(Wh::WebHook& webHook, const QUrl& url, const QJsonObject& message, unsigned messageCount) {
+    unsigned   completed = 0;
+    unsigned   failures  = 0;
+    QEventLoop loop;
+
+    auto finished = [&completed, &loop, messageCount]() {
+        ++completed;
+        if (completed == messageCount) {
+            loop.quit();
+        }
+    };
+
+    QMetaObject::Connection delivered = QObject::connect(
+        &webHook,
+        &Wh::WebHook::messageDelivered,
+        &loop,
+        [&finished](unsigned long long, const QByteArray&) {
+            finished();
+        }
+    );
+
+    QMetaObject::Connection failed = QObject::connect(
+        &webHook,
+        &Wh::WebHook::messageFailed,
+        &loop,
+        [&finished, &failures](unsigned long long, int) {
+            ++failures;
+            finished();
+        }
+    );
+
+    for (unsigned i=0 ; i<messageCount ; ++i) {
+        webHook.send(url, message);
+    }
+
+    webHook.flush();
+
+    QTimer::singleShot(120000, &loop, &QEventLoop::quit);
+    if (completed < messageCount) {
+        loop.exec();
+    }
+
+    QObject::disconnect(delivered);
+    QObject::disconnect(failed);
+
+    return completed == messageCount && failures == 0;
+}
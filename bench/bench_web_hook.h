@@ -0,0 +1,71 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header provides end-to-end benchmarks for the \ref Wh::WebHook class.
+***********************************************************************************************************************/
+
+#ifndef BENCH_WEB_HOOK_H
+#define BENCH_WEB_HOOK_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "stand_in_server.h"
+
+class QUrl;
+class QJsonObject;
+class QNetworkAccessManager;
+
+namespace Wh {
+    class WebHook;
+}
+
+class BenchWebHook:public QObject {
+    Q_OBJECT
+
+    public:
+        BenchWebHook();
+
+        ~BenchWebHook() override;
+
+    private slots:
+        void initTestCase();
+
+        void benchmarkThroughput_data();
+        void benchmarkThroughput();
+
+        void benchmarkLatency_data();
+        void benchmarkLatency();
+
+        void cleanupTestCase();
+
+    private:
+        static QJsonObject payload(unsigned size);
+
+        static void report(const char* label, Wh::WebHook& webHook, unsigned messageCount, qint64 elapsedMsec);
+
+        static bool sendAll(Wh::WebHook& webHook, const QUrl& url, const QJsonObject& message, unsigned messageCount);
+
+        static const QByteArray secret;
+
+        StandInServer          server;
+        QNetworkAccessManager* networkAccessManager;
+};
+
+#endif
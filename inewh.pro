@@ -17,6 +17,8 @@
 ########################################################################################################################
 
 TEMPLATE = subdirs
-SUBDIRS = inewh test
+SUBDIRS = inewh test bench loadgen
 
 test.depends = inewh
+bench.depends = inewh
+loadgen.depends = inewh
@@ -0,0 +1,201 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::CircuitBreaker class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inewh */
+
+#ifndef WH_CIRCUIT_BREAKER_H
+#define WH_CIRCUIT_BREAKER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QHash>
+#include <QMutex>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that stops sending to a destination that is down.  Each destination URL has its own circuit:
+     *
+     *     * A circuit starts closed and every request is allowed.  The circuit opens after a run of consecutive
+     *       failures.  A failure is a request that got no HTTP response, for example a refused connection or a
+     *       transfer timeout, or that got a 5xx status.  Any other response shows the destination is up.
+     *
+     *     * While a circuit is open every request is refused so messages fail at once rather than waiting for a
+     *       timeout and a series of retries.
+     *
+     *     * Once the open duration has passed the circuit becomes half-open and a single probe request is allowed.
+     *       The circuit closes if the probe succeeds and opens again if it fails.  If no response to the probe
+     *       arrives within another open duration a new probe is allowed.
+     *
+     * Responses to requests sent before a circuit last opened or became half-open are ignored so that late responses
+     * from before the change can not close the circuit early or reopen it while a probe is outstanding.
+     *
+     * The circuits are shared by every webhook using the same instance and an instance can be shared by webhooks
+     * running on different threads.  Times are in microseconds on the \ref Metrics::now clock.
+     */
+    class WH_PUBLIC_API CircuitBreaker {
+        public:
+            /**
+             * Enumeration of circuit states.
+             */
+            enum class State {
+                /**
+                 * Indicates requests are allowed.
+                 */
+                CLOSED,
+
+                /**
+                 * Indicates requests are refused.
+                 */
+                OPEN,
+
+                /**
+                 * Indicates a single probe request is allowed to test the destination.
+                 */
+                HALF_OPEN
+            };
+
+            /**
+             * The default number of consecutive failures that open a circuit.
+             */
+            static constexpr unsigned defaultFailureThreshold = 5;
+
+            /**
+             * The default time a circuit stays open before a probe is allowed, in milliseconds.
+             */
+            static constexpr unsigned defaultOpenDuration = 30000;
+
+            /**
+             * Constructor
+             *
+             * \param[in] failureThreshold The number of consecutive failures that open a circuit.
+             *
+             * \param[in] openDuration     The time a circuit stays open before a probe is allowed, in milliseconds.
+             */
+            CircuitBreaker(
+                unsigned failureThreshold = defaultFailureThreshold,
+                unsigned openDuration     = defaultOpenDuration
+            );
+
+            ~CircuitBreaker();
+
+            /**
+             * Method you can use to set the number of consecutive failures that open a circuit.
+             *
+             * \param[in] newFailureThreshold The new failure threshold.  A value of 0 is treated as 1.
+             */
+            void setFailureThreshold(unsigned newFailureThreshold);
+
+            /**
+             * Method you can use to obtain the number of consecutive failures that open a circuit.
+             *
+             * \return Returns the failure threshold.
+             */
+            unsigned failureThreshold() const;
+
+            /**
+             * Method you can use to set the time a circuit stays open before a probe is allowed.
+             *
+             * \param[in] newOpenDuration The new open duration, in milliseconds.
+             */
+            void setOpenDuration(unsigned newOpenDuration);
+
+            /**
+             * Method you can use to obtain the time a circuit stays open before a probe is allowed.
+             *
+             * \return Returns the open duration, in milliseconds.
+             */
+            unsigned openDuration() const;
+
+            /**
+             * Method that is called before a request is sent to a destination.
+             *
+             * \param[in] destination The destination URL.
+             *
+             * \param[in] now         The current time, in microseconds.
+             *
+             * \return Returns true if the request can be sent.  Returns false if the request should be refused.
+             */
+            bool allow(const QString& destination, long long now);
+
+            /**
+             * Method that is called for every response, including the responses to retries.
+             *
+             * \param[in] destination The destination URL.
+             *
+             * \param[in] success     If true, the destination responded.  If false, the request failed in a way that
+             *                        indicates the destination is down.
+             *
+             * \param[in] sendTime    The time the request was sent, in microseconds.
+             *
+             * \param[in] now         The current time, in microseconds.
+             */
+            void record(const QString& destination, bool success, long long sendTime, long long now);
+
+            /**
+             * Method you can use to obtain the state of a destination's circuit.  An open circuit is reported as open
+             * until a request is made after the open duration has passed.
+             *
+             * \param[in] destination The destination URL.
+             *
+             * \return Returns the circuit state.
+             */
+            State state(const QString& destination) const;
+
+            /**
+             * Method you can use to close a destination's circuit, for example once you know an outage has ended.
+             *
+             * \param[in] destination The destination URL.
+             */
+            void reset(const QString& destination);
+
+        private:
+            /**
+             * Class that holds the circuit for one destination.
+             */
+            class Destination;
+
+            /**
+             * Mutex used to guard the settings and the destination table.
+             */
+            mutable QMutex mutex;
+
+            /**
+             * The circuits of destinations that have recently failed, keyed by destination URL.  Destinations that
+             * are not listed have a closed circuit.
+             */
+            QHash<QString, Destination*> destinations;
+
+            /**
+             * The number of consecutive failures that open a circuit.
+             */
+            unsigned currentFailureThreshold;
+
+            /**
+             * The time a circuit stays open before a probe is allowed, in milliseconds.
+             */
+            unsigned currentOpenDuration;
+    };
+}
+
+#endif
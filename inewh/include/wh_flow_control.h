@@ -0,0 +1,337 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::FlowControl class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inewh */
+
+#ifndef WH_FLOW_CONTROL_H
+#define WH_FLOW_CONTROL_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QHash>
+#include <QMutex>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that limits the load placed on each destination.  Two limits are applied per destination origin:
+     *
+     *     * A token bucket limits the rate at which new messages are sent.  Retries are not charged against the
+     *       bucket as they are already limited by the retry budget.
+     *
+     *     * An adaptive concurrency limit caps the number of messages outstanding at once.  The limit grows by one
+     *       for every limit's worth of successful responses and is cut by a multiplicative factor when the
+     *       destination reports overload with a 429 or 503 status, when a request times out, or when the response
+     *       latency rises well above the lowest latency seen.
+     *
+     * Only one decrease is applied for each round of requests.  Responses to requests sent before the most recent
+     * decrease are not used to decrease the limit again, so a burst of failures from a single overload event does not
+     * collapse the limit.
+     *
+     * The limits are shared by every webhook using the same instance and an instance can be shared by webhooks
+     * running on different threads.  Times are in microseconds on the \ref Metrics::now clock.
+     */
+    class WH_PUBLIC_API FlowControl {
+        public:
+            /**
+             * Enumeration of request outcomes.
+             */
+            enum class Outcome {
+                /**
+                 * Indicates the request succeeded.
+                 */
+                SUCCESS,
+
+                /**
+                 * Indicates the destination reported it is overloaded.
+                 */
+                OVERLOADED,
+
+                /**
+                 * Indicates the request timed out.
+                 */
+                TIMED_OUT,
+
+                /**
+                 * Indicates the request failed for a reason that says nothing about the destination's load.
+                 */
+                FAILED
+            };
+
+            /**
+             * The default number of tokens the bucket can hold.
+             */
+            static constexpr unsigned defaultBurst = 10;
+
+            /**
+             * The default initial concurrency limit.
+             */
+            static constexpr unsigned defaultInitialLimit = 4;
+
+            /**
+             * The default minimum concurrency limit.
+             */
+            static constexpr unsigned defaultMinimumLimit = 1;
+
+            /**
+             * The default maximum concurrency limit.
+             */
+            static constexpr unsigned defaultMaximumLimit = 256;
+
+            /**
+             * The default factor applied to the concurrency limit on overload.
+             */
+            static constexpr double defaultDecreaseFactor = 0.5;
+
+            /**
+             * The default ratio between the response latency and the lowest latency that indicates overload.
+             */
+            static constexpr double defaultLatencyTolerance = 2.0;
+
+            /**
+             * Latency increases smaller than this value, in microseconds, are never treated as overload.  This keeps
+             * normal jitter on fast destinations from reducing the concurrency limit.
+             */
+            static constexpr long long latencyNoiseFloor = 5000;
+
+            /**
+             * Constructor
+             *
+             * \param[in] messagesPerSecond The rate at which new messages can be sent to each destination.  A value
+             *                              of 0 disables rate limiting.
+             *
+             * \param[in] burst             The number of messages that can be sent at once after an idle period.
+             */
+            FlowControl(double messagesPerSecond = 0, unsigned burst = defaultBurst);
+
+            ~FlowControl();
+
+            /**
+             * Method you can use to set the rate limit.
+             *
+             * \param[in] messagesPerSecond The rate at which new messages can be sent to each destination.  A value
+             *                              of 0 disables rate limiting.
+             *
+             * \param[in] burst             The number of messages that can be sent at once after an idle period.  A
+             *                              value of 0 is treated as 1.
+             */
+            void setRate(double messagesPerSecond, unsigned burst = defaultBurst);
+
+            /**
+             * Method you can use to obtain the rate limit.
+             *
+             * \return Returns the rate at which new messages can be sent to each destination.  A value of 0 indicates
+             *         rate limiting is disabled.
+             */
+            double rate() const;
+
+            /**
+             * Method you can use to obtain the token bucket size.
+             *
+             * \return Returns the number of messages that can be sent at once after an idle period.
+             */
+            unsigned burst() const;
+
+            /**
+             * Method you can use to set the concurrency limits.  Destinations that are already known keep their
+             * current limit, clamped to the new range.
+             *
+             * \param[in] initialLimit The concurrency limit given to a destination when it is first used.
+             *
+             * \param[in] minimumLimit The lowest concurrency limit.  A value of 0 is treated as 1.
+             *
+             * \param[in] maximumLimit The highest concurrency limit.
+             */
+            void setConcurrencyLimits(unsigned initialLimit, unsigned minimumLimit, unsigned maximumLimit);
+
+            /**
+             * Method you can use to obtain the initial concurrency limit.
+             *
+             * \return Returns the concurrency limit given to a destination when it is first used.
+             */
+            unsigned initialLimit() const;
+
+            /**
+             * Method you can use to obtain the minimum concurrency limit.
+             *
+             * \return Returns the lowest concurrency limit.
+             */
+            unsigned minimumLimit() const;
+
+            /**
+             * Method you can use to obtain the maximum concurrency limit.
+             *
+             * \return Returns the highest concurrency limit.
+             */
+            unsigned maximumLimit() const;
+
+            /**
+             * Method you can use to set the factor applied to the concurrency limit on overload.
+             *
+             * \param[in] newDecreaseFactor The new factor.  The value is clamped to the range 0.1 to 0.95.
+             */
+            void setDecreaseFactor(double newDecreaseFactor);
+
+            /**
+             * Method you can use to obtain the factor applied to the concurrency limit on overload.
+             *
+             * \return Returns the decrease factor.
+             */
+            double decreaseFactor() const;
+
+            /**
+             * Method you can use to set the latency tolerance.  A successful response whose latency exceeds the
+             * lowest latency seen for the destination by more than this ratio is treated as a sign of overload.  The
+             * lowest latency slowly follows the observed latency so that a lasting change in network path is not
+             * mistaken for overload.
+             *
+             * \param[in] newLatencyTolerance The new latency tolerance.  A value of 0 stops latency from being
+             *                                used.  Other values below 1 are treated as 1.
+             */
+            void setLatencyTolerance(double newLatencyTolerance);
+
+            /**
+             * Method you can use to obtain the latency tolerance.
+             *
+             * \return Returns the latency tolerance.  A value of 0 indicates latency is not used.
+             */
+            double latencyTolerance() const;
+
+            /**
+             * Method that is called before a message is sent to a destination.  On success, the message holds one
+             * concurrency slot until \ref FlowControl::release is called.
+             *
+             * \param[in] destination The destination origin.
+             *
+             * \param[in] now         The current time, in microseconds.
+             *
+             * \return Returns 0 if the message can be sent.  Returns the time to wait for a token, in microseconds, if
+             *         the destination is rate limited.  Returns -1 if the destination is at its concurrency limit, in
+             *         which case the caller should try again after a slot is released.
+             */
+            long long acquire(const QString& destination, long long now);
+
+            /**
+             * Method that is called for every response, including the responses to retries, to adjust the
+             * concurrency limit.
+             *
+             * \param[in] destination The destination origin.
+             *
+             * \param[in] outcome     The outcome of the request.
+             *
+             * \param[in] sendTime    The time the request was sent, in microseconds.
+             *
+             * \param[in] now         The current time, in microseconds.
+             */
+            void record(const QString& destination, Outcome outcome, long long sendTime, long long now);
+
+            /**
+             * Method that is called when a message acquired through \ref FlowControl::acquire is delivered or fails.
+             *
+             * \param[in] destination The destination origin.
+             */
+            void release(const QString& destination);
+
+            /**
+             * Method you can use to obtain the current concurrency limit for a destination.
+             *
+             * \param[in] destination The destination origin.
+             *
+             * \return Returns the current concurrency limit.
+             */
+            unsigned concurrencyLimit(const QString& destination) const;
+
+            /**
+             * Method you can use to obtain the number of messages holding a slot for a destination.
+             *
+             * \param[in] destination The destination origin.
+             *
+             * \return Returns the number of outstanding messages.
+             */
+            unsigned outstanding(const QString& destination) const;
+
+        private:
+            /**
+             * Class that holds the state for one destination.
+             */
+            class Destination;
+
+            /**
+             * Method that locates, and if needed creates, the state for a destination.  The mutex must be held.
+             *
+             * \param[in] destination The destination origin.
+             *
+             * \param[in] now         The current time, in microseconds.
+             *
+             * \return Returns a pointer to the destination state.
+             */
+            Destination* destinationEntry(const QString& destination, long long now);
+
+            /**
+             * Mutex used to guard the settings and the destination table.
+             */
+            mutable QMutex mutex;
+
+            /**
+             * The destination state, keyed by destination origin.
+             */
+            QHash<QString, Destination*> destinations;
+
+            /**
+             * The rate limit, in messages per second.
+             */
+            double currentRate;
+
+            /**
+             * The token bucket size.
+             */
+            unsigned currentBurst;
+
+            /**
+             * The initial concurrency limit.
+             */
+            unsigned currentInitialLimit;
+
+            /**
+             * The minimum concurrency limit.
+             */
+            unsigned currentMinimumLimit;
+
+            /**
+             * The maximum concurrency limit.
+             */
+            unsigned currentMaximumLimit;
+
+            /**
+             * The factor applied to the concurrency limit on overload.
+             */
+            double currentDecreaseFactor;
+
+            /**
+             * The latency tolerance.
+             */
+            double currentLatencyTolerance;
+    };
+}
+
+#endif
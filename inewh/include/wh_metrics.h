@@ -0,0 +1,445 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::Metrics class.
+***********************************************************************************************************************/
+
+#ifndef WH_METRICS_H
+#define WH_METRICS_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+
+#include <atomic>
+
+#include "wh_common.h"
+
+namespace Wh {
+    class Histogram;
+
+    /**
+     * Class that collects delivery metrics for one or more webhooks.  Counters and latency histograms are kept per
+     * destination origin and in aggregate.  Values are updated with atomic operations and the only lock is a short one
+     * used to locate the destination, so a single instance can be shared by webhooks running on different threads.
+     * Callers that update the same destination repeatedly can locate it once with \ref Metrics::destinationEntry and
+     * avoid the lock entirely.
+     *
+     * Latencies are recorded in microseconds.  Use \ref Metrics::snapshot to read the metrics or
+     * \ref Metrics::prometheusText to export them in the Prometheus text exposition format.
+     */
+    class WH_PUBLIC_API Metrics {
+        public:
+            /**
+             * Enumeration of counters.
+             */
+            enum class Counter : unsigned {
+                /**
+                 * Messages submitted for delivery.  Each payload in a batch is counted.
+                 */
+                MESSAGES = 0,
+
+                /**
+                 * HTTP requests sent, including retries.
+                 */
+                REQUESTS = 1,
+
+                /**
+                 * HTTP requests that were retries.
+                 */
+                RETRIES = 2,
+
+                /**
+                 * Messages delivered.  Each payload in a batch is counted.
+                 */
+                DELIVERED = 3,
+
+                /**
+                 * Messages that could not be delivered.  Each payload in a batch is counted.
+                 */
+                FAILED = 4,
+
+                /**
+                 * Request body bytes sent, after compression.
+                 */
+                BYTES_SENT = 5,
+
+                /**
+                 * Response body bytes received.
+                 */
+                BYTES_RECEIVED = 6,
+
+                /**
+                 * Requests sent to the timestamp server to refresh the time delta.
+                 */
+                TIME_DELTA_REFRESHES = 7
+            };
+
+            /**
+             * The number of counters.
+             */
+            static constexpr unsigned numberCounters = 8;
+
+            /**
+             * Enumeration of latencies.
+             */
+            enum class Latency : unsigned {
+                /**
+                 * Time spent signing the payload and building the envelope.
+                 */
+                SIGN = 0,
+
+                /**
+                 * Time from sending a request until the response is received.
+                 */
+                ROUND_TRIP = 1,
+
+                /**
+                 * Time from queueing a message until it is delivered, including any retries.
+                 */
+                DELIVERY = 2
+            };
+
+            /**
+             * The number of latencies.
+             */
+            static constexpr unsigned numberLatencies = 3;
+
+            /**
+             * Enumeration of gauges.  Gauges are kept in aggregate only.
+             */
+            enum class Gauge : unsigned {
+                /**
+                 * Messages waiting for an in-flight slot.
+                 */
+                QUEUED = 0,
+
+                /**
+                 * Messages in flight.
+                 */
+                IN_FLIGHT = 1
+            };
+
+            /**
+             * The number of gauges.
+             */
+            static constexpr unsigned numberGauges = 2;
+
+            /**
+             * Class that holds a point in time copy of a latency histogram.
+             */
+            class WH_PUBLIC_API Distribution {
+                friend class Metrics;
+
+                public:
+                    Distribution();
+
+                    ~Distribution();
+
+                    /**
+                     * Method you can use to obtain the number of recorded values.
+                     *
+                     * \return Returns the number of recorded values.
+                     */
+                    unsigned long long count() const;
+
+                    /**
+                     * Method you can use to obtain the sum of the recorded values.
+                     *
+                     * \return Returns the sum of the recorded values, in microseconds.
+                     */
+                    unsigned long long sum() const;
+
+                    /**
+                     * Method you can use to obtain the largest recorded value.
+                     *
+                     * \return Returns the largest recorded value, in microseconds.
+                     */
+                    unsigned long long maximum() const;
+
+                    /**
+                     * Method you can use to obtain the mean of the recorded values.
+                     *
+                     * \return Returns the mean, in microseconds.  A value of 0 is returned if no values were recorded.
+                     */
+                    double mean() const;
+
+                    /**
+                     * Method you can use to obtain a percentile.  The value returned is the upper bound of the bucket
+                     * holding the percentile so it may overstate the true value by a few percent.
+                     *
+                     * \param[in] percent The percentile of interest, from 0 to 100.
+                     *
+                     * \return Returns the value at the percentile, in microseconds.  A value of 0 is returned if no
+                     *         values were recorded.
+                     */
+                    unsigned long long percentile(double percent) const;
+
+                private:
+                    /**
+                     * The bucket counts.  The vector is empty if no values were recorded.
+                     */
+                    QVector<unsigned long long> buckets;
+
+                    /**
+                     * The number of recorded values.
+                     */
+                    unsigned long long currentCount;
+
+                    /**
+                     * The sum of the recorded values.
+                     */
+                    unsigned long long currentSum;
+
+                    /**
+                     * The largest recorded value.
+                     */
+                    unsigned long long currentMaximum;
+            };
+
+            /**
+             * Class that holds a point in time copy of the metrics.
+             */
+            class WH_PUBLIC_API Snapshot {
+                friend class Metrics;
+
+                public:
+                    Snapshot();
+
+                    ~Snapshot();
+
+                    /**
+                     * Method you can use to obtain the destinations seen so far.
+                     *
+                     * \return Returns the destination origins, sorted.
+                     */
+                    QStringList destinations() const;
+
+                    /**
+                     * Method you can use to obtain a counter.
+                     *
+                     * \param[in] counter     The counter of interest.
+                     *
+                     * \param[in] destination The destination origin.  An empty string returns the aggregate value.
+                     *
+                     * \return Returns the counter value.
+                     */
+                    unsigned long long counter(Counter counter, const QString& destination = QString()) const;
+
+                    /**
+                     * Method you can use to obtain a latency distribution.
+                     *
+                     * \param[in] latency     The latency of interest.
+                     *
+                     * \param[in] destination The destination origin.  An empty string returns the aggregate value.
+                     *
+                     * \return Returns the latency distribution.
+                     */
+                    Distribution latency(Latency latency, const QString& destination = QString()) const;
+
+                    /**
+                     * Method you can use to obtain a gauge.
+                     *
+                     * \param[in] gauge The gauge of interest.
+                     *
+                     * \return Returns the gauge value.
+                     */
+                    long long gauge(Gauge gauge) const;
+
+                    /**
+                     * Method you can use to obtain the retry amplification, the number of requests sent per message.
+                     * Batches make this value smaller than the true per-request amplification.
+                     *
+                     * \param[in] destination The destination origin.  An empty string returns the aggregate value.
+                     *
+                     * \return Returns the ratio of requests to messages.  A value of 0 is returned if no messages were
+                     *         sent.
+                     */
+                    double retryAmplification(const QString& destination = QString()) const;
+
+                private:
+                    /**
+                     * Class that holds the metrics for one destination.
+                     */
+                    class Entry {
+                        public:
+                            Entry();
+
+                            /**
+                             * The counter values.
+                             */
+                            unsigned long long counters[numberCounters];
+
+                            /**
+                             * The latency distributions.
+                             */
+                            Distribution latencies[numberLatencies];
+                    };
+
+                    /**
+                     * The aggregate metrics.
+                     */
+                    Entry total;
+
+                    /**
+                     * The metrics for each destination.
+                     */
+                    QMap<QString, Entry> entries;
+
+                    /**
+                     * The gauge values.
+                     */
+                    long long gauges[numberGauges];
+            };
+
+            /**
+             * Class that holds the live metrics for one destination.  Defined in the implementation.
+             */
+            class Destination;
+
+            Metrics();
+
+            ~Metrics();
+
+            /**
+             * Method that locates, and if needed creates, the metrics for a destination.  The returned pointer remains
+             * valid for the lifetime of this object.
+             *
+             * \param[in] destination The destination origin.
+             *
+             * \return Returns a pointer to the destination metrics.
+             */
+            Destination* destinationEntry(const QString& destination);
+
+            /**
+             * Method you can use to increment a counter.
+             *
+             * \param[in] counter     The counter to be incremented.
+             *
+             * \param[in] destination The destination origin.
+             *
+             * \param[in] amount      The amount to add to the counter.
+             */
+            void increment(Counter counter, const QString& destination, unsigned long long amount = 1);
+
+            /**
+             * Method you can use to increment a counter for a destination located earlier.  No lock is taken.
+             *
+             * \param[in] counter     The counter to be incremented.
+             *
+             * \param[in] destination The destination metrics returned by \ref Metrics::destinationEntry.
+             *
+             * \param[in] amount      The amount to add to the counter.
+             */
+            void increment(Counter counter, Destination* destination, unsigned long long amount = 1);
+
+            /**
+             * Method you can use to record a latency.
+             *
+             * \param[in] latency     The latency to be recorded.
+             *
+             * \param[in] destination The destination origin.
+             *
+             * \param[in] duration    The measured duration, in microseconds.
+             */
+            void record(Latency latency, const QString& destination, unsigned long long duration);
+
+            /**
+             * Method you can use to record a latency for a destination located earlier.  No lock is taken.
+             *
+             * \param[in] latency     The latency to be recorded.
+             *
+             * \param[in] destination The destination metrics returned by \ref Metrics::destinationEntry.
+             *
+             * \param[in] duration    The measured duration, in microseconds.
+             */
+            void record(Latency latency, Destination* destination, unsigned long long duration);
+
+            /**
+             * Method you can use to adjust a gauge.
+             *
+             * \param[in] gauge  The gauge to be adjusted.
+             *
+             * \param[in] amount The amount to add to the gauge.  Use a negative value to reduce the gauge.
+             */
+            void adjust(Gauge gauge, long long amount);
+
+            /**
+             * Method you can use to obtain a copy of the metrics.
+             *
+             * \return Returns a snapshot of the metrics.
+             */
+            Snapshot snapshot() const;
+
+            /**
+             * Method you can use to obtain the metrics in the Prometheus text exposition format.  Counters and gauges
+             * are exported as-is.  Latencies are exported as summaries, in seconds, with the 50th, 90th, 99th, and
+             * 99.9th percentiles.  Counters and latencies carry a "destination" label.
+             *
+             * \param[in] prefix The prefix applied to every metric name.
+             *
+             * \return Returns the metrics as UTF-8 text.
+             */
+            QByteArray prometheusText(const QString& prefix = QString("inewh")) const;
+
+            /**
+             * Method you can use to obtain the current time on the monotonic clock used for latencies.
+             *
+             * \return Returns the current time, in microseconds.  The epoch is unspecified.
+             */
+            static long long now();
+
+        private:
+            /**
+             * Method that copies live destination metrics into a snapshot entry.
+             *
+             * \param[in]  destination The live destination metrics.
+             *
+             * \param[out] entry       The snapshot entry to be populated.
+             */
+            static void copyEntry(const Destination* destination, Snapshot::Entry& entry);
+
+            /**
+             * Mutex used to guard the destination table.
+             */
+            mutable QMutex destinationMutex;
+
+            /**
+             * The metrics for each destination.
+             */
+            QHash<QString, Destination*> destinations;
+
+            /**
+             * The aggregate metrics.
+             */
+            Destination* total;
+
+            /**
+             * The gauge values.
+             */
+            std::atomic<long long> gauges[numberGauges];
+    };
+}
+
+#endif
@@ -0,0 +1,243 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::RetryPolicy class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inewh */
+
+#ifndef WH_RETRY_POLICY_H
+#define WH_RETRY_POLICY_H
+
+#include <QtGlobal>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that decides if, and when, a failed request should be retried.  The default implementation uses
+     * exponential backoff with full jitter, honors any delay requested by the server through a Retry-After header,
+     * up to a configurable limit, and draws every retry from a process-wide retry budget so that retries can not
+     * amplify load on a struggling server.
+     *
+     * You can overload \ref RetryPolicy::retryDelay to provide your own policy.
+     */
+    class WH_PUBLIC_API RetryPolicy {
+        public:
+            /**
+             * The default maximum number of attempts, including the first attempt.
+             */
+            static constexpr unsigned defaultMaximumAttempts = 5;
+
+            /**
+             * The default base backoff, in milliseconds.
+             */
+            static constexpr unsigned defaultBaseBackoff = 100;
+
+            /**
+             * The default maximum backoff, in milliseconds.
+             */
+            static constexpr unsigned defaultMaximumBackoff = 30000;
+
+            /**
+             * The default longest delay honored from a Retry-After header, in milliseconds.
+             */
+            static constexpr unsigned defaultMaximumRetryAfter = 300000;
+
+            /**
+             * The default number of retries earned by each request.
+             */
+            static constexpr double defaultBudgetRatio = 0.1;
+
+            /**
+             * The default number of retries per second always allowed by the retry budget.
+             */
+            static constexpr unsigned defaultBudgetMinimumPerSecond = 10;
+
+            /**
+             * Constructor
+             *
+             * \param[in] maximumAttempts   The maximum number of attempts, including the first attempt.
+             *
+             * \param[in] baseBackoff       The base backoff, in milliseconds.
+             *
+             * \param[in] maximumBackoff    The maximum backoff, in milliseconds.
+             *
+             * \param[in] respectRetryAfter If true, the delay requested by the server will be honored.
+             */
+            RetryPolicy(
+                unsigned maximumAttempts   = defaultMaximumAttempts,
+                unsigned baseBackoff       = defaultBaseBackoff,
+                unsigned maximumBackoff    = defaultMaximumBackoff,
+                bool     respectRetryAfter = true
+            );
+
+            virtual ~RetryPolicy();
+
+            /**
+             * Method you can use to set the maximum number of attempts.
+             *
+             * \param[in] newMaximumAttempts The maximum number of attempts, including the first attempt.
+             */
+            void setMaximumAttempts(unsigned newMaximumAttempts);
+
+            /**
+             * Method you can use to obtain the maximum number of attempts.
+             *
+             * \return Returns the maximum number of attempts, including the first attempt.
+             */
+            unsigned maximumAttempts() const;
+
+            /**
+             * Method you can use to set the base backoff.
+             *
+             * \param[in] newBaseBackoff The base backoff, in milliseconds.
+             */
+            void setBaseBackoff(unsigned newBaseBackoff);
+
+            /**
+             * Method you can use to obtain the base backoff.
+             *
+             * \return Returns the base backoff, in milliseconds.
+             */
+            unsigned baseBackoff() const;
+
+            /**
+             * Method you can use to set the maximum backoff.
+             *
+             * \param[in] newMaximumBackoff The maximum backoff, in milliseconds.
+             */
+            void setMaximumBackoff(unsigned newMaximumBackoff);
+
+            /**
+             * Method you can use to obtain the maximum backoff.
+             *
+             * \return Returns the maximum backoff, in milliseconds.
+             */
+            unsigned maximumBackoff() const;
+
+            /**
+             * Method you can use to indicate if delays requested by the server should be honored.
+             *
+             * \param[in] nowRespectRetryAfter If true, the Retry-After header will be honored.
+             */
+            void setRespectRetryAfter(bool nowRespectRetryAfter = true);
+
+            /**
+             * Method you can use to determine if delays requested by the server are honored.
+             *
+             * \return Returns true if the Retry-After header is honored.
+             */
+            bool respectRetryAfter() const;
+
+            /**
+             * Method you can use to limit the delay honored from a Retry-After header.  Longer requested delays are
+             * shortened to this limit so that a misbehaving server can not hold a message indefinitely.
+             *
+             * \param[in] newMaximumRetryAfter The longest delay honored, in milliseconds.
+             */
+            void setMaximumRetryAfter(unsigned newMaximumRetryAfter);
+
+            /**
+             * Method you can use to obtain the longest delay honored from a Retry-After header.
+             *
+             * \return Returns the longest delay honored, in milliseconds.
+             */
+            unsigned maximumRetryAfter() const;
+
+            /**
+             * Method that is called to determine the delay before the next attempt.
+             *
+             * \param[in] attempts   The number of attempts made so far.
+             *
+             * \param[in] retryAfter The delay requested by the server, in milliseconds.  A negative value indicates
+             *                       that the server did not request a delay.  The default implementation honors at
+             *                       most \ref RetryPolicy::maximumRetryAfter milliseconds.
+             *
+             * \return Returns the delay before the next attempt, in milliseconds.  A negative value indicates that
+             *         no further attempts should be made.
+             */
+            virtual long long retryDelay(unsigned attempts, long long retryAfter) const;
+
+            /**
+             * Method you can use to configure the process-wide retry budget.  Every request adds the ratio to the
+             * budget and every retry removes one from it.  The budget is also refilled at a fixed minimum rate so
+             * that occasional failures are always retried.
+             *
+             * \param[in] ratio            The number of retries earned by each request.
+             *
+             * \param[in] minimumPerSecond The number of retries per second that are always allowed.
+             */
+            static void setRetryBudget(double ratio, unsigned minimumPerSecond);
+
+            /**
+             * Method you can use to obtain the number of retries earned by each request.
+             *
+             * \return Returns the retry budget ratio.
+             */
+            static double retryBudgetRatio();
+
+            /**
+             * Method you can use to obtain the number of retries per second that are always allowed.
+             *
+             * \return Returns the minimum number of retries per second.
+             */
+            static unsigned retryBudgetMinimumPerSecond();
+
+            /**
+             * Method that is called when a new request is made, adding to the retry budget.
+             */
+            static void recordRequest();
+
+            /**
+             * Method that is called to withdraw a single retry from the retry budget.
+             *
+             * \return Returns true if the retry is allowed.  Returns false if the retry budget is exhausted.
+             */
+            static bool acquireRetry();
+
+        private:
+            /**
+             * The maximum number of attempts.
+             */
+            unsigned currentMaximumAttempts;
+
+            /**
+             * The base backoff, in milliseconds.
+             */
+            unsigned currentBaseBackoff;
+
+            /**
+             * The maximum backoff, in milliseconds.
+             */
+            unsigned currentMaximumBackoff;
+
+            /**
+             * Flag indicating if the Retry-After header is honored.
+             */
+            bool currentRespectRetryAfter;
+
+            /**
+             * The longest delay honored from a Retry-After header, in milliseconds.
+             */
+            unsigned currentMaximumRetryAfter;
+    };
+}
+
+#endif
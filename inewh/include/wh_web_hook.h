@@ -30,10 +30,22 @@
 #include <QtGlobal>
 #include <QDateTime>
 #include <QUrl>
+#include <QQueue>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QPair>
+#include <QSharedPointer>
+#include <QMutex>
 
 #include <cstdint>
+#include <atomic>
 
 #include "wh_common.h"
+#include "wh_retry_policy.h"
+#include "wh_metrics.h"
+#include "wh_flow_control.h"
+#include "wh_circuit_breaker.h"
 
 class QTimer;
 class QDateTime;
@@ -41,9 +53,16 @@ class QByteArray;
 class QNetworkAccessManager;
 class QJsonObject;
 class QJsonDocument;
+class QNetworkRequest;
 class QNetworkReply;
+class QIODevice;
 
 namespace Wh {
+    class SigningKeyCache;
+    class Spool;
+    class SubmissionQueue;
+    class Response;
+
     /**
      * Class that provides support for generic Inesonic web hooks.
      */
@@ -51,6 +70,89 @@ namespace Wh {
         Q_OBJECT
 
         public:
+            /**
+             * Enumeration of request body compression modes.
+             */
+            enum class Compression {
+                /**
+                 * Indicates request bodies are sent uncompressed.
+                 */
+                NONE,
+
+                /**
+                 * Indicates request bodies are sent with "Content-Encoding: deflate".
+                 */
+                DEFLATE,
+
+                /**
+                 * Indicates request bodies are sent with "Content-Encoding: gzip".
+                 */
+                GZIP
+            };
+
+            /**
+             * Enumeration of message envelope formats.
+             */
+            enum class EnvelopeFormat {
+                /**
+                 * Indicates the payload and signature are sent base-64 encoded inside a JSON object.
+                 */
+                JSON,
+
+                /**
+                 * Indicates the payload and signature are sent as raw byte strings inside a CBOR map, using the
+                 * application/cbor content type.
+                 */
+                CBOR
+            };
+
+            /**
+             * Enumeration of message priorities.  Each priority has its own queue and can be given its own limit on
+             * in-flight messages.
+             */
+            enum class Priority : unsigned {
+                /**
+                 * Indicates latency sensitive messages.  High priority messages are never batched.
+                 */
+                HIGH,
+
+                /**
+                 * Indicates ordinary messages.
+                 */
+                NORMAL,
+
+                /**
+                 * Indicates bulk traffic that can wait behind other messages.
+                 */
+                BULK
+            };
+
+            /**
+             * The number of message priorities.
+             */
+            static constexpr unsigned numberPriorities = 3;
+
+            /**
+             * Enumeration of the ways queued messages are picked across priorities.
+             */
+            enum class Scheduling {
+                /**
+                 * Indicates a queued message is always sent before any message of a lower priority.
+                 */
+                STRICT,
+
+                /**
+                 * Indicates free in-flight slots are shared between priorities in proportion to their weights so
+                 * lower priorities are never starved.
+                 */
+                WEIGHTED
+            };
+
+            /**
+             * The default minimum body size, in bytes, that will be compressed.
+             */
+            static constexpr unsigned defaultCompressionThreshold = 1024;
+
             /**
              * Constructor
              *
@@ -78,7 +180,7 @@ namespace Wh {
             ~WebHook() override;
 
             /**
-             * Method you can use to set the global timestamp secret.
+             * Method you can use to set the global timestamp secret.  This method is thread safe.
              *
              * \param[in] newTimestampSecret The new webhook secret.
              */
@@ -87,12 +189,12 @@ namespace Wh {
             /**
              * Method you can use to obtain the current global timestamp secret.
              *
-             * \return Returns the current global timestamp secret.
+             * \return Returns a copy of the current global timestamp secret.
              */
-            static const QByteArray& timestampSecret();
+            static QByteArray timestampSecret();
 
             /**
-             * Method you can use to set the global timestamp URL.
+             * Method you can use to set the global timestamp URL.  This method is thread safe.
              *
              * \param[in] timestampWebhookUrl The timestamp webhook URL to be used to measure time deltas.
              */
@@ -101,12 +203,13 @@ namespace Wh {
             /**
              * Method you can use to obtain the current global timestamp URL.
              *
-             * \return Returns the currently selected timestamp URL.
+             * \return Returns a copy of the currently selected timestamp URL.
              */
-            static const QUrl& timestampUrl();
+            static QUrl timestampUrl();
 
             /**
-             * Method you can use to force the time delta.  This method is primarily intended for test purposes.
+             * Method you can use to force the time delta.  This method is primarily intended for test purposes.  The
+             * time delta is shared by every webhook in the process.
              *
              * \param[in] newTimeDelta The new time delta to be applied.
              */
@@ -119,171 +222,1465 @@ namespace Wh {
              */
             static long long timeDelta();
 
-        signals:
             /**
-             * Signal that is emitted when a valid JSON response is received.
+             * Method you can use to keep the time delta current in the background so that messages are not rejected
+             * because of clock drift.  When enabled, the time delta is measured immediately and then again at the
+             * requested interval.  If the measured time delta drifts, it is also measured shortly before the drift
+             * is expected to invalidate signatures.  Background measurements are shared with every other webhook in
+             * the process and failures are not reported through \ref WebHook::failedToSend.
              *
-             * \param[out] jsonDocument A JSON document holding the received response.
+             * \param[in] intervalMsec The longest time, in milliseconds, between measurements.  A value of 0 disables
+             *                         background measurements.
              */
-            void jsonResponseReceived(const QJsonDocument& jsonDocument);
+            void setTimeDeltaRefreshInterval(unsigned intervalMsec);
 
             /**
-             * Signal that is emitted when a valid response is received.
+             * Method you can use to obtain the background time delta refresh interval.
              *
-             * \param[out] rawData The raw response data.
+             * \return Returns the refresh interval, in milliseconds.  A value of 0 indicates that background
+             *         measurements are disabled.
              */
-            void responseReceived(const QByteArray& rawData);
+            unsigned timeDeltaRefreshInterval() const;
 
             /**
-             * Signal that is emitted when no response has been received or an invalid response has been received.
+             * Method you can use to set the maximum number of messages that can be in flight at any one time.
+             * Messages beyond this limit are queued and sent, in order, as earlier messages complete.
              *
-             * \param[out] networkError The last reported network error.  This is the value of
-             *                          QNetworkReply::NetworkError cast to an integer.
+             * \param[in] newMaximumInFlight The new maximum number of in-flight messages.  A value of 0 is treated
+             *                               as 1.
              */
-            void failedToSend(int networkError);
+            void setMaximumInFlight(unsigned newMaximumInFlight);
 
             /**
-             * Signal that is emitted when the internal time delta is updated.  This signal is primarily intended for
-             * test purposes.
+             * Method you can use to obtain the maximum number of messages that can be in flight at any one time.
+             *
+             * \return Returns the maximum number of in-flight messages.
              */
-            void timeDeltaUpdated();
+            unsigned maximumInFlight() const;
+
+            /**
+             * Method you can use to determine the number of messages currently in flight.  Messages waiting on a
+             * retry or a time delta adjustment are counted as in flight.
+             *
+             * \return Returns the number of in-flight messages.
+             */
+            unsigned messagesInFlight() const;
+
+            /**
+             * Method you can use to determine the number of messages queued behind the in-flight messages.
+             *
+             * \return Returns the number of queued messages.
+             */
+            unsigned messagesQueued() const;
+
+            /**
+             * Method you can use to limit the number of messages of one priority that can be in flight at any one
+             * time.  The overall limit set by \ref WebHook::setMaximumInFlight still applies.
+             *
+             * Messages waiting on a retry or a time delta adjustment keep their in-flight slot.  Limiting the lower
+             * priorities to fewer slots than the overall limit reserves the remaining slots for higher priority
+             * messages so they are not held up by a backlog of lower priority messages or their retries.
+             *
+             * \param[in] priority           The priority of interest.
+             *
+             * \param[in] newMaximumInFlight The new maximum number of in-flight messages of this priority.  A value
+             *                               of 0 removes the limit.
+             */
+            void setMaximumInFlight(Priority priority, unsigned newMaximumInFlight);
+
+            /**
+             * Method you can use to obtain the limit on in-flight messages of one priority.
+             *
+             * \param[in] priority The priority of interest.
+             *
+             * \return Returns the maximum number of in-flight messages of this priority.  A value of 0 indicates
+             *         there is no limit beyond the overall limit.
+             */
+            unsigned maximumInFlight(Priority priority) const;
+
+            /**
+             * Method you can use to determine the number of messages of one priority currently in flight.
+             *
+             * \param[in] priority The priority of interest.
+             *
+             * \return Returns the number of in-flight messages of this priority.
+             */
+            unsigned messagesInFlight(Priority priority) const;
+
+            /**
+             * Method you can use to determine the number of messages of one priority waiting for an in-flight slot.
+             *
+             * \param[in] priority The priority of interest.
+             *
+             * \return Returns the number of queued messages of this priority.
+             */
+            unsigned messagesQueued(Priority priority) const;
+
+            /**
+             * Method you can use to select how queued messages are picked across priorities.  Strict scheduling is
+             * used by default.
+             *
+             * \param[in] newScheduling The new scheduling mode.
+             */
+            void setScheduling(Scheduling newScheduling);
+
+            /**
+             * Method you can use to determine how queued messages are picked across priorities.
+             *
+             * \return Returns the scheduling mode.
+             */
+            Scheduling scheduling() const;
+
+            /**
+             * Method you can use to set the weight of a priority under weighted scheduling.  When every priority has
+             * messages waiting, each priority receives a share of the free in-flight slots proportional to its
+             * weight.  The default weights are 8, 4, and 1 for high, normal, and bulk messages.
+             *
+             * \param[in] priority  The priority of interest.
+             *
+             * \param[in] newWeight The new weight.  A value of 0 is treated as 1.
+             */
+            void setPriorityWeight(Priority priority, unsigned newWeight);
+
+            /**
+             * Method you can use to obtain the weight of a priority under weighted scheduling.
+             *
+             * \param[in] priority The priority of interest.
+             *
+             * \return Returns the weight.
+             */
+            unsigned priorityWeight(Priority priority) const;
+
+            /**
+             * Method you can use to set the policy used to retry failed requests.  The policy is shared and can be
+             * used by multiple webhooks.
+             *
+             * \param[in] newRetryPolicy The new retry policy.  A null pointer restores the default policy.
+             */
+            void setRetryPolicy(QSharedPointer<RetryPolicy> newRetryPolicy);
+
+            /**
+             * Method you can use to obtain the policy used to retry failed requests.
+             *
+             * \return Returns the current retry policy.
+             */
+            QSharedPointer<RetryPolicy> retryPolicy() const;
+
+            /**
+             * Method you can use to set the object used to collect delivery metrics.  The object is shared and can be
+             * used by multiple webhooks to collect aggregate metrics.  Metrics are not collected by default.
+             *
+             * \param[in] newMetrics The new metrics object.  A null pointer disables metrics collection.
+             */
+            void setMetrics(QSharedPointer<Metrics> newMetrics);
+
+            /**
+             * Method you can use to obtain the object used to collect delivery metrics.
+             *
+             * \return Returns the metrics object.  A null pointer is returned if metrics collection is disabled.
+             */
+            QSharedPointer<Metrics> metrics() const;
+
+            /**
+             * Method you can use to limit the rate and concurrency of messages sent to each destination.  The object
+             * is shared and can be used by multiple webhooks so that all of them back off together when a destination
+             * is overloaded.  Flow control is disabled by default.
+             *
+             * Messages held back by flow control remain queued and do not take an in-flight slot.  A message holds
+             * its flow control slot until it is delivered or fails, including any time spent waiting to retry.
+             *
+             * \param[in] newFlowControl The new flow control object.  A null pointer disables flow control.
+             */
+            void setFlowControl(QSharedPointer<FlowControl> newFlowControl);
+
+            /**
+             * Method you can use to obtain the object used to limit the load on each destination.
+             *
+             * \return Returns the flow control object.  A null pointer is returned if flow control is disabled.
+             */
+            QSharedPointer<FlowControl> flowControl() const;
+
+            /**
+             * Method you can use to stop sending to destinations that are down.  The object is shared and can be used
+             * by multiple webhooks.  No circuit breaker is used by default.
+             *
+             * While a destination's circuit is open, queued messages and pending retries for the destination fail at
+             * once with \ref WebHook::messageFailed reporting QNetworkReply::ServiceUnavailableError.  Spooled
+             * messages stay in the spool and are sent again when the spool is next opened.
+             *
+             * \param[in] newCircuitBreaker The new circuit breaker.  A null pointer disables the circuit breaker.
+             */
+            void setCircuitBreaker(QSharedPointer<CircuitBreaker> newCircuitBreaker);
+
+            /**
+             * Method you can use to obtain the object used to stop sending to destinations that are down.
+             *
+             * \return Returns the circuit breaker.  A null pointer is returned if no circuit breaker is used.
+             */
+            QSharedPointer<CircuitBreaker> circuitBreaker() const;
+
+            /**
+             * Method you can use to enable a durable spool of undelivered messages.  Every message is recorded in
+             * the spool when it is sent and removed once it has been delivered.  Messages that could not be delivered
+             * before the process exited, including messages that exhausted their retries or were rejected by the
+             * circuit breaker, are resent at their original priority the next time the spool is opened.  Resent
+             * messages are queued behind the in-flight limit so the replay runs with bounded concurrency.
+             *
+             * Each webhook should use its own spool directory.
+             *
+             * \param[in] directory The directory used to hold the spool.  An empty string disables the spool.
+             *
+             * \return Returns true on success.  Returns false if the spool could not be opened.
+             */
+            bool setSpoolDirectory(const QString& directory);
+
+            /**
+             * Method you can use to obtain the current spool directory.
+             *
+             * \return Returns the spool directory.  An empty string is returned if the spool is disabled.
+             */
+            QString spoolDirectory() const;
+
+            /**
+             * Method you can use to select how spool records are flushed to storage.  By default records are flushed
+             * asynchronously so they survive the process exiting or crashing.  A synchronous flush also survives the
+             * system failing but each send waits for storage.
+             *
+             * \param[in] nowSynchronous If true, each spool write waits for the record to reach storage.
+             */
+            void setSpoolSynchronous(bool nowSynchronous = true);
+
+            /**
+             * Method you can use to determine how spool records are flushed to storage.
+             *
+             * \return Returns true if each spool write waits for the record to reach storage.
+             */
+            bool spoolSynchronous() const;
+
+            /**
+             * Method you can use to enable or disable batching.  When batching is enabled, payloads sent to the same
+             * destination are collected into a JSON array and sent as a single signed message once one of the batch
+             * thresholds is reached.  Disabling batching flushes any partially filled batches.
+             *
+             * Batching changes the message seen by the receiver.  The signed data holds a JSON array whose entries
+             * are the batched payloads in the order they were sent, so the receiver must accept an array in place of
+             * a single payload.  A batch holding a single payload is still sent as an array with one entry.
+             *
+             * Responses to a batch are reported to each submitter through \ref WebHook::messageDelivered.  If the
+             * server responds with a JSON array holding exactly one entry per batched payload, entry N is the result
+             * for payload N and each submitter whose entry is an object or array receives that entry.  In all other
+             * cases, including a response array of a different length or an entry that is neither an object nor an
+             * array, the submitter receives the full response.  A failed batch is reported to every submitter
+             * through \ref WebHook::messageFailed.
+             *
+             * \param[in] nowEnabled If true, batching will be enabled.  If false, batching will be disabled.
+             */
+            void setBatchingEnabled(bool nowEnabled = true);
+
+            /**
+             * Method you can use to determine if batching is enabled.
+             *
+             * \return Returns true if batching is enabled.  Returns false if batching is disabled.
+             */
+            bool batchingEnabled() const;
+
+            /**
+             * Method you can use to set the thresholds used to flush a batch.  A batch is sent as soon as any one of
+             * the thresholds is reached.
+             *
+             * \param[in] maximumCount     The maximum number of payloads in a single batch.
+             *
+             * \param[in] maximumBytes     The maximum size of a batch, in bytes, prior to encoding.
+             *
+             * \param[in] maximumDelayMsec The maximum time, in milliseconds, that a payload will wait in a batch.
+             */
+            void setBatchThresholds(unsigned maximumCount, unsigned maximumBytes, unsigned maximumDelayMsec);
+
+            /**
+             * Method you can use to obtain the maximum number of payloads in a single batch.
+             *
+             * \return Returns the maximum number of payloads in a batch.
+             */
+            unsigned batchMaximumCount() const;
+
+            /**
+             * Method you can use to obtain the maximum size of a batch, in bytes.
+             *
+             * \return Returns the maximum size of a batch prior to encoding.
+             */
+            unsigned batchMaximumBytes() const;
+
+            /**
+             * Method you can use to obtain the maximum time a payload will wait in a batch.
+             *
+             * \return Returns the maximum batching delay, in milliseconds.
+             */
+            unsigned batchMaximumDelay() const;
 
-        public slots:
             /**
-             * Slot you can trigger to send a message.
+             * Method you can use to send a message from any thread.  The payload is serialized on the calling thread
+             * and placed on a lock-free queue that the thread owning this webhook drains in batches.  The calling
+             * thread never takes a lock and at most one event is posted to the owning thread per batch.
+             *
+             * Messages posted by a single thread are sent in the order they were posted.  No ordering is guaranteed
+             * between posted messages and messages submitted through \ref WebHook::send.
              *
              * \param[in] destinationUrl The URL where the message should be received.
              *
              * \param[in] jsonDocument   The JSON payload to be sent.
+             *
+             * \param[in] priority       The message priority.
+             *
+             * \return Returns an identifier for the message.  A value of 0 is returned if the submission queue is full.
              */
-            void send(const QUrl& destinationUrl, const QJsonDocument& jsonDocument);
+            unsigned long long post(
+                const QUrl&          destinationUrl,
+                const QJsonDocument& jsonDocument,
+                Priority             priority = Priority::NORMAL
+            );
 
             /**
-             * Slot you can trigger to send a message.
+             * Method you can use to send a message from any thread.  See \ref WebHook::post.
              *
              * \param[in] destinationUrl The URL where the message should be received.
              *
-             * \param[in] jsonObject   The JSON payload to be sent.
+             * \param[in] jsonObject     The JSON payload to be sent.
+             *
+             * \param[in] priority       The message priority.
+             *
+             * \return Returns an identifier for the message.  A value of 0 is returned if the submission queue is full.
              */
-            void send(const QUrl& destinationUrl, const QJsonObject& jsonObject);
+            unsigned long long post(
+                const QUrl&        destinationUrl,
+                const QJsonObject& jsonObject,
+                Priority           priority = Priority::NORMAL
+            );
 
             /**
-             * Slot you can trigger to force a time delta adjustment.
+             * Method you can use to obtain the number of messages the thread-safe submission queue can hold.
+             *
+             * \return Returns the submission queue capacity.
              */
-            void forceTimeDeltaAdjustment();
+            unsigned submissionQueueCapacity() const;
 
-        protected:
             /**
-             * Method you can overload to intercept valid responses.  The default implementation triggers the
-             * \ref WebHook::jsonResponseReceived signal.
+             * Method you can use to compress request bodies.  The complete signed envelope is compressed and sent
+             * with a Content-Encoding header.  The signature still covers the uncompressed payload so receivers only
+             * need to decode the content encoding.  Bodies that do not get smaller are sent uncompressed.
              *
-             * \param[in] jsonDocument A JSON document holding the received response.
+             * \param[in] newCompression The compression mode.
+             *
+             * \param[in] minimumSize    The smallest body, in bytes, that will be compressed.
+             *
+             * \param[in] level          The compression level, 0 through 9.  A value of -1 selects the zlib default.
              */
-            virtual void jsonResponseWasReceived(const QJsonDocument& jsonDocument);
+            void setCompression(
+                Compression newCompression,
+                unsigned    minimumSize = defaultCompressionThreshold,
+                int         level = -1
+            );
 
             /**
-             * Method you can overload to intercept non-JSON responses.  The default implementation triggers the
-             * \ref WebHook::responseReceived signal.
+             * Method you can use to obtain the current compression mode.
              *
-             * \param[in] rawData The raw response data.
+             * \return Returns the compression mode.
              */
-            virtual void responseWasReceived(const QByteArray& rawData);
+            Compression compression() const;
 
             /**
-             * Method you can overload to intercept failure notifications.  The default implementation triggers the
-             * \ref WebHook::failedToSend signal.
+             * Method you can use to obtain the smallest body that will be compressed.
              *
-             * \param[in] networkError The last reported network error.  This is the value of
-             *                         QNetworkReply::NetworkError cast to an integer.
+             * \return Returns the compression threshold, in bytes.
              */
-            virtual void failed(int networkError);
+            unsigned compressionThreshold() const;
 
-        private slots:
             /**
-             * Slot that is triggered in response to a timestamp adjustment.
+             * Method you can use to obtain the compression level.
+             *
+             * \return Returns the compression level.  A value of -1 indicates the zlib default.
              */
-            void timestampReplyReceived();
+            int compressionLevel() const;
 
             /**
-             * Slot that is triggered when a response to the requested message is received.
+             * Method you can use to select the message envelope format.  The binary CBOR envelope avoids base-64
+             * encoding the payload and is roughly 25% smaller than the JSON envelope.  Binary requests advertise
+             * support for CBOR responses, which are converted to JSON documents before they are reported.
+             *
+             * If a server rejects a binary envelope with HTTP status 415, Unsupported Media Type, the message is
+             * resent immediately using the JSON envelope and later messages to the same server use the JSON
+             * envelope.
+             *
+             * \param[in] newEnvelopeFormat The new envelope format.
              */
-            void messageResponseReceived();
+            void setEnvelopeFormat(EnvelopeFormat newEnvelopeFormat);
 
             /**
-             * Method that is called to send the requested message.
+             * Method you can use to obtain the selected message envelope format.
+             *
+             * \return Returns the selected envelope format.
              */
-            void doSend();
+            EnvelopeFormat envelopeFormat() const;
 
             /**
-             * Method that is called to trigger a request for a timestamp adjustment.
+             * Method you can use to discard response bodies.  This is intended for fire-and-forget messages where
+             * the server's response is never inspected.  When response bodies are discarded, responses are neither
+             * read nor parsed, \ref WebHook::jsonResponseReceived and \ref WebHook::responseReceived are not
+             * emitted, and \ref WebHook::messageDelivered reports an empty response.
+             *
+             * When response bodies are kept, responses are only parsed if something consumes the parsed response.
+             * That is a connection to \ref WebHook::jsonResponseReceived, a class derived from this class, or a
+             * batched message whose per-entry results are reported through \ref WebHook::messageDelivered.
+             *
+             * \param[in] nowDiscarded If true, response bodies will be discarded.  If false, response bodies will be
+             *                         kept.
              */
-            void doTimestampAdjustment();
+            void setResponseBodiesDiscarded(bool nowDiscarded = true);
 
-        private:
             /**
-             * Method that does common configuration for this object.
+             * Method you can use to determine if response bodies are discarded.
+             *
+             * \return Returns true if response bodies are discarded.  Returns false if response bodies are kept.
              */
-            void configure();
+            bool responseBodiesDiscarded() const;
 
             /**
-             * The maximum number of allowed retries.
+             * Method you can use to allow requests to be sent over HTTP/2.  When enabled, requests to the same origin
+             * are multiplexed over a single connection.  HTTP/2 is disabled by default.
+             *
+             * \param[in] nowEnabled If true, HTTP/2 will be negotiated with servers that support it.  If false, only
+             *                       HTTP/1.1 will be used.
              */
-            static constexpr unsigned maximumNumberRetries = 4;
+            void setHttp2Enabled(bool nowEnabled = true);
 
             /**
-             * The global timestamp secret.
+             * Method you can use to determine if requests may be sent over HTTP/2.
+             *
+             * \return Returns true if HTTP/2 is enabled.  Returns false if HTTP/2 is disabled.
              */
-            static QByteArray globalTimestampSecret;
+            bool http2Enabled() const;
 
             /**
-             * The global timestamp URL.
+             * Method you can use to control whether HTTP/1.1 connections are kept open between requests.  Keep-alive
+             * is enabled by default.  HTTP/2 connections are always kept open.
+             *
+             * \param[in] nowEnabled If true, connections will be reused.  If false, each request will ask the server
+             *                       to close the connection once the response is sent.
              */
-            static QUrl globalTimestampUrl;
+            void setKeepAliveEnabled(bool nowEnabled = true);
 
             /**
-             * The current time delta value.
+             * Method you can use to determine if HTTP/1.1 connections are kept open between requests.
+             *
+             * \return Returns true if keep-alive is enabled.  Returns false if keep-alive is disabled.
              */
-            static long long globalTimeDelta;
+            bool keepAliveEnabled() const;
 
             /**
-             * Timer used to trigger the message to be resent.
+             * Method you can use to set the header used to carry each message's idempotency key.  Every message is
+             * given a random key when it is first sent and the same key is sent with every retry so that the receiver
+             * can recognize a message it has already processed when an earlier response was lost.  Batches carry a
+             * single key.  Messages recovered from the spool are given a new key.  The "Idempotency-Key" header is
+             * used by default.
+             *
+             * \param[in] headerName The name of the header.  An empty value stops idempotency keys from being sent.
              */
-            QTimer* resendTimer;
+            void setIdempotencyKeyHeader(const QByteArray& headerName);
 
             /**
-             * Timer used to trigger the time delta to be recalculated.
+             * Method you can use to obtain the header used to carry each message's idempotency key.
+             *
+             * \return Returns the header name.  An empty value indicates idempotency keys are not sent.
              */
-            QTimer* timeDeltaTimer;
+            QByteArray idempotencyKeyHeader() const;
 
             /**
-             * The current webhook secret.
+             * Method you can use to enable removal of duplicate messages.  When enabled, a message whose destination,
+             * priority, and payload match a message still waiting to be sent is not sent again.  The duplicate is
+             * reported delivered, or failed, along with the original.  Messages that are in flight, or whose
+             * payload is streamed from a device, are never matched.  Duplicate removal is disabled by default.
+             *
+             * \param[in] nowEnabled If true, duplicate messages will be removed.
              */
-            QByteArray currentSecret;
+            void setDeduplicationEnabled(bool nowEnabled = true);
 
             /**
-             * The network access manager.
+             * Method you can use to determine if duplicate messages are removed.
+             *
+             * \return Returns true if duplicate messages are removed.
              */
-            QNetworkAccessManager* currentNetworkAccessManager;
+            bool deduplicationEnabled() const;
+
+        signals:
+            /**
+             * Signal that is emitted when a valid JSON response is received.
+             *
+             * \param[out] jsonDocument A JSON document holding the received response.
+             */
+            void jsonResponseReceived(const QJsonDocument& jsonDocument);
+
+            /**
+             * Signal that is emitted when a valid response is received.
+             *
+             * \param[out] rawData The raw response data.
+             */
+            void responseReceived(const QByteArray& rawData);
+
+            /**
+             * Signal that is emitted when no response has been received or an invalid response has been received.
+             *
+             * \param[out] networkError The last reported network error.  This is the value of
+             *                          QNetworkReply::NetworkError cast to an integer.
+             */
+            void failedToSend(int networkError);
+
+            /**
+             * Signal that is emitted when a specific message has been delivered.  This signal is emitted after
+             * \ref WebHook::responseReceived.
+             *
+             * \param[out] messageId The identifier returned by \ref WebHook::send for the message.
+             *
+             * \param[out] rawData   The raw response data.
+             */
+            void messageDelivered(unsigned long long messageId, const QByteArray& rawData);
+
+            /**
+             * Signal that is emitted when a specific message could not be delivered.  This signal is emitted after
+             * \ref WebHook::failedToSend.
+             *
+             * \param[out] messageId    The identifier returned by \ref WebHook::send for the message.
+             *
+             * \param[out] networkError The last reported network error.  This is the value of
+             *                          QNetworkReply::NetworkError cast to an integer.
+             */
+            void messageFailed(unsigned long long messageId, int networkError);
+
+            /**
+             * Signal that is emitted when a time delta this webhook requested has been received.  The time delta is
+             * shared across the process so the request may be answered by another webhook's timestamp request.
+             * Background refreshes and refreshes requested only by other webhooks do not trigger this signal.  This
+             * signal is primarily intended for test purposes.
+             */
+            void timeDeltaUpdated();
+
+        public slots:
+            /**
+             * Slot you can trigger to send a message.  The message is queued and will be sent as soon as an
+             * in-flight slot is available.
+             *
+             * \param[in] destinationUrl The URL where the message should be received.
+             *
+             * \param[in] jsonDocument   The JSON payload to be sent.
+             *
+             * \param[in] priority       The message priority.
+             *
+             * \return Returns an identifier for the message.
+             */
+            unsigned long long send(
+                const QUrl&          destinationUrl,
+                const QJsonDocument& jsonDocument,
+                Priority             priority = Priority::NORMAL
+            );
+
+            /**
+             * Slot you can trigger to send a message.  The message is queued and will be sent as soon as an
+             * in-flight slot is available.
+             *
+             * \param[in] destinationUrl The URL where the message should be received.
+             *
+             * \param[in] jsonObject     The JSON payload to be sent.
+             *
+             * \param[in] priority       The message priority.
+             *
+             * \return Returns an identifier for the message.
+             */
+            unsigned long long send(
+                const QUrl&        destinationUrl,
+                const QJsonObject& jsonObject,
+                Priority           priority = Priority::NORMAL
+            );
+
+            /**
+             * Slot you can trigger to send a large payload held in a device.  The payload is read, signed, and encoded
+             * a chunk at a time while the request is uploaded so memory use does not depend on the payload size.  The
+             * envelope is identical to the envelope used for other messages.
+             *
+             * Streamed payloads are not spooled, batched, compressed, or sent using the binary envelope.  The payload
+             * runs from the current position of the device to the end of the device.
+             *
+             * \param[in] destinationUrl The URL where the message should be received.
+             *
+             * \param[in] payload        The device holding the payload.  The device must be open, readable, and random
+             *                           access and must remain valid until the message is delivered or fails.  The
+             *                           device is not owned by the webhook.
+             *
+             * \param[in] priority       The message priority.
+             *
+             * \return Returns an identifier for the message.  A value of 0 is returned if the device can not be used.
+             */
+            unsigned long long send(
+                const QUrl& destinationUrl,
+                QIODevice*  payload,
+                Priority    priority = Priority::NORMAL
+            );
+
+            /**
+             * Slot you can trigger to send the contents of a file.  The file is streamed in the same way as payloads
+             * sent from a device.
+             *
+             * \param[in] destinationUrl The URL where the message should be received.
+             *
+             * \param[in] filePath       The path to the file holding the payload.
+             *
+             * \param[in] priority       The message priority.
+             *
+             * \return Returns an identifier for the message.  A value of 0 is returned if the file can not be opened.
+             */
+            unsigned long long send(
+                const QUrl&    destinationUrl,
+                const QString& filePath,
+                Priority       priority = Priority::NORMAL
+            );
+
+            /**
+             * Slot you can trigger to send one message to several destinations sharing the webhook secret.  The
+             * payload is serialized once and the signed envelope is built once and shared by every destination, so
+             * the cost of signing does not grow with the number of destinations.
+             *
+             * Each destination is tracked as a separate message with its own identifier, retries, and result.
+             * Messages sent this way are not batched.
+             *
+             * \param[in] destinationUrls The URLs where the message should be received.
+             *
+             * \param[in] jsonDocument    The JSON payload to be sent.
+             *
+             * \param[in] priority        The message priority.
+             *
+             * 
+eturn Returns an identifier for each destination, in the same order as the destination URLs.
+             */
+            QList<unsigned long long> send(
+                const QList<QUrl>&   destinationUrls,
+                const QJsonDocument& jsonDocument,
+                Priority             priority = Priority::NORMAL
+            );
+
+            /**
+             * Slot you can trigger to send one message to several destinations sharing the webhook secret.  The
+             * message is sent in the same way as a JSON document sent to several destinations.
+             *
+             * \param[in] destinationUrls The URLs where the message should be received.
+             *
+             * \param[in] jsonObject      The JSON payload to be sent.
+             *
+             * \param[in] priority        The message priority.
+             *
+             * 
+eturn Returns an identifier for each destination, in the same order as the destination URLs.
+             */
+            QList<unsigned long long> send(
+                const QList<QUrl>& destinationUrls,
+                const QJsonObject& jsonObject,
+                Priority           priority = Priority::NORMAL
+            );
+
+            /**
+             * Slot you can trigger to force a time delta adjustment.
+             */
+            void forceTimeDeltaAdjustment();
+
+            /**
+             * Slot you can trigger to immediately send any partially filled batches.
+             */
+            void flush();
+
+            /**
+             * Slot you can trigger to open connections to a destination and to the timestamp server ahead of time so
+             * the first message after a quiet period does not pay for DNS lookup and the TCP and TLS handshakes.
+             * Connections are opened in the background and are reused by later requests while they remain open.
+             *
+             * \param[in] destinationUrl A URL on the server that will receive messages.
+             */
+            void warmUp(const QUrl& destinationUrl);
+
+        protected:
+            /**
+             * Method you can overload to intercept valid responses.  The default implementation triggers the
+             * \ref WebHook::jsonResponseReceived signal.
+             *
+             * \param[in] jsonDocument A JSON document holding the received response.
+             */
+            virtual void jsonResponseWasReceived(const QJsonDocument& jsonDocument);
+
+            /**
+             * Method you can overload to intercept non-JSON responses.  The default implementation triggers the
+             * \ref WebHook::responseReceived signal.
+             *
+             * \param[in] rawData The raw response data.
+             */
+            virtual void responseWasReceived(const QByteArray& rawData);
+
+            /**
+             * Method you can overload to intercept failure notifications.  The default implementation triggers the
+             * \ref WebHook::failedToSend signal.
+             *
+             * \param[in] networkError The last reported network error.  This is the value of
+             *                         QNetworkReply::NetworkError cast to an integer.
+             */
+            virtual void failed(int networkError);
+
+        private slots:
+            /**
+             * Slot that is triggered in response to a timestamp adjustment.
+             */
+            void timestampReplyReceived();
+
+            /**
+             * Slot that is triggered when a response to the requested message is received.
+             */
+            void messageResponseReceived();
+
+            /**
+             * Method that is called to trigger a request for a timestamp adjustment.
+             */
+            void doTimestampAdjustment();
+
+            /**
+             * Slot that is triggered when any webhook in the process has updated the time delta.
+             */
+            void timeDeltaRefreshed();
+
+            /**
+             * Slot that is triggered when the process-wide timestamp request has failed.
+             *
+             * \param[in] networkError The last reported network error.
+             */
+            void timeDeltaRefreshFailed(int networkError);
+
+            /**
+             * Slot that is triggered when the webhook making the process-wide timestamp request was destroyed before
+             * the request completed.
+             */
+            void timeDeltaRefreshAbandoned();
+
+            /**
+             * Slot that is triggered when a background time delta refresh may be due.
+             */
+            void refreshTimeDelta();
+
+        private:
+            /**
+             * Class used to track a single outbound message.  Defined in the implementation.
+             */
+            class Message;
+
+            /**
+             * Class used to track a payload waiting to be sent.  Defined in the implementation.
+             */
+            class PendingPayload;
+
+            /**
+             * Class used to share a signed envelope between messages with the same payload.  Defined in the
+             * implementation.
+             */
+            class SharedEnvelope;
+
+            /**
+             * Method that does common configuration for this object.
+             */
+            void configure();
+
+            /**
+             * Method that requests a new time delta.  If no other webhook is making a timestamp request, this webhook
+             * makes the request, otherwise this webhook waits on the request already in flight.
+             */
+            void requestTimeDelta();
+
+            /**
+             * Method that schedules the next background time delta refresh.
+             */
+            void scheduleTimeDeltaRefresh();
+
+            /**
+             * Method that moves messages posted from other threads onto the outbound queue.
+             */
+            void drainSubmissions();
+
+            /**
+             * Method that spools a message and then either queues it or adds it to a batch.
+             *
+             * \param[in] messageId      The identifier assigned to the message.
+             *
+             * \param[in] destinationUrl The URL where the message should be received.
+             *
+             * \param[in] payload        The serialized payload to be sent.
+             *
+             * \param[in] priority       The message priority.
+             */
+            void submit(
+                unsigned long long messageId,
+                const QUrl&        destinationUrl,
+                const QByteArray&  payload,
+                Priority           priority
+            );
+
+            /**
+             * Method that queues a message for transmission.
+             *
+             * \param[in] messageId      The identifier assigned to the message.
+             *
+             * \param[in] destinationUrl The URL where the message should be received.
+             *
+             * \param[in] payload        The serialized payload to be sent.
+             *
+             * \param[in] spoolId        The spool record holding the payload.  A value of 0 indicates the payload is
+             *                           not spooled.
+             *
+             * \param[in] priority       The message priority.
+             *
+             * \param[in] envelope       The envelope shared with other messages carrying the same payload.  A null
+             *                           pointer indicates the envelope is not shared.
+             */
+            void enqueue(
+                unsigned long long                    messageId,
+                const QUrl&                           destinationUrl,
+                const QByteArray&                     payload,
+                unsigned long long                    spoolId,
+                Priority                              priority,
+                const QSharedPointer<SharedEnvelope>& envelope = QSharedPointer<SharedEnvelope>()
+            );
+
+            /**
+             * Method that adds a payload to the open batch for a destination.
+             *
+             * \param[in] payloadId      The identifier assigned to the payload.
+             *
+             * \param[in] destinationUrl The URL where the message should be received.
+             *
+             * \param[in] payload        The serialized payload to be sent.
+             *
+             * \param[in] spoolId        The spool record holding the payload.  A value of 0 indicates the payload is
+             *                           not spooled.
+             *
+             * \param[in] priority       The message priority.
+             */
+            void addToBatch(
+                unsigned long long payloadId,
+                const QUrl&        destinationUrl,
+                const QByteArray&  payload,
+                unsigned long long spoolId,
+                Priority           priority
+            );
+
+            /**
+             * Method that closes a batch and queues it for transmission.
+             *
+             * \param[in] batch The batch to be sent.
+             */
+            void flushBatch(Message* batch);
+
+            /**
+             * Method that queues a message whose payload is streamed from a device.
+             *
+             * \param[in] destinationUrl The URL where the message should be received.
+             *
+             * \param[in] payload        The device holding the payload.
+             *
+             * \param[in] ownsDevice     If true, the message takes ownership of the device.
+             *
+             * \param[in] priority       The message priority.
+             *
+             * \return Returns an identifier for the message.  A value of 0 is returned if the device can not be used.
+             */
+            unsigned long long enqueueStream(
+                const QUrl& destinationUrl,
+                QIODevice*  payload,
+                bool        ownsDevice,
+                Priority    priority
+            );
+
+            /**
+             * Method that places a message on the outbound queue.
+             *
+             * \param[in] message The message to be queued.
+             */
+            void queueMessage(Message* message);
+
+            /**
+             * Method that attaches a message to an identical message that is still waiting to be sent.
+             *
+             * \param[in] messageId      The identifier assigned to the message.
+             *
+             * \param[in] destinationUrl The URL where the message should be received.
+             *
+             * \param[in] payload        The serialized payload.
+             *
+             * \param[in] priority       The message priority.
+             *
+             * \return Returns true if the message was a duplicate.  Returns false if the message should be sent.
+             */
+            bool deduplicate(
+                unsigned long long messageId,
+                const QUrl&        destinationUrl,
+                const QByteArray&  payload,
+                Priority           priority
+            );
+
+            /**
+             * Method that records a payload waiting to be sent so that later duplicates can be found.
+             *
+             * \param[in] message   The message carrying the payload.
+             *
+             * \param[in] payloadId The identifier assigned to the payload.
+             *
+             * \param[in] payload   The serialized payload.
+             */
+            void addPendingPayload(Message* message, unsigned long long payloadId, const QByteArray& payload);
+
+            /**
+             * Method that forgets the payloads carried by a message once the message is sent or discarded.
+             *
+             * \param[in] message The message.
+             */
+            void removePendingPayloads(Message* message);
+
+            /**
+             * Method that reports a payload, and any duplicates of it, as delivered.
+             *
+             * \param[in] message   The message that carried the payload.
+             *
+             * \param[in] payloadId The identifier assigned to the payload.
+             *
+             * \param[in] rawData   The response data to be reported.
+             */
+            void emitDelivered(Message* message, unsigned long long payloadId, const QByteArray& rawData);
+
+            /**
+             * Method that reports a payload, and any duplicates of it, as failed.
+             *
+             * \param[in] message      The message that carried the payload.
+             *
+             * \param[in] payloadId    The identifier assigned to the payload.
+             *
+             * \param[in] networkError The last reported network error.
+             */
+            void emitFailed(Message* message, unsigned long long payloadId, int networkError);
+
+            /**
+             * Method that generates a new idempotency key.
+             *
+             * \return Returns a random key, encoded as hexadecimal.
+             */
+            static QByteArray newIdempotencyKey();
+
+            /**
+             * Method that reports a successful response to every submitter of a message.
+             *
+             * \param[in] message  The message that was delivered.
+             *
+             * \param[in] response The response.  The response is only decoded if a batch needs per-entry results.
+             */
+            void reportDelivered(Message* message, Response& response);
+
+            /**
+             * Method that determines if anything consumes parsed responses.
+             *
+             * \return Returns true if responses should be parsed.
+             */
+            bool jsonResponsesConsumed() const;
+
+            /**
+             * Method that selects the priority whose queued message should be sent next.
+             *
+             * \param[out] priority Receives the selected priority.
+             *
+             * \return Returns true if a message can be sent.  Returns false if no queue holds a message that fits
+             *         within its priority's in-flight limit.
+             */
+            bool nextPriority(unsigned& priority);
+
+            /**
+             * Method that moves queued messages into flight until the in-flight limit is reached.
+             */
+            void dispatchMessages();
+
+            /**
+             * Method that moves messages held back by flow control into flight once their destination can accept
+             * them.
+             */
+            void dispatchThrottledMessages();
+
+            /**
+             * Method that asks the circuit breaker if a message can be sent.
+             *
+             * \param[in] message The message to be sent.
+             *
+             * \return Returns true if the message can be sent.  Returns false if the destination's circuit is open.
+             */
+            bool circuitAllows(Message* message);
+
+            /**
+             * Method that asks flow control for permission to send a message.  Messages that can not be sent yet are
+             * held back until their destination can accept them.
+             *
+             * \param[in] message The message to be sent.
+             *
+             * \return Returns true if the message can be sent now.  Returns false if the message was held back.
+             */
+            bool admit(Message* message);
+
+            /**
+             * Method that arranges for held back messages to be checked again.
+             *
+             * \param[in] wait The time until a token is available, in microseconds.  A negative value indicates the
+             *                 destination is at its concurrency limit.
+             */
+            void scheduleThrottleCheck(long long wait);
+
+            /**
+             * Method that gives a message an in-flight slot and sends it.
+             *
+             * \param[in] message The message to be sent.
+             */
+            void startMessage(Message* message);
+
+            /**
+             * Method that classifies a reply for flow control.
+             *
+             * \param[in] reply The reply to be classified.
+             *
+             * \return Returns the outcome of the request.
+             */
+            static FlowControl::Outcome flowOutcome(QNetworkReply* reply);
+
+            /**
+             * Method that determines if a reply indicates the destination is down.
+             *
+             * \param[in] reply The reply to be checked.
+             *
+             * \return Returns true if no HTTP response was received or the server reported a 5xx status.
+             */
+            static bool destinationFailed(QNetworkReply* reply);
+
+            /**
+             * Method that is called to send a message.
+             *
+             * \param[in] message The message to be sent.
+             */
+            void doSend(Message* message);
+
+            /**
+             * Method that sends a message whose payload is streamed from a device.
+             *
+             * \param[in] message The message to be sent.
+             *
+             * \param[in] request The request holding the common headers.
+             *
+             * \param[in] minute  The minute used to derive the signing key.
+             *
+             * \return Returns the size of the request body, in bytes.
+             */
+            qint64 doSendStream(Message* message, QNetworkRequest& request, long long minute);
+
+            /**
+             * Method that sends a message whose payload is held in memory.
+             *
+             * \param[in] message The message to be sent.
+             *
+             * \param[in] request The request holding the common headers.
+             *
+             * \param[in] minute  The minute used to derive the signing key.
+             *
+             * \return Returns the size of the request body, in bytes.
+             */
+            qint64 doSendBuffered(Message* message, QNetworkRequest& request, long long minute);
+
+            /**
+             * Method that signs, encodes, and compresses the envelope for a message whose payload is held in memory.
+             *
+             * \param[in]  message         The message to be sent.
+             *
+             * \param[in]  minute          The minute used to derive the signing key.
+             *
+             * \param[out] contentEncoding The content encoding applied to the envelope.  An empty value indicates
+             *                             the envelope is not compressed.
+             *
+             * \return Returns the request body.
+             */
+            QByteArray buildEnvelope(Message* message, long long minute, QByteArray& contentEncoding);
+
+            /**
+             * Method that applies the connection settings to a request.
+             *
+             * \param[in] request The request to be updated.
+             */
+            void applyConnectionSettings(QNetworkRequest& request) const;
+
+            /**
+             * Method that opens a connection to the server holding a URL.
+             *
+             * \param[in] url The URL of interest.
+             */
+            void preconnect(const QUrl& url);
+
+            /**
+             * Method that schedules a message to be resent.
+             *
+             * \param[in] message The message to be resent.
+             *
+             * \param[in] delay   The delay before the message is resent, in milliseconds.
+             */
+            void scheduleResend(Message* message, long long delay);
+
+            /**
+             * Method that determines the origin of a URL.  The origin is used to track servers that do not accept
+             * the binary envelope.
+             *
+             * \param[in] url The URL to be checked.
+             *
+             * \return Returns the URL with the path, query and fragment removed.
+             */
+            static QUrl origin(const QUrl& url);
+
+            /**
+             * Method that determines the delay requested by the server through the Retry-After header.
+             *
+             * \param[in] reply The reply to be checked.
+             *
+             * \return Returns the requested delay, in milliseconds.  A negative value is returned if the server did
+             *         not request a delay.
+             */
+            static long long retryAfter(QNetworkReply* reply);
+
+            /**
+             * Method that removes a delivered message from the spool.
+             *
+             * \param[in] message The delivered message.
+             */
+            void acknowledge(Message* message);
+
+            /**
+             * Method that locates the destination metrics for a message, once per metrics object, so that later
+             * updates need no lookup.  Does nothing if metrics collection is disabled.
+             *
+             * \param[in] message The message to be updated.
+             */
+            void resolveMetrics(Message* message);
+
+            /**
+             * Method that completes a message, releasing its in-flight slot.
+             *
+             * \param[in] message The message to be completed.
+             */
+            void releaseMessage(Message* message);
+
+            /**
+             * Method that reports a message as failed to every submitter.
+             *
+             * \param[in] message      The message that failed.
+             *
+             * \param[in] networkError The last reported network error.
+             */
+            void reportFailed(Message* message, int networkError);
+
+            /**
+             * Method that reports a message as failed and releases its in-flight slot.
+             *
+             * \param[in] message      The message that failed.
+             *
+             * \param[in] networkError The last reported network error.
+             */
+            void failMessage(Message* message, int networkError);
+
+            /**
+             * Method that fails a queued message without sending it.
+             *
+             * \param[in] message The message to be rejected.  The message must not hold an in-flight slot.
+             */
+            void rejectMessage(Message* message);
+
+            /**
+             * The default maximum number of in-flight messages.
+             */
+            static constexpr unsigned defaultMaximumInFlight = 8;
+
+            /**
+             * The default maximum number of payloads in a batch.
+             */
+            static constexpr unsigned defaultBatchMaximumCount = 100;
+
+            /**
+             * The default maximum size of a batch, in bytes.
+             */
+            static constexpr unsigned defaultBatchMaximumBytes = 65536;
+
+            /**
+             * The default maximum batching delay, in milliseconds.
+             */
+            static constexpr unsigned defaultBatchMaximumDelay = 1000;
+
+            /**
+             * The interval, in milliseconds, at which messages held back by another webhook's use of a shared
+             * concurrency limit are checked again.
+             */
+            static constexpr unsigned throttleRecheckInterval = 10;
+
+            /**
+             * Mutex used to guard the global timestamp secret and URL.
+             */
+            static QMutex globalTimestampMutex;
+
+            /**
+             * The global timestamp secret.
+             */
+            static QByteArray globalTimestampSecret;
+
+            /**
+             * The global timestamp URL.
+             */
+            static QUrl globalTimestampUrl;
+
+            /**
+             * Timer used to trigger the time delta to be recalculated.
+             */
+            QTimer* timeDeltaTimer;
+
+            /**
+             * Timer used to flush partially filled batches.
+             */
+            QTimer* batchTimer;
+
+            /**
+             * Timer used to trigger background time delta refreshes.
+             */
+            QTimer* refreshTimer;
+
+            /**
+             * Timer used to check messages held back by flow control.
+             */
+            QTimer* throttleTimer;
+
+            /**
+             * The background time delta refresh interval, in milliseconds.
+             */
+            unsigned currentTimeDeltaRefreshInterval;
+
+            /**
+             * The current webhook secret.
+             */
+            QByteArray currentSecret;
+
+            /**
+             * The network access manager.
+             */
+            QNetworkAccessManager* currentNetworkAccessManager;
+
+            /**
+             * Cache of per-minute signing keys derived from the webhook secret.
+             */
+            SigningKeyCache* signingKeys;
+
+            /**
+             * The spool used to hold undelivered messages.  A null pointer indicates that no spool is in use.
+             */
+            Spool* currentSpool;
+
+            /**
+             * Flag indicating if spool writes wait for records to reach storage.
+             */
+            bool currentSpoolSynchronous;
+
+            /**
+             * The in-flight timestamp reply we're waiting to receive.  A null pointer indicates that no timestamp
+             * request is pending.
+             */
+            QNetworkReply* pendingTimestampReply;
+
+            /**
+             * The number of timestamp requests made for the current time delta adjustment.
+             */
+            unsigned timestampAttempts;
+
+            /**
+             * Flag indicating that this webhook is making the process-wide timestamp request.
+             */
+            bool timeDeltaLeader;
+
+            /**
+             * Flag indicating that this webhook is waiting on a new time delta.
+             */
+            bool awaitingTimeDelta;
+
+            /**
+             * The policy used to retry failed requests.
+             */
+            QSharedPointer<RetryPolicy> currentRetryPolicy;
+
+            /**
+             * The object used to collect delivery metrics.  A null pointer indicates metrics are not collected.
+             */
+            QSharedPointer<Metrics> currentMetrics;
+
+            /**
+             * The object used to limit the load on each destination.  A null pointer indicates flow control is
+             * disabled.
+             */
+            QSharedPointer<FlowControl> currentFlowControl;
+
+            /**
+             * The object used to stop sending to destinations that are down.  A null pointer indicates no circuit
+             * breaker is used.
+             */
+            QSharedPointer<CircuitBreaker> currentCircuitBreaker;
+
+            /**
+             * Messages held back by flow control, in send order, keyed by destination origin.
+             */
+            QHash<QString, QQueue<Message*>> throttledMessages;
+
+            /**
+             * The number of messages held back by flow control, indexed by priority.
+             */
+            unsigned throttledByPriority[numberPriorities];
+
+            /**
+             * The maximum number of in-flight messages.
+             */
+            unsigned currentMaximumInFlight;
+
+            /**
+             * The identifier to assign to the next message.  Identifiers can be assigned from any thread.
+             */
+            std::atomic<unsigned long long> nextMessageId;
+
+            /**
+             * Queue of messages posted from other threads.
+             */
+            SubmissionQueue* submissions;
+
+            /**
+             * Messages waiting for an in-flight slot, in send order, indexed by priority.
+             */
+            QQueue<Message*> queuedMessages[numberPriorities];
+
+            /**
+             * The number of in-flight messages, indexed by priority.
+             */
+            unsigned inFlightByPriority[numberPriorities];
+
+            /**
+             * The maximum number of in-flight messages, indexed by priority.  A value of 0 indicates no limit.
+             */
+            unsigned currentPriorityMaximumInFlight[numberPriorities];
+
+            /**
+             * The weighted scheduling weights, indexed by priority.
+             */
+            unsigned currentPriorityWeights[numberPriorities];
+
+            /**
+             * The running weighted round robin credits, indexed by priority.
+             */
+            long long schedulingCredits[numberPriorities];
+
+            /**
+             * The scheduling mode.
+             */
+            Scheduling currentScheduling;
+
+            /**
+             * Messages currently holding an in-flight slot, keyed by message identifier.
+             */
+            QHash<unsigned long long, Message*> activeMessages;
+
+            /**
+             * Messages with an outstanding network reply, keyed by the reply.
+             */
+            QHash<QNetworkReply*, Message*> messagesByReply;
+
+            /**
+             * Messages that will be resent once the time delta has been updated.
+             */
+            QList<Message*> messagesAwaitingTimeDelta;
+
+            /**
+             * Flag indicating if batching is enabled.
+             */
+            bool currentBatchingEnabled;
+
+            /**
+             * The maximum number of payloads in a batch.
+             */
+            unsigned currentBatchMaximumCount;
+
+            /**
+             * The maximum size of a batch, in bytes.
+             */
+            unsigned currentBatchMaximumBytes;
+
+            /**
+             * The maximum batching delay, in milliseconds.
+             */
+            unsigned currentBatchMaximumDelay;
+
+            /**
+             * Batches that are still accepting payloads, keyed by destination and priority.
+             */
+            QHash<QPair<QUrl, unsigned>, Message*> openBatches;
+
+            /**
+             * The request body compression mode.
+             */
+            Compression currentCompression;
+
+            /**
+             * The smallest body, in bytes, that will be compressed.
+             */
+            unsigned currentCompressionThreshold;
+
+            /**
+             * The compression level.
+             */
+            int currentCompressionLevel;
+
+            /**
+             * The selected envelope format.
+             */
+            EnvelopeFormat currentEnvelopeFormat;
+
+            /**
+             * Servers that rejected the binary envelope.
+             */
+            QSet<QUrl> jsonOnlyOrigins;
+
+            /**
+             * Flag indicating if response bodies are discarded.
+             */
+            bool currentResponseBodiesDiscarded;
+
+            /**
+             * Flag indicating if HTTP/2 is enabled.
+             */
+            bool currentHttp2Enabled;
 
             /**
-             * The currently in-flight reply we're waiting to receive.  A null pointer indicates that
+             * Flag indicating if HTTP/1.1 keep-alive is enabled.
              */
-            QNetworkReply* pendingReply;
+            bool currentKeepAliveEnabled;
 
             /**
-             * The number of remaining retries.
+             * The header used to carry idempotency keys.  An empty value indicates keys are not sent.
              */
-            unsigned remainingRetries;
+            QByteArray currentIdempotencyKeyHeader;
 
             /**
-             * The current destination URL.
+             * Flag indicating if duplicate messages are removed.
              */
-            QUrl currentUrl;
+            bool currentDeduplicationEnabled;
 
             /**
-             * The payload to be sent.
+             * Payloads waiting to be sent, keyed by a hash of the destination, priority, and payload.
              */
-            QByteArray currentPayload;
+            QMultiHash<uint, PendingPayload*> pendingPayloads;
     };
 }
 
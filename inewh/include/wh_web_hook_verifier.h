@@ -0,0 +1,400 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::WebHookVerifier class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inewh */
+
+#ifndef WH_WEB_HOOK_VERIFIER_H
+#define WH_WEB_HOOK_VERIFIER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QMap>
+#include <QSet>
+#include <QMutex>
+
+#include <atomic>
+
+#include "wh_common.h"
+
+class QThreadPool;
+
+namespace Wh {
+    class SigningKeyCache;
+
+    /**
+     * Class that verifies signed envelopes on the receiving side of a webhook.  This is the inverse of the signing
+     * done by \ref Wh::WebHook.
+     *
+     * A message envelope holds the payload and an HMAC-SHA256 signature keyed with a key derived from the webhook
+     * secret and the minute the message was signed.  An envelope is accepted if it was signed in the current minute
+     * or in either adjacent minute so small clock differences and transit time are tolerated.  Derived keys are
+     * cached so verifying a message only costs hashing the message.
+     *
+     * Both the JSON envelope and the CBOR envelope are accepted.  Bodies must be decompressed before they are
+     * verified.
+     *
+     * Replay protection can optionally be enabled.  When enabled, the signature of every accepted envelope is
+     * remembered for as long as the envelope could still be accepted and a second envelope with the same signature is
+     * rejected.  Identical payloads sent within the same minute carry identical signatures so senders should include
+     * a unique value, such as a message ID, in each payload when replay protection is used.
+     *
+     * The class also verifies requests sent to the timestamp endpoint, which are signed directly with the timestamp
+     * secret.
+     *
+     * All verification methods can be called from multiple threads at once.
+     */
+    class WH_PUBLIC_API WebHookVerifier {
+        public:
+            /**
+             * Enumeration of verification outcomes.
+             */
+            enum class Status {
+                /**
+                 * Indicates the envelope is authentic.
+                 */
+                VALID,
+
+                /**
+                 * Indicates the body is not a valid envelope.
+                 */
+                MALFORMED,
+
+                /**
+                 * Indicates the signature does not match the payload.  This is also reported for envelopes signed
+                 * outside of the accepted minutes.
+                 */
+                BAD_SIGNATURE,
+
+                /**
+                 * Indicates the envelope is authentic but was already accepted.
+                 */
+                REPLAYED
+            };
+
+            /**
+             * The smallest number of envelopes handed to each thread by \ref WebHookVerifier::verify.  Smaller
+             * batches are verified on the calling thread.
+             */
+            static constexpr unsigned minimumBatchPerThread = 64;
+
+            /**
+             * Class that holds a received request body to be verified.
+             */
+            class WH_PUBLIC_API Envelope {
+                public:
+                    /**
+                     * Constructor.  Creates an empty envelope.
+                     */
+                    Envelope();
+
+                    /**
+                     * Constructor
+                     *
+                     * \param[in] body        The request body.
+                     *
+                     * \param[in] contentType The value of the request Content-Type header.
+                     */
+                    Envelope(const QByteArray& body, const QString& contentType = QString("application/json"));
+
+                    /**
+                     * Method you can use to obtain the request body.
+                     *
+                     * \return Returns the request body.
+                     */
+                    const QByteArray& body() const;
+
+                    /**
+                     * Method you can use to obtain the request content type.
+                     *
+                     * \return Returns the request content type.
+                     */
+                    const QString& contentType() const;
+
+                private:
+                    /**
+                     * The request body.
+                     */
+                    QByteArray currentBody;
+
+                    /**
+                     * The request content type.
+                     */
+                    QString currentContentType;
+            };
+
+            /**
+             * Class that holds the outcome of verifying an envelope.
+             */
+            class WH_PUBLIC_API Result {
+                public:
+                    /**
+                     * Constructor.  Creates a result reporting a malformed envelope.
+                     */
+                    Result();
+
+                    /**
+                     * Constructor
+                     *
+                     * \param[in] status  The verification status.
+                     *
+                     * \param[in] payload The decoded payload.
+                     */
+                    Result(Status status, const QByteArray& payload = QByteArray());
+
+                    /**
+                     * Method you can use to obtain the verification status.
+                     *
+                     * \return Returns the verification status.
+                     */
+                    Status status() const;
+
+                    /**
+                     * Method you can use to determine if the envelope is authentic and was not replayed.
+                     *
+                     * \return Returns true if the status is \ref WebHookVerifier::Status::VALID.
+                     */
+                    bool isValid() const;
+
+                    /**
+                     * Method you can use to obtain the decoded payload.
+                     *
+                     * \return Returns the decoded payload.  An empty byte array is returned if the envelope is not
+                     *         valid.
+                     */
+                    const QByteArray& payload() const;
+
+                private:
+                    /**
+                     * The verification status.
+                     */
+                    Status currentStatus;
+
+                    /**
+                     * The decoded payload.
+                     */
+                    QByteArray currentPayload;
+            };
+
+            /**
+             * Constructor
+             *
+             * \param[in] webhookSecret   The secret shared with the senders.
+             *
+             * \param[in] timestampSecret The secret used to sign timestamp requests.
+             */
+            WebHookVerifier(const QByteArray& webhookSecret, const QByteArray& timestampSecret = QByteArray());
+
+            ~WebHookVerifier();
+
+            /**
+             * Method you can use to change the webhook secret.  This method should not be called while envelopes are
+             * being verified.
+             *
+             * \param[in] newWebhookSecret The new webhook secret.
+             */
+            void setWebhookSecret(const QByteArray& newWebhookSecret);
+
+            /**
+             * Method you can use to change the timestamp secret.  This method should not be called while envelopes
+             * are being verified.
+             *
+             * \param[in] newTimestampSecret The new timestamp secret.
+             */
+            void setTimestampSecret(const QByteArray& newTimestampSecret);
+
+            /**
+             * Method you can use to apply an offset to the local clock.  The offset is used to pick the accepted
+             * minutes and the time reported to timestamp requests.
+             *
+             * \param[in] newTimeDelta The offset, in milliseconds.
+             */
+            void setTimeDelta(long long newTimeDelta);
+
+            /**
+             * Method you can use to obtain the offset applied to the local clock.
+             *
+             * \return Returns the offset, in milliseconds.
+             */
+            long long timeDelta() const;
+
+            /**
+             * Method you can use to enable or disable replay protection.  Replay protection is disabled by default.
+             *
+             * \param[in] nowEnabled If true, replay protection will be enabled.
+             */
+            void setReplayProtectionEnabled(bool nowEnabled = true);
+
+            /**
+             * Method you can use to determine if replay protection is enabled.
+             *
+             * \return Returns true if replay protection is enabled.
+             */
+            bool replayProtectionEnabled() const;
+
+            /**
+             * Method you can use to set the maximum number of threads used to verify batches.
+             *
+             * \param[in] newMaximumThreads The maximum number of threads.  A value of 0 selects one thread per
+             *                              core.
+             */
+            void setMaximumThreads(unsigned newMaximumThreads);
+
+            /**
+             * Method you can use to obtain the maximum number of threads used to verify batches.
+             *
+             * \return Returns the maximum number of threads.
+             */
+            unsigned maximumThreads() const;
+
+            /**
+             * Method you can use to verify a single envelope.
+             *
+             * \param[in] body        The request body.
+             *
+             * \param[in] contentType The value of the request Content-Type header.
+             *
+             * \return Returns the verification result.
+             */
+            Result verify(const QByteArray& body, const QString& contentType = QString("application/json"));
+
+            /**
+             * Method you can use to verify a single envelope.
+             *
+             * \param[in] envelope The envelope to be verified.
+             *
+             * \return Returns the verification result.
+             */
+            Result verify(const Envelope& envelope);
+
+            /**
+             * Method you can use to verify a batch of envelopes.  Large batches are split across threads.  Replay
+             * protection is applied in batch order so the first of two identical envelopes is the one accepted.
+             *
+             * \param[in] envelopes The envelopes to be verified.
+             *
+             * \return Returns the verification results, in the same order as the envelopes.
+             */
+            QVector<Result> verify(const QVector<Envelope>& envelopes);
+
+            /**
+             * Method you can use to verify a request sent to the timestamp endpoint.  The payload of a valid request
+             * holds the client time, in milliseconds since the epoch, as decimal text.
+             *
+             * \param[in] body        The request body.
+             *
+             * \param[in] contentType The value of the request Content-Type header.
+             *
+             * \return Returns the verification result.  Requests whose payload is not a time are reported as
+             *         malformed.
+             */
+            Result verifyTimestamp(const QByteArray& body, const QString& contentType = QString("application/json"));
+
+            /**
+             * Method you can use to calculate the value the timestamp endpoint should reply with.
+             *
+             * \param[in] timestampResult The result of verifying the timestamp request.
+             *
+             * \return Returns the difference, in milliseconds, between the local clock, including the time delta,
+             *         and the client clock.  A value of 0 is returned if the result is not valid.
+             */
+            long long clockOffset(const Result& timestampResult) const;
+
+        private:
+            /**
+             * Class that holds the intermediate outcome of checking one envelope.
+             */
+            class Check;
+
+            /**
+             * Method that checks the signatures of a range of envelopes.
+             *
+             * \param[in]  envelopes Pointer to the first envelope.
+             *
+             * \param[out] checks    Pointer to the first check to be populated.
+             *
+             * \param[in]  count     The number of envelopes to check.
+             *
+             * \param[in]  minute    The current minute.
+             */
+            void checkRange(const Envelope* envelopes, Check* checks, unsigned count, long long minute);
+
+            /**
+             * Method that rejects replayed envelopes and records the signatures of newly accepted envelopes.
+             *
+             * \param[in,out] checks The checks to be updated.
+             *
+             * \param[in]     count  The number of checks.
+             *
+             * \param[in]     minute The current minute.
+             */
+            void rejectReplays(Check* checks, unsigned count, long long minute);
+
+            /**
+             * The webhook secret.
+             */
+            QByteArray currentWebhookSecret;
+
+            /**
+             * The timestamp secret.
+             */
+            QByteArray currentTimestampSecret;
+
+            /**
+             * The offset applied to the local clock, in milliseconds.
+             */
+            std::atomic<long long> currentTimeDelta;
+
+            /**
+             * Flag indicating if replay protection is enabled.
+             */
+            std::atomic<bool> currentReplayProtectionEnabled;
+
+            /**
+             * Mutex used to guard the signing key cache.
+             */
+            QMutex signingKeyMutex;
+
+            /**
+             * The signing key cache.
+             */
+            SigningKeyCache* signingKeys;
+
+            /**
+             * Mutex used to guard the accepted signatures.
+             */
+            QMutex replayMutex;
+
+            /**
+             * The signatures of accepted envelopes, by signing minute.
+             */
+            QMap<long long, QSet<QByteArray>> acceptedSignatures;
+
+            /**
+             * The pool used to verify large batches.
+             */
+            QThreadPool* threadPool;
+    };
+}
+
+#endif
@@ -32,12 +32,45 @@ CONFIG += static c++14
 INCLUDEPATH += include
 HEADERS = include/wh_common.h \
           include/wh_web_hook.h \
+          include/wh_retry_policy.h \
+          include/wh_flow_control.h \
+          include/wh_circuit_breaker.h \
+          include/wh_metrics.h \
+          include/wh_web_hook_verifier.h \
 
 ########################################################################################################################
 # Source files
 #
 
+HEADERS += source/wh_signing_key_cache.h \
+           source/wh_envelope_writer.h \
+           source/wh_envelope_stream.h \
+           source/wh_base64.h \
+           source/wh_spool.h \
+           source/wh_submission_queue.h \
+           source/wh_time_sync.h \
+           source/wh_crc32.h \
+           source/wh_compressor.h \
+           source/wh_response.h \
+           source/wh_histogram.h \
+
 SOURCES = source/wh_web_hook.cpp \
+          source/wh_signing_key_cache.cpp \
+          source/wh_envelope_writer.cpp \
+          source/wh_envelope_stream.cpp \
+          source/wh_base64.cpp \
+          source/wh_retry_policy.cpp \
+          source/wh_flow_control.cpp \
+          source/wh_circuit_breaker.cpp \
+          source/wh_spool.cpp \
+          source/wh_submission_queue.cpp \
+          source/wh_time_sync.cpp \
+          source/wh_crc32.cpp \
+          source/wh_compressor.cpp \
+          source/wh_response.cpp \
+          source/wh_histogram.cpp \
+          source/wh_metrics.cpp \
+          source/wh_web_hook_verifier.cpp \
 
 ########################################################################################################################
 # Libraries
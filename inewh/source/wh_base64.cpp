@@ -0,0 +1,610 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::Base64 class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QByteArray>
+
+#include <cstring>
+#include <atomic>
+
+#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+
+    #include <immintrin.h>
+
+    #define WH_BASE64_X86
+    #define WH_TARGET_SSSE3 __attribute__((target("ssse3")))
+    #define WH_TARGET_AVX2 __attribute__((target("avx2")))
+
+#elif (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+
+    #include <intrin.h>
+    #include <immintrin.h>
+
+    #define WH_BASE64_X86
+    #define WH_TARGET_SSSE3
+    #define WH_TARGET_AVX2
+
+#endif
+
+#include "wh_base64.h"
+
+namespace Wh {
+    static const char encodeTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    /**
+     * Table mapping encoded characters to their 6-bit values.  Characters outside of the alphabet map to 0xFF.
+     */
+    static const unsigned char decodeTable[256] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   0xFF, 0xFF, 0xFF,   62, 0xFF, 0xFF, 0xFF,   63,
+          52,   53,   54,   55,   56,   57,   58,   59,     60,   61, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF,    0,    1,    2,    3,    4,    5,    6,      7,    8,    9,   10,   11,   12,   13,   14,
+          15,   16,   17,   18,   19,   20,   21,   22,     23,   24,   25, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF,   26,   27,   28,   29,   30,   31,   32,     33,   34,   35,   36,   37,   38,   39,   40,
+          41,   42,   43,   44,   45,   46,   47,   48,     49,   50,   51, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+    };
+
+    /**
+     * Function that encodes data using the scalar implementation.
+     *
+     * \param[in] destination The location to receive the encoded data.
+     *
+     * \param[in] source      The data to be encoded.
+     *
+     * \param[in] length      The length of the data to be encoded, in bytes.
+     *
+     * \return Returns a pointer just past the last encoded byte.
+     */
+    static char* encodeScalar(char* destination, const unsigned char* source, unsigned length) {
+        const unsigned char* s = source;
+        char*                d = destination;
+
+        unsigned fullGroups = length / 3;
+        for (unsigned i=0 ; i<fullGroups ; ++i) {
+            unsigned v = (static_cast<unsigned>(s[0]) << 16) | (static_cast<unsigned>(s[1]) << 8) | s[2];
+
+            d[0] = encodeTable[(v >> 18) & 0x3F];
+            d[1] = encodeTable[(v >> 12) & 0x3F];
+            d[2] = encodeTable[(v >>  6) & 0x3F];
+            d[3] = encodeTable[ v        & 0x3F];
+
+            s += 3;
+            d += 4;
+        }
+
+        unsigned remaining = length - 3 * fullGroups;
+        if (remaining == 1) {
+            unsigned v = static_cast<unsigned>(s[0]) << 16;
+
+            d[0] = encodeTable[(v >> 18) & 0x3F];
+            d[1] = encodeTable[(v >> 12) & 0x3F];
+            d[2] = '=';
+            d[3] = '=';
+
+            d += 4;
+        } else if (remaining == 2) {
+            unsigned v = (static_cast<unsigned>(s[0]) << 16) | (static_cast<unsigned>(s[1]) << 8);
+
+            d[0] = encodeTable[(v >> 18) & 0x3F];
+            d[1] = encodeTable[(v >> 12) & 0x3F];
+            d[2] = encodeTable[(v >>  6) & 0x3F];
+            d[3] = '=';
+
+            d += 4;
+        }
+
+        return d;
+    }
+
+
+    /**
+     * Function that decodes data using the scalar implementation.
+     *
+     * \param[in] destination The location to receive the decoded data.
+     *
+     * \param[in] source      The data to be decoded.
+     *
+     * \param[in] length      The length of the data to be decoded, in bytes.
+     *
+     * \return Returns the number of decoded bytes.  A negative value is returned if the data is malformed.
+     */
+    static long decodeScalar(unsigned char* destination, const char* source, unsigned length) {
+        const unsigned char* s = reinterpret_cast<const unsigned char*>(source);
+        unsigned char*       d = destination;
+
+        unsigned padding = 0;
+        while (padding < 2 && length > 0 && s[length - 1] == '=') {
+            --length;
+            ++padding;
+        }
+
+        if (padding > 0 && ((length + padding) & 3) != 0) {
+            // Padding is only allowed to complete the final group.
+            return -1;
+        }
+
+        unsigned fullGroups = length / 4;
+        for (unsigned i=0 ; i<fullGroups ; ++i) {
+            unsigned a = decodeTable[s[0]];
+            unsigned b = decodeTable[s[1]];
+            unsigned c = decodeTable[s[2]];
+            unsigned e = decodeTable[s[3]];
+
+            if ((a | b | c | e) & 0x80) {
+                return -1;
+            }
+
+            unsigned v = (a << 18) | (b << 12) | (c << 6) | e;
+            d[0] = static_cast<unsigned char>(v >> 16);
+            d[1] = static_cast<unsigned char>(v >> 8);
+            d[2] = static_cast<unsigned char>(v);
+
+            s += 4;
+            d += 3;
+        }
+
+        unsigned remaining = length - 4 * fullGroups;
+        if (remaining == 1) {
+            return -1;
+        } else if (remaining == 2) {
+            unsigned a = decodeTable[s[0]];
+            unsigned b = decodeTable[s[1]];
+
+            if (((a | b) & 0x80) || (b & 0x0F) != 0) {
+                return -1;
+            }
+
+            d[0] = static_cast<unsigned char>((a << 2) | (b >> 4));
+            d += 1;
+        } else if (remaining == 3) {
+            unsigned a = decodeTable[s[0]];
+            unsigned b = decodeTable[s[1]];
+            unsigned c = decodeTable[s[2]];
+
+            if (((a | b | c) & 0x80) || (c & 0x03) != 0) {
+                return -1;
+            }
+
+            d[0] = static_cast<unsigned char>((a << 2) | (b >> 4));
+            d[1] = static_cast<unsigned char>((b << 4) | (c >> 2));
+            d += 2;
+        }
+
+        return static_cast<long>(d - destination);
+    }
+
+#if (defined(WH_BASE64_X86))
+
+    // The vectorized encoders and decoders follow the approach described by Wojciech Mula and Daniel Lemire,
+    // "Faster Base64 Encoding and Decoding Using AVX2 Instructions".  Each processes the bulk of the input and hands
+    // the remainder, including any padding, to the scalar implementation.
+
+    /**
+     * Function that encodes data using SSSE3.
+     *
+     * \param[in] destination The location to receive the encoded data.
+     *
+     * \param[in] source      The data to be encoded.
+     *
+     * \param[in] length      The length of the data to be encoded, in bytes.
+     *
+     * \return Returns a pointer just past the last encoded byte.
+     */
+    WH_TARGET_SSSE3 static char* encodeSsse3(char* destination, const unsigned char* source, unsigned length) {
+        const __m128i shuffle   = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+        const __m128i maskAc    = _mm_set1_epi32(0x0FC0FC00);
+        const __m128i shiftAc   = _mm_set1_epi32(0x04000040);
+        const __m128i maskBd    = _mm_set1_epi32(0x003F03F0);
+        const __m128i shiftBd   = _mm_set1_epi32(0x01000010);
+        const __m128i fiftyOne  = _mm_set1_epi8(51);
+        const __m128i twentySix = _mm_set1_epi8(26);
+        const __m128i thirteen  = _mm_set1_epi8(13);
+        const __m128i offsets   = _mm_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+        );
+
+        const unsigned char* s = source;
+        char*                d = destination;
+        unsigned             r = length;
+
+        while (r >= 16) {
+            __m128i in      = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s)), shuffle);
+            __m128i ac      = _mm_mulhi_epu16(_mm_and_si128(in, maskAc), shiftAc);
+            __m128i bd      = _mm_mullo_epi16(_mm_and_si128(in, maskBd), shiftBd);
+            __m128i indices = _mm_or_si128(ac, bd);
+
+            __m128i reduced = _mm_subs_epu8(indices, fiftyOne);
+            __m128i less    = _mm_cmpgt_epi8(twentySix, indices);
+            reduced = _mm_or_si128(reduced, _mm_and_si128(less, thirteen));
+
+            __m128i out = _mm_add_epi8(_mm_shuffle_epi8(offsets, reduced), indices);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d), out);
+
+            s += 12;
+            d += 16;
+            r -= 12;
+        }
+
+        return encodeScalar(d, s, r);
+    }
+
+
+    /**
+     * Function that encodes data using AVX2.
+     *
+     * \param[in] destination The location to receive the encoded data.
+     *
+     * \param[in] source      The data to be encoded.
+     *
+     * \param[in] length      The length of the data to be encoded, in bytes.
+     *
+     * \return Returns a pointer just past the last encoded byte.
+     */
+    WH_TARGET_AVX2 static char* encodeAvx2(char* destination, const unsigned char* source, unsigned length) {
+        const __m256i shuffle   = _mm256_set_epi8(
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1
+        );
+        const __m256i maskAc    = _mm256_set1_epi32(0x0FC0FC00);
+        const __m256i shiftAc   = _mm256_set1_epi32(0x04000040);
+        const __m256i maskBd    = _mm256_set1_epi32(0x003F03F0);
+        const __m256i shiftBd   = _mm256_set1_epi32(0x01000010);
+        const __m256i fiftyOne  = _mm256_set1_epi8(51);
+        const __m256i twentySix = _mm256_set1_epi8(26);
+        const __m256i thirteen  = _mm256_set1_epi8(13);
+        const __m256i offsets   = _mm256_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+        );
+
+        const unsigned char* s = source;
+        char*                d = destination;
+        unsigned             r = length;
+
+        while (r >= 28) {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 12));
+            __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+            in = _mm256_shuffle_epi8(in, shuffle);
+
+            __m256i ac      = _mm256_mulhi_epu16(_mm256_and_si256(in, maskAc), shiftAc);
+            __m256i bd      = _mm256_mullo_epi16(_mm256_and_si256(in, maskBd), shiftBd);
+            __m256i indices = _mm256_or_si256(ac, bd);
+
+            __m256i reduced = _mm256_subs_epu8(indices, fiftyOne);
+            __m256i less    = _mm256_cmpgt_epi8(twentySix, indices);
+            reduced = _mm256_or_si256(reduced, _mm256_and_si256(less, thirteen));
+
+            __m256i out = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, reduced), indices);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), out);
+
+            s += 24;
+            d += 32;
+            r -= 24;
+        }
+
+        return encodeSsse3(d, s, r);
+    }
+
+
+    /**
+     * Function that decodes data using SSSE3.
+     *
+     * \param[in] destination The location to receive the decoded data.
+     *
+     * \param[in] source      The data to be decoded.
+     *
+     * \param[in] length      The length of the data to be decoded, in bytes.
+     *
+     * \return Returns the number of decoded bytes.  A negative value is returned if the data is malformed.
+     */
+    WH_TARGET_SSSE3 static long decodeSsse3(unsigned char* destination, const char* source, unsigned length) {
+        const __m128i lookupLow  = _mm_setr_epi8(
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+        );
+        const __m128i lookupHigh = _mm_setr_epi8(
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+        );
+        const __m128i lookupRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m128i mask2f     = _mm_set1_epi8(0x2F);
+        const __m128i zero       = _mm_setzero_si128();
+        const __m128i mergeAbBc  = _mm_set1_epi32(0x01400140);
+        const __m128i mergeAbcd  = _mm_set1_epi32(0x00011000);
+        const __m128i pack       = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+        const char*    s = source;
+        unsigned char* d = destination;
+        unsigned       r = length;
+
+        while (r >= 24) {
+            __m128i in         = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+            __m128i highNibble = _mm_and_si128(_mm_srli_epi32(in, 4), mask2f);
+            __m128i lowNibble  = _mm_and_si128(in, mask2f);
+            __m128i low        = _mm_shuffle_epi8(lookupLow, lowNibble);
+            __m128i high       = _mm_shuffle_epi8(lookupHigh, highNibble);
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(low, high), zero)) != 0xFFFF) {
+                return -1;
+            }
+
+            __m128i isSlash = _mm_cmpeq_epi8(in, mask2f);
+            __m128i roll    = _mm_shuffle_epi8(lookupRoll, _mm_add_epi8(isSlash, highNibble));
+            __m128i values  = _mm_add_epi8(in, roll);
+
+            __m128i merged = _mm_madd_epi16(_mm_maddubs_epi16(values, mergeAbBc), mergeAbcd);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_shuffle_epi8(merged, pack));
+
+            s += 16;
+            d += 12;
+            r -= 16;
+        }
+
+        long tail = decodeScalar(d, s, r);
+        return tail < 0 ? tail : static_cast<long>(d - destination) + tail;
+    }
+
+
+    /**
+     * Function that decodes data using AVX2.
+     *
+     * \param[in] destination The location to receive the decoded data.
+     *
+     * \param[in] source      The data to be decoded.
+     *
+     * \param[in] length      The length of the data to be decoded, in bytes.
+     *
+     * \return Returns the number of decoded bytes.  A negative value is returned if the data is malformed.
+     */
+    WH_TARGET_AVX2 static long decodeAvx2(unsigned char* destination, const char* source, unsigned length) {
+        const __m256i lookupLow  = _mm256_setr_epi8(
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+        );
+        const __m256i lookupHigh = _mm256_setr_epi8(
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+        );
+        const __m256i lookupRoll = _mm256_setr_epi8(
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+        );
+        const __m256i mask2f     = _mm256_set1_epi8(0x2F);
+        const __m256i mergeAbBc  = _mm256_set1_epi32(0x01400140);
+        const __m256i mergeAbcd  = _mm256_set1_epi32(0x00011000);
+        const __m256i pack       = _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+        );
+        const __m256i permute    = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+        const char*    s = source;
+        unsigned char* d = destination;
+        unsigned       r = length;
+
+        while (r >= 48) {
+            __m256i in         = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+            __m256i highNibble = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask2f);
+            __m256i lowNibble  = _mm256_and_si256(in, mask2f);
+            __m256i low        = _mm256_shuffle_epi8(lookupLow, lowNibble);
+            __m256i high       = _mm256_shuffle_epi8(lookupHigh, highNibble);
+
+            if (!_mm256_testz_si256(low, high)) {
+                return -1;
+            }
+
+            __m256i isSlash = _mm256_cmpeq_epi8(in, mask2f);
+            __m256i roll    = _mm256_shuffle_epi8(lookupRoll, _mm256_add_epi8(isSlash, highNibble));
+            __m256i values  = _mm256_add_epi8(in, roll);
+
+            __m256i merged = _mm256_madd_epi16(_mm256_maddubs_epi16(values, mergeAbBc), mergeAbcd);
+            merged = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(merged, pack), permute);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), merged);
+
+            s += 32;
+            d += 24;
+            r -= 32;
+        }
+
+        long tail = decodeSsse3(d, s, r);
+        return tail < 0 ? tail : static_cast<long>(d - destination) + tail;
+    }
+
+#endif
+
+    std::atomic<Base64::Implementation> Base64::currentImplementation(Base64::Implementation::SCALAR);
+    std::atomic<Base64::Encoder>        Base64::currentEncoder(encodeScalar);
+    std::atomic<Base64::Decoder>        Base64::currentDecoder(decodeScalar);
+
+    Base64::Implementation Base64::implementation() {
+        initialize();
+        return currentImplementation.load(std::memory_order_acquire);
+    }
+
+
+    bool Base64::isSupported(Base64::Implementation implementation) {
+        bool result;
+
+        if (implementation == Implementation::SCALAR) {
+            result = true;
+        } else {
+            #if (defined(WH_BASE64_X86) && defined(__GNUC__))
+
+                __builtin_cpu_init();
+                if (implementation == Implementation::SSSE3) {
+                    result = __builtin_cpu_supports("ssse3");
+                } else {
+                    result = __builtin_cpu_supports("avx2");
+                }
+
+            #elif (defined(WH_BASE64_X86) && defined(_MSC_VER))
+
+                int information[4];
+                __cpuid(information, 0);
+                int maximumLeaf = information[0];
+
+                __cpuid(information, 1);
+                bool ssse3   = (information[2] & (1 << 9)) != 0;
+                bool osxsave = (information[2] & (1 << 27)) != 0;
+                bool avx     = (information[2] & (1 << 28)) != 0;
+
+                if (implementation == Implementation::SSSE3) {
+                    result = ssse3;
+                } else if (maximumLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x06) == 0x06) {
+                    __cpuidex(information, 7, 0);
+                    result = (information[1] & (1 << 5)) != 0;
+                } else {
+                    result = false;
+                }
+
+            #else
+
+                result = false;
+
+            #endif
+        }
+
+        return result;
+    }
+
+
+    bool Base64::setImplementation(Base64::Implementation newImplementation) {
+        initialize();
+        return select(newImplementation);
+    }
+
+
+    unsigned Base64::encodedLength(unsigned length) {
+        return 4 * ((length + 2) / 3);
+    }
+
+
+    char* Base64::encode(char* destination, const char* source, unsigned length) {
+        initialize();
+
+        Encoder encoder = currentEncoder.load(std::memory_order_acquire);
+        return (*encoder)(destination, reinterpret_cast<const unsigned char*>(source), length);
+    }
+
+
+    QByteArray Base64::encode(const QByteArray& data) {
+        unsigned   length = static_cast<unsigned>(data.size());
+        QByteArray result(static_cast<int>(encodedLength(length)), Qt::Uninitialized);
+
+        encode(result.data(), data.constData(), length);
+        return result;
+    }
+
+
+    QByteArray Base64::decode(const QByteArray& encoded, bool* ok, bool paddingOptional) {
+        unsigned   length = static_cast<unsigned>(encoded.size());
+        QByteArray result(static_cast<int>(3 * ((length + 3) / 4)), Qt::Uninitialized);
+
+        long decodedLength;
+        if (!paddingOptional && (length & 3) != 0) {
+            // Unpadded input is a second encoding of the same bytes so it is rejected unless asked for.
+            decodedLength = -1;
+        } else {
+            initialize();
+
+            Decoder decoder = currentDecoder.load(std::memory_order_acquire);
+            decodedLength = (*decoder)(
+                reinterpret_cast<unsigned char*>(result.data()),
+                encoded.constData(),
+                length
+            );
+        }
+
+        if (decodedLength >= 0) {
+            result.truncate(static_cast<int>(decodedLength));
+        } else {
+            result.clear();
+        }
+
+        if (ok != Q_NULLPTR) {
+            *ok = (decodedLength >= 0);
+        }
+
+        return result;
+    }
+
+
+    Base64::Implementation Base64::detectImplementation() {
+        Implementation result;
+
+        if (isSupported(Implementation::AVX2)) {
+            result = Implementation::AVX2;
+        } else if (isSupported(Implementation::SSSE3)) {
+            result = Implementation::SSSE3;
+        } else {
+            result = Implementation::SCALAR;
+        }
+
+        return result;
+    }
+
+
+    void Base64::initialize() {
+        static const bool initialized = select(detectImplementation());
+        (void) initialized;
+    }
+
+
+    bool Base64::select(Base64::Implementation newImplementation) {
+        bool success = isSupported(newImplementation);
+
+        if (success) {
+            Encoder encoder = encodeScalar;
+            Decoder decoder = decodeScalar;
+
+            #if (defined(WH_BASE64_X86))
+
+                if (newImplementation == Implementation::AVX2) {
+                    encoder = encodeAvx2;
+                    decoder = decodeAvx2;
+                } else if (newImplementation == Implementation::SSSE3) {
+                    encoder = encodeSsse3;
+                    decoder = decodeSsse3;
+                }
+
+            #endif
+
+            currentEncoder.store(encoder, std::memory_order_release);
+            currentDecoder.store(decoder, std::memory_order_release);
+            currentImplementation.store(newImplementation, std::memory_order_release);
+        }
+
+        return success;
+    }
+}
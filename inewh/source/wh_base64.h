@@ -0,0 +1,188 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::Base64 class.
+***********************************************************************************************************************/
+
+#ifndef WH_BASE64_H
+#define WH_BASE64_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+#include <atomic>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that provides base-64 encoding and decoding using the standard alphabet with padding.  On x86 processors,
+     * SSSE3 and AVX2 implementations are selected at run time based on the capabilities of the processor.  A scalar
+     * implementation is used on all other processors.  All implementations produce output identical to
+     * QByteArray::toBase64.
+     */
+    class Base64 {
+        public:
+            /**
+             * Enumeration of supported implementations.
+             */
+            enum class Implementation {
+                /**
+                 * Indicates the portable scalar implementation.
+                 */
+                SCALAR,
+
+                /**
+                 * Indicates the SSSE3 implementation.
+                 */
+                SSSE3,
+
+                /**
+                 * Indicates the AVX2 implementation.
+                 */
+                AVX2
+            };
+
+            /**
+             * Method you can use to determine the implementation currently in use.
+             *
+             * \return Returns the current implementation.
+             */
+            static Implementation implementation();
+
+            /**
+             * Method you can use to determine if an implementation is supported by this processor.
+             *
+             * \param[in] implementation The implementation to check.
+             *
+             * \return Returns true if the implementation is supported.  Returns false if the implementation is not
+             *         supported.
+             */
+            static bool isSupported(Implementation implementation);
+
+            /**
+             * Method you can use to select the implementation to use.  This method is primarily intended for test
+             * purposes.  The method may be called while other threads are encoding or decoding.  Each call in
+             * progress completes using either the previous or the new implementation.
+             *
+             * \param[in] newImplementation The implementation to use.
+             *
+             * \return Returns true on success.  Returns false if the implementation is not supported.
+             */
+            static bool setImplementation(Implementation newImplementation);
+
+            /**
+             * Method you can use to determine the encoded length of a block of data.
+             *
+             * \param[in] length The length of the raw data, in bytes.
+             *
+             * \return Returns the length of the encoded data, including padding.
+             */
+            static unsigned encodedLength(unsigned length);
+
+            /**
+             * Method that encodes data into a buffer.
+             *
+             * \param[in] destination The location to receive the encoded data.  The buffer must hold at least
+             *                        \ref Base64::encodedLength bytes.
+             *
+             * \param[in] source      The data to be encoded.
+             *
+             * \param[in] length      The length of the data to be encoded, in bytes.
+             *
+             * \return Returns a pointer just past the last encoded byte.
+             */
+            static char* encode(char* destination, const char* source, unsigned length);
+
+            /**
+             * Method that encodes data.
+             *
+             * \param[in] data The data to be encoded.
+             *
+             * \return Returns the encoded data.
+             */
+            static QByteArray encode(const QByteArray& data);
+
+            /**
+             * Method that decodes data.  By default only the canonical encoding is accepted, so the encoded length
+             * must be a multiple of 4 and the final group must be padded.  Any character outside of the base-64
+             * alphabet is treated as an error, as are unused bits that are not zero.
+             *
+             * \param[in]  encoded         The encoded data.
+             *
+             * \param[out] ok              An optional pointer to a boolean that is set to true on success and false
+             *                             if the encoded data is malformed.
+             *
+             * \param[in]  paddingOptional If true, the trailing padding may be omitted.  If false, input that is not
+             *                             padded to a multiple of 4 characters is treated as malformed.
+             *
+             * \return Returns the decoded data.  An empty byte array is returned if the encoded data is malformed.
+             */
+            static QByteArray decode(const QByteArray& encoded, bool* ok = Q_NULLPTR, bool paddingOptional = false);
+
+        private:
+            /**
+             * Type used to represent an encoder.
+             */
+            typedef char* (*Encoder)(char* destination, const unsigned char* source, unsigned length);
+
+            /**
+             * Type used to represent a decoder.
+             */
+            typedef long (*Decoder)(unsigned char* destination, const char* source, unsigned length);
+
+            /**
+             * Method that selects the fastest supported implementation.
+             *
+             * \return Returns the selected implementation.
+             */
+            static Implementation detectImplementation();
+
+            /**
+             * Method that selects the fastest supported implementation the first time it is called.
+             */
+            static void initialize();
+
+            /**
+             * Method that switches to a given implementation.
+             *
+             * \param[in] newImplementation The implementation to use.
+             *
+             * \return Returns true on success.  Returns false if the implementation is not supported.
+             */
+            static bool select(Implementation newImplementation);
+
+            /**
+             * The implementation currently in use.
+             */
+            static std::atomic<Implementation> currentImplementation;
+
+            /**
+             * The encoder currently in use.
+             */
+            static std::atomic<Encoder> currentEncoder;
+
+            /**
+             * The decoder currently in use.
+             */
+            static std::atomic<Decoder> currentDecoder;
+    };
+}
+
+#endif
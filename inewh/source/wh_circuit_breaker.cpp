@@ -0,0 +1,182 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::CircuitBreaker class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "wh_circuit_breaker.h"
+
+namespace Wh {
+    /**
+     * Class that holds the circuit for one destination.
+     */
+    class CircuitBreaker::Destination {
+        public:
+            /**
+             * The circuit state.
+             */
+            State state;
+
+            /**
+             * The number of consecutive failures.
+             */
+            unsigned failures;
+
+            /**
+             * The time of the most recent change of state, in microseconds.
+             */
+            long long changedAt;
+
+            /**
+             * The time the most recent probe was allowed, in microseconds.
+             */
+            long long probeTime;
+    };
+
+    constexpr unsigned CircuitBreaker::defaultFailureThreshold;
+    constexpr unsigned CircuitBreaker::defaultOpenDuration;
+
+    CircuitBreaker::CircuitBreaker(unsigned failureThreshold, unsigned openDuration) {
+        currentFailureThreshold = qMax(failureThreshold, 1U);
+        currentOpenDuration     = openDuration;
+    }
+
+
+    CircuitBreaker::~CircuitBreaker() {
+        qDeleteAll(destinations);
+    }
+
+
+    void CircuitBreaker::setFailureThreshold(unsigned newFailureThreshold) {
+        QMutexLocker locker(&mutex);
+        currentFailureThreshold = qMax(newFailureThreshold, 1U);
+    }
+
+
+    unsigned CircuitBreaker::failureThreshold() const {
+        QMutexLocker locker(&mutex);
+        return currentFailureThreshold;
+    }
+
+
+    void CircuitBreaker::setOpenDuration(unsigned newOpenDuration) {
+        QMutexLocker locker(&mutex);
+        currentOpenDuration = newOpenDuration;
+    }
+
+
+    unsigned CircuitBreaker::openDuration() const {
+        QMutexLocker locker(&mutex);
+        return currentOpenDuration;
+    }
+
+
+    bool CircuitBreaker::allow(const QString& destination, long long now) {
+        QMutexLocker locker(&mutex);
+
+        bool         result;
+        Destination* entry = destinations.value(destination);
+
+        if (entry == Q_NULLPTR || entry->state == State::CLOSED) {
+            result = true;
+        } else {
+            long long openFor = 1000LL * currentOpenDuration;
+
+            if (entry->state == State::OPEN) {
+                if (now - entry->changedAt >= openFor) {
+                    entry->state     = State::HALF_OPEN;
+                    entry->changedAt = now;
+                    entry->probeTime = now;
+                    result           = true;
+                } else {
+                    result = false;
+                }
+            } else if (now - entry->probeTime >= openFor) {
+                // The probe was lost so we allow another.
+                entry->probeTime = now;
+                result           = true;
+            } else {
+                result = false;
+            }
+        }
+
+        return result;
+    }
+
+
+    void CircuitBreaker::record(const QString& destination, bool success, long long sendTime, long long now) {
+        QMutexLocker locker(&mutex);
+
+        Destination* entry = destinations.value(destination);
+        if (entry == Q_NULLPTR && !success) {
+            entry = new Destination;
+
+            entry->state     = State::CLOSED;
+            entry->failures  = 0;
+            entry->changedAt = 0;
+            entry->probeTime = 0;
+
+            destinations.insert(destination, entry);
+        }
+
+        if (entry != Q_NULLPTR && sendTime >= entry->changedAt) {
+            if (entry->state == State::CLOSED) {
+                if (success) {
+                    // Healthy destinations are not tracked.
+                    destinations.remove(destination);
+                    delete entry;
+                } else {
+                    ++entry->failures;
+                    if (entry->failures >= currentFailureThreshold) {
+                        entry->state     = State::OPEN;
+                        entry->changedAt = now;
+                    }
+                }
+            } else if (entry->state == State::HALF_OPEN) {
+                if (success) {
+                    destinations.remove(destination);
+                    delete entry;
+                } else {
+                    entry->state     = State::OPEN;
+                    entry->changedAt = now;
+                }
+            }
+        }
+    }
+
+
+    CircuitBreaker::State CircuitBreaker::state(const QString& destination) const {
+        QMutexLocker locker(&mutex);
+
+        const Destination* entry = destinations.value(destination);
+        return entry != Q_NULLPTR ? entry->state : State::CLOSED;
+    }
+
+
+    void CircuitBreaker::reset(const QString& destination) {
+        QMutexLocker locker(&mutex);
+        delete destinations.take(destination);
+    }
+}
@@ -0,0 +1,91 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::Compressor class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QtEndian>
+#include <QByteArray>
+
+#include <cstring>
+
+#include "wh_crc32.h"
+#include "wh_compressor.h"
+
+namespace Wh {
+    static const unsigned lengthPrefixLength = 4; // Added by qCompress ahead of the zlib stream.
+    static const unsigned zlibHeaderLength   = 2;
+    static const unsigned zlibTrailerLength  = 4; // Adler-32
+    static const unsigned gzipHeaderLength   = 10;
+    static const unsigned gzipTrailerLength  = 8; // CRC-32 and input size
+
+    QByteArray Compressor::compress(const QByteArray& data, Format format, int level) {
+        QByteArray result;
+
+        QByteArray compressed = qCompress(data, level);
+        if (static_cast<unsigned>(compressed.size()) > lengthPrefixLength + zlibHeaderLength + zlibTrailerLength) {
+            if (format == Format::DEFLATE) {
+                result = compressed.mid(lengthPrefixLength);
+            } else {
+                // A gzip member carries the same raw deflate data as a zlib stream, framed by a different header
+                // and trailer.
+                const char* deflateData   = compressed.constData() + lengthPrefixLength + zlibHeaderLength;
+                unsigned    deflateLength = (
+                      static_cast<unsigned>(compressed.size())
+                    - lengthPrefixLength
+                    - zlibHeaderLength
+                    - zlibTrailerLength
+                );
+
+                result.resize(static_cast<int>(gzipHeaderLength + deflateLength + gzipTrailerLength));
+                uchar* p = reinterpret_cast<uchar*>(result.data());
+
+                uchar extraFlags = level == 9 ? 0x02 : (level == 1 ? 0x04 : 0x00);
+
+                p[0] = 0x1F;                        // ID1
+                p[1] = 0x8B;                        // ID2
+                p[2] = 0x08;                        // CM, deflate
+                p[3] = 0x00;                        // FLG
+                qToLittleEndian<quint32>(0, p + 4); // MTIME, not available
+                p[8] = extraFlags;                  // XFL
+                p[9] = 0xFF;                        // OS, unknown
+
+                std::memcpy(p + gzipHeaderLength, deflateData, deflateLength);
+
+                uchar*  trailer = p + gzipHeaderLength + deflateLength;
+                quint32 crc     = Crc32::update(
+                    0,
+                    reinterpret_cast<const uchar*>(data.constData()),
+                    static_cast<unsigned>(data.size())
+                );
+
+                qToLittleEndian<quint32>(crc, trailer);
+                qToLittleEndian<quint32>(static_cast<quint32>(data.size()), trailer + 4);
+            }
+        }
+
+        return result;
+    }
+
+
+    QByteArray Compressor::contentEncoding(Format format) {
+        return format == Format::GZIP ? QByteArray("gzip") : QByteArray("deflate");
+    }
+}
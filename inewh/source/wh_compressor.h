@@ -0,0 +1,77 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::Compressor class.
+***********************************************************************************************************************/
+
+#ifndef WH_COMPRESSOR_H
+#define WH_COMPRESSOR_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that compresses request bodies for the HTTP deflate and gzip content encodings.  Both encodings are
+     * built from the zlib stream produced by qCompress so no additional library is needed.
+     */
+    class Compressor {
+        public:
+            /**
+             * Enumeration of supported content encodings.
+             */
+            enum class Format {
+                /**
+                 * Indicates a zlib stream (RFC 1950), sent as "Content-Encoding: deflate".
+                 */
+                DEFLATE,
+
+                /**
+                 * Indicates a gzip member (RFC 1952), sent as "Content-Encoding: gzip".
+                 */
+                GZIP
+            };
+
+            /**
+             * Method that compresses a block of data.
+             *
+             * \param[in] data   The data to be compressed.
+             *
+             * \param[in] format The content encoding to produce.
+             *
+             * \param[in] level  The compression level, 0 through 9.  A value of -1 selects zlib's default level.
+             *
+             * \return Returns the compressed data.  An empty array is returned if the data could not be compressed.
+             */
+            static QByteArray compress(const QByteArray& data, Format format, int level = -1);
+
+            /**
+             * Method that returns the HTTP Content-Encoding token for a format.
+             *
+             * \param[in] format The content encoding.
+             *
+             * \return Returns the Content-Encoding token.
+             */
+            static QByteArray contentEncoding(Format format);
+    };
+}
+
+#endif
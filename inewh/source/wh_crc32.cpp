@@ -0,0 +1,60 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::Crc32 class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+
+#include "wh_crc32.h"
+
+namespace Wh {
+    /**
+     * Class that holds the CRC-32 lookup table.
+     */
+    class Crc32Table {
+        public:
+            Crc32Table() {
+                for (quint32 i=0 ; i<256 ; ++i) {
+                    quint32 c = i;
+                    for (unsigned bit=0 ; bit<8 ; ++bit) {
+                        c = (c & 1) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+                    }
+
+                    entries[i] = c;
+                }
+            }
+
+            /**
+             * The table entries.
+             */
+            quint32 entries[256];
+    };
+
+    quint32 Crc32::update(quint32 crc, const uchar* data, unsigned length) {
+        static const Crc32Table table;
+
+        crc = ~crc;
+        for (unsigned i=0 ; i<length ; ++i) {
+            crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return ~crc;
+    }
+}
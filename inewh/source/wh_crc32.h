@@ -0,0 +1,51 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::Crc32 class.
+***********************************************************************************************************************/
+
+#ifndef WH_CRC32_H
+#define WH_CRC32_H
+
+#include <QtGlobal>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that calculates the CRC-32 used by zlib, gzip and the spool record framing.
+     */
+    class Crc32 {
+        public:
+            /**
+             * Method that calculates the CRC-32 of a block of data.
+             *
+             * \param[in] crc    The running CRC value.  Use 0 for the first block.
+             *
+             * \param[in] data   The data to include.
+             *
+             * \param[in] length The length of the data, in bytes.
+             *
+             * \return Returns the updated CRC value.
+             */
+            static quint32 update(quint32 crc, const uchar* data, unsigned length);
+    };
+}
+
+#endif
@@ -0,0 +1,178 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::EnvelopeStream class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QIODevice>
+#include <QByteArray>
+
+#include <cstring>
+
+#include "wh_base64.h"
+#include "wh_envelope_writer.h"
+#include "wh_signing_key_cache.h"
+#include "wh_envelope_stream.h"
+
+namespace Wh {
+    constexpr unsigned EnvelopeStream::chunkSize;
+
+    EnvelopeStream::EnvelopeStream(
+            QIODevice*        payload,
+            qint64            payloadOffset,
+            qint64            payloadSize,
+            SigningKeyCache&  signingKeys,
+            const QByteArray& secret,
+            long long         minute,
+            QObject*          parent
+        ):QIODevice(
+            parent
+        ),signer(
+            signingKeys,
+            secret,
+            minute
+        ) {
+        currentPayload       = payload;
+        currentPayloadOffset = payloadOffset;
+        currentPayloadSize   = payloadSize;
+        currentEnvelopeSize  = (
+              EnvelopeWriter::envelopeSize(0, SigningKeyCache::signatureLength)
+            + 4 * ((payloadSize + 2) / 3)
+        );
+
+        rawBuffer.reserve(static_cast<int>(chunkSize));
+        staged.reserve(static_cast<int>(Base64::encodedLength(chunkSize)));
+
+        rewind();
+        open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+
+
+    EnvelopeStream::~EnvelopeStream() {}
+
+
+    bool EnvelopeStream::isSequential() const {
+        return false;
+    }
+
+
+    qint64 EnvelopeStream::size() const {
+        return currentEnvelopeSize;
+    }
+
+
+    bool EnvelopeStream::seek(qint64 pos) {
+        bool success;
+
+        if (pos == 0) {
+            success = rewind() && QIODevice::seek(0);
+        } else {
+            success = (pos == QIODevice::pos()) && QIODevice::seek(pos);
+        }
+
+        return success;
+    }
+
+
+    qint64 EnvelopeStream::readData(char* data, qint64 maxSize) {
+        qint64 bytesRead = 0;
+        bool   success   = true;
+
+        while (success && bytesRead < maxSize && (!finished || stagedOffset < staged.size())) {
+            if (stagedOffset < staged.size()) {
+                qint64 count = qMin(maxSize - bytesRead, static_cast<qint64>(staged.size() - stagedOffset));
+                std::memcpy(data + bytesRead, staged.constData() + stagedOffset, static_cast<size_t>(count));
+
+                bytesRead    += count;
+                stagedOffset += static_cast<int>(count);
+            } else {
+                success = refill();
+            }
+        }
+
+        return success || bytesRead > 0 ? bytesRead : -1;
+    }
+
+
+    qint64 EnvelopeStream::writeData(const char*, qint64) {
+        return -1;
+    }
+
+
+    bool EnvelopeStream::rewind() {
+        signer.reset();
+
+        payloadConsumed = 0;
+        finished        = false;
+
+        rawBuffer.clear();
+        staged       = EnvelopeWriter::prefix();
+        stagedOffset = 0;
+
+        return currentPayload->seek(currentPayloadOffset);
+    }
+
+
+    bool EnvelopeStream::refill() {
+        bool success = true;
+
+        staged.clear();
+        stagedOffset = 0;
+
+        if (payloadConsumed < currentPayloadSize) {
+            int    bufferUsed = rawBuffer.size();
+            qint64 wanted     = qMin(static_cast<qint64>(chunkSize - bufferUsed), currentPayloadSize - payloadConsumed);
+
+            rawBuffer.resize(bufferUsed + static_cast<int>(wanted));
+            qint64 count = currentPayload->read(rawBuffer.data() + bufferUsed, wanted);
+
+            if (count <= 0) {
+                rawBuffer.resize(bufferUsed);
+                success = false;
+            } else {
+                rawBuffer.resize(bufferUsed + static_cast<int>(count));
+                signer.addData(rawBuffer.constData() + bufferUsed, static_cast<unsigned>(count));
+
+                payloadConsumed += count;
+
+                // Only the final chunk may carry base-64 padding, so hold back any trailing partial group.
+                unsigned available = static_cast<unsigned>(rawBuffer.size());
+                unsigned encodable = payloadConsumed == currentPayloadSize ? available : available - available % 3;
+
+                if (encodable > 0) {
+                    staged.resize(static_cast<int>(Base64::encodedLength(encodable)));
+                    Base64::encode(staged.data(), rawBuffer.constData(), encodable);
+
+                    rawBuffer.remove(0, static_cast<int>(encodable));
+                }
+            }
+        } else {
+            QByteArray hash = signer.result();
+
+            staged.append(EnvelopeWriter::separator());
+            staged.append(Base64::encode(hash));
+            staged.append(EnvelopeWriter::suffix());
+
+            finished = true;
+        }
+
+        return success;
+    }
+}
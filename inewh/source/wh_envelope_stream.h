@@ -0,0 +1,195 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::EnvelopeStream class.
+***********************************************************************************************************************/
+
+#ifndef WH_ENVELOPE_STREAM_H
+#define WH_ENVELOPE_STREAM_H
+
+#include <QtGlobal>
+#include <QIODevice>
+#include <QByteArray>
+
+#include "wh_common.h"
+#include "wh_signing_key_cache.h"
+
+namespace Wh {
+    /**
+     * Class that produces a signed message envelope from a payload held in another device.  The output is
+     * byte-for-byte identical to \ref EnvelopeWriter::write.  Because the signature follows the payload in the
+     * envelope, the payload is read, signed, and base-64 encoded one chunk at a time as the envelope is read so memory
+     * use does not depend on the payload size.
+     *
+     * The payload device must be random access so that the envelope size is known up front and the envelope can be
+     * reset if the request must be restarted.
+     */
+    class EnvelopeStream:public QIODevice {
+        Q_OBJECT
+
+        public:
+            /**
+             * The number of payload bytes read and encoded at a time.  This value must be a multiple of 3.
+             */
+            static constexpr unsigned chunkSize = 48 * 1024;
+
+            /**
+             * Constructor
+             *
+             * \param[in] payload       The device holding the payload.  The device is not owned by this object.
+             *
+             * \param[in] payloadOffset The offset of the payload within the device.
+             *
+             * \param[in] payloadSize   The size of the payload, in bytes.
+             *
+             * \param[in] signingKeys   The cache holding the signing keys.
+             *
+             * \param[in] secret        The webhook secret.
+             *
+             * \param[in] minute        The number of whole minutes since the epoch, UTC, used to derive the key.
+             *
+             * \param[in] parent        Pointer to the parent object.
+             */
+            EnvelopeStream(
+                QIODevice*        payload,
+                qint64            payloadOffset,
+                qint64            payloadSize,
+                SigningKeyCache&  signingKeys,
+                const QByteArray& secret,
+                long long         minute,
+                QObject*          parent = Q_NULLPTR
+            );
+
+            ~EnvelopeStream() override;
+
+            /**
+             * Method that indicates this device is random access.
+             *
+             * \return Returns false.
+             */
+            bool isSequential() const override;
+
+            /**
+             * Method that returns the size of the envelope.
+             *
+             * \return Returns the size of the envelope, in bytes.
+             */
+            qint64 size() const override;
+
+            /**
+             * Method that repositions the envelope.  Only rewinding to the start of the envelope is supported.
+             *
+             * \param[in] pos The new position.
+             *
+             * \return Returns true on success.  Returns false if the position is not supported or the payload device
+             *         could not be repositioned.
+             */
+            bool seek(qint64 pos) override;
+
+        protected:
+            /**
+             * Method that reads envelope data.
+             *
+             * \param[out] data    Buffer to receive the data.
+             *
+             * \param[in]  maxSize The size of the buffer, in bytes.
+             *
+             * \return Returns the number of bytes read or -1 on error.
+             */
+            qint64 readData(char* data, qint64 maxSize) override;
+
+            /**
+             * Method that rejects writes.
+             *
+             * \param[in] data    The data to be written.
+             *
+             * \param[in] maxSize The number of bytes to be written.
+             *
+             * \return Returns -1.
+             */
+            qint64 writeData(const char* data, qint64 maxSize) override;
+
+        private:
+            /**
+             * Method that restarts the envelope from the beginning.
+             *
+             * \return Returns true on success.  Returns false if the payload device could not be repositioned.
+             */
+            bool rewind();
+
+            /**
+             * Method that refills the staging buffer with the next piece of the envelope.
+             *
+             * \return Returns true on success.  Returns false if the payload could not be read.
+             */
+            bool refill();
+
+            /**
+             * The device holding the payload.
+             */
+            QIODevice* currentPayload;
+
+            /**
+             * The offset of the payload within the payload device.
+             */
+            qint64 currentPayloadOffset;
+
+            /**
+             * The size of the payload, in bytes.
+             */
+            qint64 currentPayloadSize;
+
+            /**
+             * The number of payload bytes consumed so far.
+             */
+            qint64 payloadConsumed;
+
+            /**
+             * The size of the envelope, in bytes.
+             */
+            qint64 currentEnvelopeSize;
+
+            /**
+             * Flag indicating that the signature has been staged.
+             */
+            bool finished;
+
+            /**
+             * The signer used to sign the payload.
+             */
+            SigningKeyCache::Signer signer;
+
+            /**
+             * Buffer holding raw payload bytes that have been read but not yet encoded.
+             */
+            QByteArray rawBuffer;
+
+            /**
+             * Buffer holding encoded envelope bytes that have not yet been read.
+             */
+            QByteArray staged;
+
+            /**
+             * The offset of the next unread byte in the staging buffer.
+             */
+            int stagedOffset;
+    };
+}
+
+#endif
@@ -0,0 +1,145 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::EnvelopeWriter class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QLatin1String>
+#include <QCborStreamWriter>
+
+#include <cstring>
+
+#include "wh_base64.h"
+#include "wh_envelope_writer.h"
+
+namespace Wh {
+    static const char  envelopePrefix[]    = "{\"data\":\"";
+    static const char  envelopeSeparator[] = "\",\"hash\":\"";
+    static const char  envelopeSuffix[]    = "\"}";
+
+    static const unsigned envelopePrefixLength    = sizeof(envelopePrefix) - 1;
+    static const unsigned envelopeSeparatorLength = sizeof(envelopeSeparator) - 1;
+    static const unsigned envelopeSuffixLength    = sizeof(envelopeSuffix) - 1;
+
+    static const unsigned cborKeyLength           = 5; // Text string header plus "data" or "hash".
+
+    /**
+     * Function that determines the size of a CBOR byte string header.
+     *
+     * \param[in] length The length of the byte string.
+     *
+     * \return Returns the size of the header, in bytes.
+     */
+    static inline unsigned cborByteStringHeaderLength(unsigned length) {
+        unsigned result;
+
+        if (length < 24) {
+            result = 1;
+        } else if (length < 0x100) {
+            result = 2;
+        } else if (length < 0x10000) {
+            result = 3;
+        } else {
+            result = 5;
+        }
+
+        return result;
+    }
+
+    unsigned EnvelopeWriter::envelopeSize(unsigned dataLength, unsigned hashLength) {
+        return (
+              envelopePrefixLength
+            + Base64::encodedLength(dataLength)
+            + envelopeSeparatorLength
+            + Base64::encodedLength(hashLength)
+            + envelopeSuffixLength
+        );
+    }
+
+
+    QByteArray EnvelopeWriter::write(const QByteArray& data, const QByteArray& hash) {
+        unsigned   dataLength = static_cast<unsigned>(data.size());
+        unsigned   hashLength = static_cast<unsigned>(hash.size());
+        QByteArray result(static_cast<int>(envelopeSize(dataLength, hashLength)), Qt::Uninitialized);
+
+        char* d = result.data();
+
+        std::memcpy(d, envelopePrefix, envelopePrefixLength);
+        d += envelopePrefixLength;
+
+        d = Base64::encode(d, data.constData(), dataLength);
+
+        std::memcpy(d, envelopeSeparator, envelopeSeparatorLength);
+        d += envelopeSeparatorLength;
+
+        d = Base64::encode(d, hash.constData(), hashLength);
+
+        std::memcpy(d, envelopeSuffix, envelopeSuffixLength);
+
+        return result;
+    }
+
+
+    QByteArray EnvelopeWriter::prefix() {
+        return QByteArray::fromRawData(envelopePrefix, static_cast<int>(envelopePrefixLength));
+    }
+
+
+    QByteArray EnvelopeWriter::separator() {
+        return QByteArray::fromRawData(envelopeSeparator, static_cast<int>(envelopeSeparatorLength));
+    }
+
+
+    QByteArray EnvelopeWriter::suffix() {
+        return QByteArray::fromRawData(envelopeSuffix, static_cast<int>(envelopeSuffixLength));
+    }
+
+
+    unsigned EnvelopeWriter::cborEnvelopeSize(unsigned dataLength, unsigned hashLength) {
+        return (
+              1
+            + cborKeyLength
+            + cborByteStringHeaderLength(dataLength)
+            + dataLength
+            + cborKeyLength
+            + cborByteStringHeaderLength(hashLength)
+            + hashLength
+        );
+    }
+
+
+    QByteArray EnvelopeWriter::writeCbor(const QByteArray& data, const QByteArray& hash) {
+        QByteArray result;
+        result.reserve(
+            static_cast<int>(cborEnvelopeSize(static_cast<unsigned>(data.size()), static_cast<unsigned>(hash.size())))
+        );
+
+        QCborStreamWriter writer(&result);
+        writer.startMap(2);
+        writer.append(QLatin1String("data"));
+        writer.append(data);
+        writer.append(QLatin1String("hash"));
+        writer.append(hash);
+        writer.endMap();
+
+        return result;
+    }
+}
@@ -0,0 +1,113 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::EnvelopeWriter class.
+***********************************************************************************************************************/
+
+#ifndef WH_ENVELOPE_WRITER_H
+#define WH_ENVELOPE_WRITER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that builds the signed message envelope sent to Inesonic webhooks.  The envelope is the compact JSON
+     * object
+     *
+     *     {"data":"<base64 payload>","hash":"<base64 signature>"}
+     *
+     * The class writes the envelope directly into a single, pre-sized buffer.  The output is byte-for-byte identical
+     * to building the envelope with QJsonObject and QJsonDocument::toJson using the compact format.
+     *
+     * The class can also build a binary envelope, sent as application/cbor.  The binary envelope is a CBOR map with
+     * the same two keys whose values are byte strings holding the raw payload and the raw signature.
+     */
+    class EnvelopeWriter {
+        public:
+            /**
+             * Method you can use to determine the size of an envelope.
+             *
+             * \param[in] dataLength The length of the raw payload, in bytes.
+             *
+             * \param[in] hashLength The length of the raw signature, in bytes.
+             *
+             * \return Returns the size of the envelope, in bytes.
+             */
+            static unsigned envelopeSize(unsigned dataLength, unsigned hashLength);
+
+            /**
+             * Method that builds an envelope.
+             *
+             * \param[in] data The raw payload.
+             *
+             * \param[in] hash The raw signature.
+             *
+             * \return Returns the envelope.
+             */
+            static QByteArray write(const QByteArray& data, const QByteArray& hash);
+
+            /**
+             * Method that returns the text placed ahead of the encoded payload.
+             *
+             * \return Returns the envelope prefix.
+             */
+            static QByteArray prefix();
+
+            /**
+             * Method that returns the text placed between the encoded payload and the encoded signature.
+             *
+             * \return Returns the envelope separator.
+             */
+            static QByteArray separator();
+
+            /**
+             * Method that returns the text placed after the encoded signature.
+             *
+             * \return Returns the envelope suffix.
+             */
+            static QByteArray suffix();
+
+            /**
+             * Method you can use to determine the size of a binary envelope.
+             *
+             * \param[in] dataLength The length of the raw payload, in bytes.
+             *
+             * \param[in] hashLength The length of the raw signature, in bytes.
+             *
+             * \return Returns the size of the binary envelope, in bytes.
+             */
+            static unsigned cborEnvelopeSize(unsigned dataLength, unsigned hashLength);
+
+            /**
+             * Method that builds a binary envelope.
+             *
+             * \param[in] data The raw payload.
+             *
+             * \param[in] hash The raw signature.
+             *
+             * \return Returns the binary envelope.
+             */
+            static QByteArray writeCbor(const QByteArray& data, const QByteArray& hash);
+    };
+}
+
+#endif
@@ -0,0 +1,300 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::FlowControl class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <cmath>
+
+#include "wh_flow_control.h"
+
+namespace Wh {
+    /**
+     * Class that holds the state for one destination.
+     */
+    class FlowControl::Destination {
+        public:
+            /**
+             * The current concurrency limit.  The limit is held as a fraction so that additive increases can be
+             * spread across a full round of requests.
+             */
+            double limit;
+
+            /**
+             * The number of messages holding a concurrency slot.
+             */
+            unsigned outstanding;
+
+            /**
+             * The number of tokens in the bucket.
+             */
+            double tokens;
+
+            /**
+             * The time the bucket was last refilled, in microseconds.
+             */
+            long long lastRefill;
+
+            /**
+             * The lowest recent latency, in microseconds.  A value of 0 indicates no latency has been measured.
+             */
+            long long baselineLatency;
+
+            /**
+             * The time of the most recent decrease, in microseconds.
+             */
+            long long lastDecrease;
+
+            /**
+             * Method that returns the concurrency limit as a whole number of messages.
+             *
+             * \return Returns the concurrency limit.
+             */
+            unsigned limitSlots() const {
+                return qMax(static_cast<unsigned>(limit), 1U);
+            }
+    };
+
+    constexpr unsigned  FlowControl::defaultBurst;
+    constexpr unsigned  FlowControl::defaultInitialLimit;
+    constexpr unsigned  FlowControl::defaultMinimumLimit;
+    constexpr unsigned  FlowControl::defaultMaximumLimit;
+    constexpr double    FlowControl::defaultDecreaseFactor;
+    constexpr double    FlowControl::defaultLatencyTolerance;
+    constexpr long long FlowControl::latencyNoiseFloor;
+
+    FlowControl::FlowControl(double messagesPerSecond, unsigned burst) {
+        currentRate             = qMax(messagesPerSecond, 0.0);
+        currentBurst            = qMax(burst, 1U);
+        currentInitialLimit     = defaultInitialLimit;
+        currentMinimumLimit     = defaultMinimumLimit;
+        currentMaximumLimit     = defaultMaximumLimit;
+        currentDecreaseFactor   = defaultDecreaseFactor;
+        currentLatencyTolerance = defaultLatencyTolerance;
+    }
+
+
+    FlowControl::~FlowControl() {
+        qDeleteAll(destinations);
+    }
+
+
+    void FlowControl::setRate(double messagesPerSecond, unsigned burst) {
+        QMutexLocker locker(&mutex);
+
+        currentRate  = qMax(messagesPerSecond, 0.0);
+        currentBurst = qMax(burst, 1U);
+
+        for (Destination* entry : destinations) {
+            entry->tokens = qMin(entry->tokens, static_cast<double>(currentBurst));
+        }
+    }
+
+
+    double FlowControl::rate() const {
+        QMutexLocker locker(&mutex);
+        return currentRate;
+    }
+
+
+    unsigned FlowControl::burst() const {
+        QMutexLocker locker(&mutex);
+        return currentBurst;
+    }
+
+
+    void FlowControl::setConcurrencyLimits(unsigned initialLimit, unsigned minimumLimit, unsigned maximumLimit) {
+        QMutexLocker locker(&mutex);
+
+        currentMinimumLimit = qMax(minimumLimit, 1U);
+        currentMaximumLimit = qMax(maximumLimit, currentMinimumLimit);
+        currentInitialLimit = qBound(currentMinimumLimit, initialLimit, currentMaximumLimit);
+
+        for (Destination* entry : destinations) {
+            entry->limit = qBound(
+                static_cast<double>(currentMinimumLimit),
+                entry->limit,
+                static_cast<double>(currentMaximumLimit)
+            );
+        }
+    }
+
+
+    unsigned FlowControl::initialLimit() const {
+        QMutexLocker locker(&mutex);
+        return currentInitialLimit;
+    }
+
+
+    unsigned FlowControl::minimumLimit() const {
+        QMutexLocker locker(&mutex);
+        return currentMinimumLimit;
+    }
+
+
+    unsigned FlowControl::maximumLimit() const {
+        QMutexLocker locker(&mutex);
+        return currentMaximumLimit;
+    }
+
+
+    void FlowControl::setDecreaseFactor(double newDecreaseFactor) {
+        QMutexLocker locker(&mutex);
+        currentDecreaseFactor = qBound(0.1, newDecreaseFactor, 0.95);
+    }
+
+
+    double FlowControl::decreaseFactor() const {
+        QMutexLocker locker(&mutex);
+        return currentDecreaseFactor;
+    }
+
+
+    void FlowControl::setLatencyTolerance(double newLatencyTolerance) {
+        QMutexLocker locker(&mutex);
+        currentLatencyTolerance = newLatencyTolerance <= 0 ? 0 : qMax(newLatencyTolerance, 1.0);
+    }
+
+
+    double FlowControl::latencyTolerance() const {
+        QMutexLocker locker(&mutex);
+        return currentLatencyTolerance;
+    }
+
+
+    long long FlowControl::acquire(const QString& destination, long long now) {
+        QMutexLocker locker(&mutex);
+
+        long long    result;
+        Destination* entry = destinationEntry(destination, now);
+
+        if (entry->outstanding >= entry->limitSlots()) {
+            result = -1;
+        } else if (currentRate <= 0) {
+            ++entry->outstanding;
+            result = 0;
+        } else {
+            double elapsed = static_cast<double>(qMax(now - entry->lastRefill, 0LL)) / 1.0E6;
+
+            entry->tokens     = qMin(entry->tokens + elapsed * currentRate, static_cast<double>(currentBurst));
+            entry->lastRefill = now;
+
+            if (entry->tokens >= 1.0) {
+                entry->tokens -= 1.0;
+                ++entry->outstanding;
+                result = 0;
+            } else {
+                result = qMax(static_cast<long long>(std::ceil((1.0 - entry->tokens) * 1.0E6 / currentRate)), 1LL);
+            }
+        }
+
+        return result;
+    }
+
+
+    void FlowControl::record(const QString& destination, Outcome outcome, long long sendTime, long long now) {
+        QMutexLocker locker(&mutex);
+
+        Destination* entry      = destinationEntry(destination, now);
+        bool         overloaded = (outcome == Outcome::OVERLOADED || outcome == Outcome::TIMED_OUT);
+
+        if (outcome == Outcome::SUCCESS) {
+            long long latency  = now - sendTime;
+            long long baseline = entry->baselineLatency;
+
+            if (latency > 0) {
+                if (currentLatencyTolerance > 0                                 &&
+                    baseline > 0                                                &&
+                    latency > baseline + latencyNoiseFloor                      &&
+                    latency > static_cast<long long>(currentLatencyTolerance * baseline)    ) {
+                    overloaded = true;
+                }
+
+                // The baseline drops to a new low at once but rises slowly.
+                if (baseline == 0 || latency < baseline) {
+                    entry->baselineLatency = latency;
+                } else {
+                    entry->baselineLatency = baseline + (latency - baseline) / 64;
+                }
+            }
+        }
+
+        if (overloaded) {
+            if (sendTime >= entry->lastDecrease) {
+                entry->limit        = qMax(entry->limit * currentDecreaseFactor, 1.0 * currentMinimumLimit);
+                entry->lastDecrease = now;
+            }
+        } else if (outcome == Outcome::SUCCESS && 2 * entry->outstanding >= entry->limitSlots()) {
+            // Only grow the limit while it is actually being used.  An idle destination tells us nothing about how
+            // much more load it can take.
+            entry->limit = qMin(entry->limit + 1.0 / entry->limit, 1.0 * currentMaximumLimit);
+        }
+    }
+
+
+    void FlowControl::release(const QString& destination) {
+        QMutexLocker locker(&mutex);
+
+        Destination* entry = destinations.value(destination);
+        if (entry != Q_NULLPTR && entry->outstanding > 0) {
+            --entry->outstanding;
+        }
+    }
+
+
+    unsigned FlowControl::concurrencyLimit(const QString& destination) const {
+        QMutexLocker locker(&mutex);
+
+        const Destination* entry = destinations.value(destination);
+        return entry != Q_NULLPTR ? entry->limitSlots() : currentInitialLimit;
+    }
+
+
+    unsigned FlowControl::outstanding(const QString& destination) const {
+        QMutexLocker locker(&mutex);
+
+        const Destination* entry = destinations.value(destination);
+        return entry != Q_NULLPTR ? entry->outstanding : 0;
+    }
+
+
+    FlowControl::Destination* FlowControl::destinationEntry(const QString& destination, long long now) {
+        Destination* result = destinations.value(destination);
+        if (result == Q_NULLPTR) {
+            result = new Destination;
+
+            result->limit           = currentInitialLimit;
+            result->outstanding     = 0;
+            result->tokens          = currentBurst;
+            result->lastRefill      = now;
+            result->baselineLatency = 0;
+            result->lastDecrease    = 0;
+
+            destinations.insert(destination, result);
+        }
+
+        return result;
+    }
+}
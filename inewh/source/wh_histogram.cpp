@@ -0,0 +1,116 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::Histogram class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+
+#include <atomic>
+
+#include "wh_histogram.h"
+
+namespace Wh {
+    constexpr unsigned           Histogram::subBucketBits;
+    constexpr unsigned           Histogram::magnitudeBits;
+    constexpr unsigned long long Histogram::maximumValue;
+    constexpr unsigned           Histogram::numberBuckets;
+
+    Histogram::Histogram() {
+        for (unsigned i=0 ; i<numberBuckets ; ++i) {
+            buckets[i].store(0, std::memory_order_relaxed);
+        }
+
+        currentCount.store(0, std::memory_order_relaxed);
+        currentSum.store(0, std::memory_order_relaxed);
+        currentMaximum.store(0, std::memory_order_relaxed);
+    }
+
+
+    Histogram::~Histogram() {}
+
+
+    void Histogram::record(unsigned long long value) {
+        if (value > maximumValue) {
+            value = maximumValue;
+        }
+
+        buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        currentCount.fetch_add(1, std::memory_order_relaxed);
+        currentSum.fetch_add(value, std::memory_order_relaxed);
+
+        unsigned long long maximum = currentMaximum.load(std::memory_order_relaxed);
+        while (value > maximum && !currentMaximum.compare_exchange_weak(maximum, value, std::memory_order_relaxed)) {}
+    }
+
+
+    void Histogram::read(
+            unsigned long long* bucketCounts,
+            unsigned long long& count,
+            unsigned long long& sum,
+            unsigned long long& maximum
+        ) const {
+        // Count the buckets rather than trusting currentCount so percentiles are consistent with the buckets we read.
+        count = 0;
+        for (unsigned i=0 ; i<numberBuckets ; ++i) {
+            bucketCounts[i]  = buckets[i].load(std::memory_order_relaxed);
+            count           += bucketCounts[i];
+        }
+
+        sum     = currentSum.load(std::memory_order_relaxed);
+        maximum = currentMaximum.load(std::memory_order_relaxed);
+    }
+
+
+    unsigned Histogram::bucketIndex(unsigned long long value) {
+        unsigned result;
+
+        if (value < (1ULL << subBucketBits)) {
+            result = static_cast<unsigned>(value);
+        } else {
+            unsigned magnitude = 63U - qCountLeadingZeroBits(static_cast<quint64>(value));
+            unsigned shift     = magnitude - subBucketBits + 1;
+            unsigned half      = 1U << (subBucketBits - 1);
+            unsigned top       = static_cast<unsigned>(value >> shift);
+
+            result = (1U << subBucketBits) + (shift - 1) * half + (top - half);
+        }
+
+        return result;
+    }
+
+
+    unsigned long long Histogram::bucketUpperBound(unsigned index) {
+        unsigned long long result;
+
+        if (index < (1U << subBucketBits)) {
+            result = index;
+        } else {
+            unsigned half   = 1U << (subBucketBits - 1);
+            unsigned offset = index - (1U << subBucketBits);
+            unsigned shift  = offset / half + 1;
+            unsigned top    = offset % half + half;
+
+            result = ((static_cast<unsigned long long>(top) + 1) << shift) - 1;
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,136 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::Histogram class.
+***********************************************************************************************************************/
+
+#ifndef WH_HISTOGRAM_H
+#define WH_HISTOGRAM_H
+
+#include <QtGlobal>
+
+#include <atomic>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that tracks a distribution of values using log-linear buckets in the style of an HDR histogram.  Values
+     * below 2^\ref Histogram::subBucketBits are tracked exactly.  Larger values are tracked with a relative error of
+     * at most 1 part in 2^(\ref Histogram::subBucketBits - 1).
+     *
+     * Recording is lock-free and may be performed from any thread.  Reads are not atomic across buckets so a read
+     * that races with a recording may be off by the values recorded during the read.
+     */
+    class Histogram {
+        public:
+            /**
+             * The number of bits of precision kept for each value.
+             */
+            static constexpr unsigned subBucketBits = 5;
+
+            /**
+             * The number of bits needed to represent the largest trackable value.
+             */
+            static constexpr unsigned magnitudeBits = 40;
+
+            /**
+             * The largest trackable value.  Larger values are recorded as this value.
+             */
+            static constexpr unsigned long long maximumValue = (1ULL << magnitudeBits) - 1;
+
+            /**
+             * The number of buckets.
+             */
+            static constexpr unsigned numberBuckets = (
+                  (1U << subBucketBits)
+                + (magnitudeBits - subBucketBits) * (1U << (subBucketBits - 1))
+            );
+
+            Histogram();
+
+            ~Histogram();
+
+            /**
+             * Method you can use to record a value.
+             *
+             * \param[in] value The value to be recorded.
+             */
+            void record(unsigned long long value);
+
+            /**
+             * Method you can use to read the histogram.
+             *
+             * \param[out] bucketCounts Array of \ref Histogram::numberBuckets entries to receive the bucket counts.
+             *
+             * \param[out] count        The number of recorded values.
+             *
+             * \param[out] sum          The sum of the recorded values.
+             *
+             * \param[out] maximum      The largest recorded value.
+             */
+            void read(
+                unsigned long long* bucketCounts,
+                unsigned long long& count,
+                unsigned long long& sum,
+                unsigned long long& maximum
+            ) const;
+
+            /**
+             * Method that determines the bucket holding a value.
+             *
+             * \param[in] value The value of interest.
+             *
+             * \return Returns the zero based bucket index.
+             */
+            static unsigned bucketIndex(unsigned long long value);
+
+            /**
+             * Method that determines the largest value held by a bucket.
+             *
+             * \param[in] index The zero based bucket index.
+             *
+             * \return Returns the largest value that maps to the bucket.
+             */
+            static unsigned long long bucketUpperBound(unsigned index);
+
+        private:
+            /**
+             * The bucket counts.
+             */
+            std::atomic<unsigned long long> buckets[numberBuckets];
+
+            /**
+             * The number of recorded values.
+             */
+            std::atomic<unsigned long long> currentCount;
+
+            /**
+             * The sum of the recorded values.
+             */
+            std::atomic<unsigned long long> currentSum;
+
+            /**
+             * The largest recorded value.
+             */
+            std::atomic<unsigned long long> currentMaximum;
+    };
+}
+
+#endif
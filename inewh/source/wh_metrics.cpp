@@ -0,0 +1,436 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::Metrics class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include "wh_histogram.h"
+#include "wh_metrics.h"
+
+namespace Wh {
+    /**
+     * Class that describes how a metric is exported.
+     */
+    class MetricExport {
+        public:
+            /**
+             * The metric name, without the prefix.
+             */
+            const char* name;
+
+            /**
+             * The help text.
+             */
+            const char* help;
+    };
+
+    static const MetricExport counterExports[Metrics::numberCounters] = {
+        { "messages_total",             "Messages submitted for delivery." },
+        { "requests_total",             "HTTP requests sent, including retries." },
+        { "retries_total",              "HTTP requests that were retries." },
+        { "delivered_total",            "Messages delivered." },
+        { "failed_total",               "Messages that could not be delivered." },
+        { "sent_bytes_total",           "Request body bytes sent." },
+        { "received_bytes_total",       "Response body bytes received." },
+        { "time_delta_refreshes_total", "Requests sent to the timestamp server." }
+    };
+
+    static const MetricExport latencyExports[Metrics::numberLatencies] = {
+        { "sign_duration_seconds",       "Time spent signing and building envelopes." },
+        { "round_trip_duration_seconds", "Time from sending a request until the response is received." },
+        { "delivery_duration_seconds",   "Time from queueing a message until it is delivered." }
+    };
+
+    static const MetricExport gaugeExports[Metrics::numberGauges] = {
+        { "messages_queued",    "Messages waiting for an in-flight slot." },
+        { "messages_in_flight", "Messages in flight." }
+    };
+
+    static const double exportedPercentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
+    /**
+     * Function that escapes a Prometheus label value.
+     *
+     * \param[in] value The value to be escaped.
+     *
+     * \return Returns the escaped value.
+     */
+    static QByteArray escapeLabel(const QString& value) {
+        QByteArray result;
+        QByteArray raw = value.toUtf8();
+
+        result.reserve(raw.size());
+        for (char c : raw) {
+            if (c == '\\') {
+                result.append("\\\\");
+            } else if (c == '"') {
+                result.append("\\\"");
+            } else if (c == '\n') {
+                result.append("\\n");
+            } else {
+                result.append(c);
+            }
+        }
+
+        return result;
+    }
+
+
+    /**
+     * Function that writes the HELP and TYPE lines for a metric.
+     *
+     * \param[in,out] text The text being built.
+     *
+     * \param[in]     name The full metric name.
+     *
+     * \param[in]     help The help text.
+     *
+     * \param[in]     type The metric type.
+     */
+    static void writeHeader(QByteArray& text, const QByteArray& name, const char* help, const char* type) {
+        text.append("# HELP ").append(name).append(' ').append(help).append('\n');
+        text.append("# TYPE ").append(name).append(' ').append(type).append('\n');
+    }
+
+
+    class Metrics::Destination {
+        public:
+            Destination() {
+                for (unsigned i=0 ; i<numberCounters ; ++i) {
+                    counters[i].store(0, std::memory_order_relaxed);
+                }
+            }
+
+            /**
+             * The counter values.
+             */
+            std::atomic<unsigned long long> counters[numberCounters];
+
+            /**
+             * The latency histograms.
+             */
+            Histogram latencies[numberLatencies];
+    };
+
+    constexpr unsigned Metrics::numberCounters;
+    constexpr unsigned Metrics::numberLatencies;
+    constexpr unsigned Metrics::numberGauges;
+
+    Metrics::Distribution::Distribution() {
+        currentCount   = 0;
+        currentSum     = 0;
+        currentMaximum = 0;
+    }
+
+
+    Metrics::Distribution::~Distribution() {}
+
+
+    unsigned long long Metrics::Distribution::count() const {
+        return currentCount;
+    }
+
+
+    unsigned long long Metrics::Distribution::sum() const {
+        return currentSum;
+    }
+
+
+    unsigned long long Metrics::Distribution::maximum() const {
+        return currentMaximum;
+    }
+
+
+    double Metrics::Distribution::mean() const {
+        return currentCount > 0 ? static_cast<double>(currentSum) / static_cast<double>(currentCount) : 0.0;
+    }
+
+
+    unsigned long long Metrics::Distribution::percentile(double percent) const {
+        unsigned long long result = 0;
+
+        if (currentCount > 0) {
+            double             clamped = qBound(0.0, percent, 100.0);
+            unsigned long long rank    = static_cast<unsigned long long>(std::ceil(clamped * currentCount / 100.0));
+            if (rank == 0) {
+                rank = 1;
+            }
+
+            unsigned long long seen  = 0;
+            unsigned           index = 0;
+            while (seen < rank && index < static_cast<unsigned>(buckets.size())) {
+                seen += buckets.at(index);
+                ++index;
+            }
+
+            result = qMin(Histogram::bucketUpperBound(index - 1), currentMaximum);
+        }
+
+        return result;
+    }
+
+    Metrics::Snapshot::Entry::Entry() {
+        for (unsigned i=0 ; i<numberCounters ; ++i) {
+            counters[i] = 0;
+        }
+    }
+
+
+    Metrics::Snapshot::Snapshot() {
+        for (unsigned i=0 ; i<numberGauges ; ++i) {
+            gauges[i] = 0;
+        }
+    }
+
+
+    Metrics::Snapshot::~Snapshot() {}
+
+
+    QStringList Metrics::Snapshot::destinations() const {
+        return entries.keys();
+    }
+
+
+    unsigned long long Metrics::Snapshot::counter(Counter counter, const QString& destination) const {
+        unsigned long long result = 0;
+        unsigned           index  = static_cast<unsigned>(counter);
+
+        if (destination.isEmpty()) {
+            result = total.counters[index];
+        } else {
+            QMap<QString, Entry>::const_iterator it = entries.constFind(destination);
+            if (it != entries.constEnd()) {
+                result = it.value().counters[index];
+            }
+        }
+
+        return result;
+    }
+
+
+    Metrics::Distribution Metrics::Snapshot::latency(Latency latency, const QString& destination) const {
+        Distribution result;
+        unsigned     index = static_cast<unsigned>(latency);
+
+        if (destination.isEmpty()) {
+            result = total.latencies[index];
+        } else {
+            QMap<QString, Entry>::const_iterator it = entries.constFind(destination);
+            if (it != entries.constEnd()) {
+                result = it.value().latencies[index];
+            }
+        }
+
+        return result;
+    }
+
+
+    long long Metrics::Snapshot::gauge(Gauge gauge) const {
+        return gauges[static_cast<unsigned>(gauge)];
+    }
+
+
+    double Metrics::Snapshot::retryAmplification(const QString& destination) const {
+        unsigned long long messages = counter(Counter::MESSAGES, destination);
+        unsigned long long requests = counter(Counter::REQUESTS, destination);
+
+        return messages > 0 ? static_cast<double>(requests) / static_cast<double>(messages) : 0.0;
+    }
+
+    Metrics::Metrics() {
+        total = new Destination;
+
+        for (unsigned i=0 ; i<numberGauges ; ++i) {
+            gauges[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+
+    Metrics::~Metrics() {
+        qDeleteAll(destinations);
+        delete total;
+    }
+
+
+    Metrics::Destination* Metrics::destinationEntry(const QString& destination) {
+        QMutexLocker locker(&destinationMutex);
+
+        Destination* result = destinations.value(destination);
+        if (result == Q_NULLPTR) {
+            result = new Destination;
+            destinations.insert(destination, result);
+        }
+
+        return result;
+    }
+
+
+    void Metrics::increment(Counter counter, const QString& destination, unsigned long long amount) {
+        increment(counter, destinationEntry(destination), amount);
+    }
+
+
+    void Metrics::increment(Counter counter, Metrics::Destination* destination, unsigned long long amount) {
+        unsigned index = static_cast<unsigned>(counter);
+
+        destination->counters[index].fetch_add(amount, std::memory_order_relaxed);
+        total->counters[index].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+
+    void Metrics::record(Latency latency, const QString& destination, unsigned long long duration) {
+        record(latency, destinationEntry(destination), duration);
+    }
+
+
+    void Metrics::record(Latency latency, Metrics::Destination* destination, unsigned long long duration) {
+        unsigned index = static_cast<unsigned>(latency);
+
+        destination->latencies[index].record(duration);
+        total->latencies[index].record(duration);
+    }
+
+
+    void Metrics::adjust(Gauge gauge, long long amount) {
+        gauges[static_cast<unsigned>(gauge)].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+
+    Metrics::Snapshot Metrics::snapshot() const {
+        Snapshot result;
+
+        copyEntry(total, result.total);
+
+        QMutexLocker locker(&destinationMutex);
+        QHash<QString, Destination*>::const_iterator it  = destinations.constBegin();
+        QHash<QString, Destination*>::const_iterator end = destinations.constEnd();
+        while (it != end) {
+            copyEntry(it.value(), result.entries[it.key()]);
+            ++it;
+        }
+
+        locker.unlock();
+
+        for (unsigned i=0 ; i<numberGauges ; ++i) {
+            result.gauges[i] = gauges[i].load(std::memory_order_relaxed);
+        }
+
+        return result;
+    }
+
+
+    QByteArray Metrics::prometheusText(const QString& prefix) const {
+        QByteArray  result;
+        Snapshot    metrics      = snapshot();
+        QStringList destinations = metrics.destinations();
+        QByteArray  namePrefix   = prefix.isEmpty() ? QByteArray() : prefix.toUtf8() + '_';
+
+        QList<QByteArray> labels;
+        for (const QString& destination : destinations) {
+            labels.append(QByteArray("destination=\"") + escapeLabel(destination) + '"');
+        }
+
+        for (unsigned c=0 ; c<numberCounters ; ++c) {
+            QByteArray name = namePrefix + counterExports[c].name;
+            writeHeader(result, name, counterExports[c].help, "counter");
+
+            for (unsigned d=0 ; d<static_cast<unsigned>(destinations.size()) ; ++d) {
+                unsigned long long value = metrics.counter(static_cast<Counter>(c), destinations.at(d));
+                result.append(name).append('{').append(labels.at(d)).append("} ");
+                result.append(QByteArray::number(value)).append('\n');
+            }
+        }
+
+        for (unsigned l=0 ; l<numberLatencies ; ++l) {
+            QByteArray name = namePrefix + latencyExports[l].name;
+            writeHeader(result, name, latencyExports[l].help, "summary");
+
+            for (unsigned d=0 ; d<static_cast<unsigned>(destinations.size()) ; ++d) {
+                Distribution distribution = metrics.latency(static_cast<Latency>(l), destinations.at(d));
+                const QByteArray& label   = labels.at(d);
+
+                for (double percent : exportedPercentiles) {
+                    double seconds = distribution.percentile(percent) / 1.0E6;
+                    result.append(name).append('{').append(label).append(",quantile=\"");
+                    result.append(QByteArray::number(percent / 100.0, 'g', 4)).append("\"} ");
+                    result.append(QByteArray::number(seconds, 'g', 9)).append('\n');
+                }
+
+                result.append(name).append("_sum{").append(label).append("} ");
+                result.append(QByteArray::number(distribution.sum() / 1.0E6, 'g', 12)).append('\n');
+                result.append(name).append("_count{").append(label).append("} ");
+                result.append(QByteArray::number(distribution.count())).append('\n');
+            }
+        }
+
+        for (unsigned g=0 ; g<numberGauges ; ++g) {
+            QByteArray name = namePrefix + gaugeExports[g].name;
+            writeHeader(result, name, gaugeExports[g].help, "gauge");
+
+            result.append(name).append(' ').append(QByteArray::number(metrics.gauge(static_cast<Gauge>(g))));
+            result.append('\n');
+        }
+
+        return result;
+    }
+
+
+    long long Metrics::now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+
+    void Metrics::copyEntry(const Destination* destination, Snapshot::Entry& entry) {
+        for (unsigned i=0 ; i<numberCounters ; ++i) {
+            entry.counters[i] = destination->counters[i].load(std::memory_order_relaxed);
+        }
+
+        for (unsigned i=0 ; i<numberLatencies ; ++i) {
+            Distribution& distribution = entry.latencies[i];
+
+            distribution.buckets.resize(static_cast<int>(Histogram::numberBuckets));
+            destination->latencies[i].read(
+                distribution.buckets.data(),
+                distribution.currentCount,
+                distribution.currentSum,
+                distribution.currentMaximum
+            );
+
+            if (distribution.currentCount == 0) {
+                distribution.buckets.clear();
+            }
+        }
+    }
+}
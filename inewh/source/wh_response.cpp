@@ -0,0 +1,99 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::Response class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QCborValue>
+#include <QCborMap>
+#include <QCborArray>
+#include <QCborParserError>
+
+#include "wh_response.h"
+
+namespace Wh {
+    Response::Response():decoded(false) {}
+
+
+    Response::Response(
+            const QByteArray& rawData,
+            const QString&    contentType
+        ):currentRawData(
+            rawData
+        ),currentContentType(
+            contentType
+        ),decoded(
+            false
+        ) {}
+
+
+    const QByteArray& Response::rawData() const {
+        return currentRawData;
+    }
+
+
+    const QJsonDocument& Response::json() {
+        if (!decoded) {
+            if (!currentRawData.isEmpty()) {
+                decodedJson = decode(currentRawData, currentContentType);
+            }
+
+            decoded = true;
+        }
+
+        return decodedJson;
+    }
+
+
+    bool Response::isDecoded() const {
+        return decoded;
+    }
+
+
+    QJsonDocument Response::decode(const QByteArray& rawData, const QString& contentType) {
+        QJsonDocument result;
+
+        if (contentType.startsWith(QString("application/cbor"), Qt::CaseInsensitive)) {
+            QCborParserError parseError;
+            QCborValue       value = QCborValue::fromCbor(rawData, &parseError);
+
+            if (parseError.error == QCborError::NoError) {
+                if (value.isMap()) {
+                    result = QJsonDocument(value.toMap().toJsonObject());
+                } else if (value.isArray()) {
+                    result = QJsonDocument(value.toArray().toJsonArray());
+                }
+            }
+        } else {
+            QJsonParseError parseError;
+            QJsonDocument   jsonDocument = QJsonDocument::fromJson(rawData, &parseError);
+
+            if (parseError.error == QJsonParseError::NoError) {
+                result = jsonDocument;
+            }
+        }
+
+        return result;
+    }
+}
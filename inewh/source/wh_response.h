@@ -0,0 +1,110 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::Response class.
+***********************************************************************************************************************/
+
+#ifndef WH_RESPONSE_H
+#define WH_RESPONSE_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+#include <QJsonDocument>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that holds a response body and decodes it on first use.  JSON and CBOR bodies are supported.  Responses
+     * nobody inspects are never parsed.
+     */
+    class Response {
+        public:
+            /**
+             * Constructor.  Creates an empty response.
+             */
+            Response();
+
+            /**
+             * Constructor
+             *
+             * \param[in] rawData     The raw response body.
+             *
+             * \param[in] contentType The value of the response Content-Type header.
+             */
+            Response(const QByteArray& rawData, const QString& contentType);
+
+            /**
+             * Method you can use to obtain the raw response body.
+             *
+             * \return Returns the raw response body.
+             */
+            const QByteArray& rawData() const;
+
+            /**
+             * Method you can use to obtain the decoded response.  The body is decoded on the first call.
+             *
+             * \return Returns the decoded response.  A null document is returned if the body is empty or could not
+             *         be decoded.
+             */
+            const QJsonDocument& json();
+
+            /**
+             * Method you can use to determine if the body has been decoded.
+             *
+             * \return Returns true if the body has been decoded.
+             */
+            bool isDecoded() const;
+
+            /**
+             * Method that decodes a response body.
+             *
+             * \param[in] rawData     The raw response body.
+             *
+             * \param[in] contentType The value of the response Content-Type header.
+             *
+             * \return Returns the decoded response.  A null document is returned if the body could not be decoded.
+             */
+            static QJsonDocument decode(const QByteArray& rawData, const QString& contentType);
+
+        private:
+            /**
+             * The raw response body.
+             */
+            QByteArray currentRawData;
+
+            /**
+             * The response content type.
+             */
+            QString currentContentType;
+
+            /**
+             * Flag indicating that the body has been decoded.
+             */
+            bool decoded;
+
+            /**
+             * The decoded body.
+             */
+            QJsonDocument decodedJson;
+    };
+}
+
+#endif
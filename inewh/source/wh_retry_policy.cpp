@@ -0,0 +1,231 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::RetryPolicy class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+
+#include "wh_retry_policy.h"
+
+namespace Wh {
+    /**
+     * Class holding the process-wide retry budget.
+     */
+    class RetryBudget {
+        public:
+            RetryBudget() {
+                ratio            = RetryPolicy::defaultBudgetRatio;
+                minimumPerSecond = RetryPolicy::defaultBudgetMinimumPerSecond;
+                tokens           = capacity();
+
+                refillTimer.start();
+            }
+
+            /**
+             * Method that returns the maximum number of retries the budget can hold.
+             *
+             * \return Returns the budget capacity.
+             */
+            double capacity() const {
+                return qMax(10.0 * minimumPerSecond, 100.0 * ratio);
+            }
+
+            /**
+             * Mutex used to serialize access to the budget.
+             */
+            QMutex mutex;
+
+            /**
+             * Timer used to refill the budget at the minimum rate.
+             */
+            QElapsedTimer refillTimer;
+
+            /**
+             * The number of retries earned by each request.
+             */
+            double ratio;
+
+            /**
+             * The number of retries per second that are always allowed.
+             */
+            unsigned minimumPerSecond;
+
+            /**
+             * The number of retries currently available.
+             */
+            double tokens;
+    };
+
+    /**
+     * Function that returns the process-wide retry budget.
+     *
+     * \return Returns a reference to the retry budget.
+     */
+    static RetryBudget& retryBudget() {
+        static RetryBudget budget;
+        return budget;
+    }
+
+    RetryPolicy::RetryPolicy(
+            unsigned maximumAttempts,
+            unsigned baseBackoff,
+            unsigned maximumBackoff,
+            bool     respectRetryAfter
+        ) {
+        currentMaximumAttempts   = maximumAttempts;
+        currentBaseBackoff       = baseBackoff;
+        currentMaximumBackoff    = maximumBackoff;
+        currentRespectRetryAfter = respectRetryAfter;
+        currentMaximumRetryAfter = defaultMaximumRetryAfter;
+    }
+
+
+    RetryPolicy::~RetryPolicy() {}
+
+
+    void RetryPolicy::setMaximumAttempts(unsigned newMaximumAttempts) {
+        currentMaximumAttempts = newMaximumAttempts;
+    }
+
+
+    unsigned RetryPolicy::maximumAttempts() const {
+        return currentMaximumAttempts;
+    }
+
+
+    void RetryPolicy::setBaseBackoff(unsigned newBaseBackoff) {
+        currentBaseBackoff = newBaseBackoff;
+    }
+
+
+    unsigned RetryPolicy::baseBackoff() const {
+        return currentBaseBackoff;
+    }
+
+
+    void RetryPolicy::setMaximumBackoff(unsigned newMaximumBackoff) {
+        currentMaximumBackoff = newMaximumBackoff;
+    }
+
+
+    unsigned RetryPolicy::maximumBackoff() const {
+        return currentMaximumBackoff;
+    }
+
+
+    void RetryPolicy::setRespectRetryAfter(bool nowRespectRetryAfter) {
+        currentRespectRetryAfter = nowRespectRetryAfter;
+    }
+
+
+    bool RetryPolicy::respectRetryAfter() const {
+        return currentRespectRetryAfter;
+    }
+
+
+    void RetryPolicy::setMaximumRetryAfter(unsigned newMaximumRetryAfter) {
+        currentMaximumRetryAfter = newMaximumRetryAfter;
+    }
+
+
+    unsigned RetryPolicy::maximumRetryAfter() const {
+        return currentMaximumRetryAfter;
+    }
+
+
+    long long RetryPolicy::retryDelay(unsigned attempts, long long retryAfter) const {
+        long long result;
+
+        if (attempts >= currentMaximumAttempts) {
+            result = -1;
+        } else {
+            unsigned  shift   = qMin(attempts > 0 ? attempts - 1 : 0U, 30U);
+            long long ceiling = qMin(
+                static_cast<long long>(currentBaseBackoff) << shift,
+                static_cast<long long>(currentMaximumBackoff)
+            );
+
+            // Full jitter:  pick uniformly between zero and the exponential ceiling.
+            result = static_cast<long long>(QRandomGenerator::global()->bounded(static_cast<double>(ceiling) + 1.0));
+            if (currentRespectRetryAfter && retryAfter > result) {
+                result = qMax(qMin(retryAfter, static_cast<long long>(currentMaximumRetryAfter)), result);
+            }
+        }
+
+        return result;
+    }
+
+
+    void RetryPolicy::setRetryBudget(double ratio, unsigned minimumPerSecond) {
+        RetryBudget&  budget = retryBudget();
+        QMutexLocker  locker(&budget.mutex);
+
+        budget.ratio            = ratio;
+        budget.minimumPerSecond = minimumPerSecond;
+        budget.tokens           = qMin(budget.tokens, budget.capacity());
+    }
+
+
+    double RetryPolicy::retryBudgetRatio() {
+        RetryBudget&  budget = retryBudget();
+        QMutexLocker  locker(&budget.mutex);
+
+        return budget.ratio;
+    }
+
+
+    unsigned RetryPolicy::retryBudgetMinimumPerSecond() {
+        RetryBudget&  budget = retryBudget();
+        QMutexLocker  locker(&budget.mutex);
+
+        return budget.minimumPerSecond;
+    }
+
+
+    void RetryPolicy::recordRequest() {
+        RetryBudget&  budget = retryBudget();
+        QMutexLocker  locker(&budget.mutex);
+
+        budget.tokens = qMin(budget.tokens + budget.ratio, budget.capacity());
+    }
+
+
+    bool RetryPolicy::acquireRetry() {
+        RetryBudget&  budget = retryBudget();
+        QMutexLocker  locker(&budget.mutex);
+
+        double elapsedSeconds = budget.refillTimer.restart() / 1000.0;
+        budget.tokens = qMin(budget.tokens + elapsedSeconds * budget.minimumPerSecond, budget.capacity());
+
+        bool result;
+        if (budget.tokens >= 1.0) {
+            budget.tokens -= 1.0;
+            result = true;
+        } else {
+            result = false;
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,248 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::SigningKeyCache class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QList>
+#include <QDateTime>
+#include <QString>
+#include <QCryptographicHash>
+
+#include "wh_signing_key_cache.h"
+
+namespace Wh {
+    SigningKeyCache::Signer::Signer(
+            SigningKeyCache&  cache,
+            const QByteArray& secret,
+            long long         minute
+        ):inner(
+            QCryptographicHash::Algorithm::Sha256
+        ) {
+        Entry* e = cache.entry(secret, minute);
+
+        innerPad = e->innerPad;
+        outerPad = e->outerPad;
+
+        // Detach from the cache entry so wiping our copies never touches the cached keys.
+        innerPad.detach();
+        outerPad.detach();
+
+        inner.addData(innerPad);
+    }
+
+
+    SigningKeyCache::Signer::~Signer() {
+        wipe(innerPad);
+        wipe(outerPad);
+    }
+
+
+    void SigningKeyCache::Signer::addData(const char* data, unsigned length) {
+        inner.addData(data, static_cast<int>(length));
+    }
+
+
+    void SigningKeyCache::Signer::addData(const QByteArray& data) {
+        inner.addData(data);
+    }
+
+
+    QByteArray SigningKeyCache::Signer::result() {
+        QByteArray innerDigest = inner.result();
+
+        QCryptographicHash outer(QCryptographicHash::Algorithm::Sha256);
+        outer.addData(outerPad);
+        outer.addData(innerDigest);
+
+        return outer.result();
+    }
+
+
+    void SigningKeyCache::Signer::reset() {
+        inner.reset();
+        inner.addData(innerPad);
+    }
+
+
+    SigningKeyCache::SigningKeyCache(unsigned maximumEntries) {
+        currentMaximumEntries = maximumEntries > 0 ? maximumEntries : 1;
+    }
+
+
+    SigningKeyCache::~SigningKeyCache() {
+        clear();
+    }
+
+
+    long long SigningKeyCache::currentMinute(long long timeDelta) {
+        long long msecs  = QDateTime::currentMSecsSinceEpoch() + timeDelta;
+        long long minute = msecs / 60000;
+
+        if (msecs < 0 && (msecs % 60000) != 0) {
+            --minute;
+        }
+
+        return minute;
+    }
+
+
+    QByteArray SigningKeyCache::deriveKey(const QByteArray& secret, long long minute) {
+        QByteArray dateTime = QDateTime::fromMSecsSinceEpoch(minute * 60000, Qt::UTC)
+                              .toString("yyyyMMddhhmm")
+                              .toUtf8();
+
+        QByteArray key = secret + dateTime;
+        while (static_cast<unsigned>(key.size()) < signatureLength) {
+            key += secret + dateTime;
+        }
+
+        unsigned keySize = static_cast<unsigned>(key.size());
+        if (keySize > (2 * signatureLength)) {
+            QByteArray truncated = key.left(2 * signatureLength);
+            wipe(key);
+
+            key = truncated;
+        }
+
+        return key;
+    }
+
+
+    void SigningKeyCache::wipe(QByteArray& data) {
+        if (!data.isEmpty()) {
+            volatile char* d = data.data();
+            unsigned       s = static_cast<unsigned>(data.size());
+
+            for (unsigned i=0 ; i<s ; ++i) {
+                d[i] = 0;
+            }
+        }
+    }
+
+
+    QByteArray SigningKeyCache::sign(const QByteArray& secret, long long minute, const QByteArray& payload) {
+        Signer signer(*this, secret, minute);
+        signer.addData(payload);
+
+        return signer.result();
+    }
+
+
+    void SigningKeyCache::clear() {
+        for (Entry* e : entries) {
+            release(e);
+        }
+
+        entries.clear();
+    }
+
+
+    unsigned SigningKeyCache::numberEntries() const {
+        return static_cast<unsigned>(entries.size());
+    }
+
+
+    bool SigningKeyCache::contains(const QByteArray& secret, long long minute) const {
+        bool found = false;
+
+        QList<Entry*>::const_iterator it  = entries.constBegin();
+        QList<Entry*>::const_iterator end = entries.constEnd();
+        while (!found && it != end) {
+            const Entry* e = *it;
+            found = (e->minute == minute && e->secret == secret);
+            ++it;
+        }
+
+        return found;
+    }
+
+
+    SigningKeyCache::Entry* SigningKeyCache::entry(const QByteArray& secret, long long minute) {
+        Entry* result = Q_NULLPTR;
+
+        unsigned numberEntries = static_cast<unsigned>(entries.size());
+        unsigned index         = 0;
+        while (result == Q_NULLPTR && index < numberEntries) {
+            Entry* e = entries.at(index);
+            if (e->minute == minute && e->secret == secret) {
+                result = e;
+            } else {
+                ++index;
+            }
+        }
+
+        if (result != Q_NULLPTR) {
+            if (index != 0) {
+                entries.move(index, 0);
+            }
+        } else {
+            // The minute rolled over, discard keys for this secret that can no longer be used.
+            QList<Entry*>::iterator it = entries.begin();
+            while (it != entries.end()) {
+                Entry* e = *it;
+                if (e->secret == secret && (e->minute < minute - 1 || e->minute > minute + 1)) {
+                    release(e);
+                    it = entries.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            while (static_cast<unsigned>(entries.size()) >= currentMaximumEntries) {
+                release(entries.takeLast());
+            }
+
+            QByteArray key = deriveKey(secret, minute);
+            if (static_cast<unsigned>(key.size()) > hmacBlockSize) {
+                QByteArray hashedKey = QCryptographicHash::hash(key, QCryptographicHash::Algorithm::Sha256);
+                wipe(key);
+
+                key = hashedKey;
+            }
+
+            result = new Entry;
+            result->secret = secret;
+            result->minute = minute;
+            result->innerPad.fill(0x36, hmacBlockSize);
+            result->outerPad.fill(0x5C, hmacBlockSize);
+
+            unsigned keySize = static_cast<unsigned>(key.size());
+            for (unsigned i=0 ; i<keySize ; ++i) {
+                result->innerPad[i] = static_cast<char>(result->innerPad.at(i) ^ key.at(i));
+                result->outerPad[i] = static_cast<char>(result->outerPad.at(i) ^ key.at(i));
+            }
+
+            wipe(key);
+            entries.prepend(result);
+        }
+
+        return result;
+    }
+
+
+    void SigningKeyCache::release(Entry* entry) {
+        wipe(entry->innerPad);
+        wipe(entry->outerPad);
+
+        delete entry;
+    }
+}
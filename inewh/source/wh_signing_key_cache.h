@@ -0,0 +1,253 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::SigningKeyCache class.
+***********************************************************************************************************************/
+
+#ifndef WH_SIGNING_KEY_CACHE_H
+#define WH_SIGNING_KEY_CACHE_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QList>
+#include <QCryptographicHash>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that caches the per-minute signing keys used to authenticate messages.  The webhook protocol derives a
+     * new HMAC key from the webhook secret every minute.  This class derives each key once, precomputes the HMAC
+     * inner and outer padded key blocks, and keeps them until the minute rolls over so that signing a message only
+     * costs hashing the message.
+     *
+     * Evicted keys are overwritten before their memory is released.
+     */
+    class SigningKeyCache {
+        public:
+            /**
+             * The length of the generated signatures, in bytes.
+             */
+            static constexpr unsigned signatureLength = 32;
+
+            /**
+             * The default maximum number of cached keys.
+             */
+            static constexpr unsigned defaultMaximumEntries = 4;
+
+            /**
+             * Class that signs a payload supplied in pieces.  The signer keeps its own copy of the padded key blocks
+             * so it remains valid if the key is later evicted from the cache.
+             */
+            class Signer {
+                public:
+                    /**
+                     * Constructor
+                     *
+                     * \param[in] cache  The cache holding the signing keys.
+                     *
+                     * \param[in] secret The webhook secret.
+                     *
+                     * \param[in] minute The number of whole minutes since the epoch, UTC, used to derive the key.
+                     */
+                    Signer(SigningKeyCache& cache, const QByteArray& secret, long long minute);
+
+                    ~Signer();
+
+                    /**
+                     * Method you can use to add data to the signature.
+                     *
+                     * \param[in] data   The data to be added.
+                     *
+                     * \param[in] length The length of the data, in bytes.
+                     */
+                    void addData(const char* data, unsigned length);
+
+                    /**
+                     * Method you can use to add data to the signature.
+                     *
+                     * \param[in] data The data to be added.
+                     */
+                    void addData(const QByteArray& data);
+
+                    /**
+                     * Method you can use to obtain the signature of the data added so far.
+                     *
+                     * \return Returns the raw HMAC-SHA256 signature.
+                     */
+                    QByteArray result();
+
+                    /**
+                     * Method you can use to discard the data added so far and start a new signature with the same key.
+                     */
+                    void reset();
+
+                private:
+                    /**
+                     * The derived key XORed with the HMAC inner pad.
+                     */
+                    QByteArray innerPad;
+
+                    /**
+                     * The derived key XORed with the HMAC outer pad.
+                     */
+                    QByteArray outerPad;
+
+                    /**
+                     * The running inner hash.
+                     */
+                    QCryptographicHash inner;
+            };
+
+            /**
+             * Constructor
+             *
+             * \param[in] maximumEntries The maximum number of keys to be cached.
+             */
+            SigningKeyCache(unsigned maximumEntries = defaultMaximumEntries);
+
+            ~SigningKeyCache();
+
+            /**
+             * Method you can use to determine the minute used to derive signing keys.
+             *
+             * \param[in] timeDelta The time delta, in milliseconds, to apply to the local clock.
+             *
+             * \return Returns the number of whole minutes since the epoch, UTC.
+             */
+            static long long currentMinute(long long timeDelta);
+
+            /**
+             * Method that derives the signing key for a given secret and minute.  This method performs the full
+             * derivation and does not use the cache.
+             *
+             * \param[in] secret The webhook secret.
+             *
+             * \param[in] minute The number of whole minutes since the epoch, UTC.
+             *
+             * \return Returns the derived key.  The caller is responsible for wiping the key when done with it.
+             */
+            static QByteArray deriveKey(const QByteArray& secret, long long minute);
+
+            /**
+             * Method that overwrites the contents of a byte array.
+             *
+             * \param[in,out] data The byte array to be wiped.
+             */
+            static void wipe(QByteArray& data);
+
+            /**
+             * Method you can use to sign a payload.
+             *
+             * \param[in] secret  The webhook secret.
+             *
+             * \param[in] minute  The number of whole minutes since the epoch, UTC, used to derive the key.
+             *
+             * \param[in] payload The payload to be signed.
+             *
+             * \return Returns the raw HMAC-SHA256 signature.
+             */
+            QByteArray sign(const QByteArray& secret, long long minute, const QByteArray& payload);
+
+            /**
+             * Method you can use to remove and wipe every cached key.
+             */
+            void clear();
+
+            /**
+             * Method you can use to determine the number of cached keys.
+             *
+             * \return Returns the number of cached keys.
+             */
+            unsigned numberEntries() const;
+
+            /**
+             * Method you can use to determine if the key for a secret and minute is cached.
+             *
+             * \param[in] secret The webhook secret.
+             *
+             * \param[in] minute The number of whole minutes since the epoch, UTC.
+             *
+             * \return Returns true if the key is cached.  Returns false if the key is not cached.
+             */
+            bool contains(const QByteArray& secret, long long minute) const;
+
+        private:
+            /**
+             * The HMAC block length, in bytes.
+             */
+            static constexpr unsigned hmacBlockSize = 64;
+
+            /**
+             * Class that holds a single cached key.
+             */
+            class Entry {
+                public:
+                    /**
+                     * The webhook secret used to derive this key.
+                     */
+                    QByteArray secret;
+
+                    /**
+                     * The minute used to derive this key.
+                     */
+                    long long minute;
+
+                    /**
+                     * The derived key XORed with the HMAC inner pad.
+                     */
+                    QByteArray innerPad;
+
+                    /**
+                     * The derived key XORed with the HMAC outer pad.
+                     */
+                    QByteArray outerPad;
+            };
+
+            /**
+             * Method that locates or creates the cache entry for a secret and minute.
+             *
+             * \param[in] secret The webhook secret.
+             *
+             * \param[in] minute The minute used to derive the key.
+             *
+             * \return Returns the cache entry.
+             */
+            Entry* entry(const QByteArray& secret, long long minute);
+
+            /**
+             * Method that wipes and deletes a cache entry.
+             *
+             * \param[in] entry The entry to be released.
+             */
+            static void release(Entry* entry);
+
+            /**
+             * The maximum number of cached entries.
+             */
+            unsigned currentMaximumEntries;
+
+            /**
+             * The cached entries, most recently used first.
+             */
+            QList<Entry*> entries;
+    };
+}
+
+#endif
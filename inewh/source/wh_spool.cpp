@@ -0,0 +1,430 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::Spool class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QtEndian>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+#include <QList>
+#include <QHash>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+#include <cstring>
+#include <cstdint>
+
+#if (defined(Q_OS_WIN))
+
+    #include <windows.h>
+    #include <io.h>
+
+#else
+
+    #include <sys/mman.h>
+    #include <unistd.h>
+
+#endif
+
+#include "wh_crc32.h"
+#include "wh_spool.h"
+
+namespace Wh {
+    static const char     segmentMagic[8]       = { 'W', 'H', 'S', 'P', 'O', 'O', 'L', '1' };
+    static const unsigned segmentHeaderLength   = 16;
+    static const quint32  recordMagic           = 0x52534857; // "WHSR"
+    static const unsigned recordHeaderLength    = 24;
+    static const unsigned recordChecksumOffset  = 12;
+    static const char     segmentSuffix[]       = ".whs";
+
+    /**
+     * Function that rounds a record length up to the record alignment.
+     *
+     * \param[in] length The record length, in bytes.
+     *
+     * \return Returns the aligned length.
+     */
+    static inline unsigned aligned(unsigned length) {
+        return (length + 7) & ~7U;
+    }
+
+    Spool::Spool(const QString& directory, unsigned segmentSize) {
+        currentDirectory   = directory;
+        currentSegmentSize = segmentSize > 4096 ? segmentSize : 4096;
+        currentSynchronous = false;
+        nextRecordId       = 1;
+    }
+
+
+    Spool::~Spool() {
+        for (Segment* segment : segments) {
+            releaseSegment(segment, false);
+        }
+    }
+
+
+    bool Spool::open(QList<Spool::Record>& pending) {
+        bool success = QDir().mkpath(currentDirectory);
+
+        if (success) {
+            QDir        directory(currentDirectory);
+            QStringList segmentFiles = directory.entryList(
+                QStringList() << (QString("*") + segmentSuffix),
+                QDir::Files,
+                QDir::Name
+            );
+
+            QHash<unsigned long long, Record> pendingById;
+            QList<unsigned long long>         order;
+            unsigned long long                lastIndex = 0;
+
+            for (const QString& segmentFile : segmentFiles) {
+                bool               ok;
+                unsigned long long index = segmentFile.left(segmentFile.size() - 4).toULongLong(&ok);
+
+                if (ok) {
+                    Segment* segment = mapSegment(index, false);
+                    if (segment != Q_NULLPTR) {
+                        segments.append(segment);
+                        scan(segment, pendingById, order);
+                    }
+
+                    lastIndex = qMax(lastIndex, index);
+                }
+            }
+
+            Segment* active = mapSegment(lastIndex + 1, true);
+            if (active != Q_NULLPTR) {
+                segments.append(active);
+
+                for (unsigned long long recordId : order) {
+                    if (pendingById.contains(recordId)) {
+                        pending.append(pendingById.value(recordId));
+                    }
+                }
+
+                compact();
+            } else {
+                success = false;
+            }
+        }
+
+        return success;
+    }
+
+
+    const QString& Spool::directory() const {
+        return currentDirectory;
+    }
+
+
+    unsigned long long Spool::append(const QUrl& url, const QByteArray& payload, unsigned priority) {
+        unsigned long long recordId   = nextRecordId;
+        QByteArray         encodedUrl = url.toEncoded();
+        QByteArray         header(static_cast<int>(sizeof(quint32)), Qt::Uninitialized);
+
+        qToLittleEndian<quint32>(static_cast<quint32>(encodedUrl.size()), header.data());
+        header.append(encodedUrl);
+
+        if (write(RecordType::MESSAGE, recordId, header, payload, static_cast<quint8>(qMin(priority, 255U)))) {
+            ++nextRecordId;
+
+            Segment* active = segments.last();
+            ++active->outstanding;
+            segmentsByRecord.insert(recordId, active);
+        } else {
+            recordId = 0;
+        }
+
+        return recordId;
+    }
+
+
+    void Spool::setSynchronous(bool nowSynchronous) {
+        currentSynchronous = nowSynchronous;
+    }
+
+
+    bool Spool::synchronous() const {
+        return currentSynchronous;
+    }
+
+
+    void Spool::acknowledge(unsigned long long recordId) {
+        Segment* segment = segmentsByRecord.take(recordId);
+        if (segment != Q_NULLPTR) {
+            // The message's segment still has an outstanding message while the acknowledgement is written so it can
+            // not be deleted if the write starts a new segment.
+            if (write(RecordType::ACKNOWLEDGEMENT, recordId, QByteArray(), QByteArray(), 0)) {
+                Segment* active = segments.last();
+                if (active != segment) {
+                    ++active->acknowledgedSegments[segment->index];
+                }
+            }
+
+            --segment->outstanding;
+            compact();
+        }
+    }
+
+
+    void Spool::scan(
+            Spool::Segment*                    segment,
+            QHash<unsigned long long, Record>& pending,
+            QList<unsigned long long>&         order
+        ) {
+        const uchar* data   = segment->data;
+        unsigned     offset = segmentHeaderLength;
+        bool         valid  = true;
+
+        while (valid && offset + recordHeaderLength <= segment->size) {
+            const uchar* record = data + offset;
+            quint32      magic  = qFromLittleEndian<quint32>(record);
+            quint32      length = qFromLittleEndian<quint32>(record + 4);
+
+            if (magic != recordMagic || length > segment->size - offset - recordHeaderLength) {
+                valid = false;
+            } else {
+                quint32 expectedCrc = qFromLittleEndian<quint32>(record + 8);
+                quint32 crc         = Crc32::update(
+                    0,
+                    record + recordChecksumOffset,
+                    recordHeaderLength - recordChecksumOffset + length
+                );
+
+                if (crc != expectedCrc) {
+                    // A torn write marks the end of the usable data in this segment.
+                    valid = false;
+                } else {
+                    RecordType         type     = static_cast<RecordType>(record[12]);
+                    unsigned long long recordId = qFromLittleEndian<quint64>(record + 16);
+                    const uchar*       body     = record + recordHeaderLength;
+
+                    if (type == RecordType::MESSAGE && length >= sizeof(quint32)) {
+                        quint32 urlLength = qFromLittleEndian<quint32>(body);
+                        if (urlLength <= length - sizeof(quint32)) {
+                            Record message;
+                            message.id       = recordId;
+                            message.priority = record[13];
+                            message.url      = QUrl::fromEncoded(
+                                QByteArray(reinterpret_cast<const char*>(body + 4), static_cast<int>(urlLength))
+                            );
+                            message.payload  = QByteArray(
+                                reinterpret_cast<const char*>(body + 4 + urlLength),
+                                static_cast<int>(length - 4 - urlLength)
+                            );
+
+                            pending.insert(recordId, message);
+                            order.append(recordId);
+
+                            segmentsByRecord.insert(recordId, segment);
+                            ++segment->outstanding;
+                        }
+                    } else if (type == RecordType::ACKNOWLEDGEMENT) {
+                        pending.remove(recordId);
+
+                        Segment* messageSegment = segmentsByRecord.take(recordId);
+                        if (messageSegment != Q_NULLPTR) {
+                            --messageSegment->outstanding;
+
+                            if (messageSegment != segment) {
+                                ++segment->acknowledgedSegments[messageSegment->index];
+                            }
+                        }
+                    }
+
+                    if (recordId >= nextRecordId) {
+                        nextRecordId = recordId + 1;
+                    }
+
+                    offset += aligned(recordHeaderLength + length);
+                }
+            }
+        }
+
+        segment->writeOffset = qMin(offset, segment->size);
+    }
+
+
+    bool Spool::write(
+            Spool::RecordType  type,
+            unsigned long long recordId,
+            const QByteArray&  header,
+            const QByteArray&  payload,
+            quint8             priority
+        ) {
+        unsigned headerLength  = static_cast<unsigned>(header.size());
+        unsigned payloadLength = static_cast<unsigned>(payload.size());
+        unsigned length        = headerLength + payloadLength;
+        unsigned total         = aligned(recordHeaderLength + length);
+
+        Segment* active = segments.isEmpty() ? Q_NULLPTR : segments.last();
+        if (active == Q_NULLPTR || active->writeOffset + total > active->size) {
+            unsigned long long index = active == Q_NULLPTR ? 1 : active->index + 1;
+
+            active = mapSegment(index, true, total);
+            if (active != Q_NULLPTR) {
+                segments.append(active);
+                compact();
+            }
+        }
+
+        bool success = (active != Q_NULLPTR);
+        if (success) {
+            uchar* record = active->data + active->writeOffset;
+
+            std::memcpy(record + recordHeaderLength, header.constData(), headerLength);
+            std::memcpy(record + recordHeaderLength + headerLength, payload.constData(), payloadLength);
+
+            record[12] = static_cast<uchar>(type);
+            record[13] = priority;
+            record[14] = 0;
+            record[15] = 0;
+            qToLittleEndian<quint64>(recordId, record + 16);
+
+            quint32 crc = Crc32::update(
+                0,
+                record + recordChecksumOffset,
+                recordHeaderLength - recordChecksumOffset + length
+            );
+            qToLittleEndian<quint32>(length, record + 4);
+            qToLittleEndian<quint32>(crc, record + 8);
+
+            // The magic number is written last so a partially written record is never mistaken for a valid one.
+            qToLittleEndian<quint32>(recordMagic, record);
+
+            flush(active, active->writeOffset, total);
+            active->writeOffset += total;
+        }
+
+        return success;
+    }
+
+
+    void Spool::flush(Spool::Segment* segment, unsigned offset, unsigned length) {
+        #if (defined(Q_OS_WIN))
+
+            FlushViewOfFile(segment->data + offset, length);
+            if (currentSynchronous) {
+                FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(segment->file->handle())));
+            }
+
+        #else
+
+            static const std::uintptr_t pageSize = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+
+            // msync requires a page aligned start address.
+            std::uintptr_t start = reinterpret_cast<std::uintptr_t>(segment->data + offset) & ~(pageSize - 1);
+            std::uintptr_t end   = reinterpret_cast<std::uintptr_t>(segment->data + offset + length);
+
+            msync(reinterpret_cast<void*>(start), end - start, currentSynchronous ? MS_SYNC : MS_ASYNC);
+
+        #endif
+    }
+
+
+    Spool::Segment* Spool::mapSegment(unsigned long long index, bool create, unsigned minimum) {
+        QString filename = QString("%1%2").arg(index, 16, 10, QChar('0')).arg(QString::fromLatin1(segmentSuffix));
+        QFile*  file     = new QFile(QDir(currentDirectory).filePath(filename));
+        uchar*  data     = Q_NULLPTR;
+        unsigned size    = 0;
+
+        if (!create) {
+            if (file->open(QFile::OpenModeFlag::ReadWrite)) {
+                size = static_cast<unsigned>(file->size());
+                if (size >= segmentHeaderLength) {
+                    data = file->map(0, size);
+                    if (data != Q_NULLPTR && std::memcmp(data, segmentMagic, sizeof(segmentMagic)) != 0) {
+                        file->unmap(data);
+                        data = Q_NULLPTR;
+                    }
+                }
+            }
+        } else {
+            size = qMax(currentSegmentSize, segmentHeaderLength + minimum);
+            if (file->open(QFile::OpenModeFlag::ReadWrite | QFile::OpenModeFlag::Truncate) && file->resize(size)) {
+                data = file->map(0, size);
+                if (data != Q_NULLPTR) {
+                    std::memcpy(data, segmentMagic, sizeof(segmentMagic));
+                    qToLittleEndian<quint64>(index, data + sizeof(segmentMagic));
+                }
+            }
+        }
+
+        Segment* segment;
+        if (data != Q_NULLPTR) {
+            segment = new Segment;
+            segment->index       = index;
+            segment->file        = file;
+            segment->data        = data;
+            segment->size        = size;
+            segment->writeOffset = segmentHeaderLength;
+            segment->outstanding = 0;
+
+            if (create) {
+                flush(segment, 0, segmentHeaderLength);
+            }
+        } else {
+            file->close();
+            delete file;
+
+            segment = Q_NULLPTR;
+        }
+
+        return segment;
+    }
+
+
+    void Spool::releaseSegment(Spool::Segment* segment, bool remove) {
+        segment->file->unmap(segment->data);
+        segment->file->close();
+
+        if (remove) {
+            segment->file->remove();
+        }
+
+        delete segment->file;
+        delete segment;
+    }
+
+
+    void Spool::compact() {
+        // Acknowledgements only refer to older segments so a single pass, oldest first, releases every segment that
+        // can be deleted.
+        int index = 0;
+        while (index < segments.size() - 1) {
+            Segment* segment = segments.at(index);
+            if (segment->outstanding == 0 && segment->acknowledgedSegments.isEmpty()) {
+                segments.removeAt(index);
+
+                for (Segment* newer : segments) {
+                    newer->acknowledgedSegments.remove(segment->index);
+                }
+
+                releaseSegment(segment, true);
+            } else {
+                ++index;
+            }
+        }
+    }
+}
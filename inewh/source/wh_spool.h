@@ -0,0 +1,312 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::Spool class.
+***********************************************************************************************************************/
+
+#ifndef WH_SPOOL_H
+#define WH_SPOOL_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+#include <QList>
+#include <QHash>
+
+#include "wh_common.h"
+
+class QFile;
+
+namespace Wh {
+    /**
+     * Class that provides a durable, append-only spool of undelivered messages.  The spool is a directory of
+     * memory-mapped segment files.  Each message is appended as a framed, checksummed record and a second, small
+     * record is appended when the message is acknowledged.  A segment is deleted once every message in it has been
+     * acknowledged and none of its acknowledgements still refer to a message in an older segment.
+     *
+     * Records are written directly into the mapped segment so appending a message costs a copy and a checksum of the
+     * payload.  Each record is flushed to storage as soon as it is written.  By default the flush is asynchronous so
+     * records survive the process exiting or crashing and are written out promptly.  A synchronous flush waits for the
+     * record to reach storage so that records also survive the system itself failing.
+     */
+    class Spool {
+        public:
+            /**
+             * The default segment size, in bytes.
+             */
+            static constexpr unsigned defaultSegmentSize = 4 * 1024 * 1024;
+
+            /**
+             * Class that holds a single spooled message.
+             */
+            class Record {
+                public:
+                    /**
+                     * The record identifier.
+                     */
+                    unsigned long long id;
+
+                    /**
+                     * The destination URL.
+                     */
+                    QUrl url;
+
+                    /**
+                     * The serialized payload.
+                     */
+                    QByteArray payload;
+
+                    /**
+                     * The priority supplied when the message was appended.
+                     */
+                    unsigned priority;
+            };
+
+            /**
+             * Constructor
+             *
+             * \param[in] directory   The directory holding the spool segments.  The directory is created if needed.
+             *
+             * \param[in] segmentSize The size of each segment, in bytes.
+             */
+            Spool(const QString& directory, unsigned segmentSize = defaultSegmentSize);
+
+            ~Spool();
+
+            /**
+             * Method that opens the spool.  Any messages that were never acknowledged are returned so that they can
+             * be resent.
+             *
+             * \param[out] pending A list to receive the unacknowledged messages, oldest first.
+             *
+             * \return Returns true on success.  Returns false if the spool could not be opened.
+             */
+            bool open(QList<Record>& pending);
+
+            /**
+             * Method you can use to obtain the spool directory.
+             *
+             * \return Returns the spool directory.
+             */
+            const QString& directory() const;
+
+            /**
+             * Method that appends a message to the spool.
+             *
+             * \param[in] url      The destination URL.
+             *
+             * \param[in] payload  The serialized payload.
+             *
+             * \param[in] priority The message priority, returned with the record when the spool is next opened.
+             *                     Values up to 255 are supported.
+             *
+             * \return Returns the record identifier.  A value of 0 is returned if the message could not be spooled.
+             */
+            unsigned long long append(const QUrl& url, const QByteArray& payload, unsigned priority = 0);
+
+            /**
+             * Method you can use to select how records are flushed to storage.
+             *
+             * \param[in] nowSynchronous If true, each write waits for the record to reach storage.  If false, records
+             *                           are flushed asynchronously.
+             */
+            void setSynchronous(bool nowSynchronous = true);
+
+            /**
+             * Method you can use to determine how records are flushed to storage.
+             *
+             * \return Returns true if each write waits for the record to reach storage.  Returns false if records are
+             *         flushed asynchronously.
+             */
+            bool synchronous() const;
+
+            /**
+             * Method that marks a message as delivered.  Acknowledged messages are not returned by \ref Spool::open.
+             *
+             * \param[in] recordId The record identifier returned by \ref Spool::append or \ref Spool::open.
+             */
+            void acknowledge(unsigned long long recordId);
+
+        private:
+            /**
+             * Enumeration of record types.
+             */
+            enum class RecordType : quint8 {
+                /**
+                 * Indicates a spooled message.
+                 */
+                MESSAGE = 1,
+
+                /**
+                 * Indicates an acknowledgement of an earlier message.
+                 */
+                ACKNOWLEDGEMENT = 2
+            };
+
+            /**
+             * Class that tracks a single segment file.
+             */
+            class Segment {
+                public:
+                    /**
+                     * The segment sequence number.
+                     */
+                    unsigned long long index;
+
+                    /**
+                     * The segment file.
+                     */
+                    QFile* file;
+
+                    /**
+                     * The mapped segment contents.
+                     */
+                    uchar* data;
+
+                    /**
+                     * The segment size, in bytes.
+                     */
+                    unsigned size;
+
+                    /**
+                     * The offset where the next record will be written.
+                     */
+                    unsigned writeOffset;
+
+                    /**
+                     * The number of messages in this segment that have not been acknowledged.
+                     */
+                    unsigned outstanding;
+
+                    /**
+                     * The number of acknowledgements in this segment that refer to messages in each older segment,
+                     * keyed by the older segment's sequence number.  The segment must be kept while any of those
+                     * segments exist.
+                     */
+                    QHash<unsigned long long, unsigned> acknowledgedSegments;
+            };
+
+            /**
+             * Method that scans a segment, collecting messages and acknowledgements.
+             *
+             * \param[in]     segment  The segment to scan.
+             *
+             * \param[in,out] pending  Messages not yet acknowledged, keyed by record identifier.
+             *
+             * \param[in,out] order    Record identifiers in the order they were written.
+             */
+            void scan(Segment* segment, QHash<unsigned long long, Record>& pending, QList<unsigned long long>& order);
+
+            /**
+             * Method that writes a record into the active segment, starting a new segment if needed.
+             *
+             * \param[in] type     The record type.
+             *
+             * \param[in] recordId The record identifier.
+             *
+             * \param[in] header   Body bytes placed ahead of the payload.
+             *
+             * \param[in] payload  Body bytes placed after the header.
+             *
+             * \param[in] priority The message priority stored in the record header.
+             *
+             * \return Returns true on success.  Returns false if the record could not be written.
+             */
+            bool write(
+                RecordType         type,
+                unsigned long long recordId,
+                const QByteArray&  header,
+                const QByteArray&  payload,
+                quint8             priority
+            );
+
+            /**
+             * Method that flushes part of a segment to storage.
+             *
+             * \param[in] segment The segment to flush.
+             *
+             * \param[in] offset  The offset of the first byte to flush.
+             *
+             * \param[in] length  The number of bytes to flush.
+             */
+            void flush(Segment* segment, unsigned offset, unsigned length);
+
+            /**
+             * Method that maps a segment file.
+             *
+             * \param[in] index   The segment sequence number.
+             *
+             * \param[in] create  If true, a new segment is created.  If false, an existing segment is mapped.
+             *
+             * \param[in] minimum The minimum space needed for records in a new segment, in bytes.
+             *
+             * \return Returns the segment.  A null pointer is returned on error.
+             */
+            Segment* mapSegment(unsigned long long index, bool create, unsigned minimum = 0);
+
+            /**
+             * Method that unmaps a segment and, optionally, deletes the segment file.
+             *
+             * \param[in] segment The segment to release.
+             *
+             * \param[in] remove  If true, the segment file will be deleted.
+             */
+            void releaseSegment(Segment* segment, bool remove);
+
+            /**
+             * Method that deletes fully acknowledged segments.  A segment holding acknowledgements of messages in an
+             * older segment is kept until the older segment is deleted so that acknowledgements are never lost before
+             * the messages they refer to.  The active segment is never deleted.
+             */
+            void compact();
+
+            /**
+             * The spool directory.
+             */
+            QString currentDirectory;
+
+            /**
+             * The size of new segments, in bytes.
+             */
+            unsigned currentSegmentSize;
+
+            /**
+             * Flag indicating if each write waits for the record to reach storage.
+             */
+            bool currentSynchronous;
+
+            /**
+             * The identifier of the next record.
+             */
+            unsigned long long nextRecordId;
+
+            /**
+             * The mapped segments, oldest first.  The last segment is the active segment.
+             */
+            QList<Segment*> segments;
+
+            /**
+             * The segment holding each unacknowledged message, keyed by record identifier.
+             */
+            QHash<unsigned long long, Segment*> segmentsByRecord;
+    };
+}
+
+#endif
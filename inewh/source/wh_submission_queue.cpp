@@ -0,0 +1,135 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::SubmissionQueue class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QUrl>
+#include <QByteArray>
+
+#include <atomic>
+#include <utility>
+
+#include "wh_submission_queue.h"
+
+namespace Wh {
+    SubmissionQueue::SubmissionQueue(unsigned capacity) {
+        unsigned long long slotCount = 2;
+        while (slotCount < capacity) {
+            slotCount <<= 1;
+        }
+
+        ring = new Slot[slotCount];
+        mask = slotCount - 1;
+
+        for (unsigned long long i=0 ; i<slotCount ; ++i) {
+            ring[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        enqueuePosition.store(0, std::memory_order_relaxed);
+        drainRequested.store(false, std::memory_order_relaxed);
+        dequeuePosition = 0;
+    }
+
+
+    SubmissionQueue::~SubmissionQueue() {
+        delete[] ring;
+    }
+
+
+    unsigned SubmissionQueue::capacity() const {
+        return static_cast<unsigned>(mask + 1);
+    }
+
+
+    bool SubmissionQueue::push(
+            unsigned long long messageId,
+            const QUrl&        destinationUrl,
+            const QByteArray&  payload,
+            unsigned           priority
+        ) {
+        Slot*              slot     = Q_NULLPTR;
+        bool               full     = false;
+        unsigned long long position = enqueuePosition.load(std::memory_order_relaxed);
+
+        while (slot == Q_NULLPTR && !full) {
+            Slot*              candidate  = ring + (position & mask);
+            unsigned long long sequence   = candidate->sequence.load(std::memory_order_acquire);
+            long long          difference = static_cast<long long>(sequence - position);
+
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot = candidate;
+                }
+            } else if (difference < 0) {
+                full = true;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        if (slot != Q_NULLPTR) {
+            slot->submission.id       = messageId;
+            slot->submission.url      = destinationUrl;
+            slot->submission.payload  = payload;
+            slot->submission.priority = priority;
+
+            slot->sequence.store(position + 1, std::memory_order_release);
+        }
+
+        return !full;
+    }
+
+
+    bool SubmissionQueue::pop(Submission& submission) {
+        bool  result = false;
+        Slot* slot   = ring + (dequeuePosition & mask);
+
+        if (slot->sequence.load(std::memory_order_acquire) == dequeuePosition + 1) {
+            submission.id       = slot->submission.id;
+            submission.url      = std::move(slot->submission.url);
+            submission.payload  = std::move(slot->submission.payload);
+            submission.priority = slot->submission.priority;
+
+            slot->submission.url     = QUrl();
+            slot->submission.payload = QByteArray();
+
+            slot->sequence.store(dequeuePosition + mask + 1, std::memory_order_release);
+            ++dequeuePosition;
+
+            result = true;
+        }
+
+        return result;
+    }
+
+
+    bool SubmissionQueue::requestDrain() {
+        // Pairs with the fence in beginDrain so that either the consumer sees this push or we see the cleared flag.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return !drainRequested.exchange(true, std::memory_order_acq_rel);
+    }
+
+
+    void SubmissionQueue::beginDrain() {
+        drainRequested.store(false, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
@@ -0,0 +1,196 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::SubmissionQueue class.
+***********************************************************************************************************************/
+
+#ifndef WH_SUBMISSION_QUEUE_H
+#define WH_SUBMISSION_QUEUE_H
+
+#include <QtGlobal>
+#include <QUrl>
+#include <QByteArray>
+
+#include <atomic>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that provides a bounded, lock-free, multiple-producer, single-consumer ring buffer of pending messages.
+     * Any thread can push a message.  Only the thread that owns the webhook may pop messages.
+     *
+     * Each slot carries a sequence number that tells producers and the consumer whether the slot is free or filled.
+     * Producers claim a slot with a single compare-and-swap and never wait on each other or on the consumer.  A push
+     * fails, rather than blocks, when the queue is full.
+     */
+    class SubmissionQueue {
+        public:
+            /**
+             * The default queue capacity, in messages.
+             */
+            static constexpr unsigned defaultCapacity = 4096;
+
+            /**
+             * Class that holds a single submitted message.
+             */
+            class Submission {
+                public:
+                    /**
+                     * The identifier assigned to the message.
+                     */
+                    unsigned long long id;
+
+                    /**
+                     * The destination URL.
+                     */
+                    QUrl url;
+
+                    /**
+                     * The serialized payload.
+                     */
+                    QByteArray payload;
+
+                    /**
+                     * The message priority, as an index into the webhook's priority queues.
+                     */
+                    unsigned priority;
+            };
+
+            /**
+             * Constructor
+             *
+             * \param[in] capacity The queue capacity, in messages.  The value is rounded up to a power of two.
+             */
+            explicit SubmissionQueue(unsigned capacity = defaultCapacity);
+
+            ~SubmissionQueue();
+
+            /**
+             * Method you can use to obtain the queue capacity.
+             *
+             * \return Returns the queue capacity, in messages.
+             */
+            unsigned capacity() const;
+
+            /**
+             * Method that adds a message to the queue.  This method can be called from any thread.
+             *
+             * \param[in] messageId      The identifier assigned to the message.
+             *
+             * \param[in] destinationUrl The URL where the message should be received.
+             *
+             * \param[in] payload        The serialized payload.
+             *
+             * \param[in] priority       The message priority, as an index into the webhook's priority queues.
+             *
+             * \return Returns true on success.  Returns false if the queue is full.
+             */
+            bool push(
+                unsigned long long messageId,
+                const QUrl&        destinationUrl,
+                const QByteArray&  payload,
+                unsigned           priority = 0
+            );
+
+            /**
+             * Method that removes the oldest message from the queue.  This method must only be called from the
+             * consuming thread.
+             *
+             * \param[out] submission The submission to receive the message.
+             *
+             * \return Returns true if a message was removed.  Returns false if the queue is empty.
+             */
+            bool pop(Submission& submission);
+
+            /**
+             * Method that marks the queue as needing to be drained.  This method can be called from any thread.
+             *
+             * \return Returns true if the caller is the first to request a drain since the consumer last called
+             *         \ref SubmissionQueue::beginDrain.  The caller is then responsible for waking the consumer.
+             */
+            bool requestDrain();
+
+            /**
+             * Method the consumer calls before it drains the queue.  Pushes that complete after this call will
+             * request a new drain.
+             */
+            void beginDrain();
+
+        private:
+            /**
+             * Class that holds a single slot in the ring buffer.
+             */
+            class Slot {
+                public:
+                    /**
+                     * The slot sequence number.  A value equal to the slot's position indicates the slot is free.  A
+                     * value one larger than the slot's position indicates the slot holds a message.
+                     */
+                    std::atomic<unsigned long long> sequence;
+
+                    /**
+                     * The message held in the slot.
+                     */
+                    Submission submission;
+            };
+
+            /**
+             * Size of a cache line, in bytes.  Used to keep the producer and consumer positions apart.
+             */
+            static constexpr unsigned cacheLineSize = 64;
+
+            /**
+             * The ring of slots.
+             */
+            Slot* ring;
+
+            /**
+             * Mask applied to a position to obtain a slot index.
+             */
+            unsigned long long mask;
+
+            /**
+             * Padding that keeps the producer position off the cache line holding the read-only fields.
+             */
+            char producerPadding[cacheLineSize];
+
+            /**
+             * The position of the next slot to be claimed by a producer.
+             */
+            std::atomic<unsigned long long> enqueuePosition;
+
+            /**
+             * Flag indicating that a drain has been requested and not yet started.
+             */
+            std::atomic<bool> drainRequested;
+
+            /**
+             * Padding that keeps the consumer position off the cache line used by producers.
+             */
+            char consumerPadding[cacheLineSize];
+
+            /**
+             * The position of the next slot to be read by the consumer.  Only the consumer accesses this value.
+             */
+            unsigned long long dequeuePosition;
+    };
+}
+
+#endif
@@ -0,0 +1,175 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::TimeSync class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDateTime>
+
+#include <atomic>
+#include <cmath>
+
+#include "wh_time_sync.h"
+
+namespace Wh {
+    constexpr long long TimeSync::defaultTolerance;
+    constexpr long long TimeSync::minimumRefreshInterval;
+    constexpr long long TimeSync::failureRefreshInterval;
+    constexpr long long TimeSync::minimumDriftSampleInterval;
+
+    TimeSync::TimeSync(QObject* parent):QObject(parent) {
+        currentTimeDelta.store(0);
+        currentGeneration.store(0);
+        refreshing.store(false);
+
+        lastUpdateTime   = 0;
+        lastFailureTime  = 0;
+        driftBaseTime    = 0;
+        driftBaseDelta   = 0;
+        currentDriftRate = 0;
+    }
+
+
+    TimeSync::~TimeSync() {}
+
+
+    TimeSync* TimeSync::instance() {
+        static TimeSync globalInstance;
+        return &globalInstance;
+    }
+
+
+    long long TimeSync::timeDelta() const {
+        return currentTimeDelta.load(std::memory_order_acquire);
+    }
+
+
+    unsigned long long TimeSync::generation() const {
+        return currentGeneration.load(std::memory_order_acquire);
+    }
+
+
+    void TimeSync::setTimeDelta(long long newTimeDelta) {
+        currentTimeDelta.store(newTimeDelta, std::memory_order_release);
+        currentGeneration.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+
+    bool TimeSync::acquire() {
+        bool expected = false;
+        return refreshing.compare_exchange_strong(expected, true, std::memory_order_acq_rel);
+    }
+
+
+    void TimeSync::publish(long long newTimeDelta, long long updateTime) {
+        if (updateTime < 0) {
+            updateTime = QDateTime::currentMSecsSinceEpoch();
+        }
+
+        {
+            QMutexLocker locker(&driftMutex);
+
+            long long elapsed = updateTime - driftBaseTime;
+            if (driftBaseTime == 0) {
+                driftBaseTime  = updateTime;
+                driftBaseDelta = newTimeDelta;
+            } else if (elapsed >= minimumDriftSampleInterval) {
+                double sample = static_cast<double>(newTimeDelta - driftBaseDelta) / static_cast<double>(elapsed);
+                currentDriftRate = currentDriftRate == 0 ? sample : 0.5 * (currentDriftRate + sample);
+
+                driftBaseTime  = updateTime;
+                driftBaseDelta = newTimeDelta;
+            }
+
+            lastUpdateTime = updateTime;
+        }
+
+        setTimeDelta(newTimeDelta);
+        refreshing.store(false, std::memory_order_release);
+
+        emit refreshSucceeded();
+    }
+
+
+    void TimeSync::fail(int networkError, long long failureTime) {
+        {
+            QMutexLocker locker(&driftMutex);
+            lastFailureTime = failureTime < 0 ? QDateTime::currentMSecsSinceEpoch() : failureTime;
+        }
+
+        refreshing.store(false, std::memory_order_release);
+        emit refreshFailed(networkError);
+    }
+
+
+    void TimeSync::abandon() {
+        refreshing.store(false, std::memory_order_release);
+        emit refreshAbandoned();
+    }
+
+
+    bool TimeSync::isRefreshing() const {
+        return refreshing.load(std::memory_order_acquire);
+    }
+
+
+    double TimeSync::driftRate() const {
+        QMutexLocker locker(&driftMutex);
+        return currentDriftRate;
+    }
+
+
+    long long TimeSync::refreshDelay(long long interval, long long tolerance, long long now) const {
+        long long result = 0;
+
+        if (now < 0) {
+            now = QDateTime::currentMSecsSinceEpoch();
+        }
+
+        QMutexLocker locker(&driftMutex);
+
+        if (lastUpdateTime != 0 || lastFailureTime != 0) {
+            long long dueTime;
+            if (lastFailureTime > lastUpdateTime) {
+                dueTime = lastFailureTime + qMin(interval, failureRefreshInterval);
+            } else {
+                long long period = interval;
+                double    rate   = std::fabs(currentDriftRate);
+
+                if (rate > 0) {
+                    // Refresh once three quarters of the tolerance has drifted away.
+                    double staleAfter = 0.75 * static_cast<double>(tolerance) / rate;
+                    if (staleAfter < static_cast<double>(period)) {
+                        period = qMax(static_cast<long long>(staleAfter), qMin(minimumRefreshInterval, interval));
+                    }
+                }
+
+                dueTime = lastUpdateTime + period;
+            }
+
+            result = qMax(dueTime - now, 0LL);
+        }
+
+        return result;
+    }
+}
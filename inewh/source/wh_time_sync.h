@@ -0,0 +1,253 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Wh::TimeSync class.
+***********************************************************************************************************************/
+
+#ifndef WH_TIME_SYNC_H
+#define WH_TIME_SYNC_H
+
+#include <QtGlobal>
+#include <QObject>
+#include <QMutex>
+
+#include <atomic>
+
+#include "wh_common.h"
+
+namespace Wh {
+    /**
+     * Class that coordinates time delta adjustments across every webhook in the process.  Only one timestamp request
+     * is in flight at a time.  The webhook that wins \ref TimeSync::acquire makes the request, and every other webhook
+     * that needs a new time delta waits for one of the signals below.
+     *
+     * The time delta and a generation count are published atomically so they can be read from any thread.  The
+     * generation count is incremented on every update.  A webhook compares it against the count in effect when a
+     * message was signed to decide if a rejected message can simply be resent.
+     *
+     * Signals are emitted from the thread that completed the request and are delivered to receivers through Qt's
+     * automatic connection type.
+     *
+     * The coordinator also tracks how quickly the measured time delta drifts between updates.  Webhooks that refresh
+     * the time delta in the background use \ref TimeSync::refreshDelay to refresh before the accumulated drift
+     * exceeds a tolerance.
+     */
+    class TimeSync:public QObject {
+        Q_OBJECT
+
+        public:
+            /**
+             * The default drift, in milliseconds, allowed to accumulate before the time delta is considered stale.
+             */
+            static constexpr long long defaultTolerance = 5000;
+
+            /**
+             * The shortest refresh interval, in milliseconds, that will be chosen based on the drift rate.
+             */
+            static constexpr long long minimumRefreshInterval = 10000;
+
+            /**
+             * The delay, in milliseconds, before a failed background refresh is tried again.  Shorter refresh
+             * intervals take precedence.
+             */
+            static constexpr long long failureRefreshInterval = 30000;
+
+            /**
+             * The shortest time, in milliseconds, between updates used to measure the drift rate.  Closer updates
+             * are dominated by network latency.
+             */
+            static constexpr long long minimumDriftSampleInterval = 60000;
+
+            /**
+             * Constructor
+             *
+             * \param[in] parent Pointer to the parent object.
+             */
+            explicit TimeSync(QObject* parent = Q_NULLPTR);
+
+            ~TimeSync() override;
+
+            /**
+             * Method you can use to obtain the process-wide coordinator.
+             *
+             * \return Returns the process-wide coordinator.
+             */
+            static TimeSync* instance();
+
+            /**
+             * Method you can use to obtain the current time delta.  This method can be called from any thread.
+             *
+             * \return Returns the current time delta, in milliseconds.
+             */
+            long long timeDelta() const;
+
+            /**
+             * Method you can use to obtain the number of times the time delta has been updated.  This method can be
+             * called from any thread.
+             *
+             * \return Returns the current generation count.
+             */
+            unsigned long long generation() const;
+
+            /**
+             * Method you can use to force the time delta.  No signals are emitted.
+             *
+             * \param[in] newTimeDelta The new time delta, in milliseconds.
+             */
+            void setTimeDelta(long long newTimeDelta);
+
+            /**
+             * Method a webhook calls when it needs a new time delta.
+             *
+             * \return Returns true if the caller should make the timestamp request.  Returns false if a request is
+             *         already in flight.  The caller should then wait for \ref TimeSync::refreshSucceeded,
+             *         \ref TimeSync::refreshFailed, or \ref TimeSync::refreshAbandoned.
+             */
+            bool acquire();
+
+            /**
+             * Method the requesting webhook calls to publish a new time delta.
+             *
+             * \param[in] newTimeDelta The new time delta, in milliseconds.
+             *
+             * \param[in] updateTime   The time of the update, in milliseconds since the epoch.  A negative value
+             *                         indicates the current time.  This parameter is intended for test purposes.
+             */
+            void publish(long long newTimeDelta, long long updateTime = -1);
+
+            /**
+             * Method the requesting webhook calls when the timestamp request has failed.
+             *
+             * \param[in] networkError The last reported network error.
+             *
+             * \param[in] failureTime  The time of the failure, in milliseconds since the epoch.  A negative value
+             *                         indicates the current time.  This parameter is intended for test purposes.
+             */
+            void fail(int networkError, long long failureTime = -1);
+
+            /**
+             * Method the requesting webhook calls when it is destroyed before its request completes.
+             */
+            void abandon();
+
+            /**
+             * Method you can use to determine if a timestamp request is in flight.
+             *
+             * \return Returns true if a request is in flight.
+             */
+            bool isRefreshing() const;
+
+            /**
+             * Method you can use to obtain the measured drift rate of the time delta.
+             *
+             * \return Returns the drift rate, in milliseconds of drift per millisecond of elapsed time.  A value of 0
+             *         is returned until two updates far enough apart have been published.
+             */
+            double driftRate() const;
+
+            /**
+             * Method you can use to determine how long a background refresh should wait.  The refresh is due after
+             * the refresh interval or, if sooner, shortly before the measured drift is expected to exceed the
+             * tolerance.  A refresh is due immediately if the time delta has never been published.
+             *
+             * \param[in] interval  The longest time, in milliseconds, between refreshes.
+             *
+             * \param[in] tolerance The drift, in milliseconds, allowed to accumulate.
+             *
+             * \param[in] now       The current time, in milliseconds since the epoch.  A negative value indicates the
+             *                      current time.  This parameter is intended for test purposes.
+             *
+             * \return Returns the time remaining until the next refresh, in milliseconds.
+             */
+            long long refreshDelay(
+                long long interval,
+                long long tolerance = defaultTolerance,
+                long long now = -1
+            ) const;
+
+        signals:
+            /**
+             * Signal that is emitted when a new time delta has been published.
+             */
+            void refreshSucceeded();
+
+            /**
+             * Signal that is emitted when a timestamp request has failed.
+             *
+             * \param[out] networkError The last reported network error.  This is the value of
+             *                          QNetworkReply::NetworkError cast to an integer.
+             */
+            void refreshFailed(int networkError);
+
+            /**
+             * Signal that is emitted when the requesting webhook was destroyed before its request completed.
+             * Waiting webhooks should call \ref TimeSync::acquire again.
+             */
+            void refreshAbandoned();
+
+        private:
+            /**
+             * The current time delta, in milliseconds.
+             */
+            std::atomic<long long> currentTimeDelta;
+
+            /**
+             * The current generation count.
+             */
+            std::atomic<unsigned long long> currentGeneration;
+
+            /**
+             * Flag indicating that a timestamp request is in flight.
+             */
+            std::atomic<bool> refreshing;
+
+            /**
+             * Mutex protecting the drift measurements.
+             */
+            mutable QMutex driftMutex;
+
+            /**
+             * The time of the last published update, in milliseconds since the epoch.  A value of 0 indicates that no
+             * update has been published.
+             */
+            long long lastUpdateTime;
+
+            /**
+             * The time of the last failed request, in milliseconds since the epoch.
+             */
+            long long lastFailureTime;
+
+            /**
+             * The time of the update used as the base of the next drift measurement.
+             */
+            long long driftBaseTime;
+
+            /**
+             * The time delta reported by the update used as the base of the next drift measurement.
+             */
+            long long driftBaseDelta;
+
+            /**
+             * The smoothed drift rate, in milliseconds per millisecond.
+             */
+            double currentDriftRate;
+    };
+}
+
+#endif
@@ -29,24 +29,306 @@
 #include <QByteArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QJsonParseError>
+#include <QJsonArray>
+#include <QJsonValue>
+#include <QMetaMethod>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
+#include <QSslConfiguration>
+#include <QIODevice>
+#include <QFile>
+#include <QRandomGenerator>
 
 #include <cstring>
+#include <climits>
+#include <typeinfo>
 
 #include <crypto_hmac.h>
 
+#include "wh_retry_policy.h"
+#include "wh_flow_control.h"
+#include "wh_circuit_breaker.h"
+#include "wh_envelope_writer.h"
+#include "wh_envelope_stream.h"
+#include "wh_signing_key_cache.h"
+#include "wh_spool.h"
+#include "wh_submission_queue.h"
+#include "wh_time_sync.h"
+#include "wh_compressor.h"
+#include "wh_response.h"
 #include "wh_web_hook.h"
 
 namespace Wh {
+    /**
+     * Class used to track a single outbound message.
+     */
+    class WebHook::Message {
+        public:
+            /**
+             * Constructor
+             *
+             * \param[in] messageId      The identifier assigned to the message.
+             *
+             * \param[in] destinationUrl The URL where the message should be received.
+             *
+             * \param[in] messagePayload The serialized payload to be sent.
+             */
+            Message(
+                    unsigned long long messageId,
+                    const QUrl&        destinationUrl,
+                    const QByteArray&  messagePayload
+                ):id(
+                    messageId
+                ),url(
+                    destinationUrl
+                ),payload(
+                    messagePayload
+                ),attempts(
+                    0
+                ),spoolId(
+                    0
+                ),timeDeltaGeneration(
+                    0
+                ),binaryEnvelope(
+                    false
+                ),renegotiating(
+                    false
+                ),device(
+                    Q_NULLPTR
+                ),deviceOffset(
+                    0
+                ),deviceSize(
+                    0
+                ),ownsDevice(
+                    false
+                ),metricsDestination(
+                    Q_NULLPTR
+                ),queueTime(
+                    0
+                ),sendTime(
+                    0
+                ),priority(
+                    Priority::NORMAL
+                ) {}
+
+            ~Message() {
+                if (ownsDevice) {
+                    delete device;
+                }
+            }
+
+            /**
+             * The message identifier.
+             */
+            unsigned long long id;
+
+            /**
+             * The destination URL.
+             */
+            QUrl url;
+
+            /**
+             * The payload to be sent.
+             */
+            QByteArray payload;
+
+            /**
+             * The number of attempts made to send this message.
+             */
+            unsigned attempts;
+
+            /**
+             * The spool record holding this message.  A value of 0 indicates the message is not spooled.
+             */
+            unsigned long long spoolId;
+
+            /**
+             * The time delta generation in effect when this message was last signed.
+             */
+            unsigned long long timeDeltaGeneration;
+
+            /**
+             * Flag indicating that this message was last sent using the binary envelope.
+             */
+            bool binaryEnvelope;
+
+            /**
+             * Flag indicating that the next send repeats the last attempt in a format the server accepts.  The send
+             * is counted as a new request rather than a retry.
+             */
+            bool renegotiating;
+
+            /**
+             * The identifiers of the payloads carried by this message when the message is a batch.  The list is
+             * empty for messages that are not batches.
+             */
+            QList<unsigned long long> memberIds;
+
+            /**
+             * The spool records holding the payloads carried by this message when the message is a batch.
+             */
+            QList<unsigned long long> memberSpoolIds;
+
+            /**
+             * The device holding the payload when the payload is streamed.  A null pointer indicates the payload is
+             * held in memory.
+             */
+            QIODevice* device;
+
+            /**
+             * The offset of the streamed payload within the device.
+             */
+            qint64 deviceOffset;
+
+            /**
+             * The size of the streamed payload, in bytes.
+             */
+            qint64 deviceSize;
+
+            /**
+             * Method that determines the number of payloads carried by this message.
+             *
+             * \return Returns the number of payloads.
+             */
+            unsigned numberPayloads() const {
+                return memberIds.isEmpty() ? 1 : static_cast<unsigned>(memberIds.size());
+            }
+
+            /**
+             * Flag indicating that the message owns the device.
+             */
+            bool ownsDevice;
+
+            /**
+             * The metrics object the message reports to.  The value is set when the message is first sent and
+             * again if the webhook's metrics object changes.
+             */
+            QSharedPointer<Metrics> metrics;
+
+            /**
+             * The destination metrics, located once in \ref Message::metrics so that updates do not need a lookup.
+             * A null pointer indicates the message has not been sent with metrics enabled.
+             */
+            Metrics::Destination* metricsDestination;
+
+            /**
+             * The time the message was queued, in microseconds, on the metrics clock.
+             */
+            long long queueTime;
+
+            /**
+             * The time the most recent request for this message was sent, in microseconds, on the metrics clock.
+             */
+            long long sendTime;
+
+            /**
+             * The message priority.
+             */
+            Priority priority;
+
+            /**
+             * The flow control object holding a slot for this message.  A null pointer indicates the message holds
+             * no flow control slot.
+             */
+            QSharedPointer<FlowControl> flowControl;
+
+            /**
+             * The destination origin the flow control slot was acquired for.
+             */
+            QString flowDestination;
+
+            /**
+             * The idempotency key sent with every attempt.  The key is assigned when the message is first sent.
+             */
+            QByteArray idempotencyKey;
+
+            /**
+             * The identifiers of duplicate messages folded into this message, keyed by the identifier of the payload
+             * they duplicate.
+             */
+            QMultiHash<unsigned long long, unsigned long long> duplicateIds;
+
+            /**
+             * The keys of this message's entries in the table of payloads waiting to be sent.
+             */
+            QList<uint> pendingPayloadKeys;
+
+            /**
+             * The envelope shared with other messages carrying the same payload.  A null pointer indicates the
+             * envelope is not shared.
+             */
+            QSharedPointer<SharedEnvelope> sharedEnvelope;
+    };
+
+    /**
+     * Class used to track a payload waiting to be sent.
+     */
+    class WebHook::PendingPayload {
+        public:
+            /**
+             * The message carrying the payload.
+             */
+            Message* message;
+
+            /**
+             * The identifier assigned to the payload.
+             */
+            unsigned long long payloadId;
+
+            /**
+             * The serialized payload.
+             */
+            QByteArray payload;
+    };
+
+    /**
+     * Class used to share a signed envelope between messages with the same payload.  One envelope is kept for each
+     * envelope format since destinations that only accept JSON can be mixed with destinations that accept CBOR.
+     */
+    class WebHook::SharedEnvelope {
+        public:
+            /**
+             * Constructor
+             */
+            SharedEnvelope() {
+                for (unsigned i=0 ; i<numberFormats ; ++i) {
+                    minute[i] = 0;
+                }
+            }
+
+            /**
+             * The number of envelope formats.
+             */
+            static constexpr unsigned numberFormats = 2;
+
+            /**
+             * The minute used to sign each envelope.  The envelope must be rebuilt when the signing key changes.
+             */
+            long long minute[numberFormats];
+
+            /**
+             * The request body for each envelope format.  An empty body indicates no envelope has been built.
+             */
+            QByteArray body[numberFormats];
+
+            /**
+             * The content encoding applied to each envelope.
+             */
+            QByteArray contentEncoding[numberFormats];
+    };
+
+    constexpr unsigned WebHook::SharedEnvelope::numberFormats;
+
+    constexpr unsigned WebHook::defaultCompressionThreshold;
+    constexpr unsigned WebHook::numberPriorities;
+    constexpr unsigned WebHook::throttleRecheckInterval;
+
+    QMutex     WebHook::globalTimestampMutex;
     QByteArray WebHook::globalTimestampSecret;
     QUrl       WebHook::globalTimestampUrl;
-    long long  WebHook::globalTimeDelta = 0;
-
-    const Crypto::Hmac::Algorithm hmacAlgorithm = Crypto::Hmac::Algorithm::Sha256;
-    const unsigned                hmacBlockLength = Crypto::Hmac::digestSize(hmacAlgorithm);
 
     WebHook::WebHook(QNetworkAccessManager* networkAccessManager, QObject* parent):QObject(parent) {
         currentNetworkAccessManager = networkAccessManager;
@@ -67,232 +349,1726 @@ namespace Wh {
     }
 
 
-    WebHook::~WebHook() {}
+    WebHook::~WebHook() {
+        if (timeDeltaLeader) {
+            disconnect(TimeSync::instance(), Q_NULLPTR, this, Q_NULLPTR);
+            TimeSync::instance()->abandon();
+        }
+
+        if (!currentMetrics.isNull()) {
+            currentMetrics->adjust(Metrics::Gauge::QUEUED, -static_cast<long long>(messagesQueued()));
+            currentMetrics->adjust(Metrics::Gauge::IN_FLIGHT, -static_cast<long long>(activeMessages.size()));
+        }
+
+        qDeleteAll(openBatches);
+        for (unsigned priority=0 ; priority<numberPriorities ; ++priority) {
+            qDeleteAll(queuedMessages[priority]);
+        }
+
+        for (const QQueue<Message*>& waiting : throttledMessages) {
+            qDeleteAll(waiting);
+        }
+
+        // Slots on a shared flow control object would otherwise be lost to the webhooks that remain.
+        for (Message* message : activeMessages) {
+            if (!message->flowControl.isNull()) {
+                message->flowControl->release(message->flowDestination);
+            }
+        }
+
+        qDeleteAll(activeMessages);
+        qDeleteAll(pendingPayloads);
+
+        delete signingKeys;
+        delete currentSpool;
+        delete submissions;
+    }
 
 
     void WebHook::setTimestampSecret(const QByteArray& newTimestampSecret) {
+        QMutexLocker locker(&globalTimestampMutex);
         globalTimestampSecret = newTimestampSecret;
     }
 
 
-    const QByteArray& WebHook::timestampSecret() {
+    QByteArray WebHook::timestampSecret() {
+        QMutexLocker locker(&globalTimestampMutex);
         return globalTimestampSecret;
     }
 
 
     void WebHook::setTimestampUrl(const QUrl& timestampWebhookUrl) {
+        QMutexLocker locker(&globalTimestampMutex);
         globalTimestampUrl = timestampWebhookUrl;
     }
 
 
-    const QUrl& WebHook::timestampUrl() {
+    QUrl WebHook::timestampUrl() {
+        QMutexLocker locker(&globalTimestampMutex);
         return globalTimestampUrl;
     }
 
 
     void WebHook::setTimeDelta(long long newTimeDelta) {
-        globalTimeDelta = newTimeDelta;
+        TimeSync::instance()->setTimeDelta(newTimeDelta);
     }
 
 
     long long WebHook::timeDelta() {
-        return globalTimeDelta;
+        return TimeSync::instance()->timeDelta();
+    }
+
+
+    void WebHook::setTimeDeltaRefreshInterval(unsigned intervalMsec) {
+        currentTimeDeltaRefreshInterval = intervalMsec;
+        if (intervalMsec > 0) {
+            refreshTimer->start(0);
+        } else {
+            refreshTimer->stop();
+        }
     }
 
 
-    void WebHook::send(const QUrl& destinationUrl, const QJsonDocument& jsonDocument) {
-        currentUrl       = destinationUrl;
-        currentPayload   = jsonDocument.toJson(QJsonDocument::JsonFormat::Compact);
-        remainingRetries = maximumNumberRetries;
+    unsigned WebHook::timeDeltaRefreshInterval() const {
+        return currentTimeDeltaRefreshInterval;
+    }
+
 
-        doSend();
+    void WebHook::setMaximumInFlight(unsigned newMaximumInFlight) {
+        currentMaximumInFlight = newMaximumInFlight > 0 ? newMaximumInFlight : 1;
+        dispatchMessages();
     }
 
 
-    void WebHook::send(const QUrl& destinationUrl, const QJsonObject& jsonObject) {
-        send(destinationUrl, QJsonDocument(jsonObject));
+    unsigned WebHook::maximumInFlight() const {
+        return currentMaximumInFlight;
     }
 
 
-    void WebHook::forceTimeDeltaAdjustment() {
-        remainingRetries = maximumNumberRetries;
-        currentUrl = QUrl();
+    unsigned WebHook::messagesInFlight() const {
+        return static_cast<unsigned>(activeMessages.size());
+    }
+
+
+    unsigned WebHook::messagesQueued() const {
+        unsigned result = 0;
+        for (unsigned priority=0 ; priority<numberPriorities ; ++priority) {
+            result += static_cast<unsigned>(queuedMessages[priority].size()) + throttledByPriority[priority];
+        }
 
-        doTimestampAdjustment();
+        return result;
     }
 
 
-    void WebHook::jsonResponseWasReceived(const QJsonDocument& jsonDocument) {
-        emit jsonResponseReceived(jsonDocument);
+    void WebHook::setMaximumInFlight(Priority priority, unsigned newMaximumInFlight) {
+        currentPriorityMaximumInFlight[static_cast<unsigned>(priority)] = newMaximumInFlight;
+        dispatchMessages();
     }
 
 
-    void WebHook::responseWasReceived(const QByteArray& rawData) {
-        emit responseReceived(rawData);
+    unsigned WebHook::maximumInFlight(Priority priority) const {
+        return currentPriorityMaximumInFlight[static_cast<unsigned>(priority)];
     }
 
 
-    void WebHook::failed(int networkError) {
-        emit failedToSend(networkError);
+    unsigned WebHook::messagesInFlight(Priority priority) const {
+        return inFlightByPriority[static_cast<unsigned>(priority)];
     }
 
 
-    void WebHook::timestampReplyReceived() {
-        QNetworkReply::NetworkError networkError = pendingReply->error();
+    unsigned WebHook::messagesQueued(Priority priority) const {
+        unsigned index = static_cast<unsigned>(priority);
+        return static_cast<unsigned>(queuedMessages[index].size()) + throttledByPriority[index];
+    }
 
-        if (networkError == QNetworkReply::NetworkError::NoError) {
-            QByteArray receivedData = pendingReply->readAll();
-            QString    payload = QString::fromUtf8(receivedData);
 
-            pendingReply->deleteLater();
-            pendingReply = Q_NULLPTR;
+    void WebHook::setScheduling(Scheduling newScheduling) {
+        currentScheduling = newScheduling;
+        for (unsigned priority=0 ; priority<numberPriorities ; ++priority) {
+            schedulingCredits[priority] = 0;
+        }
+    }
 
-            bool       ok;
-            long long  correction = payload.toLongLong(&ok);
 
-            if (ok) {
-                globalTimeDelta = correction;
-                emit timeDeltaUpdated();
+    WebHook::Scheduling WebHook::scheduling() const {
+        return currentScheduling;
+    }
 
-                if (!currentUrl.isEmpty()) {
-                    resendTimer->start(1);
-                }
-            } else {
-                failed(static_cast<int>(QNetworkReply::NetworkError::ProtocolFailure));
-            }
+
+    void WebHook::setPriorityWeight(Priority priority, unsigned newWeight) {
+        currentPriorityWeights[static_cast<unsigned>(priority)] = newWeight > 0 ? newWeight : 1;
+    }
+
+
+    unsigned WebHook::priorityWeight(Priority priority) const {
+        return currentPriorityWeights[static_cast<unsigned>(priority)];
+    }
+
+
+    void WebHook::setBatchingEnabled(bool nowEnabled) {
+        currentBatchingEnabled = nowEnabled;
+        if (!nowEnabled) {
+            flush();
+        }
+    }
+
+
+    bool WebHook::batchingEnabled() const {
+        return currentBatchingEnabled;
+    }
+
+
+    void WebHook::setBatchThresholds(unsigned maximumCount, unsigned maximumBytes, unsigned maximumDelayMsec) {
+        currentBatchMaximumCount = maximumCount > 0 ? maximumCount : 1;
+        currentBatchMaximumBytes = maximumBytes;
+        currentBatchMaximumDelay = maximumDelayMsec;
+    }
+
+
+    unsigned WebHook::batchMaximumCount() const {
+        return currentBatchMaximumCount;
+    }
+
+
+    unsigned WebHook::batchMaximumBytes() const {
+        return currentBatchMaximumBytes;
+    }
+
+
+    unsigned WebHook::batchMaximumDelay() const {
+        return currentBatchMaximumDelay;
+    }
+
+
+    void WebHook::setCompression(Compression newCompression, unsigned minimumSize, int level) {
+        currentCompression          = newCompression;
+        currentCompressionThreshold = minimumSize;
+        currentCompressionLevel     = qBound(-1, level, 9);
+    }
+
+
+    WebHook::Compression WebHook::compression() const {
+        return currentCompression;
+    }
+
+
+    unsigned WebHook::compressionThreshold() const {
+        return currentCompressionThreshold;
+    }
+
+
+    int WebHook::compressionLevel() const {
+        return currentCompressionLevel;
+    }
+
+
+    void WebHook::setEnvelopeFormat(EnvelopeFormat newEnvelopeFormat) {
+        currentEnvelopeFormat = newEnvelopeFormat;
+    }
+
+
+    WebHook::EnvelopeFormat WebHook::envelopeFormat() const {
+        return currentEnvelopeFormat;
+    }
+
+
+    void WebHook::setResponseBodiesDiscarded(bool nowDiscarded) {
+        currentResponseBodiesDiscarded = nowDiscarded;
+    }
+
+
+    bool WebHook::responseBodiesDiscarded() const {
+        return currentResponseBodiesDiscarded;
+    }
+
+
+    void WebHook::setHttp2Enabled(bool nowEnabled) {
+        currentHttp2Enabled = nowEnabled;
+    }
+
+
+    bool WebHook::http2Enabled() const {
+        return currentHttp2Enabled;
+    }
+
+
+    void WebHook::setKeepAliveEnabled(bool nowEnabled) {
+        currentKeepAliveEnabled = nowEnabled;
+    }
+
+
+    bool WebHook::keepAliveEnabled() const {
+        return currentKeepAliveEnabled;
+    }
+
+
+    void WebHook::setIdempotencyKeyHeader(const QByteArray& headerName) {
+        currentIdempotencyKeyHeader = headerName;
+    }
+
+
+    QByteArray WebHook::idempotencyKeyHeader() const {
+        return currentIdempotencyKeyHeader;
+    }
+
+
+    void WebHook::setDeduplicationEnabled(bool nowEnabled) {
+        currentDeduplicationEnabled = nowEnabled;
+
+        if (!nowEnabled) {
+            qDeleteAll(pendingPayloads);
+            pendingPayloads.clear();
+        }
+    }
+
+
+    bool WebHook::deduplicationEnabled() const {
+        return currentDeduplicationEnabled;
+    }
+
+
+    void WebHook::setRetryPolicy(QSharedPointer<RetryPolicy> newRetryPolicy) {
+        if (newRetryPolicy.isNull()) {
+            currentRetryPolicy.reset(new RetryPolicy);
         } else {
-            pendingReply->deleteLater();
-            pendingReply = Q_NULLPTR;
+            currentRetryPolicy = newRetryPolicy;
+        }
+    }
 
-            if (remainingRetries > 0) {
-                --remainingRetries;
-                timeDeltaTimer->start(1);
-            } else {
-                failed(static_cast<int>(networkError));
-                currentUrl = QUrl();
+
+    QSharedPointer<RetryPolicy> WebHook::retryPolicy() const {
+        return currentRetryPolicy;
+    }
+
+
+    void WebHook::setMetrics(QSharedPointer<Metrics> newMetrics) {
+        // Move our share of the gauges so both objects stay balanced.
+        long long queued   = messagesQueued();
+        long long inFlight = activeMessages.size();
+
+        if (!currentMetrics.isNull()) {
+            currentMetrics->adjust(Metrics::Gauge::QUEUED, -queued);
+            currentMetrics->adjust(Metrics::Gauge::IN_FLIGHT, -inFlight);
+        }
+
+        currentMetrics = newMetrics;
+
+        if (!currentMetrics.isNull()) {
+            currentMetrics->adjust(Metrics::Gauge::QUEUED, queued);
+            currentMetrics->adjust(Metrics::Gauge::IN_FLIGHT, inFlight);
+        }
+    }
+
+
+    QSharedPointer<Metrics> WebHook::metrics() const {
+        return currentMetrics;
+    }
+
+
+    void WebHook::setFlowControl(QSharedPointer<FlowControl> newFlowControl) {
+        currentFlowControl = newFlowControl;
+
+        // Messages held back by the old object go back to the head of their queues.  Messages already holding a
+        // slot keep a reference to the object they acquired it from.
+        for (const QQueue<Message*>& waiting : throttledMessages) {
+            for (int i=waiting.size()-1 ; i>=0 ; --i) {
+                Message* message = waiting.at(i);
+                queuedMessages[static_cast<unsigned>(message->priority)].prepend(message);
             }
         }
+
+        throttledMessages.clear();
+        for (unsigned priority=0 ; priority<numberPriorities ; ++priority) {
+            throttledByPriority[priority] = 0;
+        }
+
+        throttleTimer->stop();
+        dispatchMessages();
     }
 
 
-    void WebHook::messageResponseReceived() {
-        QNetworkReply::NetworkError networkError = pendingReply->error();
+    QSharedPointer<FlowControl> WebHook::flowControl() const {
+        return currentFlowControl;
+    }
 
-        if (networkError == QNetworkReply::NetworkError::NoError) {
-            QByteArray receivedData = pendingReply->readAll();
 
-            pendingReply->deleteLater();
-            pendingReply = Q_NULLPTR;
+    void WebHook::setCircuitBreaker(QSharedPointer<CircuitBreaker> newCircuitBreaker) {
+        currentCircuitBreaker = newCircuitBreaker;
+    }
+
+
+    QSharedPointer<CircuitBreaker> WebHook::circuitBreaker() const {
+        return currentCircuitBreaker;
+    }
 
-            QJsonParseError parseError;
-            QJsonDocument   jsonDocument = QJsonDocument::fromJson(receivedData, &parseError);
-            if (parseError.error == QJsonParseError::NoError) {
-                jsonResponseWasReceived(jsonDocument);
+
+    bool WebHook::setSpoolDirectory(const QString& directory) {
+        bool success = true;
+
+        if (currentSpool != Q_NULLPTR) {
+            delete currentSpool;
+            currentSpool = Q_NULLPTR;
+
+            QList<Message*> messages = activeMessages.values() + openBatches.values();
+            for (unsigned priority=0 ; priority<numberPriorities ; ++priority) {
+                messages += queuedMessages[priority];
             }
 
-            responseWasReceived(receivedData);
-            currentUrl = QUrl();
-        } else {
-            pendingReply->deleteLater();
-            pendingReply = Q_NULLPTR;
-
-            if (remainingRetries > 0) {
-                --remainingRetries;
-                // Server returns a 403 if the hash didn't match.
-                if (networkError == QNetworkReply::NetworkError::ContentAccessDenied && remainingRetries > 0) {
-                    timeDeltaTimer->start(1);
-                } else {
-                    resendTimer->start(1);
+            for (const QQueue<Message*>& waiting : throttledMessages) {
+                messages += waiting;
+            }
+
+            for (Message* message : messages) {
+                message->spoolId = 0;
+                message->memberSpoolIds.clear();
+            }
+        }
+
+        if (!directory.isEmpty()) {
+            Spool*               spool = new Spool(directory);
+            QList<Spool::Record> pending;
+
+            spool->setSynchronous(currentSpoolSynchronous);
+            if (spool->open(pending)) {
+                currentSpool = spool;
+                for (const Spool::Record& record : pending) {
+                    Priority priority = (
+                          record.priority < numberPriorities
+                        ? static_cast<Priority>(record.priority)
+                        : Priority::NORMAL
+                    );
+
+                    enqueue(nextMessageId.fetch_add(1), record.url, record.payload, record.id, priority);
                 }
             } else {
-                failed(static_cast<int>(networkError));
-                currentUrl = QUrl();
+                delete spool;
+                success = false;
             }
         }
+
+        return success;
     }
 
 
-    void WebHook::doTimestampAdjustment() {
-        QNetworkRequest request(globalTimestampUrl);
-        request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader, "Inesonic, LLC");
-        request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, "application/json");
-        request.setTransferTimeout();
+    QString WebHook::spoolDirectory() const {
+        return currentSpool != Q_NULLPTR ? currentSpool->directory() : QString();
+    }
 
-        currentNetworkAccessManager->setRedirectPolicy(QNetworkRequest::RedirectPolicy::NoLessSafeRedirectPolicy);
-        currentNetworkAccessManager->setStrictTransportSecurityEnabled(false);
 
-        unsigned long long currentSystemTime = QDateTime::currentMSecsSinceEpoch();
-        QByteArray data = QString::number(currentSystemTime).toUtf8();
+    void WebHook::setSpoolSynchronous(bool nowSynchronous) {
+        currentSpoolSynchronous = nowSynchronous;
+
+        if (currentSpool != Q_NULLPTR) {
+            currentSpool->setSynchronous(nowSynchronous);
+        }
+    }
+
+
+    bool WebHook::spoolSynchronous() const {
+        return currentSpoolSynchronous;
+    }
 
-        Crypto::Hmac hmac(globalTimestampSecret);
-        hmac.addData(data);
-        QByteArray hash = hmac.digest();
 
-        QJsonObject json;
-        json.insert(QString("data"), QString::fromLatin1(data.toBase64()));
-        json.insert(QString("hash"), QString::fromLatin1(hash.toBase64()));
-        QByteArray jsonPayload = QJsonDocument(json).toJson(QJsonDocument::JsonFormat::Compact);
+    unsigned long long WebHook::post(
+            const QUrl&          destinationUrl,
+            const QJsonDocument& jsonDocument,
+            Priority             priority
+        ) {
+        QByteArray         payload   = jsonDocument.toJson(QJsonDocument::JsonFormat::Compact);
+        unsigned long long messageId = nextMessageId.fetch_add(1);
 
-        pendingReply = currentNetworkAccessManager->post(request, jsonPayload);
-        pendingReply->setParent(this);
+        if (submissions->push(messageId, destinationUrl, payload, static_cast<unsigned>(priority))) {
+            if (submissions->requestDrain()) {
+                QMetaObject::invokeMethod(this, [this]() { drainSubmissions(); }, Qt::QueuedConnection);
+            }
+        } else {
+            messageId = 0;
+        }
 
-        connect(pendingReply, &QNetworkReply::finished, this, &WebHook::timestampReplyReceived);
+        return messageId;
     }
 
 
-    void WebHook::doSend() {
-        QNetworkRequest request(currentUrl);
-        request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader, "Inesonic, LLC");
-        request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, "application/json");
-        request.setTransferTimeout();
+    unsigned long long WebHook::post(
+            const QUrl&        destinationUrl,
+            const QJsonObject& jsonObject,
+            Priority           priority
+        ) {
+        return post(destinationUrl, QJsonDocument(jsonObject), priority);
+    }
 
-        currentNetworkAccessManager->setRedirectPolicy(QNetworkRequest::RedirectPolicy::NoLessSafeRedirectPolicy);
-        currentNetworkAccessManager->setStrictTransportSecurityEnabled(false);
 
-        QString    dateTime = QDateTime::currentDateTimeUtc().addMSecs(globalTimeDelta).toString("yyyyMMddhhmm");
-        QByteArray secret   = currentSecret + dateTime.toUtf8();
+    unsigned WebHook::submissionQueueCapacity() const {
+        return submissions->capacity();
+    }
+
 
-        while (static_cast<unsigned>(secret.size()) < hmacBlockLength) {
-            secret += currentSecret + dateTime.toUtf8();
-        }
+    unsigned long long WebHook::send(
+            const QUrl&          destinationUrl,
+            const QJsonDocument& jsonDocument,
+            Priority             priority
+        ) {
+        QByteArray         payload   = jsonDocument.toJson(QJsonDocument::JsonFormat::Compact);
+        unsigned long long messageId = nextMessageId.fetch_add(1);
+
+        submit(messageId, destinationUrl, payload, priority);
+        return messageId;
+    }
+
+
+    unsigned long long WebHook::send(
+            const QUrl&        destinationUrl,
+            const QJsonObject& jsonObject,
+            Priority           priority
+        ) {
+        return send(destinationUrl, QJsonDocument(jsonObject), priority);
+    }
+
+
+    QList<unsigned long long> WebHook::send(
+            const QList<QUrl>&   destinationUrls,
+            const QJsonDocument& jsonDocument,
+            Priority             priority
+        ) {
+        QList<unsigned long long>      result;
+        QByteArray                     payload = jsonDocument.toJson(QJsonDocument::JsonFormat::Compact);
+        QSharedPointer<SharedEnvelope> envelope(new SharedEnvelope);
+
+        for (const QUrl& destinationUrl : destinationUrls) {
+            unsigned long long messageId = nextMessageId.fetch_add(1);
+            result.append(messageId);
+
+            if (!currentDeduplicationEnabled || !deduplicate(messageId, destinationUrl, payload, priority)) {
+                unsigned long long spoolId = 0;
+                if (currentSpool != Q_NULLPTR) {
+                    spoolId = currentSpool->append(destinationUrl, payload, static_cast<unsigned>(priority));
+                }
 
-        unsigned secretSize = static_cast<unsigned>(secret.size());
-        if (secretSize > (2 * hmacBlockLength)) {
-            for (unsigned i=(2 * hmacBlockLength) ; i<secretSize ; ++i) {
-                secret[i] = 0;
+                enqueue(messageId, destinationUrl, payload, spoolId, priority, envelope);
             }
+        }
+
+        return result;
+    }
+
+
+    QList<unsigned long long> WebHook::send(
+            const QList<QUrl>& destinationUrls,
+            const QJsonObject& jsonObject,
+            Priority           priority
+        ) {
+        return send(destinationUrls, QJsonDocument(jsonObject), priority);
+    }
 
-            secret = secret.left(2 * hmacBlockLength);
+
+    unsigned long long WebHook::send(const QUrl& destinationUrl, QIODevice* payload, Priority priority) {
+        return enqueueStream(destinationUrl, payload, false, priority);
+    }
+
+
+    unsigned long long WebHook::send(const QUrl& destinationUrl, const QString& filePath, Priority priority) {
+        unsigned long long result = 0;
+        QFile*             file   = new QFile(filePath);
+
+        if (file->open(QFile::OpenModeFlag::ReadOnly)) {
+            result = enqueueStream(destinationUrl, file, true, priority);
+        } else {
+            delete file;
         }
 
-        Crypto::Hmac hmac(secret);
-        hmac.addData(currentPayload);
-        QByteArray hash = hmac.digest();
+        return result;
+    }
 
-        for (unsigned i=0 ; i<(2 * hmacBlockLength) ; ++i) {
-            secret[i] = 0;
+
+    void WebHook::forceTimeDeltaAdjustment() {
+        requestTimeDelta();
+    }
+
+
+    void WebHook::flush() {
+        batchTimer->stop();
+
+        QList<Message*> batches = openBatches.values();
+        openBatches.clear();
+
+        for (Message* batch : batches) {
+            flushBatch(batch);
         }
+    }
 
-        QJsonObject json;
-        json.insert(QString("data"), QString::fromLatin1(currentPayload.toBase64()));
-        json.insert(QString("hash"), QString::fromLatin1(hash.toBase64()));
-        QByteArray jsonPayload = QJsonDocument(json).toJson(QJsonDocument::JsonFormat::Compact);
 
-        pendingReply = currentNetworkAccessManager->post(request, jsonPayload);
-        pendingReply->setParent(this);
+    void WebHook::warmUp(const QUrl& destinationUrl) {
+        preconnect(destinationUrl);
 
-        connect(pendingReply, &QNetworkReply::finished, this, &WebHook::messageResponseReceived);
+        QUrl timestampWebhookUrl = timestampUrl();
+        if (timestampWebhookUrl.isValid() && origin(timestampWebhookUrl) != origin(destinationUrl)) {
+            preconnect(timestampWebhookUrl);
+        }
     }
 
 
-    void WebHook::configure() {
-        resendTimer = new QTimer(this);
-        resendTimer->setSingleShot(true);
+    void WebHook::jsonResponseWasReceived(const QJsonDocument& jsonDocument) {
+        emit jsonResponseReceived(jsonDocument);
+    }
 
-        timeDeltaTimer = new QTimer(this);
-        timeDeltaTimer->setSingleShot(true);
 
-        connect(resendTimer, &QTimer::timeout, this, &WebHook::doSend);
-        connect(timeDeltaTimer, &QTimer::timeout, this, &WebHook::doTimestampAdjustment);
+    void WebHook::responseWasReceived(const QByteArray& rawData) {
+        emit responseReceived(rawData);
+    }
+
+
+    void WebHook::failed(int networkError) {
+        emit failedToSend(networkError);
+    }
+
+
+    void WebHook::timestampReplyReceived() {
+        QNetworkReply*              reply        = pendingTimestampReply;
+        QNetworkReply::NetworkError networkError = reply->error();
+
+        reply->deleteLater();
+        pendingTimestampReply = Q_NULLPTR;
+
+        if (networkError == QNetworkReply::NetworkError::NoError) {
+            QByteArray receivedData = reply->readAll();
+            QString    payload = QString::fromUtf8(receivedData);
+
+            bool       ok;
+            long long  correction = payload.toLongLong(&ok);
+
+            timeDeltaLeader = false;
+            if (ok) {
+                TimeSync::instance()->publish(correction);
+            } else {
+                TimeSync::instance()->fail(static_cast<int>(QNetworkReply::NetworkError::ProtocolFailure));
+            }
+        } else {
+            long long delay = currentRetryPolicy->retryDelay(timestampAttempts, retryAfter(reply));
+            if (delay >= 0 && RetryPolicy::acquireRetry()) {
+                timeDeltaTimer->start(static_cast<int>(qMin(delay, static_cast<long long>(INT_MAX))));
+            } else {
+                timeDeltaLeader = false;
+                TimeSync::instance()->fail(static_cast<int>(networkError));
+            }
+        }
+    }
+
+
+    void WebHook::messageResponseReceived() {
+        QNetworkReply* reply   = qobject_cast<QNetworkReply*>(sender());
+        Message*       message = messagesByReply.take(reply);
+
+        reply->deleteLater();
+
+        if (message != Q_NULLPTR) {
+            QNetworkReply::NetworkError networkError = reply->error();
+
+            if (!message->flowControl.isNull()) {
+                message->flowControl->record(
+                    message->flowDestination,
+                    flowOutcome(reply),
+                    message->sendTime,
+                    Metrics::now()
+                );
+            }
+
+            if (!currentCircuitBreaker.isNull() && message->sendTime != 0) {
+                currentCircuitBreaker->record(
+                    message->url.toString(QUrl::RemoveUserInfo),
+                    !destinationFailed(reply),
+                    message->sendTime,
+                    Metrics::now()
+                );
+            }
+
+            // Messages sent before metrics were enabled are not reported.
+            if (message->sendTime != 0                       &&
+                message->metricsDestination != Q_NULLPTR     &&
+                message->metrics == currentMetrics           ) {
+                long long             receiveTime = Metrics::now();
+                Metrics::Destination* destination = message->metricsDestination;
+
+                currentMetrics->record(
+                    Metrics::Latency::ROUND_TRIP,
+                    destination,
+                    static_cast<unsigned long long>(receiveTime - message->sendTime)
+                );
+
+                currentMetrics->increment(
+                    Metrics::Counter::BYTES_RECEIVED,
+                    destination,
+                    static_cast<unsigned long long>(reply->bytesAvailable())
+                );
+
+                if (networkError == QNetworkReply::NetworkError::NoError) {
+                    currentMetrics->increment(Metrics::Counter::DELIVERED, destination, message->numberPayloads());
+
+                    if (message->queueTime != 0) {
+                        currentMetrics->record(
+                            Metrics::Latency::DELIVERY,
+                            destination,
+                            static_cast<unsigned long long>(receiveTime - message->queueTime)
+                        );
+                    }
+                }
+            }
+
+            if (networkError == QNetworkReply::NetworkError::NoError) {
+                if (currentResponseBodiesDiscarded) {
+                    Response response;
+
+                    acknowledge(message);
+                    reportDelivered(message, response);
+                } else {
+                    Response response(
+                        reply->readAll(),
+                        reply->header(QNetworkRequest::KnownHeaders::ContentTypeHeader).toString()
+                    );
+
+                    if (jsonResponsesConsumed()) {
+                        const QJsonDocument& jsonDocument = response.json();
+                        if (!jsonDocument.isNull()) {
+                            jsonResponseWasReceived(jsonDocument);
+                        }
+                    }
+
+                    acknowledge(message);
+
+                    responseWasReceived(response.rawData());
+                    reportDelivered(message, response);
+                }
+
+                releaseMessage(message);
+            } else if (message->binaryEnvelope                                                      &&
+                       reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 415    ) {
+                // The server does not accept the binary envelope.  This is a negotiation, not a failure, so the
+                // resend is neither an attempt nor a retry.
+                jsonOnlyOrigins.insert(origin(message->url));
+                message->renegotiating = true;
+                scheduleResend(message, 0);
+            } else {
+                long long delay       = currentRetryPolicy->retryDelay(message->attempts, retryAfter(reply));
+                bool      circuitOpen = (
+                       !currentCircuitBreaker.isNull()
+                    && currentCircuitBreaker->state(message->url.toString(QUrl::RemoveUserInfo))
+                       == CircuitBreaker::State::OPEN
+                );
+
+                if (circuitOpen) {
+                    // No point holding a slot and a timer for a retry that would be refused.
+                    failMessage(message, static_cast<int>(networkError));
+                } else if (delay >= 0 && RetryPolicy::acquireRetry()) {
+                    // Server returns a 403 if the hash didn't match.  If another webhook has updated the time delta
+                    // since this message was signed, we simply resend the message with the new time delta.
+                    if (networkError == QNetworkReply::NetworkError::ContentAccessDenied) {
+                        if (message->timeDeltaGeneration != TimeSync::instance()->generation()) {
+                            scheduleResend(message, 0);
+                        } else {
+                            messagesAwaitingTimeDelta.append(message);
+                            requestTimeDelta();
+                        }
+                    } else {
+                        scheduleResend(message, delay);
+                    }
+                } else {
+                    failMessage(message, static_cast<int>(networkError));
+                }
+            }
+        }
+    }
+
+
+    void WebHook::doTimestampAdjustment() {
+        QUrl            timestampWebhookUrl = timestampUrl();
+        QNetworkRequest request(timestampWebhookUrl);
+        request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader, "Inesonic, LLC");
+        request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, "application/json");
+        request.setTransferTimeout();
+
+        applyConnectionSettings(request);
+
+        unsigned long long currentSystemTime = QDateTime::currentMSecsSinceEpoch();
+        QByteArray data = QString::number(currentSystemTime).toUtf8();
+
+        Crypto::Hmac hmac(timestampSecret());
+        hmac.addData(data);
+        QByteArray hash = hmac.digest();
+
+        QByteArray jsonPayload = EnvelopeWriter::write(data, hash);
+
+        pendingTimestampReply = currentNetworkAccessManager->post(request, jsonPayload);
+        pendingTimestampReply->setParent(this);
+
+        ++timestampAttempts;
+        RetryPolicy::recordRequest();
+
+        if (!currentMetrics.isNull()) {
+            currentMetrics->increment(Metrics::Counter::TIME_DELTA_REFRESHES, origin(timestampWebhookUrl).toString());
+        }
+
+        connect(pendingTimestampReply, &QNetworkReply::finished, this, &WebHook::timestampReplyReceived);
+    }
+
+
+    void WebHook::timeDeltaRefreshed() {
+        QList<Message*> waitingMessages = messagesAwaitingTimeDelta;
+        messagesAwaitingTimeDelta.clear();
+
+        if (awaitingTimeDelta) {
+            awaitingTimeDelta = false;
+            emit timeDeltaUpdated();
+        }
+
+        for (Message* message : waitingMessages) {
+            scheduleResend(message, 0);
+        }
+
+        scheduleTimeDeltaRefresh();
+    }
+
+
+    void WebHook::timeDeltaRefreshFailed(int networkError) {
+        scheduleTimeDeltaRefresh();
+
+        if (awaitingTimeDelta) {
+            QList<Message*> waitingMessages = messagesAwaitingTimeDelta;
+            messagesAwaitingTimeDelta.clear();
+            awaitingTimeDelta = false;
+
+            if (waitingMessages.isEmpty()) {
+                failed(networkError);
+            } else {
+                for (Message* message : waitingMessages) {
+                    failMessage(message, networkError);
+                }
+            }
+        }
+    }
+
+
+    void WebHook::timeDeltaRefreshAbandoned() {
+        if (awaitingTimeDelta) {
+            requestTimeDelta();
+        } else {
+            scheduleTimeDeltaRefresh();
+        }
+    }
+
+
+    void WebHook::refreshTimeDelta() {
+        if (currentTimeDeltaRefreshInterval > 0) {
+            TimeSync* timeSync  = TimeSync::instance();
+            long long remaining = timeSync->refreshDelay(currentTimeDeltaRefreshInterval);
+
+            if (remaining > 0) {
+                refreshTimer->start(static_cast<int>(qMin(remaining, static_cast<long long>(INT_MAX))));
+            } else if (timeSync->acquire()) {
+                timeDeltaLeader   = true;
+                timestampAttempts = 0;
+                doTimestampAdjustment();
+            }
+
+            // If another webhook's request is in flight, its result will reschedule this webhook.
+        }
+    }
+
+
+    void WebHook::configure() {
+        signingKeys                     = new SigningKeyCache;
+        currentSpool                    = Q_NULLPTR;
+        currentSpoolSynchronous         = false;
+        pendingTimestampReply           = Q_NULLPTR;
+        timestampAttempts               = 0;
+        currentTimeDeltaRefreshInterval = 0;
+        timeDeltaLeader                 = false;
+        awaitingTimeDelta               = false;
+        currentRetryPolicy.reset(new RetryPolicy);
+        currentMaximumInFlight          = defaultMaximumInFlight;
+        nextMessageId                   = 1;
+        submissions                     = new SubmissionQueue;
+        currentBatchingEnabled          = false;
+        currentBatchMaximumCount        = defaultBatchMaximumCount;
+        currentBatchMaximumBytes        = defaultBatchMaximumBytes;
+        currentBatchMaximumDelay        = defaultBatchMaximumDelay;
+        currentCompression              = Compression::NONE;
+        currentCompressionThreshold     = defaultCompressionThreshold;
+        currentCompressionLevel         = -1;
+        currentEnvelopeFormat           = EnvelopeFormat::JSON;
+        currentResponseBodiesDiscarded  = false;
+        currentHttp2Enabled             = false;
+        currentKeepAliveEnabled         = true;
+        currentIdempotencyKeyHeader     = QByteArray("Idempotency-Key");
+        currentDeduplicationEnabled     = false;
+        currentScheduling               = Scheduling::STRICT;
+
+        for (unsigned priority=0 ; priority<numberPriorities ; ++priority) {
+            inFlightByPriority[priority]             = 0;
+            throttledByPriority[priority]            = 0;
+            currentPriorityMaximumInFlight[priority] = 0;
+            schedulingCredits[priority]              = 0;
+        }
+
+        currentPriorityWeights[static_cast<unsigned>(Priority::HIGH)]   = 8;
+        currentPriorityWeights[static_cast<unsigned>(Priority::NORMAL)] = 4;
+        currentPriorityWeights[static_cast<unsigned>(Priority::BULK)]   = 1;
+
+        // These are manager-wide settings so we apply them once rather than on every request.
+        currentNetworkAccessManager->setRedirectPolicy(QNetworkRequest::RedirectPolicy::NoLessSafeRedirectPolicy);
+        currentNetworkAccessManager->setStrictTransportSecurityEnabled(false);
+
+        timeDeltaTimer = new QTimer(this);
+        timeDeltaTimer->setSingleShot(true);
+
+        batchTimer = new QTimer(this);
+        batchTimer->setSingleShot(true);
+
+        refreshTimer = new QTimer(this);
+        refreshTimer->setSingleShot(true);
+
+        throttleTimer = new QTimer(this);
+        throttleTimer->setSingleShot(true);
+
+        connect(timeDeltaTimer, &QTimer::timeout, this, &WebHook::doTimestampAdjustment);
+        connect(batchTimer, &QTimer::timeout, this, &WebHook::flush);
+        connect(refreshTimer, &QTimer::timeout, this, &WebHook::refreshTimeDelta);
+        connect(throttleTimer, &QTimer::timeout, this, &WebHook::dispatchMessages);
+
+        TimeSync* timeSync = TimeSync::instance();
+        connect(timeSync, &TimeSync::refreshSucceeded, this, &WebHook::timeDeltaRefreshed);
+        connect(timeSync, &TimeSync::refreshFailed, this, &WebHook::timeDeltaRefreshFailed);
+        connect(timeSync, &TimeSync::refreshAbandoned, this, &WebHook::timeDeltaRefreshAbandoned);
+    }
+
+
+    void WebHook::scheduleTimeDeltaRefresh() {
+        if (currentTimeDeltaRefreshInterval > 0) {
+            long long remaining = TimeSync::instance()->refreshDelay(currentTimeDeltaRefreshInterval);
+            refreshTimer->start(static_cast<int>(qMin(remaining, static_cast<long long>(INT_MAX))));
+        }
+    }
+
+
+    void WebHook::requestTimeDelta() {
+        awaitingTimeDelta = true;
+        if (TimeSync::instance()->acquire()) {
+            timeDeltaLeader   = true;
+            timestampAttempts = 0;
+            timeDeltaTimer->start(0);
+        }
+    }
+
+
+    void WebHook::drainSubmissions() {
+        submissions->beginDrain();
+
+        SubmissionQueue::Submission submission;
+        while (submissions->pop(submission)) {
+            submit(submission.id, submission.url, submission.payload, static_cast<Priority>(submission.priority));
+        }
+    }
+
+
+    void WebHook::submit(
+            unsigned long long messageId,
+            const QUrl&        destinationUrl,
+            const QByteArray&  payload,
+            Priority           priority
+        ) {
+        if (!currentDeduplicationEnabled || !deduplicate(messageId, destinationUrl, payload, priority)) {
+            unsigned long long spoolId = 0;
+            if (currentSpool != Q_NULLPTR) {
+                spoolId = currentSpool->append(destinationUrl, payload, static_cast<unsigned>(priority));
+            }
+
+            // High priority messages skip batching so they never wait on the batching delay.
+            if (currentBatchingEnabled && priority != Priority::HIGH) {
+                addToBatch(messageId, destinationUrl, payload, spoolId, priority);
+            } else {
+                enqueue(messageId, destinationUrl, payload, spoolId, priority);
+            }
+        }
+    }
+
+
+    void WebHook::enqueue(
+            unsigned long long                    messageId,
+            const QUrl&                           destinationUrl,
+            const QByteArray&                     payload,
+            unsigned long long                    spoolId,
+            Priority                              priority,
+            const QSharedPointer<SharedEnvelope>& envelope
+        ) {
+        Message* message = new Message(messageId, destinationUrl, payload);
+        message->spoolId        = spoolId;
+        message->priority       = priority;
+        message->sharedEnvelope = envelope;
+
+        if (currentDeduplicationEnabled) {
+            addPendingPayload(message, messageId, payload);
+        }
+
+        queueMessage(message);
+    }
+
+
+    void WebHook::addToBatch(
+            unsigned long long payloadId,
+            const QUrl&        destinationUrl,
+            const QByteArray&  payload,
+            unsigned long long spoolId,
+            Priority           priority
+        ) {
+        QPair<QUrl, unsigned> batchKey(destinationUrl, static_cast<unsigned>(priority));
+
+        Message* batch = openBatches.value(batchKey);
+        if (batch != Q_NULLPTR                                                                           &&
+            static_cast<unsigned>(batch->payload.size() + payload.size() + 2) > currentBatchMaximumBytes    ) {
+            openBatches.remove(batchKey);
+            flushBatch(batch);
+
+            batch = Q_NULLPTR;
+        }
+
+        if (batch == Q_NULLPTR) {
+            batch = new Message(nextMessageId.fetch_add(1), destinationUrl, QByteArray());
+            batch->priority = priority;
+
+            batch->payload.reserve(static_cast<int>(qMin(currentBatchMaximumBytes, 1U << 20)));
+            batch->payload.append('[');
+
+            openBatches.insert(batchKey, batch);
+        } else {
+            batch->payload.append(',');
+        }
+
+        batch->payload.append(payload);
+        batch->memberIds.append(payloadId);
+
+        if (currentDeduplicationEnabled) {
+            addPendingPayload(batch, payloadId, payload);
+        }
+
+        if (spoolId != 0) {
+            batch->memberSpoolIds.append(spoolId);
+        }
+
+        if (static_cast<unsigned>(batch->memberIds.size()) >= currentBatchMaximumCount      ||
+            static_cast<unsigned>(batch->payload.size() + 1) >= currentBatchMaximumBytes    ) {
+            openBatches.remove(batchKey);
+            flushBatch(batch);
+        } else if (!batchTimer->isActive()) {
+            batchTimer->start(static_cast<int>(currentBatchMaximumDelay));
+        }
+    }
+
+
+    void WebHook::flushBatch(Message* batch) {
+        batch->payload.append(']');
+        queueMessage(batch);
+
+        if (openBatches.isEmpty()) {
+            batchTimer->stop();
+        }
+    }
+
+
+    unsigned long long WebHook::enqueueStream(
+            const QUrl& destinationUrl,
+            QIODevice*  payload,
+            bool        ownsDevice,
+            Priority    priority
+        ) {
+        unsigned long long result = 0;
+
+        if (payload != Q_NULLPTR && payload->isReadable() && !payload->isSequential()) {
+            result = nextMessageId.fetch_add(1);
+
+            Message* message = new Message(result, destinationUrl, QByteArray());
+            message->device       = payload;
+            message->deviceOffset = payload->pos();
+            message->deviceSize   = payload->size() - message->deviceOffset;
+            message->ownsDevice   = ownsDevice;
+            message->priority     = priority;
+
+            queueMessage(message);
+        } else if (ownsDevice) {
+            delete payload;
+        }
+
+        return result;
+    }
+
+
+    void WebHook::queueMessage(Message* message) {
+        if (!currentMetrics.isNull()) {
+            message->queueTime = Metrics::now();
+            currentMetrics->adjust(Metrics::Gauge::QUEUED, 1);
+        }
+
+        queuedMessages[static_cast<unsigned>(message->priority)].enqueue(message);
+        dispatchMessages();
+    }
+
+
+    bool WebHook::deduplicate(
+            unsigned long long messageId,
+            const QUrl&        destinationUrl,
+            const QByteArray&  payload,
+            Priority           priority
+        ) {
+        bool found = false;
+        uint key   = qHash(payload, qHash(destinationUrl) ^ static_cast<uint>(priority));
+
+        QMultiHash<uint, PendingPayload*>::const_iterator it  = pendingPayloads.constFind(key);
+        QMultiHash<uint, PendingPayload*>::const_iterator end = pendingPayloads.constEnd();
+        while (!found && it != end && it.key() == key) {
+            const PendingPayload* pending = it.value();
+            const Message*        message = pending->message;
+
+            if (message->priority == priority && pending->payload == payload && message->url == destinationUrl) {
+                pending->message->duplicateIds.insert(pending->payloadId, messageId);
+                found = true;
+            } else {
+                ++it;
+            }
+        }
+
+        return found;
+    }
+
+
+    void WebHook::addPendingPayload(Message* message, unsigned long long payloadId, const QByteArray& payload) {
+        uint key = qHash(payload, qHash(message->url) ^ static_cast<uint>(message->priority));
+
+        PendingPayload* pending = new PendingPayload;
+        pending->message   = message;
+        pending->payloadId = payloadId;
+        pending->payload   = payload;
+
+        pendingPayloads.insert(key, pending);
+        message->pendingPayloadKeys.append(key);
+    }
+
+
+    void WebHook::removePendingPayloads(Message* message) {
+        for (uint key : message->pendingPayloadKeys) {
+            QMultiHash<uint, PendingPayload*>::iterator it = pendingPayloads.find(key);
+            while (it != pendingPayloads.end() && it.key() == key) {
+                if (it.value()->message == message) {
+                    delete it.value();
+                    it = pendingPayloads.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        message->pendingPayloadKeys.clear();
+    }
+
+
+    void WebHook::emitDelivered(Message* message, unsigned long long payloadId, const QByteArray& rawData) {
+        emit messageDelivered(payloadId, rawData);
+
+        if (!message->duplicateIds.isEmpty()) {
+            for (unsigned long long duplicateId : message->duplicateIds.values(payloadId)) {
+                emit messageDelivered(duplicateId, rawData);
+            }
+        }
+    }
+
+
+    void WebHook::emitFailed(Message* message, unsigned long long payloadId, int networkError) {
+        emit messageFailed(payloadId, networkError);
+
+        if (!message->duplicateIds.isEmpty()) {
+            for (unsigned long long duplicateId : message->duplicateIds.values(payloadId)) {
+                emit messageFailed(duplicateId, networkError);
+            }
+        }
+    }
+
+
+    QByteArray WebHook::newIdempotencyKey() {
+        quint32 words[4];
+        QRandomGenerator::global()->fillRange(words);
+
+        return QByteArray(reinterpret_cast<const char*>(words), sizeof(words)).toHex();
+    }
+
+
+    void WebHook::reportDelivered(Message* message, Response& response) {
+        if (message->memberIds.isEmpty()) {
+            emitDelivered(message, message->id, response.rawData());
+        } else if (isSignalConnected(QMetaMethod::fromSignal(&WebHook::messageDelivered))) {
+            const QJsonDocument& jsonDocument   = response.json();
+            QJsonArray           results        = jsonDocument.isArray() ? jsonDocument.array() : QJsonArray();
+            bool                 resultPerEntry = (results.size() == message->memberIds.size());
+
+            unsigned numberMembers = static_cast<unsigned>(message->memberIds.size());
+            for (unsigned i=0 ; i<numberMembers ; ++i) {
+                unsigned long long memberId = message->memberIds.at(i);
+
+                if (resultPerEntry) {
+                    QJsonValue result = results.at(i);
+                    if (result.isObject()) {
+                        emitDelivered(
+                            message,
+                            memberId,
+                            QJsonDocument(result.toObject()).toJson(QJsonDocument::JsonFormat::Compact)
+                        );
+                    } else if (result.isArray()) {
+                        emitDelivered(
+                            message,
+                            memberId,
+                            QJsonDocument(result.toArray()).toJson(QJsonDocument::JsonFormat::Compact)
+                        );
+                    } else {
+                        emitDelivered(message, memberId, response.rawData());
+                    }
+                } else {
+                    emitDelivered(message, memberId, response.rawData());
+                }
+            }
+        }
+    }
+
+
+    bool WebHook::jsonResponsesConsumed() const {
+        // Derived classes may override jsonResponseWasReceived so we always parse responses for them.
+        return (
+               typeid(*this) != typeid(WebHook)
+            || isSignalConnected(QMetaMethod::fromSignal(&WebHook::jsonResponseReceived))
+        );
+    }
+
+
+    bool WebHook::nextPriority(unsigned& priority) {
+        bool     eligible[numberPriorities];
+        unsigned numberEligible = 0;
+
+        for (unsigned i=0 ; i<numberPriorities ; ++i) {
+            unsigned limit = currentPriorityMaximumInFlight[i];
+            eligible[i] = !queuedMessages[i].isEmpty() && (limit == 0 || inFlightByPriority[i] < limit);
+            if (eligible[i]) {
+                ++numberEligible;
+            }
+        }
+
+        if (numberEligible > 0) {
+            if (currentScheduling == Scheduling::STRICT || numberEligible == 1) {
+                priority = 0;
+                while (!eligible[priority]) {
+                    ++priority;
+                }
+            } else {
+                // Smooth weighted round robin:  Interleaves the lanes rather than sending each lane's share in a
+                // burst.
+                long long totalWeight = 0;
+                bool      found       = false;
+
+                for (unsigned i=0 ; i<numberPriorities ; ++i) {
+                    if (eligible[i]) {
+                        schedulingCredits[i] += currentPriorityWeights[i];
+                        totalWeight          += currentPriorityWeights[i];
+
+                        if (!found || schedulingCredits[i] > schedulingCredits[priority]) {
+                            priority = i;
+                            found    = true;
+                        }
+                    }
+                }
+
+                schedulingCredits[priority] -= totalWeight;
+            }
+        }
+
+        return numberEligible > 0;
+    }
+
+
+    void WebHook::dispatchMessages() {
+        // Held back messages were taken from the queues first so they go first once their destination frees up.
+        // They already passed the circuit breaker and any that are sent to a failed destination will fail quickly.
+        if (!throttledMessages.isEmpty()) {
+            dispatchThrottledMessages();
+        }
+
+        // Rejections are reported once we are done with the queues as the receivers may send more messages.
+        QList<Message*> rejected;
+        unsigned        priority;
+        while (static_cast<unsigned>(activeMessages.size()) < currentMaximumInFlight && nextPriority(priority)) {
+            Message* message = queuedMessages[priority].dequeue();
+            if (!circuitAllows(message)) {
+                rejected.append(message);
+            } else if (currentFlowControl.isNull() || admit(message)) {
+                startMessage(message);
+            }
+        }
+
+        for (Message* message : rejected) {
+            rejectMessage(message);
+        }
+    }
+
+
+    void WebHook::dispatchThrottledMessages() {
+        QHash<QString, QQueue<Message*>>::iterator it = throttledMessages.begin();
+        while (it != throttledMessages.end()) {
+            QQueue<Message*>& waiting = it.value();
+            bool              blocked = false;
+
+            while (!blocked                                                                   &&
+                   !waiting.isEmpty()                                                         &&
+                   static_cast<unsigned>(activeMessages.size()) < currentMaximumInFlight    ) {
+                Message* message  = waiting.head();
+                unsigned priority = static_cast<unsigned>(message->priority);
+                unsigned limit    = currentPriorityMaximumInFlight[priority];
+
+                if (limit != 0 && inFlightByPriority[priority] >= limit) {
+                    blocked = true;
+                } else {
+                    long long wait = currentFlowControl->acquire(it.key(), Metrics::now());
+                    if (wait == 0) {
+                        waiting.dequeue();
+                        --throttledByPriority[priority];
+
+                        message->flowControl     = currentFlowControl;
+                        message->flowDestination = it.key();
+
+                        startMessage(message);
+                    } else {
+                        scheduleThrottleCheck(wait);
+                        blocked = true;
+                    }
+                }
+            }
+
+            if (waiting.isEmpty()) {
+                it = throttledMessages.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+
+    bool WebHook::circuitAllows(Message* message) {
+        return (
+               currentCircuitBreaker.isNull()
+            || currentCircuitBreaker->allow(message->url.toString(QUrl::RemoveUserInfo), Metrics::now())
+        );
+    }
+
+
+    bool WebHook::admit(Message* message) {
+        bool    result      = false;
+        QString destination = origin(message->url).toString();
+
+        // Messages queue behind any already held back for the same destination so send order is kept.
+        QHash<QString, QQueue<Message*>>::iterator it = throttledMessages.find(destination);
+        if (it == throttledMessages.end()) {
+            long long wait = currentFlowControl->acquire(destination, Metrics::now());
+            if (wait == 0) {
+                message->flowControl     = currentFlowControl;
+                message->flowDestination = destination;
+                result                   = true;
+            } else {
+                scheduleThrottleCheck(wait);
+                it = throttledMessages.insert(destination, QQueue<Message*>());
+            }
+        }
+
+        if (!result) {
+            it.value().enqueue(message);
+            ++throttledByPriority[static_cast<unsigned>(message->priority)];
+        }
+
+        return result;
+    }
+
+
+    void WebHook::scheduleThrottleCheck(long long wait) {
+        int delay;
+        if (wait < 0) {
+            delay = static_cast<int>(throttleRecheckInterval);
+        } else {
+            delay = static_cast<int>(qMin((wait + 999) / 1000, static_cast<long long>(INT_MAX)));
+        }
+
+        if (!throttleTimer->isActive() || throttleTimer->remainingTime() > delay) {
+            throttleTimer->start(delay);
+        }
+    }
+
+
+    void WebHook::startMessage(Message* message) {
+        if (!message->pendingPayloadKeys.isEmpty()) {
+            removePendingPayloads(message);
+        }
+
+        activeMessages.insert(message->id, message);
+        ++inFlightByPriority[static_cast<unsigned>(message->priority)];
+
+        if (!currentMetrics.isNull()) {
+            currentMetrics->adjust(Metrics::Gauge::QUEUED, -1);
+            currentMetrics->adjust(Metrics::Gauge::IN_FLIGHT, 1);
+        }
+
+        doSend(message);
+    }
+
+
+    void WebHook::doSend(Message* message) {
+        QNetworkRequest request(message->url);
+        request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader, "Inesonic, LLC");
+        request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, "application/json");
+        request.setTransferTimeout();
+
+        applyConnectionSettings(request);
+
+        if (!currentIdempotencyKeyHeader.isEmpty()) {
+            if (message->idempotencyKey.isEmpty()) {
+                message->idempotencyKey = newIdempotencyKey();
+            }
+
+            request.setRawHeader(currentIdempotencyKeyHeader, message->idempotencyKey);
+        }
+
+        TimeSync* timeSync = TimeSync::instance();
+        message->timeDeltaGeneration = timeSync->generation();
+
+        resolveMetrics(message);
+
+        long long minute = SigningKeyCache::currentMinute(timeSync->timeDelta());
+        qint64    bodySize;
+        if (message->device != Q_NULLPTR) {
+            bodySize = doSendStream(message, request, minute);
+        } else {
+            bodySize = doSendBuffered(message, request, minute);
+        }
+
+        if (!currentMetrics.isNull()) {
+            Metrics::Destination* destination = message->metricsDestination;
+            if (message->attempts == 0) {
+                currentMetrics->increment(Metrics::Counter::MESSAGES, destination, message->numberPayloads());
+            } else if (!message->renegotiating) {
+                currentMetrics->increment(Metrics::Counter::RETRIES, destination);
+            }
+
+            currentMetrics->increment(Metrics::Counter::REQUESTS, destination);
+            currentMetrics->increment(
+                Metrics::Counter::BYTES_SENT,
+                destination,
+                static_cast<unsigned long long>(bodySize)
+            );
+        }
+
+        if (!currentMetrics.isNull() || !message->flowControl.isNull() || !currentCircuitBreaker.isNull()) {
+            message->sendTime = Metrics::now();
+        }
+
+        if (message->attempts == 0 || message->renegotiating) {
+            RetryPolicy::recordRequest();
+        }
+
+        if (message->renegotiating) {
+            message->renegotiating = false;
+        } else {
+            ++message->attempts;
+        }
+    }
+
+
+    qint64 WebHook::doSendStream(Message* message, QNetworkRequest& request, long long minute) {
+        message->binaryEnvelope = false;
+
+        EnvelopeStream* stream = new EnvelopeStream(
+            message->device,
+            message->deviceOffset,
+            message->deviceSize,
+            *signingKeys,
+            currentSecret,
+            minute
+        );
+
+        request.setHeader(QNetworkRequest::KnownHeaders::ContentLengthHeader, stream->size());
+        request.setAttribute(QNetworkRequest::Attribute::DoNotBufferUploadDataAttribute, true);
+
+        QNetworkReply* reply = currentNetworkAccessManager->post(request, stream);
+        reply->setParent(this);
+        stream->setParent(reply);
+
+        messagesByReply.insert(reply, message);
+        connect(reply, &QNetworkReply::finished, this, &WebHook::messageResponseReceived);
+
+        return stream->size();
+    }
+
+
+    qint64 WebHook::doSendBuffered(Message* message, QNetworkRequest& request, long long minute) {
+        message->binaryEnvelope = (
+               currentEnvelopeFormat == EnvelopeFormat::CBOR
+            && !jsonOnlyOrigins.contains(origin(message->url))
+        );
+
+        if (message->binaryEnvelope) {
+            request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, "application/cbor");
+            request.setRawHeader("Accept", "application/cbor, application/json");
+        }
+
+        QByteArray      body;
+        QByteArray      contentEncoding;
+        SharedEnvelope* envelope = message->sharedEnvelope.data();
+        if (envelope != Q_NULLPTR) {
+            unsigned format = message->binaryEnvelope ? 1 : 0;
+            if (envelope->body[format].isEmpty() || envelope->minute[format] != minute) {
+                envelope->body[format]   = buildEnvelope(message, minute, envelope->contentEncoding[format]);
+                envelope->minute[format] = minute;
+            }
+
+            body            = envelope->body[format];
+            contentEncoding = envelope->contentEncoding[format];
+        } else {
+            body = buildEnvelope(message, minute, contentEncoding);
+        }
+
+        if (!contentEncoding.isEmpty()) {
+            request.setRawHeader("Content-Encoding", contentEncoding);
+        }
+
+        QNetworkReply* reply = currentNetworkAccessManager->post(request, body);
+        reply->setParent(this);
+
+        messagesByReply.insert(reply, message);
+        connect(reply, &QNetworkReply::finished, this, &WebHook::messageResponseReceived);
+
+        return body.size();
+    }
+
+
+    QByteArray WebHook::buildEnvelope(Message* message, long long minute, QByteArray& contentEncoding) {
+        long long  signStartTime = currentMetrics.isNull() ? 0 : Metrics::now();
+        QByteArray hash          = signingKeys->sign(currentSecret, minute, message->payload);
+
+        QByteArray result;
+        if (message->binaryEnvelope) {
+            result = EnvelopeWriter::writeCbor(message->payload, hash);
+        } else {
+            result = EnvelopeWriter::write(message->payload, hash);
+        }
+
+        contentEncoding.clear();
+        if (currentCompression != Compression::NONE                              &&
+            static_cast<unsigned>(result.size()) >= currentCompressionThreshold  ) {
+            Compressor::Format format = Compressor::Format::DEFLATE;
+            if (currentCompression == Compression::GZIP) {
+                format = Compressor::Format::GZIP;
+            }
+
+            QByteArray compressed = Compressor::compress(result, format, currentCompressionLevel);
+            if (!compressed.isEmpty() && compressed.size() < result.size()) {
+                contentEncoding = Compressor::contentEncoding(format);
+                result          = compressed;
+            }
+        }
+
+        if (!currentMetrics.isNull()) {
+            currentMetrics->record(
+                Metrics::Latency::SIGN,
+                message->metricsDestination,
+                static_cast<unsigned long long>(Metrics::now() - signStartTime)
+            );
+        }
+
+        return result;
+    }
+
+
+    void WebHook::scheduleResend(Message* message, long long delay) {
+        unsigned long long messageId = message->id;
+        QTimer::singleShot(
+            static_cast<int>(qMin(delay, static_cast<long long>(INT_MAX))),
+            this,
+            [this, messageId]() {
+                Message* message = activeMessages.value(messageId);
+                if (message != Q_NULLPTR) {
+                    if (circuitAllows(message)) {
+                        doSend(message);
+                    } else {
+                        failMessage(message, static_cast<int>(QNetworkReply::NetworkError::ServiceUnavailableError));
+                    }
+                }
+            }
+        );
+    }
+
+
+    void WebHook::applyConnectionSettings(QNetworkRequest& request) const {
+        request.setAttribute(QNetworkRequest::Attribute::Http2AllowedAttribute, currentHttp2Enabled);
+
+        if (!currentKeepAliveEnabled && !currentHttp2Enabled) {
+            request.setRawHeader("Connection", "close");
+        }
+    }
+
+
+    void WebHook::preconnect(const QUrl& url) {
+        QString host   = url.host();
+        QString scheme = url.scheme().toLower();
+
+        if (!host.isEmpty()) {
+            if (scheme == QString("https")) {
+                #if (!defined(QT_NO_SSL))
+                    QSslConfiguration sslConfiguration = QSslConfiguration::defaultConfiguration();
+                    if (currentHttp2Enabled) {
+                        // The connection is only reused for HTTP/2 requests if HTTP/2 was negotiated up front.
+                        sslConfiguration.setAllowedNextProtocols(
+                            QList<QByteArray>()
+                            << QSslConfiguration::ALPNProtocolHTTP2
+                            << QSslConfiguration::NextProtocolHttp1_1
+                        );
+                    }
+
+                    currentNetworkAccessManager->connectToHostEncrypted(
+                        host,
+                        static_cast<quint16>(url.port(443)),
+                        sslConfiguration
+                    );
+                #endif
+            } else if (scheme == QString("http")) {
+                currentNetworkAccessManager->connectToHost(host, static_cast<quint16>(url.port(80)));
+            }
+        }
+    }
+
+
+    QUrl WebHook::origin(const QUrl& url) {
+        return url.adjusted(QUrl::RemoveUserInfo | QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment);
+    }
+
+
+    FlowControl::Outcome WebHook::flowOutcome(QNetworkReply* reply) {
+        FlowControl::Outcome        result;
+        QNetworkReply::NetworkError networkError = reply->error();
+        int                         statusCode   = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+        if (networkError == QNetworkReply::NetworkError::NoError) {
+            result = FlowControl::Outcome::SUCCESS;
+        } else if (statusCode == 429 || statusCode == 503) {
+            result = FlowControl::Outcome::OVERLOADED;
+        } else if (networkError == QNetworkReply::NetworkError::TimeoutError            ||
+                   networkError == QNetworkReply::NetworkError::OperationCanceledError    ) {
+            // Transfer timeouts are reported as cancelled requests.
+            result = FlowControl::Outcome::TIMED_OUT;
+        } else {
+            result = FlowControl::Outcome::FAILED;
+        }
+
+        return result;
+    }
+
+
+    bool WebHook::destinationFailed(QNetworkReply* reply) {
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        return reply->error() != QNetworkReply::NetworkError::NoError && (statusCode == 0 || statusCode >= 500);
+    }
+
+
+    long long WebHook::retryAfter(QNetworkReply* reply) {
+        long long  result = -1;
+        QByteArray value  = reply->rawHeader("Retry-After").trimmed();
+
+        if (!value.isEmpty()) {
+            bool      ok;
+            long long seconds = value.toLongLong(&ok);
+
+            if (ok) {
+                result = seconds >= 0 ? 1000 * seconds : -1;
+            } else {
+                QDateTime retryTime = QDateTime::fromString(QString::fromLatin1(value), Qt::RFC2822Date);
+                if (retryTime.isValid()) {
+                    result = qMax(QDateTime::currentDateTimeUtc().msecsTo(retryTime), 0LL);
+                }
+            }
+        }
+
+        return result;
+    }
+
+
+    void WebHook::acknowledge(Message* message) {
+        if (currentSpool != Q_NULLPTR) {
+            if (message->spoolId != 0) {
+                currentSpool->acknowledge(message->spoolId);
+            }
+
+            for (unsigned long long memberSpoolId : message->memberSpoolIds) {
+                currentSpool->acknowledge(memberSpoolId);
+            }
+        }
+    }
+
+
+    void WebHook::resolveMetrics(Message* message) {
+        if (!currentMetrics.isNull() && message->metrics != currentMetrics) {
+            message->metrics            = currentMetrics;
+            message->metricsDestination = currentMetrics->destinationEntry(origin(message->url).toString());
+        }
+    }
+
+
+    void WebHook::releaseMessage(Message* message) {
+        if (!currentMetrics.isNull()) {
+            currentMetrics->adjust(Metrics::Gauge::IN_FLIGHT, -1);
+        }
+
+        if (!message->flowControl.isNull()) {
+            message->flowControl->release(message->flowDestination);
+        }
+
+        activeMessages.remove(message->id);
+        --inFlightByPriority[static_cast<unsigned>(message->priority)];
+        delete message;
+
+        dispatchMessages();
+    }
+
+
+    void WebHook::reportFailed(Message* message, int networkError) {
+        if (message->metricsDestination != Q_NULLPTR && message->metrics == currentMetrics) {
+            currentMetrics->increment(Metrics::Counter::FAILED, message->metricsDestination, message->numberPayloads());
+        }
+
+        failed(networkError);
+
+        if (message->memberIds.isEmpty()) {
+            emitFailed(message, message->id, networkError);
+        } else {
+            for (unsigned long long memberId : message->memberIds) {
+                emitFailed(message, memberId, networkError);
+            }
+        }
+    }
+
+
+    void WebHook::failMessage(Message* message, int networkError) {
+        reportFailed(message, networkError);
+        releaseMessage(message);
+    }
+
+
+    void WebHook::rejectMessage(Message* message) {
+        if (!message->pendingPayloadKeys.isEmpty()) {
+            removePendingPayloads(message);
+        }
+
+        if (!currentMetrics.isNull()) {
+            resolveMetrics(message);
+            currentMetrics->adjust(Metrics::Gauge::QUEUED, -1);
+        }
+
+        reportFailed(message, static_cast<int>(QNetworkReply::NetworkError::ServiceUnavailableError));
+        delete message;
     }
 }
@@ -0,0 +1,469 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref Wh::WebHookVerifier class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QMap>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QCborValue>
+#include <QCborMap>
+
+#include <atomic>
+
+#include <crypto_hmac.h>
+
+#include "wh_base64.h"
+#include "wh_envelope_writer.h"
+#include "wh_signing_key_cache.h"
+#include "wh_web_hook_verifier.h"
+
+namespace Wh {
+    /**
+     * Function that compares two signatures in time that does not depend on where they differ.
+     *
+     * \param[in] a The first signature.
+     *
+     * \param[in] b The second signature.
+     *
+     * \return Returns true if the signatures are identical.
+     */
+    static bool signaturesMatch(const QByteArray& a, const QByteArray& b) {
+        bool result = (a.size() == b.size());
+
+        if (result) {
+            unsigned char difference = 0;
+            unsigned      length     = static_cast<unsigned>(a.size());
+            const char*   ad         = a.constData();
+            const char*   bd         = b.constData();
+
+            for (unsigned i=0 ; i<length ; ++i) {
+                difference |= static_cast<unsigned char>(ad[i] ^ bd[i]);
+            }
+
+            result = (difference == 0);
+        }
+
+        return result;
+    }
+
+
+    /**
+     * Function that decodes a signed envelope.  The JSON envelope written by \ref Wh::EnvelopeWriter is decoded
+     * without building a JSON document.  Other JSON layouts, including envelopes with reordered or additional keys,
+     * are decoded through QJsonDocument.
+     *
+     * \param[in]  body        The request body.
+     *
+     * \param[in]  contentType The value of the request Content-Type header.
+     *
+     * \param[out] data        The decoded payload.
+     *
+     * \param[out] hash        The decoded signature.
+     *
+     * \return Returns true on success.  Returns false if the envelope is malformed.
+     */
+    static bool decodeEnvelope(const QByteArray& body, const QString& contentType, QByteArray& data, QByteArray& hash) {
+        static const QByteArray prefix    = EnvelopeWriter::prefix();
+        static const QByteArray separator = EnvelopeWriter::separator();
+        static const QByteArray suffix    = EnvelopeWriter::suffix();
+
+        bool result = false;
+
+        if (contentType.startsWith(QString("application/cbor"), Qt::CaseInsensitive)) {
+            QCborValue envelope = QCborValue::fromCbor(body);
+            if (envelope.isMap()) {
+                QCborMap   map       = envelope.toMap();
+                QCborValue dataValue = map.value(QString("data"));
+                QCborValue hashValue = map.value(QString("hash"));
+
+                if (dataValue.isByteArray() && hashValue.isByteArray()) {
+                    data   = dataValue.toByteArray();
+                    hash   = hashValue.toByteArray();
+                    result = true;
+                }
+            }
+        } else {
+            int separatorIndex = body.indexOf(separator, prefix.size());
+            if (body.startsWith(prefix) && body.endsWith(suffix) && separatorIndex >= 0) {
+                int hashIndex = separatorIndex + separator.size();
+
+                bool dataOk;
+                bool hashOk;
+                data = Base64::decode(body.mid(prefix.size(), separatorIndex - prefix.size()), &dataOk);
+                hash = Base64::decode(body.mid(hashIndex, body.size() - hashIndex - suffix.size()), &hashOk);
+
+                result = dataOk && hashOk;
+            }
+
+            if (!result) {
+                QJsonDocument envelope = QJsonDocument::fromJson(body);
+                if (envelope.isObject()) {
+                    QJsonObject object    = envelope.object();
+                    QJsonValue  dataValue = object.value(QString("data"));
+                    QJsonValue  hashValue = object.value(QString("hash"));
+
+                    if (dataValue.isString() && hashValue.isString()) {
+                        bool dataOk;
+                        bool hashOk;
+                        data = Base64::decode(dataValue.toString().toLatin1(), &dataOk);
+                        hash = Base64::decode(hashValue.toString().toLatin1(), &hashOk);
+
+                        result = dataOk && hashOk;
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+
+    class WebHookVerifier::Check {
+        public:
+            /**
+             * The verification status.
+             */
+            Status status;
+
+            /**
+             * The decoded payload.
+             */
+            QByteArray payload;
+
+            /**
+             * The decoded signature.
+             */
+            QByteArray hash;
+
+            /**
+             * The minute the envelope was signed in.
+             */
+            long long minute;
+    };
+
+    constexpr unsigned WebHookVerifier::minimumBatchPerThread;
+
+    WebHookVerifier::Envelope::Envelope() {}
+
+
+    WebHookVerifier::Envelope::Envelope(
+            const QByteArray& body,
+            const QString&    contentType
+        ):currentBody(
+            body
+        ),currentContentType(
+            contentType
+        ) {}
+
+
+    const QByteArray& WebHookVerifier::Envelope::body() const {
+        return currentBody;
+    }
+
+
+    const QString& WebHookVerifier::Envelope::contentType() const {
+        return currentContentType;
+    }
+
+
+    WebHookVerifier::Result::Result() {
+        currentStatus = Status::MALFORMED;
+    }
+
+
+    WebHookVerifier::Result::Result(Status status, const QByteArray& payload):currentPayload(payload) {
+        currentStatus = status;
+    }
+
+
+    WebHookVerifier::Status WebHookVerifier::Result::status() const {
+        return currentStatus;
+    }
+
+
+    bool WebHookVerifier::Result::isValid() const {
+        return currentStatus == Status::VALID;
+    }
+
+
+    const QByteArray& WebHookVerifier::Result::payload() const {
+        return currentPayload;
+    }
+
+
+    WebHookVerifier::WebHookVerifier(
+            const QByteArray& webhookSecret,
+            const QByteArray& timestampSecret
+        ):currentWebhookSecret(
+            webhookSecret
+        ),currentTimestampSecret(
+            timestampSecret
+        ) {
+        currentTimeDelta.store(0);
+        currentReplayProtectionEnabled.store(false);
+
+        // The current minute and both adjacent minutes are checked so three keys must fit in the cache.
+        signingKeys = new SigningKeyCache(3);
+        threadPool  = new QThreadPool;
+    }
+
+
+    WebHookVerifier::~WebHookVerifier() {
+        threadPool->waitForDone();
+
+        delete threadPool;
+        delete signingKeys;
+    }
+
+
+    void WebHookVerifier::setWebhookSecret(const QByteArray& newWebhookSecret) {
+        QMutexLocker locker(&signingKeyMutex);
+
+        signingKeys->clear();
+
+        currentWebhookSecret = newWebhookSecret;
+    }
+
+
+    void WebHookVerifier::setTimestampSecret(const QByteArray& newTimestampSecret) {
+        currentTimestampSecret = newTimestampSecret;
+    }
+
+
+    void WebHookVerifier::setTimeDelta(long long newTimeDelta) {
+        currentTimeDelta.store(newTimeDelta);
+    }
+
+
+    long long WebHookVerifier::timeDelta() const {
+        return currentTimeDelta.load();
+    }
+
+
+    void WebHookVerifier::setReplayProtectionEnabled(bool nowEnabled) {
+        currentReplayProtectionEnabled.store(nowEnabled);
+
+        if (!nowEnabled) {
+            QMutexLocker locker(&replayMutex);
+            acceptedSignatures.clear();
+        }
+    }
+
+
+    bool WebHookVerifier::replayProtectionEnabled() const {
+        return currentReplayProtectionEnabled.load();
+    }
+
+
+    void WebHookVerifier::setMaximumThreads(unsigned newMaximumThreads) {
+        if (newMaximumThreads > 0) {
+            threadPool->setMaxThreadCount(static_cast<int>(newMaximumThreads));
+        } else {
+            threadPool->setMaxThreadCount(QThread::idealThreadCount());
+        }
+    }
+
+
+    unsigned WebHookVerifier::maximumThreads() const {
+        return static_cast<unsigned>(threadPool->maxThreadCount());
+    }
+
+
+    WebHookVerifier::Result WebHookVerifier::verify(const QByteArray& body, const QString& contentType) {
+        return verify(Envelope(body, contentType));
+    }
+
+
+    WebHookVerifier::Result WebHookVerifier::verify(const Envelope& envelope) {
+        long long minute = SigningKeyCache::currentMinute(currentTimeDelta.load());
+        Check     check;
+
+        checkRange(&envelope, &check, 1, minute);
+        rejectReplays(&check, 1, minute);
+
+        return Result(check.status, check.payload);
+    }
+
+
+    QVector<WebHookVerifier::Result> WebHookVerifier::verify(const QVector<Envelope>& envelopes) {
+        QVector<Result> result;
+        unsigned        numberEnvelopes = static_cast<unsigned>(envelopes.size());
+
+        if (numberEnvelopes > 0) {
+            long long      minute        = SigningKeyCache::currentMinute(currentTimeDelta.load());
+            unsigned       numberThreads = qBound(1U, numberEnvelopes / minimumBatchPerThread, maximumThreads());
+            unsigned       share         = (numberEnvelopes + numberThreads - 1) / numberThreads;
+            QVector<Check> checks(static_cast<int>(numberEnvelopes));
+            QSemaphore     completed;
+
+            // Rounding the share up can leave the last thread without work so the thread count is recalculated.  The
+            // calling thread takes the first share so only the remaining shares go to the pool.
+            numberThreads = (numberEnvelopes + share - 1) / share;
+            for (unsigned thread=1 ; thread<numberThreads ; ++thread) {
+                unsigned first = thread * share;
+                unsigned count = qMin(share, numberEnvelopes - first);
+                Check*   check = checks.data() + first;
+
+                threadPool->start(
+                    [this, &envelopes, &completed, check, first, count, minute]() {
+                        checkRange(envelopes.constData() + first, check, count, minute);
+                        completed.release();
+                    }
+                );
+            }
+
+            checkRange(envelopes.constData(), checks.data(), qMin(share, numberEnvelopes), minute);
+            completed.acquire(static_cast<int>(numberThreads - 1));
+
+            rejectReplays(checks.data(), numberEnvelopes, minute);
+
+            result.reserve(static_cast<int>(numberEnvelopes));
+            for (const Check& check : checks) {
+                result.append(Result(check.status, check.payload));
+            }
+        }
+
+        return result;
+    }
+
+
+    WebHookVerifier::Result WebHookVerifier::verifyTimestamp(const QByteArray& body, const QString& contentType) {
+        Result     result;
+        QByteArray data;
+        QByteArray hash;
+
+        if (decodeEnvelope(body, contentType, data, hash)) {
+            if (currentTimestampSecret.isEmpty()) {
+                result = Result(Status::BAD_SIGNATURE);
+            } else {
+                Crypto::Hmac hmac(currentTimestampSecret);
+                hmac.addData(data);
+
+                bool ok;
+                data.toLongLong(&ok);
+
+                if (!signaturesMatch(hmac.digest(), hash)) {
+                    result = Result(Status::BAD_SIGNATURE);
+                } else if (ok) {
+                    result = Result(Status::VALID, data);
+                }
+            }
+        }
+
+        return result;
+    }
+
+
+    long long WebHookVerifier::clockOffset(const Result& timestampResult) const {
+        long long result = 0;
+
+        if (timestampResult.isValid()) {
+            long long localTime = QDateTime::currentMSecsSinceEpoch() + currentTimeDelta.load();
+            result = localTime - timestampResult.payload().toLongLong();
+        }
+
+        return result;
+    }
+
+
+    void WebHookVerifier::checkRange(const Envelope* envelopes, Check* checks, unsigned count, long long minute) {
+        // Most envelopes are signed in the current minute so it is checked first.
+        static const long long offsets[] = { 0, -1, 1 };
+        static const unsigned  numberOffsets = sizeof(offsets) / sizeof(offsets[0]);
+
+        SigningKeyCache::Signer* signers[numberOffsets];
+        {
+            QMutexLocker locker(&signingKeyMutex);
+            for (unsigned i=0 ; i<numberOffsets ; ++i) {
+                signers[i] = new SigningKeyCache::Signer(*signingKeys, currentWebhookSecret, minute + offsets[i]);
+            }
+        }
+
+        for (unsigned index=0 ; index<count ; ++index) {
+            const Envelope& envelope = envelopes[index];
+            Check&          check    = checks[index];
+
+            check.status = Status::MALFORMED;
+            check.minute = minute;
+
+            QByteArray data;
+            if (decodeEnvelope(envelope.body(), envelope.contentType(), data, check.hash)) {
+                check.status = Status::BAD_SIGNATURE;
+
+                unsigned offsetIndex = 0;
+                while (check.status != Status::VALID && offsetIndex < numberOffsets) {
+                    SigningKeyCache::Signer* signer = signers[offsetIndex];
+                    signer->reset();
+                    signer->addData(data);
+
+                    if (signaturesMatch(signer->result(), check.hash)) {
+                        check.status  = Status::VALID;
+                        check.payload = data;
+                        check.minute  = minute + offsets[offsetIndex];
+                    } else {
+                        ++offsetIndex;
+                    }
+                }
+            }
+        }
+
+        for (unsigned i=0 ; i<numberOffsets ; ++i) {
+            delete signers[i];
+        }
+    }
+
+
+    void WebHookVerifier::rejectReplays(Check* checks, unsigned count, long long minute) {
+        if (currentReplayProtectionEnabled.load()) {
+            QMutexLocker locker(&replayMutex);
+
+            // Signatures from before the previous minute can no longer be accepted so they need not be remembered.
+            while (!acceptedSignatures.isEmpty() && acceptedSignatures.firstKey() < minute - 1) {
+                acceptedSignatures.erase(acceptedSignatures.begin());
+            }
+
+            for (unsigned i=0 ; i<count ; ++i) {
+                Check& check = checks[i];
+                if (check.status == Status::VALID) {
+                    QSet<QByteArray>& signatures = acceptedSignatures[check.minute];
+                    if (signatures.contains(check.hash)) {
+                        check.status = Status::REPLAYED;
+                        check.payload.clear();
+                    } else {
+                        signatures.insert(check.hash);
+                    }
+                }
+            }
+        }
+    }
+}
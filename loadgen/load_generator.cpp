@@ -0,0 +1,488 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the load generator used to drive webhooks at a sustained rate.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+#include <QList>
+#include <QPair>
+#include <QVariant>
+#include <QVector>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QJsonValue>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QNetworkAccessManager>
+
+#if (defined(Q_OS_LINUX))
+
+    #include <QFile>
+
+#elif (defined(Q_OS_UNIX))
+
+    #include <sys/resource.h>
+
+#endif
+
+#include <algorithm>
+#include <random>
+
+#include <wh_web_hook.h>
+#include <wh_metrics.h>
+
+#include "load_generator.h"
+
+constexpr int      LoadGenerator::tickIntervalMsec;
+constexpr unsigned LoadGenerator::numberPayloads;
+
+LoadGenerator::LoadGenerator(QObject* parent):QObject(parent) {
+    currentNumberWebHooks     = 1;
+    currentRate               = 1000.0;
+    currentDurationMsec       = 10000;
+    currentDrainTimeoutMsec   = 30000;
+    currentMinimumPayloadSize = 1024;
+    currentMaximumPayloadSize = 1024;
+    currentSeed               = 1;
+    currentMaximumInFlight    = 0;
+    currentBatchingEnabled    = false;
+    currentCompression        = Wh::WebHook::Compression::NONE;
+    currentEnvelopeFormat     = Wh::WebHook::EnvelopeFormat::JSON;
+    currentHttp2Enabled       = false;
+
+    lastTickNsec      = 0;
+    sendingNsec       = 0;
+    elapsedNsec       = 0;
+    sending           = false;
+    messagesSent      = 0;
+    payloadBytesSent  = 0;
+    messagesDelivered = 0;
+    messagesFailed    = 0;
+    peakOutstanding   = 0;
+
+    pacingTimer = new QTimer(this);
+    pacingTimer->setTimerType(Qt::PreciseTimer);
+    pacingTimer->setInterval(tickIntervalMsec);
+
+    drainTimer = new QTimer(this);
+    drainTimer->setSingleShot(true);
+
+    connect(pacingTimer, &QTimer::timeout, this, &LoadGenerator::tick);
+    connect(drainTimer, &QTimer::timeout, this, &LoadGenerator::drainTimedOut);
+}
+
+
+LoadGenerator::~LoadGenerator() {
+    qDeleteAll(webHooks);
+    qDeleteAll(networkAccessManagers);
+}
+
+
+void LoadGenerator::setDestination(const QUrl& destinationUrl, const QByteArray& webhookSecret) {
+    currentUrl    = destinationUrl;
+    currentSecret = webhookSecret;
+}
+
+
+void LoadGenerator::setNumberWebHooks(unsigned newNumberWebHooks) {
+    currentNumberWebHooks = newNumberWebHooks > 0 ? newNumberWebHooks : 1;
+}
+
+
+void LoadGenerator::setRate(double newRate) {
+    currentRate = qMax(newRate, 0.0);
+}
+
+
+void LoadGenerator::setDuration(unsigned long newDurationMsec) {
+    currentDurationMsec = newDurationMsec;
+}
+
+
+void LoadGenerator::setDrainTimeout(unsigned long newDrainTimeoutMsec) {
+    currentDrainTimeoutMsec = newDrainTimeoutMsec;
+}
+
+
+void LoadGenerator::setPayloadSizes(unsigned minimumSize, unsigned maximumSize) {
+    currentMinimumPayloadSize = qMin(minimumSize, maximumSize);
+    currentMaximumPayloadSize = qMax(minimumSize, maximumSize);
+}
+
+
+void LoadGenerator::setSeed(quint32 newSeed) {
+    currentSeed = newSeed;
+}
+
+
+void LoadGenerator::setMaximumInFlight(unsigned newMaximumInFlight) {
+    currentMaximumInFlight = newMaximumInFlight;
+}
+
+
+void LoadGenerator::setBatchingEnabled(bool nowEnabled) {
+    currentBatchingEnabled = nowEnabled;
+}
+
+
+void LoadGenerator::setCompression(Wh::WebHook::Compression newCompression) {
+    currentCompression = newCompression;
+}
+
+
+void LoadGenerator::setEnvelopeFormat(Wh::WebHook::EnvelopeFormat newEnvelopeFormat) {
+    currentEnvelopeFormat = newEnvelopeFormat;
+}
+
+
+void LoadGenerator::setHttp2Enabled(bool nowEnabled) {
+    currentHttp2Enabled = nowEnabled;
+}
+
+
+LoadGenerator::Results LoadGenerator::results() const {
+    Results                   result;
+    Wh::Metrics::Snapshot     metrics;
+
+    if (!currentMetrics.isNull()) {
+        metrics = currentMetrics->snapshot();
+    }
+
+    Wh::Metrics::Distribution delivery       = metrics.latency(Wh::Metrics::Latency::DELIVERY);
+    Wh::Metrics::Distribution roundTrip      = metrics.latency(Wh::Metrics::Latency::ROUND_TRIP);
+    Wh::Metrics::Distribution signing        = metrics.latency(Wh::Metrics::Latency::SIGN);
+    double                    sendingSeconds = qMax(sendingNsec, qint64(1)) / 1.0E9;
+    double                    elapsedSeconds = qMax(elapsedNsec, qint64(1)) / 1.0E9;
+    qint64                    outstanding    = static_cast<qint64>(messagesSent - messagesDelivered - messagesFailed);
+
+    result << qMakePair(QString("webhooks"), QVariant(currentNumberWebHooks))
+           << qMakePair(QString("target_rate"), QVariant(currentRate))
+           << qMakePair(QString("offered_rate"), QVariant(messagesSent / sendingSeconds))
+           << qMakePair(QString("throughput"), QVariant(messagesDelivered / elapsedSeconds))
+           << qMakePair(QString("sending_seconds"), QVariant(sendingSeconds))
+           << qMakePair(QString("elapsed_seconds"), QVariant(elapsedSeconds))
+           << qMakePair(QString("messages_sent"), QVariant(messagesSent))
+           << qMakePair(QString("messages_delivered"), QVariant(messagesDelivered))
+           << qMakePair(QString("messages_failed"), QVariant(messagesFailed))
+           << qMakePair(QString("messages_outstanding"), QVariant(outstanding))
+           << qMakePair(QString("peak_outstanding"), QVariant(peakOutstanding))
+           << qMakePair(QString("payload_bytes_sent"), QVariant(payloadBytesSent))
+           << qMakePair(QString("requests"), QVariant(metrics.counter(Wh::Metrics::Counter::REQUESTS)))
+           << qMakePair(QString("retries"), QVariant(metrics.counter(Wh::Metrics::Counter::RETRIES)))
+           << qMakePair(QString("retry_amplification"), QVariant(metrics.retryAmplification()))
+           << qMakePair(QString("bytes_sent"), QVariant(metrics.counter(Wh::Metrics::Counter::BYTES_SENT)))
+           << qMakePair(QString("bytes_received"), QVariant(metrics.counter(Wh::Metrics::Counter::BYTES_RECEIVED)))
+           << qMakePair(QString("latency_p50_us"), QVariant(delivery.percentile(50.0)))
+           << qMakePair(QString("latency_p90_us"), QVariant(delivery.percentile(90.0)))
+           << qMakePair(QString("latency_p99_us"), QVariant(delivery.percentile(99.0)))
+           << qMakePair(QString("latency_p999_us"), QVariant(delivery.percentile(99.9)))
+           << qMakePair(QString("latency_max_us"), QVariant(delivery.maximum()))
+           << qMakePair(QString("round_trip_p50_us"), QVariant(roundTrip.percentile(50.0)))
+           << qMakePair(QString("round_trip_p99_us"), QVariant(roundTrip.percentile(99.0)))
+           << qMakePair(QString("sign_p50_us"), QVariant(signing.percentile(50.0)))
+           << qMakePair(QString("scheduling_lag_p50_us"), QVariant(lagPercentile(50.0)))
+           << qMakePair(QString("scheduling_lag_p99_us"), QVariant(lagPercentile(99.0)))
+           << qMakePair(QString("scheduling_lag_max_us"), QVariant(lagPercentile(100.0)))
+           << qMakePair(QString("peak_rss_bytes"), QVariant(peakResidentBytes()));
+
+    return result;
+}
+
+
+QByteArray LoadGenerator::report(Format format, bool includeHeader) const {
+    QByteArray result;
+    Results    values = results();
+
+    if (format == Format::JSON) {
+        QJsonObject object;
+        for (const QPair<QString, QVariant>& value : values) {
+            object.insert(value.first, QJsonValue::fromVariant(value.second));
+        }
+
+        result = QJsonDocument(object).toJson(QJsonDocument::Indented);
+    } else {
+        int nameWidth = 0;
+        for (const QPair<QString, QVariant>& value : values) {
+            nameWidth = qMax(nameWidth, value.first.size());
+        }
+
+        QStringList names;
+        QStringList fields;
+        for (const QPair<QString, QVariant>& value : values) {
+            QString field;
+            if (value.second.type() == QVariant::Double) {
+                field = QString::number(value.second.toDouble(), 'f', 3);
+            } else {
+                field = value.second.toString();
+            }
+
+            if (format == Format::TEXT) {
+                fields << QString("%1 : %2").arg(value.first, -nameWidth).arg(field);
+            } else {
+                names << value.first;
+                fields << field;
+            }
+        }
+
+        if (format == Format::TEXT) {
+            result = fields.join('\n').toUtf8().append('\n');
+        } else {
+            if (includeHeader) {
+                result = names.join(',').toUtf8().append('\n');
+            }
+
+            result.append(fields.join(',').toUtf8()).append('\n');
+        }
+    }
+
+    return result;
+}
+
+
+unsigned long long LoadGenerator::peakResidentBytes() {
+    unsigned long long result = 0;
+
+    #if (defined(Q_OS_LINUX))
+
+        QFile status(QString("/proc/self/status"));
+        if (status.open(QFile::ReadOnly)) {
+            QList<QByteArray> lines = status.readAll().split('\n');
+            for (const QByteArray& line : lines) {
+                if (line.startsWith("VmHWM:")) {
+                    QByteArray kilobytes = line.mid(6).trimmed();
+                    kilobytes.chop(kilobytes.endsWith("kB") ? 2 : 0);
+                    result = kilobytes.trimmed().toULongLong() * 1024;
+                }
+            }
+        }
+
+    #elif (defined(Q_OS_UNIX))
+
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+            #if (defined(Q_OS_DARWIN))
+
+                result = static_cast<unsigned long long>(usage.ru_maxrss);
+
+            #else
+
+                result = static_cast<unsigned long long>(usage.ru_maxrss) * 1024;
+
+            #endif
+        }
+
+    #endif
+
+    return result;
+}
+
+
+void LoadGenerator::start() {
+    qDeleteAll(webHooks);
+    qDeleteAll(networkAccessManagers);
+    webHooks.clear();
+    networkAccessManagers.clear();
+
+    messagesSent      = 0;
+    payloadBytesSent  = 0;
+    messagesDelivered = 0;
+    messagesFailed    = 0;
+    peakOutstanding   = 0;
+    sendingNsec       = 0;
+    elapsedNsec       = 0;
+
+    buildPayloads();
+
+    lags.clear();
+    lags.reserve(static_cast<int>(currentDurationMsec / tickIntervalMsec) + 16);
+
+    currentMetrics.reset(new Wh::Metrics);
+
+    for (unsigned i=0 ; i<currentNumberWebHooks ; ++i) {
+        QNetworkAccessManager* networkAccessManager = new QNetworkAccessManager;
+        Wh::WebHook*           webHook              = new Wh::WebHook(networkAccessManager, currentSecret);
+
+        if (currentMaximumInFlight > 0) {
+            webHook->setMaximumInFlight(currentMaximumInFlight);
+        }
+
+        webHook->setBatchingEnabled(currentBatchingEnabled);
+        webHook->setCompression(currentCompression);
+        webHook->setEnvelopeFormat(currentEnvelopeFormat);
+        webHook->setHttp2Enabled(currentHttp2Enabled);
+        webHook->setResponseBodiesDiscarded();
+        webHook->setMetrics(currentMetrics);
+        webHook->warmUp(currentUrl);
+
+        connect(
+            webHook,
+            &Wh::WebHook::messageDelivered,
+            this,
+            [this](unsigned long long, const QByteArray&) {
+                messageCompleted(true);
+            }
+        );
+
+        connect(
+            webHook,
+            &Wh::WebHook::messageFailed,
+            this,
+            [this](unsigned long long, int) {
+                messageCompleted(false);
+            }
+        );
+
+        networkAccessManagers.append(networkAccessManager);
+        webHooks.append(webHook);
+    }
+
+    sending      = true;
+    lastTickNsec = 0;
+
+    clock.start();
+    pacingTimer->start();
+}
+
+
+void LoadGenerator::tick() {
+    qint64 nowNsec       = clock.nsecsElapsed();
+    qint64 durationNsec  = static_cast<qint64>(currentDurationMsec) * 1000000;
+    qint64 lateNsec      = nowNsec - lastTickNsec - static_cast<qint64>(tickIntervalMsec) * 1000000;
+    qint64 scheduledNsec = qMin(nowNsec, durationNsec);
+
+    lags.append(static_cast<quint32>(qBound(qint64(0), lateNsec / 1000, qint64(0xFFFFFFFF))));
+    lastTickNsec = nowNsec;
+
+    unsigned long long due          = static_cast<unsigned long long>(currentRate * (scheduledNsec / 1.0E9));
+    unsigned           webHookCount = static_cast<unsigned>(webHooks.size());
+    unsigned           payloadCount = static_cast<unsigned>(payloads.size());
+
+    while (messagesSent < due) {
+        unsigned payloadIndex = static_cast<unsigned>(messagesSent % payloadCount);
+        unsigned webHookIndex = static_cast<unsigned>(messagesSent % webHookCount);
+
+        webHooks.at(webHookIndex)->send(currentUrl, payloads.at(payloadIndex));
+
+        payloadBytesSent += payloadSizes.at(payloadIndex);
+        ++messagesSent;
+    }
+
+    peakOutstanding = qMax(peakOutstanding, messagesSent - messagesDelivered - messagesFailed);
+
+    if (nowNsec >= durationNsec) {
+        stopSending();
+    }
+}
+
+
+void LoadGenerator::drainTimedOut() {
+    finish();
+}
+
+
+void LoadGenerator::messageCompleted(bool success) {
+    if (success) {
+        ++messagesDelivered;
+    } else {
+        ++messagesFailed;
+    }
+
+    if (!sending && messagesDelivered + messagesFailed >= messagesSent) {
+        finish();
+    }
+}
+
+
+void LoadGenerator::stopSending() {
+    pacingTimer->stop();
+
+    sending     = false;
+    sendingNsec = clock.nsecsElapsed();
+
+    for (Wh::WebHook* webHook : webHooks) {
+        webHook->flush();
+    }
+
+    if (messagesDelivered + messagesFailed >= messagesSent) {
+        finish();
+    } else {
+        drainTimer->start(static_cast<int>(qMin(currentDrainTimeoutMsec, 0x7FFFFFFFUL)));
+    }
+}
+
+
+void LoadGenerator::finish() {
+    drainTimer->stop();
+    elapsedNsec = clock.nsecsElapsed();
+
+    // This can be reached from a webhook signal so the webhooks are released once control returns to the event loop.
+    for (Wh::WebHook* webHook : webHooks) {
+        disconnect(webHook, Q_NULLPTR, this, Q_NULLPTR);
+        webHook->deleteLater();
+    }
+
+    for (QNetworkAccessManager* networkAccessManager : networkAccessManagers) {
+        networkAccessManager->deleteLater();
+    }
+
+    webHooks.clear();
+    networkAccessManagers.clear();
+
+    emit finished();
+}
+
+
+unsigned long long LoadGenerator::lagPercentile(double percent) const {
+    unsigned long long result = 0;
+
+    if (!lags.isEmpty()) {
+        QVector<quint32> sorted = lags;
+        int              index  = static_cast<int>(qBound(0.0, percent, 100.0) * (sorted.size() - 1) / 100.0);
+
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+        result = sorted.at(index);
+    }
+
+    return result;
+}
+
+
+void LoadGenerator::buildPayloads() {
+    std::mt19937                            generator(currentSeed);
+    std::uniform_int_distribution<unsigned> size(currentMinimumPayloadSize, currentMaximumPayloadSize);
+
+    payloads.clear();
+    payloadSizes.clear();
+
+    for (unsigned i=0 ; i<numberPayloads ; ++i) {
+        unsigned    payloadSize = size(generator);
+        QJsonObject payload;
+
+        // The key, quotes, and braces account for the 12 bytes not taken up by the data.
+        payload.insert(QString("data"), QString(static_cast<int>(payloadSize > 12 ? payloadSize - 12 : 0), QChar('x')));
+
+        payloads.append(payload);
+        payloadSizes.append(payloadSize);
+    }
+}
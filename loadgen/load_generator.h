@@ -0,0 +1,436 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the load generator used to drive webhooks at a sustained rate.
+***********************************************************************************************************************/
+
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+#include <QList>
+#include <QPair>
+#include <QVariant>
+#include <QVector>
+#include <QJsonObject>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+
+#include <wh_web_hook.h>
+
+class QTimer;
+class QNetworkAccessManager;
+
+namespace Wh {
+    class Metrics;
+}
+
+/**
+ * Class that drives one or more webhooks at a target message rate and collects the results.  All webhooks share the
+ * thread of the load generator so the results show how far a single event loop can be pushed.
+ *
+ * Messages are paced by a precise timer.  On each tick the generator sends every message that is due based on the
+ * time since the run started, spreading messages across the webhooks in turn.  How late each tick fires is recorded
+ * so event loop saturation shows up as growing scheduling lag and an offered rate below the target rate.
+ */
+class LoadGenerator:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * Enumeration of supported report formats.
+         */
+        enum class Format {
+            /**
+             * Indicates a human readable report.
+             */
+            TEXT,
+
+            /**
+             * Indicates a header line followed by a single line of comma separated values.
+             */
+            CSV,
+
+            /**
+             * Indicates a JSON object.
+             */
+            JSON
+        };
+
+        /**
+         * Type used to hold the results of a run as name/value pairs, in report order.
+         */
+        typedef QList<QPair<QString, QVariant>> Results;
+
+        /**
+         * The interval between pacing timer ticks, in milliseconds.
+         */
+        static constexpr int tickIntervalMsec = 1;
+
+        /**
+         * The number of distinct payloads built before a run.  Payloads are reused in turn so building payloads does
+         * not dominate the run.
+         */
+        static constexpr unsigned numberPayloads = 256;
+
+        /**
+         * Constructor
+         *
+         * \param[in] parent Pointer to the parent object.
+         */
+        LoadGenerator(QObject* parent = Q_NULLPTR);
+
+        ~LoadGenerator() override;
+
+        /**
+         * Method you can use to set the destination and the secret used to sign messages.
+         *
+         * \param[in] destinationUrl The URL that will receive messages.
+         *
+         * \param[in] webhookSecret  The webhook secret.
+         */
+        void setDestination(const QUrl& destinationUrl, const QByteArray& webhookSecret);
+
+        /**
+         * Method you can use to set the number of webhook instances to drive.  Each webhook uses its own network
+         * access manager and therefore its own connection pool.
+         *
+         * \param[in] newNumberWebHooks The number of webhooks.
+         */
+        void setNumberWebHooks(unsigned newNumberWebHooks);
+
+        /**
+         * Method you can use to set the target rate, in messages per second, across all webhooks.
+         *
+         * \param[in] newRate The target rate.
+         */
+        void setRate(double newRate);
+
+        /**
+         * Method you can use to set how long messages are sent.
+         *
+         * \param[in] newDurationMsec The duration of the run, in milliseconds.
+         */
+        void setDuration(unsigned long newDurationMsec);
+
+        /**
+         * Method you can use to set how long the generator waits for outstanding messages once sending stops.
+         *
+         * \param[in] newDrainTimeoutMsec The drain timeout, in milliseconds.
+         */
+        void setDrainTimeout(unsigned long newDrainTimeoutMsec);
+
+        /**
+         * Method you can use to set the range of payload sizes.  Sizes are drawn uniformly from the range.
+         *
+         * \param[in] minimumSize The minimum payload size, in bytes.
+         *
+         * \param[in] maximumSize The maximum payload size, in bytes.
+         */
+        void setPayloadSizes(unsigned minimumSize, unsigned maximumSize);
+
+        /**
+         * Method you can use to set the seed used to pick payload sizes.
+         *
+         * \param[in] newSeed The new seed.
+         */
+        void setSeed(quint32 newSeed);
+
+        /**
+         * Method you can use to set the maximum number of messages in flight for each webhook.
+         *
+         * \param[in] newMaximumInFlight The maximum number of messages in flight.  A value of 0 leaves the webhook
+         *                               default in place.
+         */
+        void setMaximumInFlight(unsigned newMaximumInFlight);
+
+        /**
+         * Method you can use to enable or disable batching.
+         *
+         * \param[in] nowEnabled If true, batching will be enabled.
+         */
+        void setBatchingEnabled(bool nowEnabled = true);
+
+        /**
+         * Method you can use to set the compression mode.
+         *
+         * \param[in] newCompression The new compression mode.
+         */
+        void setCompression(Wh::WebHook::Compression newCompression);
+
+        /**
+         * Method you can use to set the envelope format.
+         *
+         * \param[in] newEnvelopeFormat The new envelope format.
+         */
+        void setEnvelopeFormat(Wh::WebHook::EnvelopeFormat newEnvelopeFormat);
+
+        /**
+         * Method you can use to enable or disable HTTP/2.
+         *
+         * \param[in] nowEnabled If true, HTTP/2 will be enabled.
+         */
+        void setHttp2Enabled(bool nowEnabled = true);
+
+        /**
+         * Method you can use to obtain the results of the last run.
+         *
+         * \return Returns the results as name/value pairs.
+         */
+        Results results() const;
+
+        /**
+         * Method you can use to format the results of the last run.
+         *
+         * \param[in] format        The report format.
+         *
+         * \param[in] includeHeader If true, the CSV header line is included.  Ignored for other formats.
+         *
+         * \return Returns the formatted report.
+         */
+        QByteArray report(Format format, bool includeHeader = true) const;
+
+        /**
+         * Method you can use to determine the peak resident memory used by this process.
+         *
+         * \return Returns the peak resident set size, in bytes.  A value of 0 is returned if the value can not be
+         *         determined on this platform.
+         */
+        static unsigned long long peakResidentBytes();
+
+    signals:
+        /**
+         * Signal that is emitted when a run completes.
+         */
+        void finished();
+
+    public slots:
+        /**
+         * Slot you can trigger to start a run.
+         */
+        void start();
+
+    private slots:
+        /**
+         * Slot that is triggered on each pacing timer tick.
+         */
+        void tick();
+
+        /**
+         * Slot that is triggered when the drain timeout expires.
+         */
+        void drainTimedOut();
+
+    private:
+        /**
+         * Method that is called when a message is delivered or fails.
+         *
+         * \param[in] success If true, the message was delivered.
+         */
+        void messageCompleted(bool success);
+
+        /**
+         * Method that stops sending and waits for outstanding messages.
+         */
+        void stopSending();
+
+        /**
+         * Method that ends the run and releases the webhooks.
+         */
+        void finish();
+
+        /**
+         * Method that calculates a percentile of the recorded scheduling lag.
+         *
+         * \param[in] percent The percentile, from 0 to 100.
+         *
+         * \return Returns the scheduling lag, in microseconds.
+         */
+        unsigned long long lagPercentile(double percent) const;
+
+        /**
+         * Method that builds the payloads used during a run.
+         */
+        void buildPayloads();
+
+        /**
+         * The destination URL.
+         */
+        QUrl currentUrl;
+
+        /**
+         * The webhook secret.
+         */
+        QByteArray currentSecret;
+
+        /**
+         * The number of webhooks to drive.
+         */
+        unsigned currentNumberWebHooks;
+
+        /**
+         * The target rate, in messages per second.
+         */
+        double currentRate;
+
+        /**
+         * The duration of the run, in milliseconds.
+         */
+        unsigned long currentDurationMsec;
+
+        /**
+         * The drain timeout, in milliseconds.
+         */
+        unsigned long currentDrainTimeoutMsec;
+
+        /**
+         * The minimum payload size, in bytes.
+         */
+        unsigned currentMinimumPayloadSize;
+
+        /**
+         * The maximum payload size, in bytes.
+         */
+        unsigned currentMaximumPayloadSize;
+
+        /**
+         * The seed used to pick payload sizes.
+         */
+        quint32 currentSeed;
+
+        /**
+         * The maximum number of messages in flight for each webhook.
+         */
+        unsigned currentMaximumInFlight;
+
+        /**
+         * Flag indicating if batching is enabled.
+         */
+        bool currentBatchingEnabled;
+
+        /**
+         * The compression mode.
+         */
+        Wh::WebHook::Compression currentCompression;
+
+        /**
+         * The envelope format.
+         */
+        Wh::WebHook::EnvelopeFormat currentEnvelopeFormat;
+
+        /**
+         * Flag indicating if HTTP/2 is enabled.
+         */
+        bool currentHttp2Enabled;
+
+        /**
+         * The network access managers, one per webhook.
+         */
+        QList<QNetworkAccessManager*> networkAccessManagers;
+
+        /**
+         * The webhooks being driven.
+         */
+        QList<Wh::WebHook*> webHooks;
+
+        /**
+         * The metrics shared by all the webhooks.
+         */
+        QSharedPointer<Wh::Metrics> currentMetrics;
+
+        /**
+         * The payloads sent during a run.
+         */
+        QVector<QJsonObject> payloads;
+
+        /**
+         * The size of each payload, in bytes.
+         */
+        QVector<unsigned> payloadSizes;
+
+        /**
+         * The pacing timer.
+         */
+        QTimer* pacingTimer;
+
+        /**
+         * The drain timer.
+         */
+        QTimer* drainTimer;
+
+        /**
+         * Timer used to measure the run.
+         */
+        QElapsedTimer clock;
+
+        /**
+         * The time the previous tick fired, in nanoseconds since the run started.
+         */
+        qint64 lastTickNsec;
+
+        /**
+         * The time sending stopped, in nanoseconds since the run started.
+         */
+        qint64 sendingNsec;
+
+        /**
+         * The time the run ended, in nanoseconds since the run started.
+         */
+        qint64 elapsedNsec;
+
+        /**
+         * Scheduling lag for each tick, in microseconds.
+         */
+        QVector<quint32> lags;
+
+        /**
+         * Flag indicating that sending has stopped.
+         */
+        bool sending;
+
+        /**
+         * The number of messages sent.
+         */
+        unsigned long long messagesSent;
+
+        /**
+         * The number of payload bytes sent.
+         */
+        unsigned long long payloadBytesSent;
+
+        /**
+         * The number of messages delivered.
+         */
+        unsigned long long messagesDelivered;
+
+        /**
+         * The number of messages that failed.
+         */
+        unsigned long long messagesFailed;
+
+        /**
+         * The largest number of messages outstanding at once.
+         */
+        unsigned long long peakOutstanding;
+};
+
+#endif
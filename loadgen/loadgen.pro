@@ -0,0 +1,90 @@
+##-*-makefile-*-########################################################################################################
+# Copyright 2016 Inesonic, LLC
+#
+# MIT License:
+#   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+#   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+#   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+#   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+#   
+#   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+#   Software.
+#   
+#   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+#   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+#   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+#   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+########################################################################################################################
+
+########################################################################################################################
+# Basic build characteristics
+#
+
+TEMPLATE = app
+QT += core network
+CONFIG += c++14
+
+HEADERS = ../test/stand_in_server.h \
+          load_generator.h \
+
+SOURCES = main.cpp \
+          load_generator.cpp \
+          ../test/stand_in_server.cpp \
+
+########################################################################################################################
+# Libraries
+#
+
+defined(SETTINGS_PRI, var) {
+    include($${SETTINGS_PRI})
+}
+
+INEWH_BASE = $${OUT_PWD}/../inewh
+INCLUDEPATH += $${PWD}/../inewh/include
+INCLUDEPATH += $${PWD}/../inewh/source
+INCLUDEPATH += $${PWD}/../test
+
+INCLUDEPATH += $${INECRYPTO_INCLUDE}
+
+unix {
+    CONFIG(debug, debug|release) {
+        LIBS += -L$${INEWH_BASE}/build/debug/ -linewh
+        PRE_TARGETDEPS += $${INEWH_BASE}/build/debug/libinewh.a
+    } else {
+        LIBS += -L$${INEWH_BASE}/build/release/ -linewh
+        PRE_TARGETDEPS += $${INEWH_BASE}/build/release/libinewh.a
+    }
+
+    LIBS += -L$${INECRYPTO_LIBDIR} -linecrypto
+}
+
+win32 {
+    CONFIG(debug, debug|release) {
+        LIBS += $${INEWH_BASE}/build/Debug/inewh.lib
+        PRE_TARGETDEPS += $${INEWH_BASE}/build/Debug/inewh.lib
+    } else {
+        LIBS += $${INEWH_BASE}/build/Release/inewh.lib
+        PRE_TARGETDEPS += $${INEWH_BASE}/build/Release/inewh.lib
+    }
+
+    LIBS += $${INECRYPTO_LIBDIR}/inecrypto.lib
+}
+
+########################################################################################################################
+# Locate build intermediate and output products
+#
+
+TARGET = inewh_loadgen
+
+CONFIG(debug, debug|release) {
+    unix:DESTDIR = build/debug
+    win32:DESTDIR = build/Debug
+} else {
+    unix:DESTDIR = build/release
+    win32:DESTDIR = build/Release
+}
+
+OBJECTS_DIR = $${DESTDIR}/objects
+MOC_DIR = $${DESTDIR}/moc
+RCC_DIR = $${DESTDIR}/rcc
+UI_DIR = $${DESTDIR}/ui
@@ -0,0 +1,363 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file is the main entry point for the inewh load generator.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QUrl>
+#include <QFile>
+#include <QTimer>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <wh_web_hook.h>
+
+#include "stand_in_server.h"
+#include "load_generator.h"
+
+/**
+ * Function that reports a usage error and terminates the application.
+ *
+ * \param[in] message The error message.
+ */
+static void usageError(const QString& message) {
+    std::fprintf(stderr, "inewh_loadgen: %s\n", message.toLocal8Bit().constData());
+    std::exit(1);
+}
+
+
+/**
+ * Function that parses an unsigned integer option.
+ *
+ * \param[in] parser The command line parser.
+ *
+ * \param[in] option The option to parse.
+ *
+ * \return Returns the parsed value.
+ */
+static unsigned long unsignedValue(const QCommandLineParser& parser, const QCommandLineOption& option) {
+    bool          ok;
+    unsigned long result = parser.value(option).toULong(&ok);
+
+    if (!ok) {
+        usageError(QString("Invalid value for --%1: %2").arg(option.names().last(), parser.value(option)));
+    }
+
+    return result;
+}
+
+
+/**
+ * Function that parses a non-negative floating point option.
+ *
+ * \param[in] parser The command line parser.
+ *
+ * \param[in] option The option to parse.
+ *
+ * \return Returns the parsed value.
+ */
+static double doubleValue(const QCommandLineParser& parser, const QCommandLineOption& option) {
+    bool   ok;
+    double result = parser.value(option).toDouble(&ok);
+
+    if (!ok || result < 0) {
+        usageError(QString("Invalid value for --%1: %2").arg(option.names().last(), parser.value(option)));
+    }
+
+    return result;
+}
+
+
+int main(int argumentCount, char** argumentValues) {
+    QCoreApplication application(argumentCount, argumentValues);
+    QCoreApplication::setApplicationName(QString("inewh_loadgen"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        QString(
+            "Drives one or more webhooks at a target message rate and reports throughput, latency, retries, and "
+            "memory use."
+        )
+    );
+    parser.addHelpOption();
+
+    QCommandLineOption urlOption(
+        QStringList() << "u" << "url",
+        QString("URL that receives messages."),
+        QString("url")
+    );
+    QCommandLineOption secretOption(
+        QStringList() << "s" << "secret",
+        QString("Webhook secret used to sign messages."),
+        QString("secret")
+    );
+    QCommandLineOption timestampUrlOption(
+        QString("timestamp-url"),
+        QString("URL of the timestamp server."),
+        QString("url")
+    );
+    QCommandLineOption timestampSecretOption(
+        QString("timestamp-secret"),
+        QString("Secret used for timestamp requests."),
+        QString("secret")
+    );
+    QCommandLineOption localOption(
+        QString("local"),
+        QString("Send to a stand-in server started on the loopback interface.")
+    );
+    QCommandLineOption serverLatencyOption(
+        QString("server-latency"),
+        QString("Delay added by the stand-in server to each response, in milliseconds."),
+        QString("msec"),
+        QString("0")
+    );
+    QCommandLineOption serverErrorRateOption(
+        QString("server-error-rate"),
+        QString("Fraction of requests the stand-in server answers with a 503."),
+        QString("rate"),
+        QString("0")
+    );
+    QCommandLineOption webHooksOption(
+        QStringList() << "n" << "webhooks",
+        QString("Number of webhook instances to drive."),
+        QString("count"),
+        QString("1")
+    );
+    QCommandLineOption rateOption(
+        QStringList() << "r" << "rate",
+        QString("Target rate across all webhooks, in messages per second."),
+        QString("rate"),
+        QString("1000")
+    );
+    QCommandLineOption durationOption(
+        QStringList() << "d" << "duration",
+        QString("How long to send messages, in seconds."),
+        QString("seconds"),
+        QString("10")
+    );
+    QCommandLineOption drainTimeoutOption(
+        QString("drain-timeout"),
+        QString("How long to wait for outstanding messages once sending stops, in seconds."),
+        QString("seconds"),
+        QString("30")
+    );
+    QCommandLineOption payloadSizeOption(
+        QStringList() << "p" << "payload-size",
+        QString("Payload size in bytes, or a range min:max to draw sizes from."),
+        QString("size"),
+        QString("1024")
+    );
+    QCommandLineOption seedOption(
+        QString("seed"),
+        QString("Seed used to pick payload sizes."),
+        QString("seed"),
+        QString("1")
+    );
+    QCommandLineOption inFlightOption(
+        QString("in-flight"),
+        QString("Maximum messages in flight for each webhook."),
+        QString("count")
+    );
+    QCommandLineOption batchingOption(
+        QString("batching"),
+        QString("Enable batching.")
+    );
+    QCommandLineOption compressionOption(
+        QString("compression"),
+        QString("Request body compression: none, deflate, or gzip."),
+        QString("mode"),
+        QString("none")
+    );
+    QCommandLineOption envelopeOption(
+        QString("envelope"),
+        QString("Envelope format: json or cbor."),
+        QString("format"),
+        QString("json")
+    );
+    QCommandLineOption http2Option(
+        QString("http2"),
+        QString("Enable HTTP/2.")
+    );
+    QCommandLineOption formatOption(
+        QStringList() << "f" << "format",
+        QString("Report format: text, csv, or json."),
+        QString("format"),
+        QString("text")
+    );
+    QCommandLineOption outputOption(
+        QStringList() << "o" << "output",
+        QString("File the report is written to.  The report is written to standard output by default."),
+        QString("file")
+    );
+    QCommandLineOption appendOption(
+        QString("append"),
+        QString("Append the report to the output file.  CSV reports omit the header when the file is not empty.")
+    );
+
+    parser.addOptions(
+        {
+            urlOption, secretOption, timestampUrlOption, timestampSecretOption, localOption, serverLatencyOption,
+            serverErrorRateOption, webHooksOption, rateOption, durationOption, drainTimeoutOption, payloadSizeOption,
+            seedOption, inFlightOption, batchingOption, compressionOption, envelopeOption, http2Option, formatOption,
+            outputOption, appendOption
+        }
+    );
+
+    parser.process(application);
+
+    bool       local           = parser.isSet(localOption);
+    QByteArray secret          = parser.value(secretOption).toUtf8();
+    QByteArray timestampSecret = parser.value(timestampSecretOption).toUtf8();
+
+    if (!local && !parser.isSet(urlOption)) {
+        usageError(QString("Either --url or --local is required."));
+    }
+
+    if (local && secret.isEmpty()) {
+        secret = QByteArray("0123456789ABCDEF0123456789ABCDEF");
+    }
+
+    if (secret.isEmpty()) {
+        usageError(QString("A webhook secret is required."));
+    }
+
+    if (timestampSecret.isEmpty()) {
+        timestampSecret = secret;
+    }
+
+    LoadGenerator generator;
+
+    QStringList sizes = parser.value(payloadSizeOption).split(':');
+    bool        minimumOk;
+    bool        maximumOk;
+    unsigned    minimumSize = sizes.first().toUInt(&minimumOk);
+    unsigned    maximumSize = sizes.last().toUInt(&maximumOk);
+
+    if (sizes.size() > 2 || !minimumOk || !maximumOk) {
+        usageError(QString("Invalid value for --payload-size: %1").arg(parser.value(payloadSizeOption)));
+    }
+
+    generator.setPayloadSizes(minimumSize, maximumSize);
+
+    QString compression = parser.value(compressionOption).toLower();
+    if (compression == QString("none")) {
+        generator.setCompression(Wh::WebHook::Compression::NONE);
+    } else if (compression == QString("deflate")) {
+        generator.setCompression(Wh::WebHook::Compression::DEFLATE);
+    } else if (compression == QString("gzip")) {
+        generator.setCompression(Wh::WebHook::Compression::GZIP);
+    } else {
+        usageError(QString("Invalid value for --compression: %1").arg(compression));
+    }
+
+    QString envelope = parser.value(envelopeOption).toLower();
+    if (envelope == QString("json")) {
+        generator.setEnvelopeFormat(Wh::WebHook::EnvelopeFormat::JSON);
+    } else if (envelope == QString("cbor")) {
+        generator.setEnvelopeFormat(Wh::WebHook::EnvelopeFormat::CBOR);
+    } else {
+        usageError(QString("Invalid value for --envelope: %1").arg(envelope));
+    }
+
+    LoadGenerator::Format format     = LoadGenerator::Format::TEXT;
+    QString               formatName = parser.value(formatOption).toLower();
+    if (formatName == QString("csv")) {
+        format = LoadGenerator::Format::CSV;
+    } else if (formatName == QString("json")) {
+        format = LoadGenerator::Format::JSON;
+    } else if (formatName != QString("text")) {
+        usageError(QString("Invalid value for --format: %1").arg(formatName));
+    }
+
+    StandInServer server(secret, timestampSecret);
+    QUrl          url = QUrl(parser.value(urlOption));
+
+    if (local) {
+        server.setVerificationEnabled();
+        server.setLatency(static_cast<unsigned>(unsignedValue(parser, serverLatencyOption)));
+        server.setErrorRate(doubleValue(parser, serverErrorRateOption));
+
+        if (!server.start()) {
+            usageError(QString("Could not start the stand-in server."));
+        }
+
+        if (!parser.isSet(urlOption)) {
+            url = server.url(QString("/v1/loadgen"));
+        }
+
+        Wh::WebHook::setTimestampUrl(server.timestampUrl());
+        Wh::WebHook::setTimestampSecret(timestampSecret);
+    } else {
+        if (!url.isValid()) {
+            usageError(QString("Invalid value for --url: %1").arg(parser.value(urlOption)));
+        }
+
+        if (parser.isSet(timestampUrlOption)) {
+            Wh::WebHook::setTimestampUrl(QUrl(parser.value(timestampUrlOption)));
+            Wh::WebHook::setTimestampSecret(timestampSecret);
+        }
+    }
+
+    generator.setDestination(url, secret);
+    generator.setNumberWebHooks(static_cast<unsigned>(unsignedValue(parser, webHooksOption)));
+    generator.setRate(doubleValue(parser, rateOption));
+    generator.setDuration(static_cast<unsigned long>(doubleValue(parser, durationOption) * 1000.0));
+    generator.setDrainTimeout(static_cast<unsigned long>(doubleValue(parser, drainTimeoutOption) * 1000.0));
+    generator.setSeed(static_cast<quint32>(unsignedValue(parser, seedOption)));
+    generator.setBatchingEnabled(parser.isSet(batchingOption));
+    generator.setHttp2Enabled(parser.isSet(http2Option));
+
+    if (parser.isSet(inFlightOption)) {
+        generator.setMaximumInFlight(static_cast<unsigned>(unsignedValue(parser, inFlightOption)));
+    }
+
+    QObject::connect(&generator, &LoadGenerator::finished, &application, &QCoreApplication::quit);
+    QTimer::singleShot(0, &generator, &LoadGenerator::start);
+
+    application.exec();
+    server.stop();
+
+    int status = 0;
+    if (parser.isSet(outputOption)) {
+        QFile               output(parser.value(outputOption));
+        bool                append = parser.isSet(appendOption);
+        QIODevice::OpenMode mode   = QIODevice::WriteOnly | (append ? QIODevice::Append : QIODevice::Truncate);
+
+        if (output.open(mode)) {
+            output.write(generator.report(format, !append || output.size() == 0));
+            output.close();
+        } else {
+            std::fprintf(stderr, "inewh_loadgen: Could not write %s\n", output.fileName().toLocal8Bit().constData());
+            status = 1;
+        }
+    } else {
+        QByteArray report = generator.report(format);
+        std::fwrite(report.constData(), 1, static_cast<std::size_t>(report.size()), stdout);
+    }
+
+    return status;
+}
@@ -0,0 +1,674 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements a local stand-in for the Inesonic webhook and timestamp servers.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QObject>
+#include <QThread>
+#include <QMetaObject>
+#include <QTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QByteArray>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QJsonDocument>
+
+#include <atomic>
+#include <random>
+#include <cstring>
+
+#include <zlib.h>
+
+#include <wh_web_hook_verifier.h>
+
+#include "stand_in_server.h"
+
+const QString StandInServer::defaultTimestampPath("/v2/ts");
+constexpr int StandInServer::defaultErrorStatusCode;
+
+/**
+ * Class that accepts connections and answers requests on the server thread.
+ */
+class StandInServer::Listener:public QTcpServer {
+    public:
+        /**
+         * Constructor
+         *
+         * \param[in] standInServer The server holding the configuration and counters.
+         */
+        Listener(StandInServer* standInServer):server(standInServer),random(standInServer->currentSeed) {}
+
+    protected:
+        /**
+         * Method that is called when a new connection arrives.
+         *
+         * \param[in] socketDescriptor The descriptor for the new connection.
+         */
+        void incomingConnection(qintptr socketDescriptor) override {
+            QTcpSocket* socket = new QTcpSocket(this);
+            if (socket->setSocketDescriptor(socketDescriptor)) {
+                server->currentConnectionsAccepted.fetch_add(1);
+                socket->setSocketOption(QAbstractSocket::SocketOption::LowDelayOption, 1);
+
+                connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() { processRequests(socket); });
+                connect(
+                    socket,
+                    &QTcpSocket::disconnected,
+                    socket,
+                    [this, socket]() {
+                        pending.remove(socket);
+                        socket->deleteLater();
+                    }
+                );
+            } else {
+                delete socket;
+            }
+        }
+
+    private:
+        /**
+         * Class that holds a parsed HTTP request.
+         */
+        class Request {
+            public:
+                /**
+                 * The request method.
+                 */
+                QByteArray method;
+
+                /**
+                 * The request path.
+                 */
+                QString path;
+
+                /**
+                 * The value of the Content-Type header.
+                 */
+                QByteArray contentType;
+
+                /**
+                 * The value of the Content-Encoding header.
+                 */
+                QByteArray contentEncoding;
+
+                /**
+                 * The value of the Idempotency-Key header.
+                 */
+                QByteArray idempotencyKey;
+
+                /**
+                 * Flag indicating the client asked for the connection to be closed.
+                 */
+                bool closeRequested;
+
+                /**
+                 * The request body.
+                 */
+                QByteArray body;
+        };
+
+        /**
+         * Method that answers every complete request received on a socket.
+         *
+         * \param[in] socket The socket holding the requests.
+         */
+        void processRequests(QTcpSocket* socket) {
+            QByteArray& buffer = pending[socket];
+            buffer.append(socket->readAll());
+
+            bool moreRequests = true;
+            while (moreRequests) {
+                Request request;
+                int     headerEnd = buffer.indexOf("\r\n\r\n");
+
+                if (headerEnd < 0) {
+                    moreRequests = false;
+                } else {
+                    int contentLength = parseHeader(buffer.left(headerEnd), request);
+
+                    int requestLength = headerEnd + 4 + contentLength;
+                    if (buffer.size() < requestLength) {
+                        moreRequests = false;
+                    } else {
+                        request.body = buffer.mid(headerEnd + 4, contentLength);
+                        buffer.remove(0, requestLength);
+
+                        respond(socket, request);
+                        moreRequests = !request.closeRequested;
+                    }
+                }
+            }
+        }
+
+        /**
+         * Method that parses a request line and headers.
+         *
+         * \param[in]  header  The request line and headers.
+         *
+         * \param[out] request The request to be populated.
+         *
+         * \return Returns the value of the Content-Length header.
+         */
+        static int parseHeader(const QByteArray& header, Request& request) {
+            int               contentLength = 0;
+            QList<QByteArray> lines         = header.split('\n');
+            QList<QByteArray> requestLine   = lines.first().trimmed().split(' ');
+
+            request.method         = requestLine.value(0);
+            request.path           = QString::fromUtf8(requestLine.value(1)).section('?', 0, 0);
+            request.closeRequested = false;
+
+            for (int i=1 ; i<lines.size() ; ++i) {
+                const QByteArray& line  = lines.at(i);
+                int               colon = line.indexOf(':');
+
+                if (colon > 0) {
+                    QByteArray name  = line.left(colon).trimmed().toLower();
+                    QByteArray value = line.mid(colon + 1).trimmed();
+
+                    if (name == "content-length") {
+                        contentLength = value.toInt();
+                    } else if (name == "content-type") {
+                        request.contentType = value.toLower().split(';').first().trimmed();
+                    } else if (name == "content-encoding") {
+                        request.contentEncoding = value.toLower();
+                    } else if (name == "idempotency-key") {
+                        request.idempotencyKey = value;
+                    } else if (name == "connection" && value.toLower() == "close") {
+                        request.closeRequested = true;
+                    }
+                }
+            }
+
+            return contentLength;
+        }
+
+        /**
+         * Method that answers a request.
+         *
+         * \param[in] socket  The socket that received the request.
+         *
+         * \param[in] request The request to be answered.
+         */
+        void respond(QTcpSocket* socket, const Request& request) {
+            int        statusCode  = 200;
+            QByteArray contentType = "application/json";
+            QByteArray extraHeaders;
+            QByteArray body;
+
+            if (!request.idempotencyKey.isEmpty() && request.path != server->currentTimestampPath) {
+                if (idempotencyKeys.contains(request.idempotencyKey)) {
+                    server->currentRepeatedIdempotencyKeys.fetch_add(1);
+                } else {
+                    idempotencyKeys.insert(request.idempotencyKey);
+                }
+            }
+
+            unsigned errorRatePpm = server->currentErrorRatePpm.load();
+            if (errorRatePpm > 0 && std::uniform_int_distribution<unsigned>(0, 999999)(random) < errorRatePpm) {
+                statusCode = server->currentErrorStatusCode.load();
+                body       = "{\"status\":\"failed\"}";
+
+                int retryAfter = server->currentRetryAfter.load();
+                if (retryAfter >= 0) {
+                    extraHeaders = "Retry-After: " + QByteArray::number(retryAfter) + "\r\n";
+                }
+
+                server->currentInjectedErrors.fetch_add(1);
+            } else if (request.method != "POST") {
+                statusCode = 405;
+            } else if (!server->currentVerificationEnabled.load()) {
+                body = "{\"status\":\"OK\"}";
+                server->currentMessagesAccepted.fetch_add(1);
+            } else if (request.path == server->currentTimestampPath) {
+                statusCode = timestampResponse(request, contentType, body);
+            } else {
+                statusCode = messageResponse(request, body);
+            }
+
+            QByteArray response = (
+                  "HTTP/1.1 " + QByteArray::number(statusCode) + ' ' + reasonPhrase(statusCode) + "\r\n"
+                + "Content-Type: " + contentType + "\r\n"
+                + "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                + extraHeaders
+                + (request.closeRequested ? "Connection: close\r\n" : "")
+                + "\r\n"
+                + body
+            );
+
+            server->currentRequestsServed.fetch_add(1);
+
+            bool     closeConnection = request.closeRequested;
+            unsigned latency         = server->currentLatency.load();
+            if (latency > 0) {
+                QTimer::singleShot(
+                    static_cast<int>(latency),
+                    socket,
+                    [socket, response, closeConnection]() {
+                        socket->write(response);
+                        if (closeConnection) {
+                            socket->disconnectFromHost();
+                        }
+                    }
+                );
+            } else {
+                socket->write(response);
+                if (closeConnection) {
+                    socket->disconnectFromHost();
+                }
+            }
+        }
+
+        /**
+         * Method that answers a timestamp request.
+         *
+         * \param[in]  request     The request to be answered.
+         *
+         * \param[out] contentType The content type of the response.
+         *
+         * \param[out] body        The response body.
+         *
+         * \return Returns the HTTP status code.
+         */
+        int timestampResponse(const Request& request, QByteArray& contentType, QByteArray& body) {
+            int                         result;
+            Wh::WebHookVerifier::Result verification = server->verifier.verifyTimestamp(
+                decodedBody(request),
+                QString::fromLatin1(request.contentType)
+            );
+
+            if (verification.status() == Wh::WebHookVerifier::Status::MALFORMED) {
+                result = 400;
+            } else if (!verification.isValid()) {
+                result = 403;
+                server->currentSignatureFailures.fetch_add(1);
+            } else {
+                result      = 200;
+                contentType = "text/plain";
+                body        = QByteArray::number(server->verifier.clockOffset(verification));
+
+                server->currentTimestampRequests.fetch_add(1);
+            }
+
+            return result;
+        }
+
+        /**
+         * Method that answers a message.
+         *
+         * \param[in]  request The request to be answered.
+         *
+         * \param[out] body    The response body.
+         *
+         * \return Returns the HTTP status code.
+         */
+        int messageResponse(const Request& request, QByteArray& body) {
+            int result;
+
+            if (request.contentType == "application/cbor" && !server->currentCborAccepted.load()) {
+                result = 415;
+            } else if (!request.contentEncoding.isEmpty()         &&
+                       request.contentEncoding != "identity"      &&
+                       request.contentEncoding != "deflate"       &&
+                       request.contentEncoding != "gzip"             ) {
+                result = 415;
+            } else {
+                Wh::WebHookVerifier::Result verification = server->verifier.verify(
+                    decodedBody(request),
+                    QString::fromLatin1(request.contentType)
+                );
+
+                if (verification.status() == Wh::WebHookVerifier::Status::MALFORMED) {
+                    result = 400;
+                } else if (verification.isValid()) {
+                    const QByteArray& data    = verification.payload();
+                    QJsonDocument     payload = QJsonDocument::fromJson(data);
+
+                    result = 200;
+                    body   = payload.isNull() ? QByteArray("{\"status\":\"OK\"}") : data;
+
+                    server->currentMessagesAccepted.fetch_add(1);
+                    if (!request.contentEncoding.isEmpty() && request.contentEncoding != "identity") {
+                        server->currentCompressedMessages.fetch_add(1);
+                    }
+                } else {
+                    result = 403;
+                    server->currentSignatureFailures.fetch_add(1);
+                }
+            }
+
+            return result;
+        }
+
+        /**
+         * Method that undoes the content encoding of a request body.
+         *
+         * \param[in] request The request holding the body.
+         *
+         * \return Returns the decoded body.  An empty array is returned if the body could not be decoded.
+         */
+        static QByteArray decodedBody(const Request& request) {
+            QByteArray result = request.body;
+
+            if (request.contentEncoding == "deflate") {
+                // qUncompress expects a zlib stream preceded by a size hint.  A hint of 0 lets it size the output.
+                result = qUncompress(QByteArray(4, '\0') + result);
+            } else if (request.contentEncoding == "gzip") {
+                result = gunzip(request.body);
+            }
+
+            return result;
+        }
+
+        /**
+         * Method that decodes a single gzip member.  Qt only handles zlib streams so zlib is used directly.  The
+         * CRC-32 and length in the gzip trailer are checked by zlib.
+         *
+         * \param[in] data The gzip member.
+         *
+         * \return Returns the decoded data.  An empty array is returned if the member is malformed or truncated.
+         */
+        static QByteArray gunzip(const QByteArray& data) {
+            QByteArray result;
+
+            z_stream stream;
+            std::memset(&stream, 0, sizeof(stream));
+
+            // Adding 16 to the window size tells zlib to expect a gzip header and trailer rather than a zlib one.
+            if (inflateInit2(&stream, 16 + MAX_WBITS) == Z_OK) {
+                stream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+                stream.avail_in = static_cast<uInt>(data.size());
+
+                char buffer[4096];
+                int  status;
+                do {
+                    stream.next_out  = reinterpret_cast<Bytef*>(buffer);
+                    stream.avail_out = sizeof(buffer);
+
+                    status = inflate(&stream, Z_NO_FLUSH);
+                    if (status == Z_OK || status == Z_STREAM_END) {
+                        result.append(buffer, static_cast<int>(sizeof(buffer) - stream.avail_out));
+                    }
+                } while (status == Z_OK);
+
+                inflateEnd(&stream);
+
+                if (status != Z_STREAM_END) {
+                    result.clear();
+                }
+            }
+
+            return result;
+        }
+
+        /**
+         * Method that returns the reason phrase for a status code.
+         *
+         * \param[in] statusCode The status code.
+         *
+         * \return Returns the reason phrase.
+         */
+        static QByteArray reasonPhrase(int statusCode) {
+            QByteArray result;
+
+            switch (statusCode) {
+                case 200: { result = "OK";                     break; }
+                case 400: { result = "Bad Request";            break; }
+                case 403: { result = "Forbidden";              break; }
+                case 405: { result = "Method Not Allowed";     break; }
+                case 415: { result = "Unsupported Media Type"; break; }
+                case 429: { result = "Too Many Requests";      break; }
+                case 500: { result = "Internal Server Error";  break; }
+                case 503: { result = "Service Unavailable";    break; }
+                default:  { result = "Unknown";                break; }
+            }
+
+            return result;
+        }
+
+        /**
+         * The server holding the configuration and counters.
+         */
+        StandInServer* server;
+
+        /**
+         * The random number generator used for error injection.
+         */
+        std::mt19937 random;
+
+        /**
+         * Partially received requests, by socket.
+         */
+        QHash<QTcpSocket*, QByteArray> pending;
+
+        /**
+         * The idempotency keys received so far.
+         */
+        QSet<QByteArray> idempotencyKeys;
+};
+
+
+StandInServer::StandInServer(
+        const QByteArray& webhookSecret,
+        const QByteArray& timestampSecret,
+        const QString&    timestampPath
+    ):verifier(
+        webhookSecret,
+        timestampSecret
+    ),currentTimestampPath(
+        timestampPath
+    ) {
+    serverThread = Q_NULLPTR;
+    currentPort  = 0;
+    currentSeed  = 1;
+
+    currentVerificationEnabled.store(true);
+    currentCborAccepted.store(true);
+    currentLatency.store(0);
+    currentErrorRatePpm.store(0);
+    currentErrorStatusCode.store(defaultErrorStatusCode);
+    currentRetryAfter.store(-1);
+
+    resetCounters();
+}
+
+
+StandInServer::~StandInServer() {
+    stop();
+}
+
+
+bool StandInServer::start() {
+    stop();
+    resetCounters();
+
+    serverThread = new QThread;
+    serverThread->start();
+
+    Listener* listener = new Listener(this);
+    listener->moveToThread(serverThread);
+    QObject::connect(serverThread, &QThread::finished, listener, &QObject::deleteLater);
+
+    quint16 listeningPort = 0;
+    QMetaObject::invokeMethod(
+        listener,
+        [listener, &listeningPort]() {
+            if (listener->listen(QHostAddress::LocalHost, 0)) {
+                listeningPort = listener->serverPort();
+            }
+        },
+        Qt::BlockingQueuedConnection
+    );
+
+    currentPort = listeningPort;
+    if (currentPort == 0) {
+        stop();
+    }
+
+    return currentPort != 0;
+}
+
+
+void StandInServer::stop() {
+    if (serverThread != Q_NULLPTR) {
+        serverThread->quit();
+        serverThread->wait();
+
+        delete serverThread;
+        serverThread = Q_NULLPTR;
+    }
+
+    currentPort = 0;
+}
+
+
+quint16 StandInServer::port() const {
+    return currentPort;
+}
+
+
+QUrl StandInServer::url(const QString& path) const {
+    QUrl result;
+    result.setScheme(QString("http"));
+    result.setHost(QString("127.0.0.1"));
+    result.setPort(currentPort);
+    result.setPath(path);
+
+    return result;
+}
+
+
+QUrl StandInServer::timestampUrl() const {
+    return url(currentTimestampPath);
+}
+
+
+void StandInServer::setVerificationEnabled(bool nowEnabled) {
+    currentVerificationEnabled.store(nowEnabled);
+}
+
+
+bool StandInServer::verificationEnabled() const {
+    return currentVerificationEnabled.load();
+}
+
+
+void StandInServer::setLatency(unsigned latencyMsec) {
+    currentLatency.store(latencyMsec);
+}
+
+
+unsigned StandInServer::latency() const {
+    return currentLatency.load();
+}
+
+
+void StandInServer::setErrorRate(double rate, int statusCode, int retryAfter) {
+    currentErrorRatePpm.store(static_cast<unsigned>(qBound(0.0, rate, 1.0) * 1000000.0 + 0.5));
+    currentErrorStatusCode.store(statusCode);
+    currentRetryAfter.store(retryAfter);
+}
+
+
+double StandInServer::errorRate() const {
+    return currentErrorRatePpm.load() / 1000000.0;
+}
+
+
+void StandInServer::setClockSkew(long long skewMsec) {
+    verifier.setTimeDelta(skewMsec);
+}
+
+
+long long StandInServer::clockSkew() const {
+    return verifier.timeDelta();
+}
+
+
+void StandInServer::setCborAccepted(bool nowAccepted) {
+    currentCborAccepted.store(nowAccepted);
+}
+
+
+bool StandInServer::cborAccepted() const {
+    return currentCborAccepted.load();
+}
+
+
+void StandInServer::setSeed(quint32 newSeed) {
+    currentSeed = newSeed;
+}
+
+
+unsigned long long StandInServer::connectionsAccepted() const {
+    return currentConnectionsAccepted.load();
+}
+
+
+unsigned long long StandInServer::requestsServed() const {
+    return currentRequestsServed.load();
+}
+
+
+unsigned long long StandInServer::messagesAccepted() const {
+    return currentMessagesAccepted.load();
+}
+
+
+unsigned long long StandInServer::compressedMessagesAccepted() const {
+    return currentCompressedMessages.load();
+}
+
+
+unsigned long long StandInServer::signatureFailures() const {
+    return currentSignatureFailures.load();
+}
+
+
+unsigned long long StandInServer::injectedErrors() const {
+    return currentInjectedErrors.load();
+}
+
+
+unsigned long long StandInServer::timestampRequests() const {
+    return currentTimestampRequests.load();
+}
+
+
+unsigned long long StandInServer::repeatedIdempotencyKeys() const {
+    return currentRepeatedIdempotencyKeys.load();
+}
+
+
+void StandInServer::resetCounters() {
+    currentConnectionsAccepted.store(0);
+    currentRequestsServed.store(0);
+    currentMessagesAccepted.store(0);
+    currentCompressedMessages.store(0);
+    currentSignatureFailures.store(0);
+    currentInjectedErrors.store(0);
+    currentTimestampRequests.store(0);
+    currentRepeatedIdempotencyKeys.store(0);
+}
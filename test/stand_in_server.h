@@ -0,0 +1,364 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header provides a local stand-in for the Inesonic webhook and timestamp servers.
+***********************************************************************************************************************/
+
+#ifndef STAND_IN_SERVER_H
+#define STAND_IN_SERVER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+
+#include <atomic>
+
+#include <wh_web_hook_verifier.h>
+
+class QThread;
+
+/**
+ * Class that runs a local stand-in for the Inesonic webhook and timestamp servers so the webhook can be tested
+ * offline and driven at high rates.  The server listens on the loopback interface on its own thread.
+ *
+ * Requests to the timestamp path are checked against the timestamp secret and answered with the difference, in
+ * milliseconds, between the server clock and the time reported by the client.  Requests to any other path are
+ * treated as messages.  Envelopes are checked with a \ref Wh::WebHookVerifier using the server's clock and the
+ * decoded payload is echoed back.  A bad signature is answered with a 403, just like the production servers.
+ *
+ * Both JSON and CBOR envelopes are accepted, as are bodies compressed with deflate or gzip.  Other content encodings
+ * are answered with a 415.
+ *
+ * Latency, error injection, and clock skew can be adjusted at any time so retry and time delta handling can be
+ * exercised deterministically.
+ */
+class StandInServer {
+    public:
+        /**
+         * The default path used for timestamp requests.
+         */
+        static const QString defaultTimestampPath;
+
+        /**
+         * The default HTTP status code used for injected errors.
+         */
+        static constexpr int defaultErrorStatusCode = 503;
+
+        /**
+         * Constructor
+         *
+         * \param[in] webhookSecret   The secret used to verify messages.
+         *
+         * \param[in] timestampSecret The secret used to verify timestamp requests.
+         *
+         * \param[in] timestampPath   The path used for timestamp requests.
+         */
+        StandInServer(
+            const QByteArray& webhookSecret,
+            const QByteArray& timestampSecret,
+            const QString&    timestampPath = defaultTimestampPath
+        );
+
+        ~StandInServer();
+
+        /**
+         * Method you can use to start the server on an ephemeral port.  The counters are reset and the random
+         * number generator used for error injection is re-seeded.
+         *
+         * \return Returns true on success.  Returns false if the server could not listen.
+         */
+        bool start();
+
+        /**
+         * Method you can use to stop the server.
+         */
+        void stop();
+
+        /**
+         * Method you can use to obtain the port the server is listening on.
+         *
+         * \return Returns the port.  A value of 0 is returned if the server is not running.
+         */
+        quint16 port() const;
+
+        /**
+         * Method you can use to build a URL on this server.
+         *
+         * \param[in] path The path portion of the URL.
+         *
+         * \return Returns the URL.
+         */
+        QUrl url(const QString& path) const;
+
+        /**
+         * Method you can use to obtain the URL used for timestamp requests.
+         *
+         * \return Returns the timestamp URL.
+         */
+        QUrl timestampUrl() const;
+
+        /**
+         * Method you can use to enable or disable checking of signatures.  With checking disabled, every request
+         * is answered with a 200 and a small fixed body so benchmarks measure the client rather than the server.
+         *
+         * \param[in] nowEnabled If true, signatures are checked.  If false, signatures are ignored.
+         */
+        void setVerificationEnabled(bool nowEnabled = true);
+
+        /**
+         * Method you can use to determine if signatures are checked.
+         *
+         * \return Returns true if signatures are checked.
+         */
+        bool verificationEnabled() const;
+
+        /**
+         * Method you can use to delay every response.
+         *
+         * \param[in] latencyMsec The delay applied to every response, in milliseconds.
+         */
+        void setLatency(unsigned latencyMsec);
+
+        /**
+         * Method you can use to obtain the delay applied to every response.
+         *
+         * \return Returns the delay, in milliseconds.
+         */
+        unsigned latency() const;
+
+        /**
+         * Method you can use to inject errors.
+         *
+         * \param[in] rate       The fraction of requests, from 0 to 1, answered with an error.
+         *
+         * \param[in] statusCode The HTTP status code used for injected errors.
+         *
+         * \param[in] retryAfter The value of the Retry-After header sent with injected errors, in seconds.  A
+         *                       negative value omits the header.
+         */
+        void setErrorRate(double rate, int statusCode = defaultErrorStatusCode, int retryAfter = -1);
+
+        /**
+         * Method you can use to obtain the fraction of requests answered with an error.
+         *
+         * \return Returns the error rate, from 0 to 1.
+         */
+        double errorRate() const;
+
+        /**
+         * Method you can use to skew the server clock relative to the local clock.
+         *
+         * \param[in] skewMsec The skew, in milliseconds.  Positive values place the server clock ahead of the local
+         *                     clock.
+         */
+        void setClockSkew(long long skewMsec);
+
+        /**
+         * Method you can use to obtain the server clock skew.
+         *
+         * \return Returns the skew, in milliseconds.
+         */
+        long long clockSkew() const;
+
+        /**
+         * Method you can use to control whether CBOR envelopes are accepted.  Rejected CBOR envelopes are answered
+         * with a 415.
+         *
+         * \param[in] nowAccepted If true, CBOR envelopes are accepted.
+         */
+        void setCborAccepted(bool nowAccepted = true);
+
+        /**
+         * Method you can use to determine if CBOR envelopes are accepted.
+         *
+         * \return Returns true if CBOR envelopes are accepted.
+         */
+        bool cborAccepted() const;
+
+        /**
+         * Method you can use to set the seed used for error injection.  The seed takes effect when the server is
+         * started.
+         *
+         * \param[in] newSeed The new seed.
+         */
+        void setSeed(quint32 newSeed);
+
+        /**
+         * Method you can use to obtain the number of connections accepted.
+         *
+         * \return Returns the number of connections accepted.
+         */
+        unsigned long long connectionsAccepted() const;
+
+        /**
+         * Method you can use to obtain the number of requests answered.
+         *
+         * \return Returns the number of requests answered.
+         */
+        unsigned long long requestsServed() const;
+
+        /**
+         * Method you can use to obtain the number of messages accepted.
+         *
+         * \return Returns the number of messages answered with a 200.
+         */
+        unsigned long long messagesAccepted() const;
+
+        /**
+         * Method you can use to obtain the number of accepted messages that arrived with a compressed body.
+         *
+         * \return Returns the number of compressed messages answered with a 200.
+         */
+        unsigned long long compressedMessagesAccepted() const;
+
+        /**
+         * Method you can use to obtain the number of requests rejected due to a bad signature.
+         *
+         * \return Returns the number of requests answered with a 403.
+         */
+        unsigned long long signatureFailures() const;
+
+        /**
+         * Method you can use to obtain the number of injected errors.
+         *
+         * \return Returns the number of requests answered with an injected error.
+         */
+        unsigned long long injectedErrors() const;
+
+        /**
+         * Method you can use to obtain the number of valid timestamp requests.
+         *
+         * \return Returns the number of timestamp requests answered with a 200.
+         */
+        unsigned long long timestampRequests() const;
+
+        /**
+         * Method you can use to obtain the number of requests carrying an idempotency key seen before.
+         *
+         * \return Returns the number of requests with a repeated idempotency key.
+         */
+        unsigned long long repeatedIdempotencyKeys() const;
+
+        /**
+         * Method you can use to reset the counters.
+         */
+        void resetCounters();
+
+    private:
+        class Listener;
+
+        /**
+         * The verifier used to check messages and timestamp requests.  The verifier time delta holds the server
+         * clock skew.
+         */
+        Wh::WebHookVerifier verifier;
+
+        /**
+         * The path used for timestamp requests.
+         */
+        const QString currentTimestampPath;
+
+        /**
+         * The thread running the server.
+         */
+        QThread* serverThread;
+
+        /**
+         * The port the server is listening on.
+         */
+        quint16 currentPort;
+
+        /**
+         * The seed used for error injection.
+         */
+        quint32 currentSeed;
+
+        /**
+         * Flag indicating if signatures are checked.
+         */
+        std::atomic<bool> currentVerificationEnabled;
+
+        /**
+         * Flag indicating if CBOR envelopes are accepted.
+         */
+        std::atomic<bool> currentCborAccepted;
+
+        /**
+         * The delay applied to every response, in milliseconds.
+         */
+        std::atomic<unsigned> currentLatency;
+
+        /**
+         * The fraction of requests answered with an error, in parts per million.
+         */
+        std::atomic<unsigned> currentErrorRatePpm;
+
+        /**
+         * The HTTP status code used for injected errors.
+         */
+        std::atomic<int> currentErrorStatusCode;
+
+        /**
+         * The Retry-After value sent with injected errors, in seconds.
+         */
+        std::atomic<int> currentRetryAfter;
+
+        /**
+         * The number of connections accepted.
+         */
+        std::atomic<unsigned long long> currentConnectionsAccepted;
+
+        /**
+         * The number of requests answered.
+         */
+        std::atomic<unsigned long long> currentRequestsServed;
+
+        /**
+         * The number of messages accepted.
+         */
+        std::atomic<unsigned long long> currentMessagesAccepted;
+
+        /**
+         * The number of accepted messages that arrived with a compressed body.
+         */
+        std::atomic<unsigned long long> currentCompressedMessages;
+
+        /**
+         * The number of requests rejected due to a bad signature.
+         */
+        std::atomic<unsigned long long> currentSignatureFailures;
+
+        /**
+         * The number of injected errors.
+         */
+        std::atomic<unsigned long long> currentInjectedErrors;
+
+        /**
+         * The number of valid timestamp requests.
+         */
+        std::atomic<unsigned long long> currentTimestampRequests;
+
+        /**
+         * The number of requests carrying an idempotency key seen before.
+         */
+        std::atomic<unsigned long long> currentRepeatedIdempotencyKeys;
+};
+
+#endif
@@ -25,11 +25,41 @@ QT += core testlib gui widgets network
 CONFIG += testcase c++14
 
 HEADERS = application_wrapper.h \
+          stand_in_server.h \
+          test_base64.h \
+          test_circuit_breaker.h \
+          test_compressor.h \
+          test_envelope_stream.h \
+          test_envelope_writer.h \
+          test_flow_control.h \
+          test_metrics.h \
+          test_response.h \
+          test_retry_policy.h \
+          test_signing_key_cache.h \
+          test_spool.h \
+          test_submission_queue.h \
+          test_time_sync.h \
           test_web_hook.h \
+          test_web_hook_verifier.h \
 
 SOURCES = test_inewh.cpp \
           application_wrapper.cpp \
+          stand_in_server.cpp \
+          test_base64.cpp \
+          test_circuit_breaker.cpp \
+          test_compressor.cpp \
+          test_envelope_stream.cpp \
+          test_envelope_writer.cpp \
+          test_flow_control.cpp \
+          test_metrics.cpp \
+          test_response.cpp \
+          test_retry_policy.cpp \
+          test_signing_key_cache.cpp \
+          test_spool.cpp \
+          test_submission_queue.cpp \
+          test_time_sync.cpp \
           test_web_hook.cpp \
+          test_web_hook_verifier.cpp \
 
 ########################################################################################################################
 # Libraries
@@ -41,9 +71,11 @@ defined(SETTINGS_PRI, var) {
 
 INEWH_BASE = $${OUT_PWD}/../inewh
 INCLUDEPATH += $${PWD}/../inewh/include
+INCLUDEPATH += $${PWD}/../inewh/source
 
 INCLUDEPATH += $${INECRYPTO_INCLUDE}
 INCLUDEPATH += $${BOOST_INCLUDE}
+INCLUDEPATH += $${ZLIB_INCLUDE}
 
 unix {
     CONFIG(debug, debug|release) {
@@ -55,6 +87,7 @@ unix {
     }
 
     LIBS += -L$${INECRYPTO_LIBDIR} -linecrypto
+    LIBS += -lz
 }
 
 win32 {
@@ -67,6 +100,7 @@ win32 {
     }
 
     LIBS += $${INECRYPTO_LIBDIR}/inecrypto.lib
+    LIBS += $${ZLIB_LIBDIR}/zlib.lib
 }
 
 ########################################################################################################################
@@ -0,0 +1,185 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::Base64 class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QByteArray>
+
+#include <wh_base64.h>
+
+#include "test_base64.h"
+
+Q_DECLARE_METATYPE(Wh::Base64::Implementation)
+
+TestBase64::TestBase64() {}
+
+
+TestBase64::~TestBase64() {}
+
+
+void TestBase64::initTestCase() {}
+
+
+void TestBase64::testEncode_data() {
+    implementations();
+}
+
+
+void TestBase64::testEncode() {
+    QFETCH(Wh::Base64::Implementation, implementation);
+
+    if (!Wh::Base64::isSupported(implementation)) {
+        QSKIP("Implementation not supported by this processor.");
+    }
+
+    Wh::Base64::Implementation originalImplementation = Wh::Base64::implementation();
+    QCOMPARE(Wh::Base64::setImplementation(implementation), true);
+
+    for (unsigned size=0 ; size<300 ; ++size) {
+        QByteArray data = payload(size, size);
+        QCOMPARE(Wh::Base64::encode(data), data.toBase64());
+    }
+
+    QByteArray large = payload(1048579, 7);
+    QCOMPARE(Wh::Base64::encode(large), large.toBase64());
+
+    Wh::Base64::setImplementation(originalImplementation);
+}
+
+
+void TestBase64::testDecode_data() {
+    implementations();
+}
+
+
+void TestBase64::testDecode() {
+    QFETCH(Wh::Base64::Implementation, implementation);
+
+    if (!Wh::Base64::isSupported(implementation)) {
+        QSKIP("Implementation not supported by this processor.");
+    }
+
+    Wh::Base64::Implementation originalImplementation = Wh::Base64::implementation();
+    QCOMPARE(Wh::Base64::setImplementation(implementation), true);
+
+    for (unsigned size=0 ; size<300 ; ++size) {
+        QByteArray data    = payload(size, size + 1000);
+        QByteArray encoded = data.toBase64();
+
+        bool ok = false;
+        QCOMPARE(Wh::Base64::decode(encoded, &ok), QByteArray::fromBase64(encoded));
+        QCOMPARE(ok, true);
+
+        QByteArray unpadded = data.toBase64(QByteArray::Base64Option::OmitTrailingEquals);
+        QCOMPARE(Wh::Base64::decode(unpadded, &ok, true), data);
+        QCOMPARE(ok, true);
+
+        if (unpadded.size() != encoded.size()) {
+            QCOMPARE(Wh::Base64::decode(unpadded, &ok), QByteArray());
+            QCOMPARE(ok, false);
+        }
+    }
+
+    QByteArray large = payload(1048579, 11);
+    QCOMPARE(Wh::Base64::decode(large.toBase64()), large);
+
+    Wh::Base64::setImplementation(originalImplementation);
+}
+
+
+void TestBase64::testMalformed_data() {
+    implementations();
+}
+
+
+void TestBase64::testMalformed() {
+    QFETCH(Wh::Base64::Implementation, implementation);
+
+    if (!Wh::Base64::isSupported(implementation)) {
+        QSKIP("Implementation not supported by this processor.");
+    }
+
+    Wh::Base64::Implementation originalImplementation = Wh::Base64::implementation();
+    QCOMPARE(Wh::Base64::setImplementation(implementation), true);
+
+    QByteArray encoded = payload(240, 3).toBase64();
+    for (unsigned i=0 ; i<static_cast<unsigned>(encoded.size()) ; i+=7) {
+        QByteArray corrupted = encoded;
+        corrupted[i] = '!';
+
+        bool ok = true;
+        QCOMPARE(Wh::Base64::decode(corrupted, &ok), QByteArray());
+        QCOMPARE(ok, false);
+    }
+
+    bool ok = true;
+    Wh::Base64::decode(QByteArray("QUJD="), &ok);
+    QCOMPARE(ok, false);
+
+    Wh::Base64::decode(QByteArray("Q==="), &ok);
+    QCOMPARE(ok, false);
+
+    // Unpadded groups are only accepted when asked for.
+    Wh::Base64::decode(QByteArray("QQ"), &ok);
+    QCOMPARE(ok, false);
+
+    Wh::Base64::decode(QByteArray("QUI"), &ok);
+    QCOMPARE(ok, false);
+
+    QCOMPARE(Wh::Base64::decode(QByteArray("QUI"), &ok, true), QByteArray("AB"));
+    QCOMPARE(ok, true);
+
+    // Unused bits must be zero, padded or not.
+    Wh::Base64::decode(QByteArray("QR=="), &ok);
+    QCOMPARE(ok, false);
+
+    Wh::Base64::decode(QByteArray("QR"), &ok, true);
+    QCOMPARE(ok, false);
+
+    Wh::Base64::setImplementation(originalImplementation);
+}
+
+
+void TestBase64::cleanupTestCase() {}
+
+
+void TestBase64::implementations() {
+    QTest::addColumn<Wh::Base64::Implementation>("implementation");
+
+    QTest::newRow("scalar") << Wh::Base64::Implementation::SCALAR;
+    QTest::newRow("SSSE3") << Wh::Base64::Implementation::SSSE3;
+    QTest::newRow("AVX2") << Wh::Base64::Implementation::AVX2;
+}
+
+
+QByteArray TestBase64::payload(unsigned size, unsigned seed) {
+    QByteArray result(static_cast<int>(size), Qt::Uninitialized);
+
+    unsigned v = seed * 2654435761U + 1;
+    for (unsigned i=0 ; i<size ; ++i) {
+        v = v * 1103515245 + 12345;
+        result[i] = static_cast<char>(v >> 24);
+    }
+
+    return result;
+}
@@ -0,0 +1,121 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::CircuitBreaker class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QString>
+
+#include <wh_circuit_breaker.h>
+
+#include "test_circuit_breaker.h"
+
+TestCircuitBreaker::TestCircuitBreaker() {}
+
+
+TestCircuitBreaker::~TestCircuitBreaker() {}
+
+
+void TestCircuitBreaker::initTestCase() {}
+
+
+void TestCircuitBreaker::testThreshold() {
+    Wh::CircuitBreaker circuitBreaker(3, 1000);
+
+    QString destination("https://example.com/hook");
+    QString other("https://example.com/other");
+
+    QCOMPARE(circuitBreaker.allow(destination, 1000), true);
+
+    // A success between failures restarts the count.
+    circuitBreaker.record(destination, false, 1000, 2000);
+    circuitBreaker.record(destination, false, 1000, 2000);
+    circuitBreaker.record(destination, true, 1000, 2000);
+    circuitBreaker.record(destination, false, 1000, 3000);
+    circuitBreaker.record(destination, false, 1000, 3000);
+    QCOMPARE(circuitBreaker.state(destination), Wh::CircuitBreaker::State::CLOSED);
+
+    circuitBreaker.record(destination, false, 1000, 4000);
+    QCOMPARE(circuitBreaker.state(destination), Wh::CircuitBreaker::State::OPEN);
+    QCOMPARE(circuitBreaker.allow(destination, 5000), false);
+
+    // Circuits are kept per URL.
+    QCOMPARE(circuitBreaker.state(other), Wh::CircuitBreaker::State::CLOSED);
+    QCOMPARE(circuitBreaker.allow(other, 5000), true);
+
+    circuitBreaker.reset(destination);
+    QCOMPARE(circuitBreaker.state(destination), Wh::CircuitBreaker::State::CLOSED);
+    QCOMPARE(circuitBreaker.allow(destination, 5000), true);
+}
+
+
+void TestCircuitBreaker::testProbe() {
+    Wh::CircuitBreaker circuitBreaker(1, 1000);
+
+    QString destination("https://example.com/hook");
+
+    circuitBreaker.record(destination, false, 0, 1000);
+    QCOMPARE(circuitBreaker.allow(destination, 500000), false);
+
+    // After the open duration a single probe is allowed.
+    QCOMPARE(circuitBreaker.allow(destination, 1001000), true);
+    QCOMPARE(circuitBreaker.state(destination), Wh::CircuitBreaker::State::HALF_OPEN);
+    QCOMPARE(circuitBreaker.allow(destination, 1002000), false);
+
+    // A failed probe opens the circuit again.
+    circuitBreaker.record(destination, false, 1001000, 1100000);
+    QCOMPARE(circuitBreaker.state(destination), Wh::CircuitBreaker::State::OPEN);
+    QCOMPARE(circuitBreaker.allow(destination, 1200000), false);
+
+    // A lost probe is replaced after another open duration.
+    QCOMPARE(circuitBreaker.allow(destination, 2100000), true);
+    QCOMPARE(circuitBreaker.allow(destination, 2200000), false);
+    QCOMPARE(circuitBreaker.allow(destination, 3100000), true);
+
+    // A successful probe closes the circuit.
+    circuitBreaker.record(destination, true, 3100000, 3200000);
+    QCOMPARE(circuitBreaker.state(destination), Wh::CircuitBreaker::State::CLOSED);
+    QCOMPARE(circuitBreaker.allow(destination, 3300000), true);
+}
+
+
+void TestCircuitBreaker::testLateResponses() {
+    Wh::CircuitBreaker circuitBreaker(1, 1000);
+
+    QString destination("https://example.com/hook");
+
+    circuitBreaker.record(destination, false, 0, 1000);
+    QCOMPARE(circuitBreaker.allow(destination, 1001000), true);
+
+    // Responses to requests sent before the probe do not decide the probe's outcome.
+    circuitBreaker.record(destination, true, 500, 1002000);
+    QCOMPARE(circuitBreaker.state(destination), Wh::CircuitBreaker::State::HALF_OPEN);
+
+    circuitBreaker.record(destination, false, 500, 1003000);
+    QCOMPARE(circuitBreaker.state(destination), Wh::CircuitBreaker::State::HALF_OPEN);
+
+    circuitBreaker.record(destination, true, 1001000, 1004000);
+    QCOMPARE(circuitBreaker.state(destination), Wh::CircuitBreaker::State::CLOSED);
+}
+
+
+void TestCircuitBreaker::cleanupTestCase() {}
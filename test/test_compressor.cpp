@@ -0,0 +1,116 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::Compressor class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QtEndian>
+#include <QByteArray>
+
+#include <wh_crc32.h>
+#include <wh_compressor.h>
+
+#include "test_compressor.h"
+
+TestCompressor::TestCompressor() {}
+
+
+TestCompressor::~TestCompressor() {}
+
+
+void TestCompressor::initTestCase() {}
+
+
+void TestCompressor::testDeflate() {
+    QByteArray data       = payload();
+    QByteArray compressed = Wh::Compressor::compress(data, Wh::Compressor::Format::DEFLATE);
+
+    QVERIFY(!compressed.isEmpty());
+    QVERIFY(compressed.size() < data.size());
+    QCOMPARE(Wh::Compressor::contentEncoding(Wh::Compressor::Format::DEFLATE), QByteArray("deflate"));
+
+    // qUncompress expects the uncompressed length ahead of the zlib stream.
+    QByteArray prefixed(4, '\0');
+    qToBigEndian<quint32>(static_cast<quint32>(data.size()), reinterpret_cast<uchar*>(prefixed.data()));
+    prefixed.append(compressed);
+
+    QCOMPARE(qUncompress(prefixed), data);
+}
+
+
+void TestCompressor::testGzip() {
+    QByteArray data    = payload();
+    QByteArray deflate = Wh::Compressor::compress(data, Wh::Compressor::Format::DEFLATE, 9);
+    QByteArray gzip    = Wh::Compressor::compress(data, Wh::Compressor::Format::GZIP, 9);
+
+    QCOMPARE(Wh::Compressor::contentEncoding(Wh::Compressor::Format::GZIP), QByteArray("gzip"));
+
+    const uchar* p = reinterpret_cast<const uchar*>(gzip.constData());
+    QCOMPARE(gzip.size(), deflate.size() - 6 + 18);
+    QCOMPARE(p[0], static_cast<uchar>(0x1F));
+    QCOMPARE(p[1], static_cast<uchar>(0x8B));
+    QCOMPARE(p[2], static_cast<uchar>(0x08));
+    QCOMPARE(p[3], static_cast<uchar>(0x00));
+    QCOMPARE(p[8], static_cast<uchar>(0x02));
+
+    // The gzip member carries the raw deflate data found inside the zlib stream.
+    QCOMPARE(gzip.mid(10, gzip.size() - 18), deflate.mid(2, deflate.size() - 6));
+
+    quint32 expectedCrc = Wh::Crc32::update(
+        0,
+        reinterpret_cast<const uchar*>(data.constData()),
+        static_cast<unsigned>(data.size())
+    );
+
+    const uchar* trailer = p + gzip.size() - 8;
+    QCOMPARE(qFromLittleEndian<quint32>(trailer), expectedCrc);
+    QCOMPARE(qFromLittleEndian<quint32>(trailer + 4), static_cast<quint32>(data.size()));
+
+    QByteArray check("123456789");
+    QCOMPARE(
+        Wh::Crc32::update(0, reinterpret_cast<const uchar*>(check.constData()), static_cast<unsigned>(check.size())),
+        0xCBF43926U
+    );
+}
+
+
+void TestCompressor::testEmpty() {
+    QVERIFY(Wh::Compressor::compress(QByteArray(), Wh::Compressor::Format::DEFLATE).isEmpty());
+    QVERIFY(Wh::Compressor::compress(QByteArray(), Wh::Compressor::Format::GZIP).isEmpty());
+}
+
+
+void TestCompressor::cleanupTestCase() {}
+
+
+QByteArray TestCompressor::payload() {
+    QByteArray result;
+    for (unsigned i=0 ; i<200 ; ++i) {
+        result.append("{\"sensor\":\"temperature\",\"index\":");
+        result.append(QByteArray::number(i));
+        result.append(",\"value\":");
+        result.append(QByteArray::number(20.0 + (i % 17) * 0.25));
+        result.append("}");
+    }
+
+    return result;
+}
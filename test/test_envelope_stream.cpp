@@ -0,0 +1,146 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::EnvelopeStream class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QBuffer>
+
+#include <wh_envelope_writer.h>
+#include <wh_signing_key_cache.h>
+#include <wh_envelope_stream.h>
+
+#include "test_envelope_stream.h"
+
+static QByteArray makePayload(unsigned length) {
+    QByteArray result(static_cast<int>(length), '\0');
+    for (unsigned i=0 ; i<length ; ++i) {
+        result[i] = static_cast<char>(i * 13 + (i >> 8));
+    }
+
+    return result;
+}
+
+
+static QByteArray readAll(QIODevice* device, qint64 pieceSize) {
+    QByteArray result;
+    QByteArray piece;
+
+    do {
+        piece = device->read(pieceSize);
+        result.append(piece);
+    } while (!piece.isEmpty());
+
+    return result;
+}
+
+
+TestEnvelopeStream::TestEnvelopeStream() {}
+
+
+TestEnvelopeStream::~TestEnvelopeStream() {}
+
+
+void TestEnvelopeStream::initTestCase() {}
+
+
+void TestEnvelopeStream::testEnvelope_data() {
+    QTest::addColumn<unsigned>("payloadSize");
+    QTest::addColumn<qint64>("pieceSize");
+
+    QTest::newRow("0 B") << 0U << qint64(4096);
+    QTest::newRow("1 B") << 1U << qint64(4096);
+    QTest::newRow("2 B") << 2U << qint64(4096);
+    QTest::newRow("3 B") << 3U << qint64(4096);
+    QTest::newRow("1 KiB, 7 B reads") << 1024U << qint64(7);
+    QTest::newRow("1 chunk") << Wh::EnvelopeStream::chunkSize << qint64(65536);
+    QTest::newRow("1 chunk + 1 B") << Wh::EnvelopeStream::chunkSize + 1 << qint64(65536);
+    QTest::newRow("1 chunk - 1 B") << Wh::EnvelopeStream::chunkSize - 1 << qint64(1000);
+    QTest::newRow("1 MiB + 2 B") << (1U << 20) + 2 << qint64(16384);
+}
+
+
+void TestEnvelopeStream::testEnvelope() {
+    QFETCH(unsigned, payloadSize);
+    QFETCH(qint64, pieceSize);
+
+    QByteArray secret("The quick brown fox");
+    QByteArray payload = makePayload(payloadSize);
+
+    QBuffer buffer(&payload);
+    buffer.open(QBuffer::OpenModeFlag::ReadOnly);
+
+    Wh::SigningKeyCache signingKeys;
+    Wh::EnvelopeStream  stream(&buffer, 0, payload.size(), signingKeys, secret, 27000000);
+
+    QByteArray expected = Wh::EnvelopeWriter::write(payload, signingKeys.sign(secret, 27000000, payload));
+
+    QCOMPARE(stream.size(), static_cast<qint64>(expected.size()));
+    QVERIFY(!stream.isSequential());
+
+    QByteArray envelope = readAll(&stream, pieceSize);
+    QCOMPARE(envelope, expected);
+    QVERIFY(stream.atEnd());
+}
+
+
+void TestEnvelopeStream::testPayloadOffset() {
+    QByteArray secret("The quick brown fox");
+    QByteArray contents = makePayload(100000);
+
+    QBuffer buffer(&contents);
+    buffer.open(QBuffer::OpenModeFlag::ReadOnly);
+
+    Wh::SigningKeyCache signingKeys;
+    Wh::EnvelopeStream  stream(&buffer, 1001, contents.size() - 1001, signingKeys, secret, 27000000);
+
+    QByteArray payload  = contents.mid(1001);
+    QByteArray expected = Wh::EnvelopeWriter::write(payload, signingKeys.sign(secret, 27000000, payload));
+
+    QCOMPARE(readAll(&stream, 8192), expected);
+}
+
+
+void TestEnvelopeStream::testRewind() {
+    QByteArray secret("The quick brown fox");
+    QByteArray payload = makePayload(3 * Wh::EnvelopeStream::chunkSize + 17);
+
+    QBuffer buffer(&payload);
+    buffer.open(QBuffer::OpenModeFlag::ReadOnly);
+
+    Wh::SigningKeyCache signingKeys;
+    Wh::EnvelopeStream  stream(&buffer, 0, payload.size(), signingKeys, secret, 27000000);
+
+    QByteArray expected = Wh::EnvelopeWriter::write(payload, signingKeys.sign(secret, 27000000, payload));
+
+    QByteArray partial = stream.read(100000);
+    QCOMPARE(partial, expected.left(100000));
+
+    QVERIFY(!stream.seek(5));
+    QVERIFY(stream.reset());
+    QCOMPARE(stream.pos(), qint64(0));
+
+    QCOMPARE(readAll(&stream, 30000), expected);
+}
+
+
+void TestEnvelopeStream::cleanupTestCase() {}
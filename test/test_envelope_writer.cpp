@@ -0,0 +1,141 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::EnvelopeWriter class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QString>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCborValue>
+#include <QCborMap>
+#include <QCborParserError>
+
+#include <wh_envelope_writer.h>
+
+#include "test_envelope_writer.h"
+
+TestEnvelopeWriter::TestEnvelopeWriter() {}
+
+
+TestEnvelopeWriter::~TestEnvelopeWriter() {}
+
+
+void TestEnvelopeWriter::initTestCase() {}
+
+
+void TestEnvelopeWriter::testJsonEnvelope() {
+    QByteArray data("{\"test_data\":1}");
+    QByteArray hash(32, '\xA5');
+
+    QByteArray envelope = Wh::EnvelopeWriter::write(data, hash);
+    QCOMPARE(
+        static_cast<unsigned>(envelope.size()),
+        Wh::EnvelopeWriter::envelopeSize(static_cast<unsigned>(data.size()), static_cast<unsigned>(hash.size()))
+    );
+
+    QJsonObject json = QJsonDocument::fromJson(envelope).object();
+    QCOMPARE(QByteArray::fromBase64(json.value("data").toString().toLatin1()), data);
+    QCOMPARE(QByteArray::fromBase64(json.value("hash").toString().toLatin1()), hash);
+}
+
+
+void TestEnvelopeWriter::testMatchesJsonDocument_data() {
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QByteArray>("hash");
+
+    QByteArray allBytes(256, '\0');
+    for (unsigned i=0 ; i<256 ; ++i) {
+        allBytes[i] = static_cast<char>(i);
+    }
+
+    // Base-64 remainders of 0, 1, and 2 bytes, characters JSON must escape, and every byte value.
+    QTest::newRow("empty") << QByteArray() << QByteArray(32, '\xA5');
+    QTest::newRow("remainder 1") << QByteArray("{\"a\":1}") << QByteArray(32, '\x00');
+    QTest::newRow("remainder 2") << QByteArray("{\"a\":12}") << QByteArray(31, '\xFF');
+    QTest::newRow("remainder 0") << QByteArray("{\"a\":123}") << QByteArray(33, '\x3E');
+    QTest::newRow("escaped") << QByteArray("{\"q\":\"\\\"/\b\f\n\r\t\x01\x1F\"}") << QByteArray(31, '\x7F');
+    QTest::newRow("utf-8") << QByteArray("{\"s\":\"\xC3\xA9\xE2\x82\xAC\"}") << QByteArray(32, '\xC0');
+    QTest::newRow("every byte") << allBytes << allBytes.left(32);
+    QTest::newRow("64 kB") << allBytes.repeated(256) << allBytes.right(32);
+}
+
+
+void TestEnvelopeWriter::testMatchesJsonDocument() {
+    QFETCH(QByteArray, data);
+    QFETCH(QByteArray, hash);
+
+    // This mirrors the envelope originally built by Wh::WebHook::doSend.
+    QJsonObject json;
+    json.insert(QString("data"), QString::fromLatin1(data.toBase64()));
+    json.insert(QString("hash"), QString::fromLatin1(hash.toBase64()));
+    QByteArray expected = QJsonDocument(json).toJson(QJsonDocument::JsonFormat::Compact);
+
+    QCOMPARE(Wh::EnvelopeWriter::write(data, hash), expected);
+}
+
+
+void TestEnvelopeWriter::testCborEnvelope_data() {
+    QTest::addColumn<unsigned>("payloadSize");
+
+    QTest::newRow("0 B") << 0U;
+    QTest::newRow("23 B") << 23U;
+    QTest::newRow("24 B") << 24U;
+    QTest::newRow("255 B") << 255U;
+    QTest::newRow("256 B") << 256U;
+    QTest::newRow("65535 B") << 65535U;
+    QTest::newRow("65536 B") << 65536U;
+}
+
+
+void TestEnvelopeWriter::testCborEnvelope() {
+    QFETCH(unsigned, payloadSize);
+
+    QByteArray data(static_cast<int>(payloadSize), '\0');
+    for (unsigned i=0 ; i<payloadSize ; ++i) {
+        data[i] = static_cast<char>(i * 7);
+    }
+
+    QByteArray hash(32, '\xA5');
+
+    QByteArray envelope = Wh::EnvelopeWriter::writeCbor(data, hash);
+    QCOMPARE(
+        static_cast<unsigned>(envelope.size()),
+        Wh::EnvelopeWriter::cborEnvelopeSize(payloadSize, static_cast<unsigned>(hash.size()))
+    );
+
+    QCborParserError parseError;
+    QCborValue       value = QCborValue::fromCbor(envelope, &parseError);
+
+    QVERIFY(parseError.error == QCborError::NoError);
+    QVERIFY(value.isMap());
+
+    QCborMap map = value.toMap();
+    QCOMPARE(map.size(), 2);
+    QVERIFY(map.value(QString("data")).isByteArray());
+    QCOMPARE(map.value(QString("data")).toByteArray(), data);
+    QCOMPARE(map.value(QString("hash")).toByteArray(), hash);
+}
+
+
+void TestEnvelopeWriter::cleanupTestCase() {}
@@ -0,0 +1,178 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::FlowControl class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QString>
+
+#include <wh_flow_control.h>
+
+#include "test_flow_control.h"
+
+TestFlowControl::TestFlowControl() {}
+
+
+TestFlowControl::~TestFlowControl() {}
+
+
+void TestFlowControl::initTestCase() {}
+
+
+void TestFlowControl::testConcurrencyLimit() {
+    Wh::FlowControl flowControl;
+    flowControl.setConcurrencyLimits(2, 1, 10);
+
+    QString first("https://first.example.com");
+    QString second("https://second.example.com");
+
+    QCOMPARE(flowControl.concurrencyLimit(first), 2U);
+
+    QCOMPARE(flowControl.acquire(first, 1000), 0LL);
+    QCOMPARE(flowControl.acquire(first, 1000), 0LL);
+    QCOMPARE(flowControl.acquire(first, 1000), -1LL);
+    QCOMPARE(flowControl.outstanding(first), 2U);
+
+    // Destinations are limited independently.
+    QCOMPARE(flowControl.acquire(second, 1000), 0LL);
+
+    flowControl.release(first);
+    QCOMPARE(flowControl.outstanding(first), 1U);
+    QCOMPARE(flowControl.acquire(first, 1000), 0LL);
+}
+
+
+void TestFlowControl::testTokenBucket() {
+    Wh::FlowControl flowControl(10.0, 2);
+    flowControl.setConcurrencyLimits(100, 1, 100);
+
+    QString   destination("https://example.com");
+    long long start = 1000000;
+
+    // The bucket starts full so the burst is sent at once.
+    QCOMPARE(flowControl.acquire(destination, start), 0LL);
+    QCOMPARE(flowControl.acquire(destination, start), 0LL);
+
+    long long wait = flowControl.acquire(destination, start);
+    QVERIFY(wait >= 99999 && wait <= 100000);
+
+    wait = flowControl.acquire(destination, start + 50000);
+    QVERIFY(wait >= 49999 && wait <= 50001);
+
+    QCOMPARE(flowControl.acquire(destination, start + 150000), 0LL);
+    QCOMPARE(flowControl.outstanding(destination), 3U);
+
+    // Idle time never fills the bucket beyond the burst size.
+    QCOMPARE(flowControl.acquire(destination, start + 10000000), 0LL);
+    QCOMPARE(flowControl.acquire(destination, start + 10000000), 0LL);
+    QVERIFY(flowControl.acquire(destination, start + 10000000) > 0);
+}
+
+
+void TestFlowControl::testIncrease() {
+    Wh::FlowControl flowControl;
+    flowControl.setConcurrencyLimits(2, 1, 10);
+
+    QString busy("https://busy.example.com");
+    QString idle("https://idle.example.com");
+
+    QCOMPARE(flowControl.acquire(busy, 1000), 0LL);
+    QCOMPARE(flowControl.acquire(busy, 1000), 0LL);
+
+    long long now = 2000;
+    for (unsigned i=0 ; i<20 ; ++i) {
+        flowControl.record(busy, Wh::FlowControl::Outcome::SUCCESS, now, now + 1000);
+        now += 2000;
+    }
+
+    QVERIFY(flowControl.concurrencyLimit(busy) > 2U);
+    QVERIFY(flowControl.concurrencyLimit(busy) <= 10U);
+
+    // A destination that never uses its limit does not earn a larger one.
+    QCOMPARE(flowControl.acquire(idle, 1000), 0LL);
+    flowControl.release(idle);
+
+    for (unsigned i=0 ; i<20 ; ++i) {
+        flowControl.record(idle, Wh::FlowControl::Outcome::SUCCESS, now, now + 1000);
+        now += 2000;
+    }
+
+    QCOMPARE(flowControl.concurrencyLimit(idle), 2U);
+}
+
+
+void TestFlowControl::testDecrease() {
+    Wh::FlowControl flowControl;
+    flowControl.setConcurrencyLimits(8, 2, 16);
+
+    QString overloaded("https://overloaded.example.com");
+    QString timedOut("https://timed-out.example.com");
+    QString failed("https://failed.example.com");
+
+    flowControl.record(overloaded, Wh::FlowControl::Outcome::OVERLOADED, 1000, 2000);
+    QCOMPARE(flowControl.concurrencyLimit(overloaded), 4U);
+
+    // Requests sent before the decrease belong to the same overload event.
+    flowControl.record(overloaded, Wh::FlowControl::Outcome::OVERLOADED, 1500, 2500);
+    QCOMPARE(flowControl.concurrencyLimit(overloaded), 4U);
+
+    flowControl.record(overloaded, Wh::FlowControl::Outcome::OVERLOADED, 3000, 4000);
+    QCOMPARE(flowControl.concurrencyLimit(overloaded), 2U);
+
+    flowControl.record(overloaded, Wh::FlowControl::Outcome::OVERLOADED, 5000, 6000);
+    QCOMPARE(flowControl.concurrencyLimit(overloaded), 2U);
+
+    flowControl.record(timedOut, Wh::FlowControl::Outcome::TIMED_OUT, 1000, 31000000);
+    QCOMPARE(flowControl.concurrencyLimit(timedOut), 4U);
+
+    flowControl.record(failed, Wh::FlowControl::Outcome::FAILED, 1000, 2000);
+    QCOMPARE(flowControl.concurrencyLimit(failed), 8U);
+}
+
+
+void TestFlowControl::testLatency() {
+    Wh::FlowControl flowControl;
+    flowControl.setConcurrencyLimits(8, 1, 16);
+
+    QString slow("https://slow.example.com");
+    QString fast("https://fast.example.com");
+    QString ignored("https://ignored.example.com");
+
+    flowControl.record(slow, Wh::FlowControl::Outcome::SUCCESS, 0, 10000);
+    flowControl.record(slow, Wh::FlowControl::Outcome::SUCCESS, 20000, 70000);
+    QCOMPARE(flowControl.concurrencyLimit(slow), 4U);
+
+    // Jitter below the noise floor is not treated as overload, even on a destination with very low latency.
+    flowControl.record(fast, Wh::FlowControl::Outcome::SUCCESS, 0, 100);
+    flowControl.record(fast, Wh::FlowControl::Outcome::SUCCESS, 1000, 2000);
+    QCOMPARE(flowControl.concurrencyLimit(fast), 8U);
+
+    flowControl.setLatencyTolerance(0);
+    QCOMPARE(flowControl.latencyTolerance(), 0.0);
+
+    flowControl.record(ignored, Wh::FlowControl::Outcome::SUCCESS, 0, 10000);
+    flowControl.record(ignored, Wh::FlowControl::Outcome::SUCCESS, 20000, 70000);
+    QCOMPARE(flowControl.concurrencyLimit(ignored), 8U);
+}
+
+
+void TestFlowControl::cleanupTestCase() {}
@@ -24,12 +24,40 @@
 
 #include "application_wrapper.h"
 
+#include "test_base64.h"
+#include "test_circuit_breaker.h"
+#include "test_compressor.h"
+#include "test_envelope_stream.h"
+#include "test_envelope_writer.h"
+#include "test_flow_control.h"
+#include "test_metrics.h"
+#include "test_response.h"
+#include "test_retry_policy.h"
+#include "test_signing_key_cache.h"
+#include "test_spool.h"
+#include "test_submission_queue.h"
+#include "test_time_sync.h"
 #include "test_web_hook.h"
+#include "test_web_hook_verifier.h"
 
 int main(int argumentCount, char** argumentValues) {
     ApplicationWrapper wrapper(argumentCount, argumentValues);
 
+    wrapper.includeTest(new TestBase64);
+    wrapper.includeTest(new TestCircuitBreaker);
+    wrapper.includeTest(new TestCompressor);
+    wrapper.includeTest(new TestEnvelopeStream);
+    wrapper.includeTest(new TestEnvelopeWriter);
+    wrapper.includeTest(new TestFlowControl);
+    wrapper.includeTest(new TestMetrics);
+    wrapper.includeTest(new TestResponse);
+    wrapper.includeTest(new TestRetryPolicy);
+    wrapper.includeTest(new TestSigningKeyCache);
+    wrapper.includeTest(new TestSpool);
+    wrapper.includeTest(new TestSubmissionQueue);
+    wrapper.includeTest(new TestTimeSync);
     wrapper.includeTest(new TestWebHook);
+    wrapper.includeTest(new TestWebHookVerifier);
     int status = wrapper.exec();
 
     return status;
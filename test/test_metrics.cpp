@@ -0,0 +1,210 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::Metrics class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include <thread>
+#include <vector>
+
+#include <wh_histogram.h>
+#include <wh_metrics.h>
+
+#include "test_metrics.h"
+
+TestMetrics::TestMetrics() {}
+
+
+TestMetrics::~TestMetrics() {}
+
+
+void TestMetrics::initTestCase() {}
+
+
+void TestMetrics::testHistogramBuckets() {
+    unsigned lastIndex = 0;
+    for (unsigned long long value=0 ; value<(1ULL << 20) ; ++value) {
+        unsigned index = Wh::Histogram::bucketIndex(value);
+
+        QVERIFY(index == lastIndex || index == lastIndex + 1);
+        QVERIFY(value <= Wh::Histogram::bucketUpperBound(index));
+        QVERIFY(index == 0 || value > Wh::Histogram::bucketUpperBound(index - 1));
+
+        lastIndex = index;
+    }
+
+    unsigned lastBucket = Wh::Histogram::numberBuckets - 1;
+    QCOMPARE(Wh::Histogram::bucketIndex(Wh::Histogram::maximumValue), lastBucket);
+    QCOMPARE(Wh::Histogram::bucketUpperBound(lastBucket), Wh::Histogram::maximumValue);
+
+    // Relative error is bounded by one part in 2^(subBucketBits - 1).
+    for (unsigned index=(1U << Wh::Histogram::subBucketBits) ; index<Wh::Histogram::numberBuckets ; ++index) {
+        unsigned long long lower = Wh::Histogram::bucketUpperBound(index - 1) + 1;
+        unsigned long long upper = Wh::Histogram::bucketUpperBound(index);
+
+        QVERIFY((upper - lower + 1) << (Wh::Histogram::subBucketBits - 1) <= lower);
+    }
+}
+
+
+void TestMetrics::testPercentiles() {
+    Wh::Metrics metrics;
+
+    for (unsigned long long value=1 ; value<=10000 ; ++value) {
+        metrics.record(Wh::Metrics::Latency::ROUND_TRIP, QString("https://a.example.com"), value);
+    }
+
+    Wh::Metrics::Distribution distribution = metrics.snapshot().latency(Wh::Metrics::Latency::ROUND_TRIP);
+
+    QCOMPARE(distribution.count(), 10000ULL);
+    QCOMPARE(distribution.sum(), 50005000ULL);
+    QCOMPARE(distribution.maximum(), 10000ULL);
+    QCOMPARE(distribution.mean(), 5000.5);
+
+    double tolerance = 1.0 / (1U << (Wh::Histogram::subBucketBits - 1));
+
+    unsigned long long p50 = distribution.percentile(50.0);
+    QVERIFY(p50 >= 5000 && p50 <= 5000 * (1.0 + tolerance));
+
+    unsigned long long p99 = distribution.percentile(99.0);
+    QVERIFY(p99 >= 9900 && p99 <= 9900 * (1.0 + tolerance));
+
+    QCOMPARE(distribution.percentile(100.0), 10000ULL);
+    QCOMPARE(distribution.percentile(0.0), 1ULL);
+
+    Wh::Metrics::Distribution empty = metrics.snapshot().latency(Wh::Metrics::Latency::SIGN);
+    QCOMPARE(empty.count(), 0ULL);
+    QCOMPARE(empty.percentile(99.0), 0ULL);
+}
+
+
+void TestMetrics::testCounters() {
+    Wh::Metrics metrics;
+    QString     a("https://a.example.com");
+    QString     b("https://b.example.com");
+
+    metrics.increment(Wh::Metrics::Counter::MESSAGES, a, 10);
+    metrics.increment(Wh::Metrics::Counter::REQUESTS, a, 12);
+    metrics.increment(Wh::Metrics::Counter::RETRIES, a, 2);
+    metrics.increment(Wh::Metrics::Counter::MESSAGES, b, 5);
+    metrics.increment(Wh::Metrics::Counter::REQUESTS, b, 5);
+    metrics.adjust(Wh::Metrics::Gauge::QUEUED, 3);
+    metrics.adjust(Wh::Metrics::Gauge::QUEUED, -1);
+
+    Wh::Metrics::Snapshot snapshot = metrics.snapshot();
+
+    QCOMPARE(snapshot.destinations(), QStringList() << a << b);
+    QCOMPARE(snapshot.counter(Wh::Metrics::Counter::MESSAGES), 15ULL);
+    QCOMPARE(snapshot.counter(Wh::Metrics::Counter::MESSAGES, a), 10ULL);
+    QCOMPARE(snapshot.counter(Wh::Metrics::Counter::RETRIES, b), 0ULL);
+    QCOMPARE(snapshot.counter(Wh::Metrics::Counter::MESSAGES, QString("https://c.example.com")), 0ULL);
+    QCOMPARE(snapshot.gauge(Wh::Metrics::Gauge::QUEUED), 2LL);
+    QCOMPARE(snapshot.gauge(Wh::Metrics::Gauge::IN_FLIGHT), 0LL);
+
+    QCOMPARE(snapshot.retryAmplification(a), 1.2);
+    QCOMPARE(snapshot.retryAmplification(), 17.0 / 15.0);
+}
+
+
+void TestMetrics::testDestinationEntry() {
+    Wh::Metrics metrics;
+    QString     a("https://a.example.com");
+
+    Wh::Metrics::Destination* destination = metrics.destinationEntry(a);
+    QVERIFY(destination != Q_NULLPTR);
+    QVERIFY(metrics.destinationEntry(a) == destination);
+
+    // Updates made through the entry and through the origin land in the same place.
+    metrics.increment(Wh::Metrics::Counter::REQUESTS, destination, 3);
+    metrics.increment(Wh::Metrics::Counter::REQUESTS, a, 2);
+    metrics.record(Wh::Metrics::Latency::SIGN, destination, 100);
+    metrics.record(Wh::Metrics::Latency::SIGN, a, 300);
+
+    Wh::Metrics::Snapshot snapshot = metrics.snapshot();
+
+    QCOMPARE(snapshot.destinations(), QStringList() << a);
+    QCOMPARE(snapshot.counter(Wh::Metrics::Counter::REQUESTS, a), 5ULL);
+    QCOMPARE(snapshot.counter(Wh::Metrics::Counter::REQUESTS), 5ULL);
+    QCOMPARE(snapshot.latency(Wh::Metrics::Latency::SIGN, a).count(), 2ULL);
+    QCOMPARE(snapshot.latency(Wh::Metrics::Latency::SIGN).count(), 2ULL);
+}
+
+
+void TestMetrics::testConcurrentRecording() {
+    Wh::Metrics metrics;
+
+    unsigned numberThreads    = 4;
+    unsigned recordsPerThread = 100000;
+
+    std::vector<std::thread> threads;
+    for (unsigned t=0 ; t<numberThreads ; ++t) {
+        threads.emplace_back(
+            [&metrics, t, recordsPerThread]() {
+                QString destination = QString("https://%1.example.com").arg(t % 2);
+                for (unsigned i=0 ; i<recordsPerThread ; ++i) {
+                    metrics.increment(Wh::Metrics::Counter::REQUESTS, destination);
+                    metrics.record(Wh::Metrics::Latency::DELIVERY, destination, i);
+                }
+            }
+        );
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    Wh::Metrics::Snapshot snapshot = metrics.snapshot();
+    unsigned long long    expected = static_cast<unsigned long long>(numberThreads) * recordsPerThread;
+
+    QCOMPARE(snapshot.counter(Wh::Metrics::Counter::REQUESTS), expected);
+    QCOMPARE(snapshot.latency(Wh::Metrics::Latency::DELIVERY).count(), expected);
+    QCOMPARE(snapshot.counter(Wh::Metrics::Counter::REQUESTS, QString("https://0.example.com")), expected / 2);
+    QCOMPARE(snapshot.latency(Wh::Metrics::Latency::DELIVERY).maximum(), recordsPerThread - 1ULL);
+}
+
+
+void TestMetrics::testPrometheusText() {
+    Wh::Metrics metrics;
+    QString     destination("https://a.example.com");
+
+    metrics.increment(Wh::Metrics::Counter::DELIVERED, destination, 7);
+    metrics.record(Wh::Metrics::Latency::DELIVERY, destination, 250000);
+    metrics.adjust(Wh::Metrics::Gauge::IN_FLIGHT, 4);
+
+    QByteArray text  = metrics.prometheusText(QString("hook"));
+    QByteArray label = "{destination=\"https://a.example.com\"";
+
+    QVERIFY(text.contains("# TYPE hook_delivered_total counter\n"));
+    QVERIFY(text.contains("hook_delivered_total" + label + "} 7\n"));
+    QVERIFY(text.contains("# TYPE hook_delivery_duration_seconds summary\n"));
+    QVERIFY(text.contains("hook_delivery_duration_seconds_count" + label + "} 1\n"));
+    QVERIFY(text.contains("hook_delivery_duration_seconds_sum" + label + "} 0.25\n"));
+    QVERIFY(text.contains("hook_delivery_duration_seconds" + label + ",quantile=\"0.99\"} 0.25\n"));
+    QVERIFY(text.contains("hook_messages_in_flight 4\n"));
+    QVERIFY(text.endsWith('\n'));
+}
+
+
+void TestMetrics::cleanupTestCase() {}
@@ -0,0 +1,93 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::Response class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QString>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QCborValue>
+#include <QCborMap>
+
+#include <wh_response.h>
+
+#include "test_response.h"
+
+TestResponse::TestResponse() {}
+
+
+TestResponse::~TestResponse() {}
+
+
+void TestResponse::initTestCase() {}
+
+
+void TestResponse::testLazyJson() {
+    QByteArray   rawData("{\"status\":\"OK\",\"count\":3}");
+    Wh::Response  response(rawData, QString("application/json"));
+
+    QCOMPARE(response.isDecoded(), false);
+    QCOMPARE(response.rawData(), rawData);
+    QCOMPARE(response.isDecoded(), false);
+
+    const QJsonDocument& jsonDocument = response.json();
+    QCOMPARE(response.isDecoded(), true);
+    QVERIFY(jsonDocument.isObject());
+    QCOMPARE(jsonDocument.object().value("status").toString(), QString("OK"));
+    QCOMPARE(jsonDocument.object().value("count").toInt(), 3);
+
+    QCOMPARE(&response.json(), &jsonDocument);
+
+    Wh::Response empty;
+    QCOMPARE(empty.rawData().isEmpty(), true);
+    QCOMPARE(empty.json().isNull(), true);
+}
+
+
+void TestResponse::testCbor() {
+    QCborMap map;
+    map.insert(QString("status"), QString("OK"));
+    map.insert(QString("count"), 3);
+
+    Wh::Response response(QCborValue(map).toCbor(), QString("application/cbor"));
+
+    const QJsonDocument& jsonDocument = response.json();
+    QVERIFY(jsonDocument.isObject());
+    QCOMPARE(jsonDocument.object().value("status").toString(), QString("OK"));
+    QCOMPARE(jsonDocument.object().value("count").toInt(), 3);
+}
+
+
+void TestResponse::testInvalid() {
+    Wh::Response text(QByteArray("OK"), QString("text/plain"));
+    QCOMPARE(text.json().isNull(), true);
+    QCOMPARE(text.isDecoded(), true);
+
+    Wh::Response cbor(QByteArray("\xFF\xFF", 2), QString("application/cbor"));
+    QCOMPARE(cbor.json().isNull(), true);
+}
+
+
+void TestResponse::cleanupTestCase() {}
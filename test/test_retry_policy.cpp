@@ -0,0 +1,109 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::RetryPolicy class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include <wh_retry_policy.h>
+
+#include "test_retry_policy.h"
+
+TestRetryPolicy::TestRetryPolicy() {}
+
+
+TestRetryPolicy::~TestRetryPolicy() {}
+
+
+void TestRetryPolicy::initTestCase() {}
+
+
+void TestRetryPolicy::testMaximumAttempts() {
+    Wh::RetryPolicy policy(3, 10, 1000);
+
+    QVERIFY(policy.retryDelay(1, -1) >= 0);
+    QVERIFY(policy.retryDelay(2, -1) >= 0);
+    QCOMPARE(policy.retryDelay(3, -1), -1LL);
+    QCOMPARE(policy.retryDelay(4, -1), -1LL);
+}
+
+
+void TestRetryPolicy::testBackoff() {
+    Wh::RetryPolicy policy(100, 10, 500);
+
+    for (unsigned attempts=1 ; attempts<20 ; ++attempts) {
+        long long ceiling = qMin(10LL << (attempts - 1), 500LL);
+
+        for (unsigned i=0 ; i<100 ; ++i) {
+            long long delay = policy.retryDelay(attempts, -1);
+            QVERIFY(delay >= 0);
+            QVERIFY(delay <= ceiling);
+        }
+    }
+}
+
+
+void TestRetryPolicy::testRetryAfter() {
+    Wh::RetryPolicy policy(5, 10, 100);
+
+    QCOMPARE(policy.retryDelay(1, 5000), 5000LL);
+
+    // An oversized Retry-After is shortened to the configured limit.
+    QCOMPARE(policy.maximumRetryAfter(), static_cast<unsigned>(Wh::RetryPolicy::defaultMaximumRetryAfter));
+    QCOMPARE(policy.retryDelay(1, 7LL * 24 * 3600 * 1000), static_cast<long long>(policy.maximumRetryAfter()));
+
+    policy.setMaximumRetryAfter(2000);
+    QCOMPARE(policy.maximumRetryAfter(), 2000U);
+    QCOMPARE(policy.retryDelay(1, 5000), 2000LL);
+    QCOMPARE(policy.retryDelay(1, 1500), 1500LL);
+
+    policy.setRespectRetryAfter(false);
+    QVERIFY(policy.retryDelay(1, 5000) <= 10);
+}
+
+
+void TestRetryPolicy::testRetryBudget() {
+    double   originalRatio            = Wh::RetryPolicy::retryBudgetRatio();
+    unsigned originalMinimumPerSecond = Wh::RetryPolicy::retryBudgetMinimumPerSecond();
+
+    Wh::RetryPolicy::setRetryBudget(0.5, 0);
+
+    unsigned granted = 0;
+    while (Wh::RetryPolicy::acquireRetry()) {
+        ++granted;
+    }
+
+    QCOMPARE(Wh::RetryPolicy::acquireRetry(), false);
+
+    for (unsigned i=0 ; i<4 ; ++i) {
+        Wh::RetryPolicy::recordRequest();
+    }
+
+    QCOMPARE(Wh::RetryPolicy::acquireRetry(), true);
+    QCOMPARE(Wh::RetryPolicy::acquireRetry(), true);
+    QCOMPARE(Wh::RetryPolicy::acquireRetry(), false);
+
+    Wh::RetryPolicy::setRetryBudget(originalRatio, originalMinimumPerSecond);
+}
+
+
+void TestRetryPolicy::cleanupTestCase() {}
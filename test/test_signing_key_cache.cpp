@@ -0,0 +1,185 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::SigningKeyCache class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QByteArray>
+
+#include <crypto_hmac.h>
+
+#include <wh_signing_key_cache.h>
+
+#include "test_signing_key_cache.h"
+
+// 2022-03-04 05:06 UTC, expressed both ways.
+const long long  TestSigningKeyCache::minute = 27439506;
+const QByteArray TestSigningKeyCache::dateTime("202203040506");
+
+TestSigningKeyCache::TestSigningKeyCache() {}
+
+
+TestSigningKeyCache::~TestSigningKeyCache() {}
+
+
+void TestSigningKeyCache::initTestCase() {}
+
+
+void TestSigningKeyCache::testBaselineSignature_data() {
+    QTest::addColumn<QByteArray>("secret");
+    QTest::addColumn<QByteArray>("payload");
+
+    // Secrets that are repeated, used as is, and truncated by the key derivation.
+    QTest::newRow("8 B secret") << QByteArray("01234567") << QByteArray("{\"test_data\":1}");
+    QTest::newRow("20 B secret") << QByteArray("0123456789ABCDEFGHIJ") << QByteArray("{\"test_data\":2}");
+    QTest::newRow("52 B secret") << QByteArray(52, '\xB1') << QByteArray(1000, 'x');
+    QTest::newRow("100 B secret") << QByteArray(100, '\x5A') << QByteArray();
+}
+
+
+void TestSigningKeyCache::testBaselineSignature() {
+    QFETCH(QByteArray, secret);
+    QFETCH(QByteArray, payload);
+
+    QByteArray expected = baselineSignature(secret, dateTime, payload);
+
+    Wh::SigningKeyCache cache;
+    QCOMPARE(cache.sign(secret, minute, payload), expected);
+
+    // The second signature comes from the cached pads.
+    QCOMPARE(cache.sign(secret, minute, payload), expected);
+    QCOMPARE(cache.numberEntries(), 1U);
+
+    Wh::SigningKeyCache::Signer signer(cache, secret, minute);
+    int half = payload.size() / 2;
+    signer.addData(payload.left(half));
+    signer.addData(payload.constData() + half, static_cast<unsigned>(payload.size() - half));
+    QCOMPARE(signer.result(), expected);
+
+    signer.reset();
+    signer.addData(payload);
+    QCOMPARE(signer.result(), expected);
+}
+
+
+void TestSigningKeyCache::testRollover() {
+    QByteArray          secret("0123456789ABCDEF0123456789ABCDEF");
+    QByteArray          payload("{\"test_data\":1}");
+    Wh::SigningKeyCache cache;
+
+    // A signer keeps its own copy of the pads so it survives eviction of the key it was built from.
+    Wh::SigningKeyCache::Signer signer(cache, secret, minute);
+    signer.addData(payload);
+
+    cache.sign(secret, minute + 1, payload);
+    QCOMPARE(cache.numberEntries(), 2U);
+    QCOMPARE(cache.contains(secret, minute), true);
+    QCOMPARE(cache.contains(secret, minute + 1), true);
+
+    // Keys more than one minute away from the newest key can no longer be used and are dropped.
+    cache.sign(secret, minute + 2, payload);
+    QCOMPARE(cache.numberEntries(), 2U);
+    QCOMPARE(cache.contains(secret, minute), false);
+    QCOMPARE(cache.contains(secret, minute + 1), true);
+    QCOMPARE(cache.contains(secret, minute + 2), true);
+
+    QCOMPARE(signer.result(), baselineSignature(secret, dateTime, payload));
+
+    // Keys are also dropped, least recently used first, once the cache is full.
+    Wh::SigningKeyCache smallCache(2);
+    smallCache.sign(QByteArray("first"), minute, payload);
+    smallCache.sign(QByteArray("second"), minute, payload);
+    smallCache.sign(QByteArray("first"), minute, payload);
+    smallCache.sign(QByteArray("third"), minute, payload);
+
+    QCOMPARE(smallCache.numberEntries(), 2U);
+    QCOMPARE(smallCache.contains(QByteArray("first"), minute), true);
+    QCOMPARE(smallCache.contains(QByteArray("second"), minute), false);
+    QCOMPARE(smallCache.contains(QByteArray("third"), minute), true);
+
+    smallCache.clear();
+    QCOMPARE(smallCache.numberEntries(), 0U);
+}
+
+
+void TestSigningKeyCache::testSecretsKeptApart() {
+    // The second secret repeats the first so both derive keys starting with the same bytes.
+    QByteArray          secretA("ABCDEFGH");
+    QByteArray          secretB("ABCDEFGHABCDEFGH");
+    QByteArray          payload("{\"test_data\":1}");
+    Wh::SigningKeyCache cache;
+
+    QByteArray signatureA = cache.sign(secretA, minute, payload);
+    QByteArray signatureB = cache.sign(secretB, minute, payload);
+
+    QCOMPARE(cache.numberEntries(), 2U);
+    QCOMPARE(cache.contains(secretA, minute), true);
+    QCOMPARE(cache.contains(secretB, minute), true);
+
+    QVERIFY(signatureA != signatureB);
+    QCOMPARE(signatureA, baselineSignature(secretA, dateTime, payload));
+    QCOMPARE(signatureB, baselineSignature(secretB, dateTime, payload));
+
+    // Rolling one secret over to a new minute leaves the other secret's key in place.
+    cache.sign(secretA, minute + 5, payload);
+    QCOMPARE(cache.contains(secretA, minute), false);
+    QCOMPARE(cache.contains(secretB, minute), true);
+    QCOMPARE(cache.sign(secretB, minute, payload), signatureB);
+}
+
+
+void TestSigningKeyCache::testWipe() {
+    QByteArray  key  = Wh::SigningKeyCache::deriveKey(QByteArray("0123456789ABCDEF"), minute);
+    const char* data = key.constData();
+    int         size = key.size();
+
+    Wh::SigningKeyCache::wipe(key);
+
+    // The key is overwritten in place rather than replaced with a new buffer.
+    QVERIFY(key.constData() == data);
+    QCOMPARE(key, QByteArray(size, '\0'));
+}
+
+
+void TestSigningKeyCache::cleanupTestCase() {}
+
+
+QByteArray TestSigningKeyCache::baselineSignature(
+        const QByteArray& secret,
+        const QByteArray& dateTime,
+        const QByteArray& payload
+    ) {
+    // This mirrors the derivation originally done by Wh::WebHook::doSend for every message.
+    QByteArray key = secret + dateTime;
+    while (key.size() < 32) {
+        key += secret + dateTime;
+    }
+
+    if (key.size() > 64) {
+        key = key.left(64);
+    }
+
+    Crypto::Hmac hmac(key);
+    hmac.addData(payload);
+
+    return hmac.digest();
+}
@@ -0,0 +1,217 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::Spool class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+#include <QUrl>
+#include <QByteArray>
+#include <QList>
+
+#include <wh_spool.h>
+
+#include "test_spool.h"
+
+TestSpool::TestSpool() {}
+
+
+TestSpool::~TestSpool() {}
+
+
+void TestSpool::initTestCase() {}
+
+
+void TestSpool::testReplay() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    QUrl url("https://example.com/v2/test");
+    QList<unsigned long long> recordIds;
+
+    {
+        Wh::Spool                spool(directory.path());
+        QList<Wh::Spool::Record> pending;
+
+        QCOMPARE(spool.open(pending), true);
+        QCOMPARE(pending.size(), 0);
+
+        for (unsigned i=0 ; i<10 ; ++i) {
+            unsigned long long recordId = spool.append(url, QByteArray::number(i), i % 3);
+            QVERIFY(recordId != 0);
+
+            recordIds.append(recordId);
+        }
+
+        for (unsigned i=0 ; i<10 ; i+=2) {
+            spool.acknowledge(recordIds.at(i));
+        }
+    }
+
+    {
+        Wh::Spool                spool(directory.path());
+        QList<Wh::Spool::Record> pending;
+
+        QCOMPARE(spool.open(pending), true);
+        QCOMPARE(pending.size(), 5);
+
+        for (unsigned i=0 ; i<5 ; ++i) {
+            const Wh::Spool::Record& record = pending.at(i);
+
+            QCOMPARE(record.id, recordIds.at(2 * i + 1));
+            QCOMPARE(record.url, url);
+            QCOMPARE(record.payload, QByteArray::number(2 * i + 1));
+            QCOMPARE(record.priority, (2 * i + 1) % 3);
+
+            spool.acknowledge(record.id);
+        }
+
+        unsigned long long recordId = spool.append(url, QByteArray("new"));
+        QVERIFY(recordId > recordIds.last());
+    }
+
+    {
+        Wh::Spool                spool(directory.path());
+        QList<Wh::Spool::Record> pending;
+
+        QCOMPARE(spool.open(pending), true);
+        QCOMPARE(pending.size(), 1);
+        QCOMPARE(pending.first().payload, QByteArray("new"));
+    }
+}
+
+
+void TestSpool::testSegmentRollover() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    QUrl       url("https://example.com/v2/test");
+    QByteArray payload(1000, 'x');
+
+    Wh::Spool                spool(directory.path(), 8192);
+    QList<Wh::Spool::Record> pending;
+    QCOMPARE(spool.open(pending), true);
+
+    QList<unsigned long long> recordIds;
+    for (unsigned i=0 ; i<50 ; ++i) {
+        recordIds.append(spool.append(url, payload));
+    }
+
+    QVERIFY(QDir(directory.path()).entryList(QStringList() << "*.whs", QDir::Files).size() > 1);
+
+    for (unsigned long long recordId : recordIds) {
+        spool.acknowledge(recordId);
+    }
+
+    QCOMPARE(QDir(directory.path()).entryList(QStringList() << "*.whs", QDir::Files).size(), 1);
+}
+
+
+void TestSpool::testReleasedSegments() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    QUrl       url("https://example.com/v2/test");
+    QByteArray payload(1000, 'x');
+
+    {
+        Wh::Spool                spool(directory.path(), 8192);
+        QList<Wh::Spool::Record> pending;
+        QCOMPARE(spool.open(pending), true);
+
+        QCOMPARE(spool.synchronous(), false);
+        spool.setSynchronous();
+        QCOMPARE(spool.synchronous(), true);
+
+        QList<unsigned long long> recordIds;
+        for (unsigned i=0 ; i<30 ; ++i) {
+            recordIds.append(spool.append(url, payload));
+        }
+
+        QVERIFY(QDir(directory.path()).entryList(QStringList() << "*.whs", QDir::Files).size() > 3);
+
+        // The first message pins its own segment and the segment holding the acknowledgements that refer to it.
+        // Every segment in between is released.
+        for (unsigned i=1 ; i<30 ; ++i) {
+            spool.acknowledge(recordIds.at(i));
+        }
+
+        QCOMPARE(QDir(directory.path()).entryList(QStringList() << "*.whs", QDir::Files).size(), 2);
+    }
+
+    {
+        Wh::Spool                spool(directory.path(), 8192);
+        QList<Wh::Spool::Record> pending;
+        QCOMPARE(spool.open(pending), true);
+        QCOMPARE(pending.size(), 1);
+
+        spool.acknowledge(pending.first().id);
+        QCOMPARE(QDir(directory.path()).entryList(QStringList() << "*.whs", QDir::Files).size(), 1);
+    }
+
+    {
+        Wh::Spool                spool(directory.path(), 8192);
+        QList<Wh::Spool::Record> pending;
+        QCOMPARE(spool.open(pending), true);
+        QCOMPARE(pending.size(), 0);
+    }
+}
+
+
+void TestSpool::testTornRecord() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    QUrl url("https://example.com/v2/test");
+
+    {
+        Wh::Spool                spool(directory.path());
+        QList<Wh::Spool::Record> pending;
+        QCOMPARE(spool.open(pending), true);
+
+        spool.append(url, QByteArray("first"));
+        spool.append(url, QByteArray("second"));
+    }
+
+    QStringList segmentFiles = QDir(directory.path()).entryList(QStringList() << "*.whs", QDir::Files, QDir::Name);
+    QFile       segmentFile(QDir(directory.path()).filePath(segmentFiles.last()));
+    QVERIFY(segmentFile.open(QFile::OpenModeFlag::ReadWrite));
+
+    QByteArray contents = segmentFile.readAll();
+    int        index    = contents.indexOf("second");
+    QVERIFY(index > 0);
+
+    segmentFile.seek(index);
+    segmentFile.write("SECOND");
+    segmentFile.close();
+
+    Wh::Spool                spool(directory.path());
+    QList<Wh::Spool::Record> pending;
+    QCOMPARE(spool.open(pending), true);
+    QCOMPARE(pending.size(), 1);
+    QCOMPARE(pending.first().payload, QByteArray("first"));
+}
+
+
+void TestSpool::cleanupTestCase() {}
@@ -0,0 +1,169 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::SubmissionQueue class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QUrl>
+#include <QByteArray>
+#include <QVector>
+
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include <wh_submission_queue.h>
+
+#include "test_submission_queue.h"
+
+TestSubmissionQueue::TestSubmissionQueue() {}
+
+
+TestSubmissionQueue::~TestSubmissionQueue() {}
+
+
+void TestSubmissionQueue::initTestCase() {}
+
+
+void TestSubmissionQueue::testOrder() {
+    Wh::SubmissionQueue queue(16);
+    QUrl                url("https://example.com/v2/test");
+
+    Wh::SubmissionQueue::Submission submission;
+    QCOMPARE(queue.pop(submission), false);
+
+    for (unsigned long long i=1 ; i<=40 ; ++i) {
+        QCOMPARE(queue.push(i, url, QByteArray::number(i)), true);
+
+        QCOMPARE(queue.pop(submission), true);
+        QCOMPARE(submission.id, i);
+        QCOMPARE(submission.url, url);
+        QCOMPARE(submission.payload, QByteArray::number(i));
+    }
+
+    QCOMPARE(queue.pop(submission), false);
+}
+
+
+void TestSubmissionQueue::testFull() {
+    Wh::SubmissionQueue queue(10);
+    QUrl                url("https://example.com/v2/test");
+
+    QCOMPARE(queue.capacity(), 16U);
+
+    for (unsigned long long i=1 ; i<=16 ; ++i) {
+        QCOMPARE(queue.push(i, url, QByteArray::number(i)), true);
+    }
+
+    QCOMPARE(queue.push(17, url, QByteArray("17")), false);
+
+    Wh::SubmissionQueue::Submission submission;
+    QCOMPARE(queue.pop(submission), true);
+    QCOMPARE(submission.id, 1ULL);
+
+    QCOMPARE(queue.push(17, url, QByteArray("17")), true);
+
+    for (unsigned long long i=2 ; i<=17 ; ++i) {
+        QCOMPARE(queue.pop(submission), true);
+        QCOMPARE(submission.id, i);
+    }
+
+    QCOMPARE(queue.pop(submission), false);
+}
+
+
+void TestSubmissionQueue::testDrainRequests() {
+    Wh::SubmissionQueue queue;
+
+    QCOMPARE(queue.requestDrain(), true);
+    QCOMPARE(queue.requestDrain(), false);
+    QCOMPARE(queue.requestDrain(), false);
+
+    queue.beginDrain();
+
+    QCOMPARE(queue.requestDrain(), true);
+    QCOMPARE(queue.requestDrain(), false);
+}
+
+
+void TestSubmissionQueue::testConcurrentProducers() {
+    static constexpr unsigned numberProducers     = 4;
+    static constexpr unsigned messagesPerProducer = 50000;
+
+    Wh::SubmissionQueue queue(1024);
+    QUrl                url("https://example.com/v2/test");
+    std::atomic<bool>   start(false);
+
+    std::vector<std::thread> producers;
+    for (unsigned producer=0 ; producer<numberProducers ; ++producer) {
+        producers.emplace_back(
+            [&queue, &url, &start, producer]() {
+                while (!start.load()) {
+                    std::this_thread::yield();
+                }
+
+                for (unsigned i=0 ; i<messagesPerProducer ; ++i) {
+                    unsigned long long messageId = (static_cast<unsigned long long>(producer) << 32) | i;
+                    while (!queue.push(messageId, url, QByteArray::number(messageId))) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        );
+    }
+
+    start.store(true);
+
+    QVector<unsigned> nextExpected(numberProducers, 0);
+    unsigned          received = 0;
+    bool              inOrder  = true;
+
+    Wh::SubmissionQueue::Submission submission;
+    while (received < numberProducers * messagesPerProducer) {
+        if (queue.pop(submission)) {
+            unsigned producer = static_cast<unsigned>(submission.id >> 32);
+            unsigned sequence = static_cast<unsigned>(submission.id & 0xFFFFFFFFULL);
+
+            if (producer >= numberProducers                                ||
+                sequence != nextExpected.at(producer)                      ||
+                submission.payload != QByteArray::number(submission.id)       ) {
+                inOrder = false;
+            } else {
+                ++nextExpected[producer];
+            }
+
+            ++received;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    for (std::thread& thread : producers) {
+        thread.join();
+    }
+
+    QCOMPARE(inOrder, true);
+    QCOMPARE(queue.pop(submission), false);
+}
+
+
+void TestSubmissionQueue::cleanupTestCase() {}
@@ -0,0 +1,181 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::TimeSync class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QSignalSpy>
+
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include <wh_time_sync.h>
+
+#include "test_time_sync.h"
+
+TestTimeSync::TestTimeSync() {}
+
+
+TestTimeSync::~TestTimeSync() {}
+
+
+void TestTimeSync::initTestCase() {}
+
+
+void TestTimeSync::testSingleFlight() {
+    static constexpr unsigned numberThreads = 8;
+
+    Wh::TimeSync          timeSync;
+    std::atomic<unsigned> winners(0);
+    std::atomic<bool>     start(false);
+
+    std::vector<std::thread> threads;
+    for (unsigned i=0 ; i<numberThreads ; ++i) {
+        threads.emplace_back(
+            [&timeSync, &winners, &start]() {
+                while (!start.load()) {
+                    std::this_thread::yield();
+                }
+
+                if (timeSync.acquire()) {
+                    ++winners;
+                }
+            }
+        );
+    }
+
+    start.store(true);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    QCOMPARE(winners.load(), 1U);
+    QCOMPARE(timeSync.isRefreshing(), true);
+    QCOMPARE(timeSync.acquire(), false);
+}
+
+
+void TestTimeSync::testPublish() {
+    Wh::TimeSync timeSync;
+    QSignalSpy   succeeded(&timeSync, &Wh::TimeSync::refreshSucceeded);
+    QSignalSpy   failed(&timeSync, &Wh::TimeSync::refreshFailed);
+
+    unsigned long long generation = timeSync.generation();
+
+    QCOMPARE(timeSync.acquire(), true);
+    QCOMPARE(timeSync.acquire(), false);
+
+    timeSync.publish(1234);
+
+    QCOMPARE(timeSync.timeDelta(), 1234LL);
+    QCOMPARE(timeSync.generation(), generation + 1);
+    QCOMPARE(timeSync.isRefreshing(), false);
+    QCOMPARE(succeeded.count(), 1);
+    QCOMPARE(failed.count(), 0);
+
+    timeSync.setTimeDelta(-5);
+    QCOMPARE(timeSync.timeDelta(), -5LL);
+    QCOMPARE(timeSync.generation(), generation + 2);
+    QCOMPARE(succeeded.count(), 1);
+
+    QCOMPARE(timeSync.acquire(), true);
+}
+
+
+void TestTimeSync::testFailure() {
+    Wh::TimeSync timeSync;
+    QSignalSpy   succeeded(&timeSync, &Wh::TimeSync::refreshSucceeded);
+    QSignalSpy   failed(&timeSync, &Wh::TimeSync::refreshFailed);
+
+    unsigned long long generation = timeSync.generation();
+
+    QCOMPARE(timeSync.acquire(), true);
+    timeSync.fail(99);
+
+    QCOMPARE(timeSync.generation(), generation);
+    QCOMPARE(timeSync.isRefreshing(), false);
+    QCOMPARE(succeeded.count(), 0);
+    QCOMPARE(failed.count(), 1);
+    QCOMPARE(failed.at(0).at(0).toInt(), 99);
+}
+
+
+void TestTimeSync::testAbandon() {
+    Wh::TimeSync timeSync;
+    QSignalSpy   abandoned(&timeSync, &Wh::TimeSync::refreshAbandoned);
+
+    QCOMPARE(timeSync.acquire(), true);
+    timeSync.abandon();
+
+    QCOMPARE(abandoned.count(), 1);
+    QCOMPARE(timeSync.acquire(), true);
+}
+
+
+void TestTimeSync::testRefreshDelay() {
+    Wh::TimeSync timeSync;
+    long long    now = 1000000000000LL;
+
+    QCOMPARE(timeSync.refreshDelay(300000, 5000, now), 0LL);
+
+    QCOMPARE(timeSync.acquire(), true);
+    timeSync.publish(100, now);
+
+    QCOMPARE(timeSync.refreshDelay(300000, 5000, now), 300000LL);
+    QCOMPARE(timeSync.refreshDelay(300000, 5000, now + 100000), 200000LL);
+    QCOMPARE(timeSync.refreshDelay(300000, 5000, now + 400000), 0LL);
+
+    QCOMPARE(timeSync.acquire(), true);
+    timeSync.fail(5, now + 1000);
+
+    QCOMPARE(timeSync.refreshDelay(300000, 5000, now + 1000), Wh::TimeSync::failureRefreshInterval);
+    QCOMPARE(timeSync.refreshDelay(20000, 5000, now + 1000), 20000LL);
+}
+
+
+void TestTimeSync::testDriftRefreshDelay() {
+    Wh::TimeSync timeSync;
+    long long    now = 1000000000000LL;
+
+    QCOMPARE(timeSync.acquire(), true);
+    timeSync.publish(0, now);
+
+    // Too close to the first update to measure drift.
+    QCOMPARE(timeSync.acquire(), true);
+    timeSync.publish(500, now + 1000);
+    QCOMPARE(timeSync.driftRate(), 0.0);
+
+    // One second of drift every 100 seconds.  Three quarters of a 5 second tolerance drifts away in 375 seconds.
+    QCOMPARE(timeSync.acquire(), true);
+    timeSync.publish(1000, now + 100000);
+    QCOMPARE(timeSync.driftRate(), 0.01);
+
+    QCOMPARE(timeSync.refreshDelay(3600000, 5000, now + 100000), 375000LL);
+    QCOMPARE(timeSync.refreshDelay(300000, 5000, now + 100000), 300000LL);
+
+    // Fast drift is bounded by the minimum refresh interval.
+    QCOMPARE(timeSync.refreshDelay(3600000, 10, now + 100000), Wh::TimeSync::minimumRefreshInterval);
+}
+
+
+void TestTimeSync::cleanupTestCase() {}
@@ -29,17 +29,61 @@
 #include <QUrl>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QNetworkRequest>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QByteArray>
+#include <QList>
+#include <QTemporaryDir>
 
 #include <cstdint>
+#include <algorithm>
 
 #include <wh_web_hook.h>
+#include <wh_retry_policy.h>
+#include <wh_metrics.h>
+#include <wh_flow_control.h>
+#include <wh_circuit_breaker.h>
+#include <wh_spool.h>
 
+#include "stand_in_server.h"
 #include "test_web_hook.h"
 
-// Fill me in with the time-stamp webhook secret.
+Q_DECLARE_METATYPE(Wh::WebHook::Compression)
+
+/**
+ * Network access manager that records every request it is asked to send.
+ */
+class RecordingNetworkAccessManager:public QNetworkAccessManager {
+    public:
+        /**
+         * The recorded requests, oldest first.
+         */
+        QList<QNetworkRequest> requests;
+
+    protected:
+        /**
+         * Method that is called to create each request.
+         *
+         * \param[in] operation    The requested operation.
+         *
+         * \param[in] request      The request to be sent.
+         *
+         * \param[in] outgoingData The request body.
+         *
+         * \return Returns the network reply.
+         */
+        QNetworkReply* createRequest(
+                Operation              operation,
+                const QNetworkRequest& request,
+                QIODevice*             outgoingData
+            ) override {
+            requests.append(request);
+            return QNetworkAccessManager::createRequest(operation, request, outgoingData);
+        }
+};
+
+// Secrets shared with the stand-in server.
 static const std::uint8_t tsSecretData[64] = {
     0x13, 0xDF, 0x36, 0x03,   0x22, 0xAD, 0x3A, 0x99,
     0xBC, 0x8F, 0x38, 0x14,   0xDA, 0x35, 0x25, 0x16,
@@ -62,10 +106,7 @@ static const std::uint8_t testSecretData[52] = {
 };
 
 const QByteArray TestWebHook::timeStampSecret(reinterpret_cast<const char*>(tsSecretData), 64);
-const QString    TestWebHook::timeStampWebHookUrl("https://autonoma2.inesonic.com/v2/ts");
-
 const QByteArray TestWebHook::testSecret(reinterpret_cast<const char*>(testSecretData), 52);
-const QString    TestWebHook::testWebHookUrl("https://autonoma2.inesonic.com/v2/test");
 
 TestWebHook::TestWebHook() {
     eventLoop           = new QEventLoop(this);
@@ -74,21 +115,26 @@ TestWebHook::TestWebHook() {
     receivedJsonData      = false;
     receivedRawData       = false;
     timeDeltaWasUpdated   = false;
+    expectedMessages      = 0;
 
+    server               = new StandInServer(testSecret, timeStampSecret);
     networkAccessManager = new QNetworkAccessManager(this);
     webHook              = new Wh::WebHook(networkAccessManager, testSecret, this);
 
     Wh::WebHook::setTimestampSecret(timeStampSecret);
-    Wh::WebHook::setTimestampUrl(QUrl(timeStampWebHookUrl));
 
     connect(webHook, &Wh::WebHook::timeDeltaUpdated, this, &TestWebHook::timeDeltaUpdated);
     connect(webHook, &Wh::WebHook::jsonResponseReceived, this, &TestWebHook::jsonResponseReceived);
     connect(webHook, &Wh::WebHook::responseReceived, this, &TestWebHook::responseReceived);
     connect(webHook, &Wh::WebHook::failedToSend, this, &TestWebHook::failedToSend);
+    connect(webHook, &Wh::WebHook::messageDelivered, this, &TestWebHook::messageDelivered);
+    connect(webHook, &Wh::WebHook::messageFailed, this, &TestWebHook::messageFailed);
 }
 
 
-TestWebHook::~TestWebHook() {}
+TestWebHook::~TestWebHook() {
+    delete server;
+}
 
 
 void TestWebHook::timeDeltaUpdated() {
@@ -109,18 +155,46 @@ void TestWebHook::responseReceived(const QByteArray& rawData) {
     receivedRawData = true;
     reportedRawData = rawData;
 
-    eventLoop->quit();
+    if (expectedMessages == 0) {
+        eventLoop->quit();
+    }
 }
 
 
 void TestWebHook::failedToSend(int networkError) {
     (void) networkError;
     operationFailed = true;
-    eventLoop->quit();
+
+    if (expectedMessages == 0) {
+        eventLoop->quit();
+    }
 }
 
 
-void TestWebHook::initTestCase() {}
+void TestWebHook::messageDelivered(unsigned long long messageId, const QByteArray& rawData) {
+    deliveredMessages.append(messageId);
+    deliveredResults.insert(messageId, rawData);
+
+    if (expectedMessages > 0 && deliveredMessages.size() + failedMessages.size() == expectedMessages) {
+        eventLoop->quit();
+    }
+}
+
+
+void TestWebHook::messageFailed(unsigned long long messageId, int networkError) {
+    (void) networkError;
+    failedMessages.append(messageId);
+
+    if (expectedMessages > 0 && deliveredMessages.size() + failedMessages.size() == expectedMessages) {
+        eventLoop->quit();
+    }
+}
+
+
+void TestWebHook::initTestCase() {
+    QVERIFY(server->start());
+    Wh::WebHook::setTimestampUrl(server->timestampUrl());
+}
 
 
 void TestWebHook::testTimeDelta() {
@@ -138,6 +212,38 @@ void TestWebHook::testTimeDelta() {
 }
 
 
+void TestWebHook::testTimeDeltaUpdatedScope() {
+    Wh::WebHook otherWebHook(networkAccessManager, testSecret);
+
+    unsigned otherUpdates = 0;
+    connect(&otherWebHook, &Wh::WebHook::timeDeltaUpdated, [&otherUpdates]() { ++otherUpdates; });
+
+    quitOnTimestampUpdate = true;
+    operationFailed       = false;
+    timeDeltaWasUpdated   = false;
+
+    // Only the webhook that asked for the time delta reports the update.
+    webHook->forceTimeDeltaAdjustment();
+    eventLoop->exec();
+
+    QCOMPARE(timeDeltaWasUpdated, true);
+    QCOMPARE(otherUpdates, 0U);
+
+    timeDeltaWasUpdated = false;
+
+    QEventLoop loop;
+    connect(&otherWebHook, &Wh::WebHook::timeDeltaUpdated, &loop, &QEventLoop::quit);
+    QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+
+    otherWebHook.forceTimeDeltaAdjustment();
+    loop.exec();
+
+    QCOMPARE(otherUpdates, 1U);
+    QCOMPARE(timeDeltaWasUpdated, false);
+    QCOMPARE(operationFailed, false);
+}
+
+
 void TestWebHook::testMessage() {
     quitOnTimestampUpdate = false;
     operationFailed       = false;
@@ -148,7 +254,7 @@ void TestWebHook::testMessage() {
     QJsonObject json;
     json.insert(QString("test_data"), 1);
 
-    webHook->send(testWebHookUrl, json);
+    webHook->send(testWebHookUrl(), json);
     eventLoop->exec();
 
     QCOMPARE(receivedJsonData, true);
@@ -165,4 +271,813 @@ void TestWebHook::testMessageWithDelta() {
 }
 
 
-void TestWebHook::cleanupTestCase() {}
+void TestWebHook::testConcurrentMessages() {
+    quitOnTimestampUpdate = false;
+    operationFailed       = false;
+    receivedJsonData      = false;
+    receivedRawData       = false;
+    timeDeltaWasUpdated   = false;
+    expectedMessages      = 20;
+
+    deliveredMessages.clear();
+    failedMessages.clear();
+
+    webHook->setTimeDelta(0);
+    webHook->setMaximumInFlight(4);
+
+    QList<unsigned long long> messageIds;
+    for (int i=0 ; i<expectedMessages ; ++i) {
+        QJsonObject json;
+        json.insert(QString("test_data"), i);
+
+        messageIds.append(webHook->send(testWebHookUrl(), json));
+    }
+
+    QCOMPARE(webHook->messagesInFlight(), 4U);
+    QCOMPARE(webHook->messagesQueued(), static_cast<unsigned>(expectedMessages - 4));
+
+    eventLoop->exec();
+    expectedMessages = 0;
+
+    QCOMPARE(failedMessages.size(), 0);
+    QCOMPARE(deliveredMessages.size(), messageIds.size());
+
+    for (unsigned long long messageId : messageIds) {
+        QCOMPARE(deliveredMessages.contains(messageId), true);
+    }
+
+    QCOMPARE(webHook->messagesInFlight(), 0U);
+    QCOMPARE(webHook->messagesQueued(), 0U);
+}
+
+
+void TestWebHook::testBadSignature() {
+    Wh::WebHook badWebHook(networkAccessManager, QByteArray("not the right secret"));
+    badWebHook.setRetryPolicy(QSharedPointer<Wh::RetryPolicy>(new Wh::RetryPolicy(2, 1, 10)));
+
+    QEventLoop                loop;
+    QList<unsigned long long> failed;
+    connect(
+        &badWebHook,
+        &Wh::WebHook::messageFailed,
+        &loop,
+        [&loop, &failed](unsigned long long messageId, int) {
+            failed.append(messageId);
+            loop.quit();
+        }
+    );
+
+    server->resetCounters();
+
+    QJsonObject json;
+    json.insert(QString("test_data"), 1);
+
+    unsigned long long messageId = badWebHook.send(testWebHookUrl(), json);
+
+    QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    QCOMPARE(failed, QList<unsigned long long>() << messageId);
+    QVERIFY(server->signatureFailures() >= 2);
+    QCOMPARE(server->messagesAccepted(), 0ULL);
+}
+
+
+void TestWebHook::testServerClockSkew() {
+    quitOnTimestampUpdate = false;
+    operationFailed       = false;
+    receivedJsonData      = false;
+    receivedRawData       = false;
+    timeDeltaWasUpdated   = false;
+
+    // Three hours puts the server well outside the signing window so the first attempt must be rejected.
+    long long skew = 3LL * 3600000LL;
+
+    server->resetCounters();
+    server->setClockSkew(skew);
+    webHook->setTimeDelta(0);
+
+    QJsonObject json;
+    json.insert(QString("test_data"), 2);
+
+    webHook->send(testWebHookUrl(), json);
+    eventLoop->exec();
+
+    server->setClockSkew(0);
+
+    QCOMPARE(receivedJsonData, true);
+    QCOMPARE(timeDeltaWasUpdated, true);
+    QVERIFY(server->signatureFailures() >= 1);
+    QVERIFY(server->timestampRequests() >= 1);
+    QCOMPARE(server->messagesAccepted(), 1ULL);
+    QVERIFY(qAbs(Wh::WebHook::timeDelta() - skew) < 5000);
+}
+
+
+void TestWebHook::testInjectedErrors() {
+    quitOnTimestampUpdate = false;
+    operationFailed       = false;
+    receivedJsonData      = false;
+    receivedRawData       = false;
+    timeDeltaWasUpdated   = false;
+    expectedMessages      = 40;
+
+    deliveredMessages.clear();
+    failedMessages.clear();
+
+    QSharedPointer<Wh::RetryPolicy> originalPolicy = webHook->retryPolicy();
+    webHook->setRetryPolicy(QSharedPointer<Wh::RetryPolicy>(new Wh::RetryPolicy(10, 1, 10)));
+    webHook->setTimeDelta(0);
+    webHook->setMaximumInFlight(1);
+
+    // A single message in flight and a fixed seed make the sequence of injected errors repeatable.
+    server->stop();
+    server->setSeed(12345);
+    server->setErrorRate(0.1);
+    QVERIFY(server->start());
+    Wh::WebHook::setTimestampUrl(server->timestampUrl());
+
+    for (int i=0 ; i<expectedMessages ; ++i) {
+        QJsonObject json;
+        json.insert(QString("test_data"), i);
+
+        webHook->send(testWebHookUrl(), json);
+    }
+
+    eventLoop->exec();
+    expectedMessages = 0;
+
+    server->setErrorRate(0.0);
+    webHook->setRetryPolicy(originalPolicy);
+
+    QCOMPARE(failedMessages.size(), 0);
+    QCOMPARE(deliveredMessages.size(), 40);
+    QVERIFY(server->injectedErrors() > 0);
+    QCOMPARE(server->messagesAccepted(), 40ULL);
+
+    // Every retry carries the key of the attempt that failed.
+    QVERIFY(server->repeatedIdempotencyKeys() > 0);
+    QVERIFY(server->repeatedIdempotencyKeys() <= server->injectedErrors());
+}
+
+
+void TestWebHook::testBatching() {
+    quitOnTimestampUpdate = false;
+    operationFailed       = false;
+    receivedJsonData      = false;
+    receivedRawData       = false;
+    timeDeltaWasUpdated   = false;
+    expectedMessages      = 4;
+
+    deliveredMessages.clear();
+    failedMessages.clear();
+    deliveredResults.clear();
+
+    unsigned originalCount = webHook->batchMaximumCount();
+    unsigned originalBytes = webHook->batchMaximumBytes();
+    unsigned originalDelay = webHook->batchMaximumDelay();
+
+    webHook->setTimeDelta(0);
+    webHook->setMaximumInFlight(8);
+    webHook->setBatchingEnabled();
+    server->resetCounters();
+
+    // The stand-in server echoes the array it receives so every submitter should get back its own payload.
+    QHash<unsigned long long, QByteArray> payloads;
+
+    // Count threshold: the fourth payload closes the batch.
+    webHook->setBatchThresholds(4, 65536, 60000);
+    for (int i=0 ; i<4 ; ++i) {
+        QJsonObject json;
+        json.insert(QString("test_data"), i);
+
+        unsigned long long messageId = webHook->send(testWebHookUrl(), json);
+        payloads.insert(messageId, QJsonDocument(json).toJson(QJsonDocument::JsonFormat::Compact));
+    }
+
+    QCOMPARE(webHook->messagesInFlight(), 1U);
+
+    eventLoop->exec();
+    QCOMPARE(server->messagesAccepted(), 1ULL);
+
+    // Size threshold: each payload below is 15 bytes so "[a,b]" fills a 33 byte batch.
+    deliveredMessages.clear();
+    server->resetCounters();
+
+    webHook->setBatchThresholds(100, 33, 60000);
+    for (int i=4 ; i<8 ; ++i) {
+        QJsonObject json;
+        json.insert(QString("test_data"), i);
+
+        unsigned long long messageId = webHook->send(testWebHookUrl(), json);
+        payloads.insert(messageId, QJsonDocument(json).toJson(QJsonDocument::JsonFormat::Compact));
+    }
+
+    QCOMPARE(webHook->messagesInFlight(), 2U);
+
+    eventLoop->exec();
+    QCOMPARE(server->messagesAccepted(), 2ULL);
+
+    // Delay threshold: nothing is sent until the batch timer fires.
+    deliveredMessages.clear();
+    server->resetCounters();
+    expectedMessages = 3;
+
+    webHook->setBatchThresholds(100, 65536, 50);
+    for (int i=8 ; i<11 ; ++i) {
+        QJsonObject json;
+        json.insert(QString("test_data"), i);
+
+        unsigned long long messageId = webHook->send(testWebHookUrl(), json);
+        payloads.insert(messageId, QJsonDocument(json).toJson(QJsonDocument::JsonFormat::Compact));
+    }
+
+    QCOMPARE(webHook->messagesInFlight(), 0U);
+
+    eventLoop->exec();
+    expectedMessages = 0;
+
+    webHook->setBatchingEnabled(false);
+    webHook->setBatchThresholds(originalCount, originalBytes, originalDelay);
+
+    QCOMPARE(server->messagesAccepted(), 1ULL);
+    QCOMPARE(failedMessages.size(), 0);
+    QCOMPARE(deliveredResults.size(), payloads.size());
+
+    for (unsigned long long messageId : payloads.keys()) {
+        QCOMPARE(deliveredResults.value(messageId), payloads.value(messageId));
+    }
+}
+
+
+void TestWebHook::testPriorities() {
+    quitOnTimestampUpdate = false;
+    operationFailed       = false;
+    receivedJsonData      = false;
+    receivedRawData       = false;
+    timeDeltaWasUpdated   = false;
+    expectedMessages      = 6;
+
+    deliveredMessages.clear();
+    failedMessages.clear();
+
+    webHook->setTimeDelta(0);
+    webHook->setMaximumInFlight(1);
+
+    // The first bulk message takes the only slot.  Every high priority message must then go ahead of the rest.
+    QList<unsigned long long> bulkIds;
+    QList<unsigned long long> highIds;
+    for (int i=0 ; i<3 ; ++i) {
+        QJsonObject json;
+        json.insert(QString("test_data"), i);
+
+        bulkIds.append(webHook->send(testWebHookUrl(), json, Wh::WebHook::Priority::BULK));
+    }
+
+    for (int i=0 ; i<3 ; ++i) {
+        QJsonObject json;
+        json.insert(QString("test_data"), i);
+
+        highIds.append(webHook->send(testWebHookUrl(), json, Wh::WebHook::Priority::HIGH));
+    }
+
+    QCOMPARE(webHook->messagesInFlight(Wh::WebHook::Priority::BULK), 1U);
+    QCOMPARE(webHook->messagesQueued(Wh::WebHook::Priority::BULK), 2U);
+    QCOMPARE(webHook->messagesQueued(Wh::WebHook::Priority::HIGH), 3U);
+    QCOMPARE(webHook->messagesQueued(), 5U);
+
+    eventLoop->exec();
+
+    QCOMPARE(failedMessages.size(), 0);
+    QCOMPARE(
+        deliveredMessages,
+        QList<unsigned long long>() << bulkIds.at(0) << highIds << bulkIds.at(1) << bulkIds.at(2)
+    );
+
+    // A lane limit keeps bulk traffic from taking the slots reserved for other priorities.
+    deliveredMessages.clear();
+    expectedMessages = 5;
+
+    webHook->setMaximumInFlight(4);
+    webHook->setMaximumInFlight(Wh::WebHook::Priority::BULK, 1);
+    QCOMPARE(webHook->maximumInFlight(Wh::WebHook::Priority::BULK), 1U);
+
+    for (int i=0 ; i<3 ; ++i) {
+        QJsonObject json;
+        json.insert(QString("test_data"), i);
+
+        webHook->send(testWebHookUrl(), json, Wh::WebHook::Priority::BULK);
+    }
+
+    for (int i=0 ; i<2 ; ++i) {
+        QJsonObject json;
+        json.insert(QString("test_data"), i);
+
+        webHook->send(testWebHookUrl(), json);
+    }
+
+    QCOMPARE(webHook->messagesInFlight(Wh::WebHook::Priority::BULK), 1U);
+    QCOMPARE(webHook->messagesInFlight(Wh::WebHook::Priority::NORMAL), 2U);
+    QCOMPARE(webHook->messagesQueued(Wh::WebHook::Priority::BULK), 2U);
+
+    eventLoop->exec();
+    expectedMessages = 0;
+
+    webHook->setMaximumInFlight(Wh::WebHook::Priority::BULK, 0);
+
+    QCOMPARE(failedMessages.size(), 0);
+    QCOMPARE(deliveredMessages.size(), 5);
+    QCOMPARE(webHook->messagesInFlight(), 0U);
+    QCOMPARE(webHook->messagesQueued(), 0U);
+}
+
+
+void TestWebHook::testFlowControl() {
+    quitOnTimestampUpdate = false;
+    operationFailed       = false;
+    receivedJsonData      = false;
+    receivedRawData       = false;
+    timeDeltaWasUpdated   = false;
+    expectedMessages      = 5;
+
+    deliveredMessages.clear();
+    failedMessages.clear();
+
+    QSharedPointer<Wh::FlowControl> flowControl(new Wh::FlowControl);
+    flowControl->setConcurrencyLimits(1, 1, 1);
+
+    webHook->setTimeDelta(0);
+    webHook->setMaximumInFlight(8);
+    webHook->setFlowControl(flowControl);
+
+    for (int i=0 ; i<expectedMessages ; ++i) {
+        QJsonObject json;
+        json.insert(QString("test_data"), i);
+
+        webHook->send(testWebHookUrl(), json);
+    }
+
+    // Held back messages stay queued rather than taking the webhook's in-flight slots.
+    QString destination = testWebHookUrl().adjusted(QUrl::RemovePath).toString();
+    QCOMPARE(flowControl->outstanding(destination), 1U);
+    QCOMPARE(webHook->messagesInFlight(), 1U);
+    QCOMPARE(webHook->messagesQueued(), 4U);
+
+    eventLoop->exec();
+    expectedMessages = 0;
+
+    webHook->setFlowControl(QSharedPointer<Wh::FlowControl>());
+
+    QCOMPARE(failedMessages.size(), 0);
+    QCOMPARE(deliveredMessages.size(), 5);
+    QCOMPARE(flowControl->outstanding(destination), 0U);
+    QCOMPARE(webHook->messagesQueued(), 0U);
+}
+
+
+void TestWebHook::testCircuitBreaker() {
+    Wh::WebHook downWebHook(networkAccessManager, testSecret);
+    downWebHook.setRetryPolicy(QSharedPointer<Wh::RetryPolicy>(new Wh::RetryPolicy(10, 1, 10)));
+    downWebHook.setMaximumInFlight(1);
+
+    QSharedPointer<Wh::CircuitBreaker> circuitBreaker(new Wh::CircuitBreaker(2, 60000));
+    downWebHook.setCircuitBreaker(circuitBreaker);
+
+    QEventLoop                loop;
+    QList<unsigned long long> failed;
+    connect(
+        &downWebHook,
+        &Wh::WebHook::messageFailed,
+        &loop,
+        [&loop, &failed](unsigned long long messageId, int) {
+            failed.append(messageId);
+            loop.quit();
+        }
+    );
+
+    // Nothing listens on port 1 so every attempt is refused.
+    QUrl downUrl("http://127.0.0.1:1/v2/test");
+
+    QJsonObject json;
+    json.insert(QString("test_data"), 1);
+
+    unsigned long long messageId = downWebHook.send(downUrl, json);
+
+    QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    // The second refusal opens the circuit so the retries stop well short of the retry policy's limit.
+    QCOMPARE(failed, QList<unsigned long long>() << messageId);
+    QCOMPARE(circuitBreaker->state(downUrl.toString()), Wh::CircuitBreaker::State::OPEN);
+
+    // Messages to an open circuit fail without being sent.
+    failed.clear();
+    for (int i=0 ; i<3 ; ++i) {
+        downWebHook.send(downUrl, json);
+    }
+
+    QCOMPARE(failed.size(), 3);
+    QCOMPARE(downWebHook.messagesInFlight(), 0U);
+    QCOMPARE(downWebHook.messagesQueued(), 0U);
+}
+
+
+void TestWebHook::testSpool() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    QUrl downUrl("http://127.0.0.1:1/v2/test");
+
+    {
+        Wh::WebHook spooledWebHook(networkAccessManager, testSecret);
+        spooledWebHook.setRetryPolicy(QSharedPointer<Wh::RetryPolicy>(new Wh::RetryPolicy(1, 1, 10)));
+        spooledWebHook.setSpoolSynchronous();
+        QCOMPARE(spooledWebHook.setSpoolDirectory(directory.path()), true);
+        QCOMPARE(spooledWebHook.spoolSynchronous(), true);
+
+        QEventLoop loop;
+        unsigned   completed = 0;
+        connect(
+            &spooledWebHook,
+            &Wh::WebHook::messageDelivered,
+            &loop,
+            [&loop, &completed](unsigned long long, const QByteArray&) {
+                if (++completed == 2) {
+                    loop.quit();
+                }
+            }
+        );
+        connect(
+            &spooledWebHook,
+            &Wh::WebHook::messageFailed,
+            &loop,
+            [&loop, &completed](unsigned long long, int) {
+                if (++completed == 2) {
+                    loop.quit();
+                }
+            }
+        );
+
+        QJsonObject json;
+        json.insert(QString("test_data"), 1);
+
+        // Nothing listens on port 1 so the message fails once its single attempt is refused.
+        spooledWebHook.setTimeDelta(0);
+        spooledWebHook.send(testWebHookUrl(), json);
+        spooledWebHook.send(downUrl, json, Wh::WebHook::Priority::BULK);
+
+        QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+        loop.exec();
+
+        QCOMPARE(completed, 2U);
+    }
+
+    // The delivered message is removed from the spool.  The failed message is kept so that it is resent, at its
+    // original priority, when the spool is reopened.
+    Wh::Spool                spool(directory.path());
+    QList<Wh::Spool::Record> pending;
+    QCOMPARE(spool.open(pending), true);
+    QCOMPARE(pending.size(), 1);
+    QCOMPARE(pending.first().url, downUrl);
+    QCOMPARE(pending.first().priority, static_cast<unsigned>(Wh::WebHook::Priority::BULK));
+}
+
+
+void TestWebHook::testDeduplication() {
+    quitOnTimestampUpdate = false;
+    operationFailed       = false;
+    receivedJsonData      = false;
+    receivedRawData       = false;
+    timeDeltaWasUpdated   = false;
+    expectedMessages      = 7;
+
+    deliveredMessages.clear();
+    failedMessages.clear();
+
+    webHook->setTimeDelta(0);
+    webHook->setMaximumInFlight(1);
+    webHook->setDeduplicationEnabled();
+    server->resetCounters();
+
+    QJsonObject first;
+    first.insert(QString("test_data"), 0);
+
+    QJsonObject repeated;
+    repeated.insert(QString("test_data"), 1);
+
+    QJsonObject other;
+    other.insert(QString("test_data"), 2);
+
+    // The first message takes the only slot so the others wait in the queue where duplicates can be folded.
+    QList<unsigned long long> messageIds;
+    messageIds.append(webHook->send(testWebHookUrl(), first));
+    for (int i=0 ; i<4 ; ++i) {
+        messageIds.append(webHook->send(testWebHookUrl(), repeated));
+    }
+
+    messageIds.append(webHook->send(testWebHookUrl(), other));
+    messageIds.append(webHook->send(testWebHookUrl(), repeated, Wh::WebHook::Priority::BULK));
+
+    QCOMPARE(webHook->messagesInFlight(), 1U);
+    QCOMPARE(webHook->messagesQueued(), 3U);
+
+    eventLoop->exec();
+    expectedMessages = 0;
+
+    webHook->setDeduplicationEnabled(false);
+
+    std::sort(deliveredMessages.begin(), deliveredMessages.end());
+
+    QCOMPARE(failedMessages.size(), 0);
+    QCOMPARE(deliveredMessages, messageIds);
+    QCOMPARE(server->messagesAccepted(), 4ULL);
+    QCOMPARE(server->repeatedIdempotencyKeys(), 0ULL);
+}
+
+
+void TestWebHook::testFanOut() {
+    quitOnTimestampUpdate = false;
+    operationFailed       = false;
+    receivedJsonData      = false;
+    receivedRawData       = false;
+    timeDeltaWasUpdated   = false;
+    expectedMessages      = 3;
+
+    deliveredMessages.clear();
+    failedMessages.clear();
+
+    QSharedPointer<Wh::Metrics> originalMetrics = webHook->metrics();
+    QSharedPointer<Wh::Metrics> metrics(new Wh::Metrics);
+
+    webHook->setMetrics(metrics);
+    webHook->setTimeDelta(0);
+    webHook->setMaximumInFlight(8);
+    server->resetCounters();
+
+    QList<QUrl> destinationUrls;
+    destinationUrls << server->url(QString("/v2/first"))
+                    << server->url(QString("/v2/second"))
+                    << server->url(QString("/v2/third"));
+
+    QJsonObject json;
+    json.insert(QString("test_data"), 1);
+
+    QList<unsigned long long> messageIds = webHook->send(destinationUrls, json);
+    QCOMPARE(messageIds.size(), 3);
+
+    eventLoop->exec();
+    expectedMessages = 0;
+
+    webHook->setMetrics(originalMetrics);
+
+    std::sort(deliveredMessages.begin(), deliveredMessages.end());
+
+    // Every destination reports its own result while the envelope is signed only once.
+    QCOMPARE(failedMessages.size(), 0);
+    QCOMPARE(deliveredMessages, messageIds);
+    QCOMPARE(server->messagesAccepted(), 3ULL);
+    QCOMPARE(metrics->snapshot().counter(Wh::Metrics::Counter::REQUESTS), 3ULL);
+    QCOMPARE(metrics->snapshot().latency(Wh::Metrics::Latency::SIGN).count(), 1ULL);
+}
+
+
+void TestWebHook::testEnvelopeNegotiation() {
+    Wh::WebHook cborWebHook(networkAccessManager, testSecret);
+    cborWebHook.setEnvelopeFormat(Wh::WebHook::EnvelopeFormat::CBOR);
+
+    // A single attempt and no retries, so only a resend that stays outside the retry budget can deliver the message.
+    cborWebHook.setRetryPolicy(QSharedPointer<Wh::RetryPolicy>(new Wh::RetryPolicy(1, 1, 10)));
+
+    // Metrics are opt-in.
+    QVERIFY(cborWebHook.metrics().isNull());
+
+    QSharedPointer<Wh::Metrics> metrics(new Wh::Metrics);
+    cborWebHook.setMetrics(metrics);
+
+    QEventLoop                loop;
+    QList<unsigned long long> delivered;
+    QList<unsigned long long> failed;
+    connect(
+        &cborWebHook,
+        &Wh::WebHook::messageDelivered,
+        &loop,
+        [&loop, &delivered](unsigned long long messageId, const QByteArray&) {
+            delivered.append(messageId);
+            loop.quit();
+        }
+    );
+    connect(
+        &cborWebHook,
+        &Wh::WebHook::messageFailed,
+        &loop,
+        [&loop, &failed](unsigned long long messageId, int) {
+            failed.append(messageId);
+            loop.quit();
+        }
+    );
+
+    bool originalCborAccepted = server->cborAccepted();
+    server->setCborAccepted(false);
+    server->resetCounters();
+
+    QJsonObject json;
+    json.insert(QString("test_data"), 1);
+
+    cborWebHook.setTimeDelta(0);
+    unsigned long long messageId = cborWebHook.send(testWebHookUrl(), json);
+
+    QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    server->setCborAccepted(originalCborAccepted);
+
+    // The server refuses the binary envelope once and the message is resent as JSON.
+    QCOMPARE(failed.size(), 0);
+    QCOMPARE(delivered, QList<unsigned long long>() << messageId);
+    QCOMPARE(server->messagesAccepted(), 1ULL);
+
+    Wh::Metrics::Snapshot snapshot = metrics->snapshot();
+    QCOMPARE(snapshot.counter(Wh::Metrics::Counter::REQUESTS), 2ULL);
+    QCOMPARE(snapshot.counter(Wh::Metrics::Counter::RETRIES), 0ULL);
+}
+
+
+void TestWebHook::testCompression_data() {
+    QTest::addColumn<Wh::WebHook::Compression>("compression");
+
+    QTest::newRow("deflate") << Wh::WebHook::Compression::DEFLATE;
+    QTest::newRow("gzip")    << Wh::WebHook::Compression::GZIP;
+}
+
+
+void TestWebHook::testCompression() {
+    QFETCH(Wh::WebHook::Compression, compression);
+
+    Wh::WebHook compressingWebHook(networkAccessManager, testSecret);
+    compressingWebHook.setCompression(compression, 0);
+    QCOMPARE(compressingWebHook.compression(), compression);
+    QCOMPARE(compressingWebHook.compressionThreshold(), 0U);
+
+    QEventLoop loop;
+    bool       delivered = false;
+    QByteArray response;
+    connect(
+        &compressingWebHook,
+        &Wh::WebHook::messageDelivered,
+        &loop,
+        [&loop, &delivered, &response](unsigned long long, const QByteArray& rawData) {
+            delivered = true;
+            response  = rawData;
+            loop.quit();
+        }
+    );
+    connect(&compressingWebHook, &Wh::WebHook::messageFailed, &loop, &QEventLoop::quit);
+
+    server->resetCounters();
+
+    // A repetitive payload so the compressed body is smaller than the envelope and is sent compressed.
+    QJsonObject json;
+    json.insert(QString("test_data"), QString("compressible ").repeated(256));
+    json.insert(QString("sequence"), 42);
+
+    compressingWebHook.setTimeDelta(0);
+    compressingWebHook.send(testWebHookUrl(), json);
+
+    QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    QCOMPARE(delivered, true);
+    QCOMPARE(server->messagesAccepted(), 1ULL);
+    QCOMPARE(server->compressedMessagesAccepted(), 1ULL);
+
+    // The server echoes the payload it decoded and verified.
+    QCOMPARE(QJsonDocument::fromJson(response).object(), json);
+}
+
+
+void TestWebHook::testWarmUp() {
+    // A new network access manager has no connections so the one made by warmUp is the only one it holds.
+    QNetworkAccessManager warmManager;
+    Wh::WebHook           warmWebHook(&warmManager, testSecret);
+
+    server->resetCounters();
+
+    warmWebHook.warmUp(testWebHookUrl());
+    QTRY_COMPARE(server->connectionsAccepted(), 1ULL);
+    QCOMPARE(server->requestsServed(), 0ULL);
+
+    QEventLoop                loop;
+    QList<unsigned long long> delivered;
+    QList<unsigned long long> failed;
+    connect(
+        &warmWebHook,
+        &Wh::WebHook::messageDelivered,
+        &loop,
+        [&loop, &delivered](unsigned long long messageId, const QByteArray&) {
+            delivered.append(messageId);
+            loop.quit();
+        }
+    );
+    connect(
+        &warmWebHook,
+        &Wh::WebHook::messageFailed,
+        &loop,
+        [&loop, &failed](unsigned long long messageId, int) {
+            failed.append(messageId);
+            loop.quit();
+        }
+    );
+
+    QJsonObject json;
+    json.insert(QString("test_data"), 1);
+
+    warmWebHook.setTimeDelta(0);
+    unsigned long long messageId = warmWebHook.send(testWebHookUrl(), json);
+
+    QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    // The message is sent over the warmed connection.
+    QCOMPARE(failed.size(), 0);
+    QCOMPARE(delivered, QList<unsigned long long>() << messageId);
+    QCOMPARE(server->messagesAccepted(), 1ULL);
+    QCOMPARE(server->connectionsAccepted(), 1ULL);
+}
+
+
+void TestWebHook::testConnectionSettings_data() {
+    QTest::addColumn<bool>("http2Enabled");
+    QTest::addColumn<bool>("keepAliveEnabled");
+    QTest::addColumn<QByteArray>("connectionHeader");
+
+    QTest::newRow("http/1.1 keep-alive")  << false << true  << QByteArray();
+    QTest::newRow("http/1.1 close")       << false << false << QByteArray("close");
+    QTest::newRow("http/2")               << true  << true  << QByteArray();
+    QTest::newRow("http/2 no keep-alive") << true  << false << QByteArray();
+}
+
+
+void TestWebHook::testConnectionSettings() {
+    QFETCH(bool, http2Enabled);
+    QFETCH(bool, keepAliveEnabled);
+    QFETCH(QByteArray, connectionHeader);
+
+    RecordingNetworkAccessManager recordingManager;
+    Wh::WebHook                   recordingWebHook(&recordingManager, testSecret);
+
+    // The redirect policy and HSTS are configured once, when the webhook is constructed.
+    QCOMPARE(recordingManager.redirectPolicy(), QNetworkRequest::RedirectPolicy::NoLessSafeRedirectPolicy);
+    QCOMPARE(recordingManager.isStrictTransportSecurityEnabled(), false);
+
+    recordingManager.setRedirectPolicy(QNetworkRequest::RedirectPolicy::ManualRedirectPolicy);
+    recordingManager.setStrictTransportSecurityEnabled(true);
+
+    recordingWebHook.setHttp2Enabled(http2Enabled);
+    recordingWebHook.setKeepAliveEnabled(keepAliveEnabled);
+    QCOMPARE(recordingWebHook.http2Enabled(), http2Enabled);
+    QCOMPARE(recordingWebHook.keepAliveEnabled(), keepAliveEnabled);
+
+    QEventLoop loop;
+    bool       delivered = false;
+    connect(
+        &recordingWebHook,
+        &Wh::WebHook::messageDelivered,
+        &loop,
+        [&loop, &delivered](unsigned long long, const QByteArray&) {
+            delivered = true;
+            loop.quit();
+        }
+    );
+    connect(&recordingWebHook, &Wh::WebHook::messageFailed, &loop, &QEventLoop::quit);
+
+    QJsonObject json;
+    json.insert(QString("test_data"), 1);
+
+    recordingWebHook.setTimeDelta(0);
+    recordingWebHook.send(testWebHookUrl(), json);
+
+    QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    QCOMPARE(delivered, true);
+    QCOMPARE(recordingManager.requests.size(), 1);
+
+    const QNetworkRequest& request = recordingManager.requests.first();
+    QCOMPARE(request.url(), testWebHookUrl());
+    QCOMPARE(request.attribute(QNetworkRequest::Attribute::Http2AllowedAttribute).toBool(), http2Enabled);
+    QCOMPARE(request.rawHeader("Connection"), connectionHeader);
+
+    // Sending does not reapply the settings changed above.
+    QCOMPARE(recordingManager.redirectPolicy(), QNetworkRequest::RedirectPolicy::ManualRedirectPolicy);
+    QCOMPARE(recordingManager.isStrictTransportSecurityEnabled(), true);
+}
+
+
+void TestWebHook::cleanupTestCase() {
+    server->stop();
+}
+
+
+QUrl TestWebHook::testWebHookUrl() const {
+    return server->url(QString("/v2/test"));
+}
@@ -27,9 +27,12 @@
 #include <QtTest/QtTest>
 #include <QJsonDocument>
 #include <QByteArray>
+#include <QHash>
 #include <QNetworkReply>
 
 class QNetworkAccessManager;
+class QUrl;
+class StandInServer;
 class QSettings;
 class QEventLoop;
 class QJsonDocument;
@@ -56,21 +59,44 @@ class TestWebHook:public QObject {
 
         void failedToSend(int networkError);
 
+        void messageDelivered(unsigned long long messageId, const QByteArray& rawData);
+
+        void messageFailed(unsigned long long messageId, int networkError);
+
     private slots:
         void initTestCase();
 
         void testTimeDelta();
+        void testTimeDeltaUpdatedScope();
         void testMessage();
         void testMessageWithDelta();
+        void testConcurrentMessages();
+        void testBadSignature();
+        void testServerClockSkew();
+        void testInjectedErrors();
+        void testBatching();
+        void testPriorities();
+        void testFlowControl();
+        void testCircuitBreaker();
+        void testSpool();
+        void testDeduplication();
+        void testFanOut();
+        void testEnvelopeNegotiation();
+        void testCompression_data();
+        void testCompression();
+        void testWarmUp();
+        void testConnectionSettings_data();
+        void testConnectionSettings();
 
         void cleanupTestCase();
 
     private:
-        static const QByteArray timeStampSecret;
-        static const QString    timeStampWebHookUrl;
+        QUrl testWebHookUrl() const;
 
+        static const QByteArray timeStampSecret;
         static const QByteArray testSecret;
-        static const QString    testWebHookUrl;
+
+        StandInServer*          server;
 
         QNetworkAccessManager*  networkAccessManager;
         Wh::WebHook*            webHook;
@@ -84,6 +110,11 @@ class TestWebHook:public QObject {
         bool                    receivedJsonData;
         bool                    receivedRawData;
         bool                    timeDeltaWasUpdated;
+
+        QList<unsigned long long> deliveredMessages;
+        QList<unsigned long long> failedMessages;
+        QHash<unsigned long long, QByteArray> deliveredResults;
+        int                       expectedMessages;
 };
 
 #endif
@@ -0,0 +1,312 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements tests for the \ref Wh::WebHookVerifier class.
+***********************************************************************************************************************/
+
+#include <QDebug>
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QDateTime>
+#include <QCborValue>
+#include <QCborMap>
+
+#include <crypto_hmac.h>
+
+#include <wh_signing_key_cache.h>
+#include <wh_envelope_writer.h>
+#include <wh_web_hook_verifier.h>
+
+#include "test_web_hook_verifier.h"
+
+const QByteArray TestWebHookVerifier::secret("0123456789ABCDEF0123456789ABCDEF");
+const QByteArray TestWebHookVerifier::timestampSecret("FEDCBA9876543210FEDCBA9876543210");
+
+TestWebHookVerifier::TestWebHookVerifier() {}
+
+
+TestWebHookVerifier::~TestWebHookVerifier() {}
+
+
+void TestWebHookVerifier::initTestCase() {}
+
+
+void TestWebHookVerifier::testValid() {
+    Wh::WebHookVerifier verifier(secret);
+    QByteArray          payload("{\"event\":\"test\"}");
+    long long           minute = Wh::SigningKeyCache::currentMinute(0);
+
+    Wh::WebHookVerifier::Result result = verifier.verify(envelope(payload, minute));
+    QCOMPARE(result.status(), Wh::WebHookVerifier::Status::VALID);
+    QCOMPARE(result.isValid(), true);
+    QCOMPARE(result.payload(), payload);
+
+    // Envelopes with a different layout go through the general JSON decoder.
+    QByteArray hash      = Wh::SigningKeyCache().sign(secret, minute, payload);
+    QByteArray reordered = (
+          "{ \"hash\" : \"" + hash.toBase64() + "\",\n"
+        + "  \"data\" : \"" + payload.toBase64() + "\" }"
+    );
+
+    result = verifier.verify(reordered);
+    QCOMPARE(result.status(), Wh::WebHookVerifier::Status::VALID);
+    QCOMPARE(result.payload(), payload);
+
+    // Additional keys between the data and the hash still match the writer's prefix and suffix.
+    QByteArray extraKeys = (
+          "{\"data\":\"" + payload.toBase64() + "\",\"version\":1,\"note\":\"x\","
+        + "\"hash\":\"" + hash.toBase64() + "\"}"
+    );
+
+    result = verifier.verify(extraKeys);
+    QCOMPARE(result.status(), Wh::WebHookVerifier::Status::VALID);
+    QCOMPARE(result.payload(), payload);
+}
+
+
+void TestWebHookVerifier::testAdjacentMinutes() {
+    Wh::WebHookVerifier verifier(secret);
+    QByteArray          payload("{\"event\":\"skew\"}");
+    long long           minute = Wh::SigningKeyCache::currentMinute(0);
+
+    QCOMPARE(verifier.verify(envelope(payload, minute - 1)).status(), Wh::WebHookVerifier::Status::VALID);
+    QCOMPARE(verifier.verify(envelope(payload, minute + 1)).status(), Wh::WebHookVerifier::Status::VALID);
+    QCOMPARE(verifier.verify(envelope(payload, minute - 5)).status(), Wh::WebHookVerifier::Status::BAD_SIGNATURE);
+    QCOMPARE(verifier.verify(envelope(payload, minute + 5)).status(), Wh::WebHookVerifier::Status::BAD_SIGNATURE);
+
+    // Moving the verifier clock moves the accepted minutes.
+    verifier.setTimeDelta(5 * 60000);
+    QCOMPARE(verifier.timeDelta(), 5 * 60000LL);
+    QCOMPARE(verifier.verify(envelope(payload, minute + 5)).status(), Wh::WebHookVerifier::Status::VALID);
+    QCOMPARE(verifier.verify(envelope(payload, minute - 5)).status(), Wh::WebHookVerifier::Status::BAD_SIGNATURE);
+}
+
+
+void TestWebHookVerifier::testBadSignature() {
+    Wh::WebHookVerifier verifier(secret);
+    long long           minute = Wh::SigningKeyCache::currentMinute(0);
+
+    QByteArray payload("{\"amount\":100}");
+    QByteArray hash = Wh::SigningKeyCache().sign(secret, minute, payload);
+
+    QByteArray tampered = Wh::EnvelopeWriter::write(QByteArray("{\"amount\":900}"), hash);
+    QCOMPARE(verifier.verify(tampered).status(), Wh::WebHookVerifier::Status::BAD_SIGNATURE);
+    QCOMPARE(verifier.verify(tampered).payload().isEmpty(), true);
+
+    Wh::WebHookVerifier other(QByteArray("another secret"));
+    QCOMPARE(other.verify(envelope(payload, minute)).status(), Wh::WebHookVerifier::Status::BAD_SIGNATURE);
+
+    QByteArray truncated = Wh::EnvelopeWriter::write(payload, hash.left(16));
+    QCOMPARE(verifier.verify(truncated).status(), Wh::WebHookVerifier::Status::BAD_SIGNATURE);
+}
+
+
+void TestWebHookVerifier::testMalformed() {
+    Wh::WebHookVerifier verifier(secret);
+
+    QCOMPARE(verifier.verify(QByteArray()).status(), Wh::WebHookVerifier::Status::MALFORMED);
+    QCOMPARE(verifier.verify(QByteArray("not json")).status(), Wh::WebHookVerifier::Status::MALFORMED);
+    QCOMPARE(verifier.verify(QByteArray("{\"data\":\"QUJD\"}")).status(), Wh::WebHookVerifier::Status::MALFORMED);
+    QCOMPARE(
+        verifier.verify(QByteArray("{\"data\":\"Q!JD\",\"hash\":\"QUJD\"}")).status(),
+        Wh::WebHookVerifier::Status::MALFORMED
+    );
+    QCOMPARE(
+        verifier.verify(QByteArray("{\"data\":1,\"hash\":\"QUJD\"}")).status(),
+        Wh::WebHookVerifier::Status::MALFORMED
+    );
+    QCOMPARE(
+        verifier.verify(QByteArray("\xFF\xFF", 2), QString("application/cbor")).status(),
+        Wh::WebHookVerifier::Status::MALFORMED
+    );
+}
+
+
+void TestWebHookVerifier::testCbor() {
+    Wh::WebHookVerifier verifier(secret);
+    QByteArray          payload("{\"format\":\"cbor\"}");
+    long long           minute = Wh::SigningKeyCache::currentMinute(0);
+    QByteArray          hash   = Wh::SigningKeyCache().sign(secret, minute, payload);
+
+    Wh::WebHookVerifier::Result result = verifier.verify(
+        Wh::EnvelopeWriter::writeCbor(payload, hash),
+        QString("application/cbor")
+    );
+
+    QCOMPARE(result.status(), Wh::WebHookVerifier::Status::VALID);
+    QCOMPARE(result.payload(), payload);
+
+    QCborMap map;
+    map.insert(QString("data"), QString::fromUtf8(payload));
+    map.insert(QString("hash"), hash);
+
+    QCOMPARE(
+        verifier.verify(QCborValue(map).toCbor(), QString("application/cbor")).status(),
+        Wh::WebHookVerifier::Status::MALFORMED
+    );
+}
+
+
+void TestWebHookVerifier::testReplay() {
+    Wh::WebHookVerifier verifier(secret);
+    long long           minute = Wh::SigningKeyCache::currentMinute(0);
+    QByteArray          first  = envelope(QByteArray("{\"id\":1}"), minute);
+    QByteArray          second = envelope(QByteArray("{\"id\":2}"), minute);
+
+    QCOMPARE(verifier.replayProtectionEnabled(), false);
+    QCOMPARE(verifier.verify(first).status(), Wh::WebHookVerifier::Status::VALID);
+    QCOMPARE(verifier.verify(first).status(), Wh::WebHookVerifier::Status::VALID);
+
+    verifier.setReplayProtectionEnabled();
+    QCOMPARE(verifier.replayProtectionEnabled(), true);
+
+    QCOMPARE(verifier.verify(first).status(), Wh::WebHookVerifier::Status::VALID);
+    QCOMPARE(verifier.verify(second).status(), Wh::WebHookVerifier::Status::VALID);
+
+    Wh::WebHookVerifier::Result replayed = verifier.verify(first);
+    QCOMPARE(replayed.status(), Wh::WebHookVerifier::Status::REPLAYED);
+    QCOMPARE(replayed.isValid(), false);
+    QCOMPARE(replayed.payload().isEmpty(), true);
+
+    // The same envelope signed in a different minute carries a different signature.
+    QCOMPARE(
+        verifier.verify(envelope(QByteArray("{\"id\":1}"), minute - 1)).status(),
+        Wh::WebHookVerifier::Status::VALID
+    );
+
+    verifier.setReplayProtectionEnabled(false);
+    verifier.setReplayProtectionEnabled(true);
+    QCOMPARE(verifier.verify(first).status(), Wh::WebHookVerifier::Status::VALID);
+}
+
+
+void TestWebHookVerifier::testBatch() {
+    Wh::WebHookVerifier verifier(secret);
+    long long           minute = Wh::SigningKeyCache::currentMinute(0);
+    unsigned            count  = 10 * Wh::WebHookVerifier::minimumBatchPerThread + 7;
+
+    QVector<Wh::WebHookVerifier::Envelope> envelopes;
+    for (unsigned i=0 ; i<count ; ++i) {
+        QByteArray payload = QString("{\"id\":%1}").arg(i).toUtf8();
+
+        if (i % 10 == 3) {
+            envelopes.append(Wh::WebHookVerifier::Envelope(envelope(payload, minute - 7)));
+        } else if (i % 10 == 7) {
+            QByteArray hash = Wh::SigningKeyCache().sign(secret, minute, payload);
+            envelopes.append(
+                Wh::WebHookVerifier::Envelope(Wh::EnvelopeWriter::writeCbor(payload, hash), QString("application/cbor"))
+            );
+        } else {
+            envelopes.append(Wh::WebHookVerifier::Envelope(envelope(payload, minute)));
+        }
+    }
+
+    // Repeat an envelope so replay protection sees it twice within one batch.
+    envelopes.append(envelopes.at(0));
+    verifier.setReplayProtectionEnabled();
+
+    for (unsigned threads : { 1U, 4U, 0U }) {
+        verifier.setMaximumThreads(threads);
+        QVERIFY(verifier.maximumThreads() > 0);
+
+        QVector<Wh::WebHookVerifier::Result> results = verifier.verify(envelopes);
+        QCOMPARE(static_cast<unsigned>(results.size()), count + 1);
+
+        for (unsigned i=0 ; i<count ; ++i) {
+            QByteArray payload = QString("{\"id\":%1}").arg(i).toUtf8();
+
+            if (i % 10 == 3) {
+                QCOMPARE(results.at(i).status(), Wh::WebHookVerifier::Status::BAD_SIGNATURE);
+            } else if (threads == 1) {
+                QCOMPARE(results.at(i).status(), Wh::WebHookVerifier::Status::VALID);
+                QCOMPARE(results.at(i).payload(), payload);
+            } else {
+                // Later passes see every signature a second time.
+                QCOMPARE(results.at(i).status(), Wh::WebHookVerifier::Status::REPLAYED);
+            }
+        }
+
+        QCOMPARE(results.last().status(), Wh::WebHookVerifier::Status::REPLAYED);
+    }
+
+    QCOMPARE(verifier.verify(QVector<Wh::WebHookVerifier::Envelope>()).isEmpty(), true);
+}
+
+
+void TestWebHookVerifier::testTimestamp() {
+    Wh::WebHookVerifier verifier(secret, timestampSecret);
+
+    long long  clientTime = QDateTime::currentMSecsSinceEpoch() - 3000;
+    QByteArray data       = QByteArray::number(clientTime);
+
+    Crypto::Hmac hmac(timestampSecret);
+    hmac.addData(data);
+    QByteArray hash = hmac.digest();
+
+    Wh::WebHookVerifier::Result result = verifier.verifyTimestamp(Wh::EnvelopeWriter::write(data, hash));
+    QCOMPARE(result.status(), Wh::WebHookVerifier::Status::VALID);
+    QCOMPARE(result.payload(), data);
+
+    long long offset = verifier.clockOffset(result);
+    QVERIFY(offset >= 3000 && offset < 13000);
+
+    verifier.setTimeDelta(-60000);
+    offset = verifier.clockOffset(result);
+    QVERIFY(offset >= -57000 && offset < -47000);
+
+    QCOMPARE(
+        verifier.verifyTimestamp(Wh::EnvelopeWriter::write(QByteArray::number(clientTime + 1), hash)).status(),
+        Wh::WebHookVerifier::Status::BAD_SIGNATURE
+    );
+
+    Crypto::Hmac textHmac(timestampSecret);
+    textHmac.addData(QByteArray("not a time"));
+    QCOMPARE(
+        verifier.verifyTimestamp(Wh::EnvelopeWriter::write(QByteArray("not a time"), textHmac.digest())).status(),
+        Wh::WebHookVerifier::Status::MALFORMED
+    );
+
+    // Message keys are derived per minute so a message envelope is never a valid timestamp request.
+    QCOMPARE(
+        verifier.verifyTimestamp(envelope(data, Wh::SigningKeyCache::currentMinute(0))).status(),
+        Wh::WebHookVerifier::Status::BAD_SIGNATURE
+    );
+
+    Wh::WebHookVerifier noSecret(secret);
+    QCOMPARE(
+        noSecret.verifyTimestamp(Wh::EnvelopeWriter::write(data, hash)).status(),
+        Wh::WebHookVerifier::Status::BAD_SIGNATURE
+    );
+    QCOMPARE(noSecret.clockOffset(Wh::WebHookVerifier::Result()), 0LL);
+}
+
+
+void TestWebHookVerifier::cleanupTestCase() {}
+
+
+QByteArray TestWebHookVerifier::envelope(const QByteArray& payload, long long minute) {
+    // Derive the key from scratch so the verifier is checked against an independent signer.
+    Crypto::Hmac hmac(Wh::SigningKeyCache::deriveKey(secret, minute));
+    hmac.addData(payload);
+
+    return Wh::EnvelopeWriter::write(payload, hmac.digest());
+}
@@ -0,0 +1,60 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header provides tests for the \ref Wh::WebHookVerifier class.
+***********************************************************************************************************************/
+
+#ifndef TEST_WEB_HOOK_VERIFIER_H
+#define TEST_WEB_HOOK_VERIFIER_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class QByteArray;
+
+class TestWebHookVerifier:public QObject {
+    Q_OBJECT
+
+    public:
+        TestWebHookVerifier();
+
+        ~TestWebHookVerifier() override;
+
+    private slots:
+        void initTestCase();
+
+        void testValid();
+        void testAdjacentMinutes();
+        void testBadSignature();
+        void testMalformed();
+        void testCbor();
+        void testReplay();
+        void testBatch();
+        void testTimestamp();
+
+        void cleanupTestCase();
+
+    private:
+        static const QByteArray secret;
+        static const QByteArray timestampSecret;
+
+        static QByteArray envelope(const QByteArray& payload, long long minute);
+};
+
+#endif